@@ -0,0 +1,100 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "mos6502/status.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MOS6502_X86_ALU 1
+#else
+#define MOS6502_X86_ALU 0
+#endif
+
+namespace mos6502
+{
+/// N and Z flags of a result, indexed by the result
+inline constexpr std::array<std::uint8_t, 256> kNZFlags = [] {
+    std::array<std::uint8_t, 256> flags{};
+    for (std::size_t value = 0U; value < flags.size(); ++value) {
+        flags[value] = static_cast<std::uint8_t>((value == 0U ? Z : 0U) | (value & N));
+    }
+    return flags;
+}();
+
+/// Result of an arithmetic operation with its carry and overflow
+struct AluResult final {
+    std::uint8_t value;
+    bool carry;
+    bool overflow;
+};
+
+/// Arithmetic computing carry and overflow from the operands, builds on any host
+struct PortableAlu final {
+    /// a + b + carry
+    static constexpr AluResult add(std::uint8_t const a, std::uint8_t const b, bool const carry) {
+        unsigned const sum = a + b + (carry ? 1U : 0U);
+        auto const value = static_cast<std::uint8_t>(sum);
+        return {value, sum > 0xFFU, ((a ^ value) & (b ^ value) & 0x80U) != 0U};
+    }
+
+    /// a - b - !carry, carry is set when there is no borrow
+    static constexpr AluResult subtract(std::uint8_t const a, std::uint8_t const b, bool const carry) {
+        return add(a, static_cast<std::uint8_t>(~b), carry);
+    }
+
+    /// a - b, carry is set when a >= b
+    static constexpr AluResult compare(std::uint8_t const a, std::uint8_t const b) {
+        return {static_cast<std::uint8_t>(a - b), a >= b, false};
+    }
+};
+
+#if MOS6502_X86_ALU
+/// Arithmetic reading carry and overflow from the flags of the host instructions
+struct X86Alu final {
+    /// a + b + carry
+    static AluResult add(std::uint8_t a, std::uint8_t const b, bool const carry) {
+        bool carry_out{};
+        bool overflow{};
+        __asm__("btl $0, %k[carry]\n\t"
+                "adcb %[b], %[a]\n\t"
+                "setc %[carry_out]\n\t"
+                "seto %[overflow]"
+                : [a] "+q" (a), [carry_out] "=q" (carry_out), [overflow] "=q" (overflow)
+                : [b] "q" (b), [carry] "r" (static_cast<unsigned>(carry))
+                : "cc");
+        return {a, carry_out, overflow};
+    }
+
+    /// a - b - !carry, carry is set when there is no borrow
+    static AluResult subtract(std::uint8_t a, std::uint8_t const b, bool const carry) {
+        bool carry_out{};
+        bool overflow{};
+        // Borrow when carry unset
+        __asm__("btl $0, %k[carry]\n\t"
+                "cmc\n\t"
+                "sbbb %[b], %[a]\n\t"
+                "setnc %[carry_out]\n\t"
+                "seto %[overflow]"
+                : [a] "+q" (a), [carry_out] "=q" (carry_out), [overflow] "=q" (overflow)
+                : [b] "q" (b), [carry] "r" (static_cast<unsigned>(carry))
+                : "cc");
+        return {a, carry_out, overflow};
+    }
+
+    /// a - b, carry is set when a >= b
+    static AluResult compare(std::uint8_t const a, std::uint8_t const b) {
+        bool carry_out{};
+        __asm__("cmpb %[b], %[a]\n\t"
+                "setnc %[carry_out]"
+                : [carry_out] "=q" (carry_out)
+                : [a] "q" (a), [b] "q" (b)
+                : "cc");
+        return {static_cast<std::uint8_t>(a - b), carry_out, false};
+    }
+};
+#else
+/// Host without x86 flags, same as PortableAlu
+using X86Alu = PortableAlu;
+#endif
+}
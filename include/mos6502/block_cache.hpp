@@ -0,0 +1,103 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mos6502
+{
+/// Cache of decoded basic blocks keyed by the address of their first instruction
+///
+/// A block is a straight-line run of instructions ending at the first branch or jump. Blocks
+/// never span more than one page, so a write to a page invalidates every block decoded from it
+/// by bumping the page generation.
+/// @tparam Handler pre-resolved handler of a decoded instruction
+template<class Handler>
+class BlockCache final {
+public:
+    static constexpr std::size_t kMaxInstructions{16U};
+    static constexpr std::size_t kBlockCount{1024U};
+
+    /// Instruction with its opcode resolved to a handler and its operand bytes already fetched
+    struct Instruction final {
+        Handler handler;
+        std::uint16_t operand;
+        std::uint8_t opcode;
+    };
+
+    struct Block final {
+        std::array<Instruction, kMaxInstructions> instructions;
+        std::uint32_t generation;
+        std::uint16_t pc;
+        std::uint8_t length;
+        std::uint8_t page;
+    };
+
+    BlockCache() : m_blocks{std::make_unique<std::array<Block, kBlockCount>>()} {
+        invalidate();
+    }
+
+    /// Retrieve the block starting at pc, or null if it was not decoded or it is stale
+    Block const* find(std::uint16_t const pc) const {
+        Block const& block = (*m_blocks)[pc % kBlockCount];
+        if (block.pc == pc && block.length != 0U && block.generation == m_generations[block.page]) {
+            return &block;
+        }
+        return nullptr;
+    }
+
+    /// Retrieve the slot of the block starting at pc to be filled by the decoder
+    /// @note The block becomes valid once commit is called
+    Block& slot(std::uint16_t const pc) {
+        Block& block = (*m_blocks)[pc % kBlockCount];
+        block.pc = pc;
+        block.length = 0U;
+        block.page = static_cast<std::uint8_t>(pc >> 8);
+        return block;
+    }
+
+    /// Validate a decoded block and watch its page for writes
+    void commit(Block& block) {
+        block.generation = m_generations[block.page];
+        m_code_pages[block.page] = true;
+    }
+
+    /// Check whether the block is still valid after executing some of its instructions
+    bool is_current(Block const& block) const {
+        return block.generation == m_generations[block.page];
+    }
+
+    /// Retrieve the generation of a page, it changes whenever a block decoded from the page becomes stale
+    std::uint32_t const* generation(std::uint8_t const page) const {
+        return &m_generations[page];
+    }
+
+    /// Invalidate the blocks decoded from the page written
+    void on_write(std::uint16_t const addr) {
+        std::uint8_t const page = static_cast<std::uint8_t>(addr >> 8);
+        if (m_code_pages[page]) {
+            invalidate_page(page);
+        }
+    }
+
+    /// Invalidate the blocks decoded from a page
+    void invalidate_page(std::uint8_t const page) {
+        m_code_pages[page] = false;
+        ++m_generations[page];
+    }
+
+    /// Invalidate every block
+    void invalidate() {
+        for (std::size_t page = 0U; page < m_generations.size(); ++page) {
+            invalidate_page(static_cast<std::uint8_t>(page));
+        }
+    }
+
+private:
+    std::unique_ptr<std::array<Block, kBlockCount>> m_blocks;
+
+    std::array<std::uint32_t, 0x100> m_generations{};
+
+    std::array<bool, 0x100> m_code_pages{};
+};
+}
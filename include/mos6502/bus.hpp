@@ -1,4 +1,5 @@
 #pragma once
+#include <concepts>
 #include <cstdint>
 
 namespace mos6502
@@ -13,4 +14,13 @@ struct IBus {
     /// Write to address
     virtual void write(std::uint16_t addr, std::uint8_t data) = 0;
 };
+
+/// Bus capable of reading a little endian word in a single access
+///
+/// Intended for contiguous memory, where both bytes can be loaded at once.
+/// fetch16(addr) must return the same value as read(addr) | (read(addr + 1) << 8).
+template<class Bus>
+concept Fetch16Bus = requires(Bus& bus, std::uint16_t addr) {
+    { bus.fetch16(addr) } -> std::convertible_to<std::uint16_t>;
+};
 }
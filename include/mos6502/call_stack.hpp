@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "mos6502/symbols.hpp"
+
+namespace mos6502
+{
+/// Track the subroutines and interrupt handlers of the guest program (see CallStack)
+/// @note Native translation (JitDispatch) is disabled, it falls back to BlockCacheDispatch
+struct CallStackTracking {};
+
+/// Cycles spent in a routine of the guest program
+struct RoutineCycles final {
+    std::uint16_t routine;
+    std::uint64_t calls;
+    /// Cycles from entry to return, including the routines it called, recursion counted once
+    std::uint64_t inclusive;
+    /// Cycles spent in the routine itself
+    std::uint64_t exclusive;
+
+    bool operator==(RoutineCycles const&) const = default;
+};
+
+/// Shadow call stack of a Cpu configured with CallStackTracking
+///
+/// JSR, BRK and interrupts push a frame for the routine entered, RTS and RTI pop it. Frames are
+/// matched by stack pointer rather than counted: a return pops the frames whose return address
+/// is no longer on the stack, so the RTS jump trick, handlers returning with RTS and code
+/// resetting the stack with TXS keep the shadow stack consistent.
+///
+/// The clock is the sum of the cycles of the instructions executed since the Cpu was created. The
+/// cycles of JSR count for the caller, those of RTS, RTI and of entering an interrupt for the
+/// routine. Time outside of any routine counts for the root, named "[top]" in folded stacks.
+class CallStack final {
+public:
+    CallStack();
+
+    /// Advance the clock by an instruction
+    void tick(std::uint8_t const cycles) {
+        m_now += cycles;
+    }
+
+    /// Enter a routine
+    /// @param routine address of its first instruction
+    /// @param return_sp low byte of the stack pointer once the routine returns
+    void enter(std::uint16_t routine, std::uint8_t return_sp);
+
+    /// Return from the routines whose return address is above the stack pointer
+    /// @param sp low byte of the stack pointer after RTS or RTI
+    void leave(std::uint8_t sp);
+
+    /// Cycles counted by the clock
+    std::uint64_t now() const {
+        return m_now;
+    }
+
+    /// Routines entered and not returned yet, outermost first
+    std::vector<std::uint16_t> frames() const;
+
+    /// Cycles of every routine entered, most inclusive cycles first
+    /// @note Routines still running count up to now()
+    std::vector<RoutineCycles> routines() const;
+
+    /// Clear the totals and the frames, the clock keeps running
+    void reset();
+
+    /// Write a table of the routines, most inclusive cycles first
+    /// @param limit largest number of routines listed
+    void write_report(std::ostream& out, SymbolTable const& symbols, std::size_t limit = 50U) const;
+
+    /// Write the cycles of every call path as folded stacks ("outer;inner cycles" lines) for flame
+    /// graph tools
+    void write_folded(std::ostream& out, SymbolTable const& symbols) const;
+
+private:
+    struct Frame final {
+        std::uint16_t routine;
+        std::uint8_t return_sp;
+        std::uint32_t node;
+        std::uint64_t start;
+        std::uint64_t children;
+    };
+
+    struct Totals final {
+        std::uint64_t calls;
+        std::uint64_t inclusive;
+        std::uint64_t exclusive;
+        /// Frames of the routine on the stack, to count recursion once
+        std::uint32_t active;
+    };
+
+    /// Call path from the root, the tree of every path seen
+    struct Node final {
+        std::uint32_t parent;
+        std::uint16_t routine;
+        std::uint64_t cycles;
+    };
+
+    std::uint64_t m_now{};
+
+    /// Clock when the cycles of the innermost frame were last attributed
+    std::uint64_t m_mark{};
+
+    std::vector<Frame> m_frames{};
+
+    std::unordered_map<std::uint16_t, Totals> m_totals{};
+
+    /// Root first
+    std::vector<Node> m_nodes{};
+
+    /// Child node by parent node and routine
+    std::unordered_map<std::uint64_t, std::uint32_t> m_children{};
+
+    /// Attribute the cycles since the last change of the stack to the innermost path
+    void attribute();
+
+    void pop();
+
+    std::uint32_t child(std::uint32_t parent, std::uint16_t routine);
+
+    static void close(std::unordered_map<std::uint16_t, Totals>& totals, Frame const& frame, Frame* parent,
+                      std::uint64_t now);
+};
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
 
+#include "mos6502/timeline.hpp"
+
 namespace mos6502
 {
 
@@ -27,7 +29,15 @@ public:
         std::uint64_t const frame_rate_fraction,
         SyncPrecision const sync_precision = SyncPrecision::Low);
 
-    void elapse(std::uint8_t ticks);
+    void elapse(std::uint64_t ticks);
+
+    /// Record the busy and idle span of every frame into a timeline, or stop with null
+    inline void set_timeline(TimelineTracer* timeline) {
+        m_timeline = timeline;
+    }
+
+    /// Monotonic time in nanoseconds, the clock of the frame timestamps
+    static std::uint64_t now();
 
     inline std::uint64_t frame_count() const {
         return m_frame_count;
@@ -70,6 +80,8 @@ private:
     std::uint64_t m_busy_period;
     std::uint64_t m_idle_period;
     std::uint64_t m_total_ticks;
+
+    TimelineTracer* m_timeline;
 };
 
 }
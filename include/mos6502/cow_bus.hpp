@@ -0,0 +1,158 @@
+#pragma once
+#include <array>
+#include <bitset>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "mos6502/bus.hpp"
+#include "mos6502/paged_bus.hpp"
+#include "mos6502/snapshot.hpp"
+
+namespace mos6502
+{
+/// Bus that can be forked into an independent bus with the same contents
+template<class Bus>
+concept ForkableBus = requires(Bus& bus) {
+    { bus.fork() } -> std::same_as<Bus>;
+};
+
+/// Paged bus whose RAM is copied on write, so forking it is cheap
+///
+/// RAM pages are immutable and shared between a bus and its forks, the first write to a page
+/// copies it into a dirty page owned by the bus that wrote it. Forking copies the page tables
+/// (6KiB) and shares every page, no matter how much memory is mapped.
+///
+/// Every copy of a page is counted on its own and freed once no bus maps it anymore, so a bus
+/// forked every frame only keeps the pages its live forks still read.
+/// A fork can run on another thread than its parent, forking itself modifies the parent.
+class CowBus final : public IBus {
+public:
+    static constexpr std::size_t kPageSize{PagedBus::kPageSize};
+    static constexpr std::size_t kPageCount{PagedBus::kPageCount};
+
+    using Page = std::array<std::uint8_t, kPageSize>;
+
+    /// Constructor
+    /// @param fallback bus serving the pages without memory, reads from them return 0xFF when null
+    /// @note Every page starts mapped to RAM cleared to zero, taking no memory until written
+    explicit CowBus(std::shared_ptr<IBus> fallback = {});
+
+    CowBus(CowBus const&) = delete;
+    CowBus& operator=(CowBus const&) = delete;
+
+    CowBus(CowBus&&) noexcept;
+    CowBus& operator=(CowBus&&) noexcept;
+
+    ~CowBus() override;
+
+    std::uint8_t read(std::uint16_t addr) override {
+        std::uint8_t const* page = m_read_pages[addr >> 8];
+        if (page != nullptr) {
+            return page[addr & 0xFF];
+        }
+        return fallback_read(addr);
+    }
+
+    void write(std::uint16_t addr, std::uint8_t data) override {
+        std::uint8_t* page = m_write_pages[addr >> 8];
+        if (page == nullptr) {
+            page = copy_page(static_cast<std::uint8_t>(addr >> 8));
+        }
+        if (page != nullptr) {
+            page[addr & 0xFF] = data;
+        } else {
+            fallback_write(addr, data);
+        }
+    }
+
+    /// Read little endian word (see Fetch16Bus)
+    std::uint16_t fetch16(std::uint16_t addr) {
+        std::uint8_t const* page = m_read_pages[addr >> 8];
+        if (page != nullptr && (addr & 0xFF) != 0xFF) {
+            return static_cast<std::uint16_t>(page[addr & 0xFF] | (page[(addr & 0xFF) + 1U] << 8));
+        }
+        std::uint8_t const lo = read(addr);
+        std::uint8_t const hi = read(static_cast<std::uint16_t>(addr + 1U));
+        return static_cast<std::uint16_t>(lo | (hi << 8));
+    }
+
+    /// Retrieve the memory of a readable page, or null if it is served by the fallback
+    std::uint8_t const* read_page(std::uint8_t page) const {
+        return m_read_pages[page];
+    }
+
+    /// Retrieve the memory of a dirty page, or null if writes must go through write
+    std::uint8_t* write_page(std::uint8_t page) const {
+        return m_write_pages[page];
+    }
+
+    /// Map pages to RAM cleared to zero
+    void map_ram(std::uint8_t first_page, std::size_t count);
+
+    /// Map pages to read only memory, writes to them are forwarded to the fallback
+    /// @param memory storage of count * kPageSize bytes that outlives the bus and its forks
+    void map_rom(std::uint8_t first_page, std::size_t count, std::uint8_t const* memory);
+
+    /// Map pages to the fallback bus
+    void map_io(std::uint8_t first_page, std::size_t count);
+
+    /// Create a bus with the same memory map and contents sharing every page with this one
+    /// @note The fallback is shared as well, devices with state must be forked by the caller
+    CowBus fork();
+
+    /// Number of pages this bus copied since it was created or last forked
+    std::size_t dirty_pages() const {
+        return m_dirty;
+    }
+
+    /// Number of page copies alive in every CowBus of the process
+    static std::size_t live_pages();
+
+    /// Bytes taken in a snapshot when every page is RAM
+    static constexpr std::size_t kSnapshotSize{PagedBus::kSnapshotSize};
+
+    /// Save the contents of the RAM pages (see SnapshotableBus), in the same format as PagedBus
+    void save(SnapshotWriter& writer) const;
+
+    /// Restore the contents of the RAM pages
+    /// @throw std::invalid_argument when the pages mapped to RAM differ from the ones saved
+    void restore(SnapshotReader& reader);
+
+private:
+    /// Copy of a RAM page, shared by the buses mapping it
+    struct PageCopy;
+
+    std::shared_ptr<IBus> m_fallback;
+    std::array<std::uint8_t const*, kPageCount> m_read_pages{};
+    std::array<std::uint8_t*, kPageCount> m_write_pages{};
+    std::bitset<kPageCount> m_ram{};
+    /// Owners of the pages read from copies, null for untouched RAM, ROM and I/O
+    std::array<std::shared_ptr<PageCopy>, kPageCount> m_copies{};
+    std::size_t m_dirty{};
+
+    /// Constructor of a fork, sharing the pages of the parent
+    explicit CowBus(CowBus const* parent);
+
+    /// Copy a RAM page into a dirty page of this bus
+    /// @return the dirty page, or null when the page is not RAM
+    std::uint8_t* copy_page(std::uint8_t page);
+
+    /// Stop mapping a page to its copy, before mapping it to something else
+    void release(std::size_t page);
+
+    std::uint8_t fallback_read(std::uint16_t addr);
+
+    void fallback_write(std::uint16_t addr, std::uint8_t data);
+};
+
+/// Copying a page moves it, native code can not keep pointers to the memory of a CowBus
+template<>
+inline constexpr bool kStablePages<CowBus> = false;
+
+static_assert(PageMappedBus<CowBus>);
+static_assert(Fetch16Bus<CowBus>);
+static_assert(SnapshotableBus<CowBus>);
+static_assert(ForkableBus<CowBus>);
+}
@@ -1,25 +1,45 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <memory>
-
+#include <stdexcept>
+#include <type_traits>
+
+#include "mos6502/alu.hpp"
+#include "mos6502/block_cache.hpp"
+#include "mos6502/bus.hpp"
+#include "mos6502/call_stack.hpp"
+#include "mos6502/cow_bus.hpp"
+#include "mos6502/decimal.hpp"
+#include "mos6502/interrupt_lines.hpp"
+#include "mos6502/jit.hpp"
+#include "mos6502/lazy_registers.hpp"
+#include "mos6502/opcodes.hpp"
+#include "mos6502/paged_bus.hpp"
 #include "mos6502/regs.hpp"
+#include "mos6502/snapshot.hpp"
 #include "mos6502/status.hpp"
+#include "mos6502/timeline.hpp"
+#include "mos6502/trace.hpp"
+#include "mos6502/traits.hpp"
 
 namespace mos6502
 {
-struct IBus;
 struct Registers;
 
 #if defined(__GNUC__) || defined(__clang__)
 #define FORCEINLINE __attribute__((always_inline))
+#define MOS6502_COMPUTED_GOTO 1
 #elif defined(_MSC_VER)
 #define FORCEINLINE __forceinline
+#define MOS6502_COMPUTED_GOTO 0
 #else
 static_assert(false, "");
 #endif
 
 /// Mos Technology 6502 Microprocessor
 /// @tparam Bus The concrete class that implements the bus interface for compile time polymorphism
+/// @tparam Traits Compile time configuration (see CpuTraits)
 ///
 /// The bus interface is composed of a read and a write function on a 16-bits address space.
 /// @code
@@ -28,16 +48,29 @@ static_assert(false, "");
 ///     void write(std::uint16_t addr, std::uint8_t data);
 /// };
 /// @endcode
-template<class Bus>
+///
+/// Optionally the bus may implement fetch16 (see Fetch16Bus) to read absolute operands in a single access.
+template<class Bus, class Traits = CpuTraits>
 class Cpu final {
 public:
+    /// Whether decoded blocks are cached, code changed behind the Cpu must be notified (see invalidate_blocks)
+    static constexpr bool kBlockCache = std::is_same_v<typename Traits::Dispatch, BlockCacheDispatch> ||
+                                        std::is_same_v<typename Traits::Dispatch, JitDispatch>;
+
     /// Constructor
-    /// @param bus the interface to access memory
-    Cpu(std::shared_ptr<Bus> bus) : m_bus{std::move(bus)} {
-        static_cast<void>(m_padding);
-        m_regs.sp = 0x1FF;
-        m_regs.sr = U | B;
-    }
+    /// @param bus the interface to access memory, owned together with the caller
+    Cpu(std::shared_ptr<Bus> bus) : Cpu{*bus, bus} {}
+
+    /// Constructor
+    /// @param bus the interface to access memory, it must outlive the Cpu
+    /// @note Declaring the bus next to the Cpu keeps both in the same cache lines
+    explicit Cpu(Bus& bus) : Cpu{bus, nullptr} {}
+
+    /// Copies run on the same bus
+    Cpu(Cpu const&) = default;
+    Cpu(Cpu&&) noexcept = default;
+    Cpu& operator=(Cpu const&) = default;
+    Cpu& operator=(Cpu&&) noexcept = default;
 
     /// Destructor
     ~Cpu() = default;
@@ -46,962 +79,1538 @@ public:
     /// @return reference to registers
     Registers& regs() { return m_regs; }
 
-    /// Signal maskable interrupt
+    /// Retrieve the bus
+    Bus& bus() { return *m_bus; }
+
+    /// Cycles run since the Cpu was created, updated when a run returns
+    std::uint64_t cycles() const { return m_cycles; }
+
+    /// Retrieve the instruction mix counted (see InstrumentedCpuTraits)
+    InstructionStats& instruction_stats() requires kInstrumented { return m_stats; }
+
+    /// Retrieve the shadow call stack (see CallStackTracking)
+    CallStack& call_stack() requires kTracksCalls { return m_calls; }
+
+    /// Start recording every instruction into a writer, or stop with null (see InstructionTracing)
+    /// @param writer it must outlive the tracing
+    /// @note Only call between runs, records count cycles from cycles()
+    void trace_to(TraceWriter* writer) requires kTraced { m_trace.attach(writer, m_cycles); }
+
+    /// Record the interrupts taken into a timeline, or stop with null
+    void trace_timeline(TimelineTracer* timeline) { m_timeline = timeline; }
+
+    /// Create a Cpu with the same registers, cycle count and interrupt lines running on another bus
+    /// @param bus the interface to access memory, it must outlive the clone
+    Cpu clone(Bus& bus) const {
+        return Cpu{bus, nullptr, *this};
+    }
+
+    /// Create a Cpu with the same registers running on a fork of the bus (see ForkableBus)
+    /// @note With CowBus both share the memory until one of them writes it
+    Cpu clone() requires ForkableBus<Bus> {
+        auto fork = std::make_shared<Bus>(m_bus->fork());
+        Bus& bus = *fork;
+        return Cpu{bus, std::move(fork), *this};
+    }
+
+    /// Drive the IRQ input line, level triggered
+    /// @param asserted whether the device holds the line, it is serviced at every instruction
+    ///        boundary while held and the I flag is clear
+    /// @param source device driving the line (0 to 7), the line is held while any of them holds it
+    /// @note Safe to call from bus callbacks and from other threads while the Cpu runs, the
+    ///       interrupt is taken after the current instruction (see InterruptLines)
+    void set_irq_line(bool const asserted, unsigned const source = 0U) {
+        m_lines.set_irq(asserted, source);
+    }
+
+    /// Drive the NMI input line, edge triggered
+    /// @param asserted whether the device holds the line, asserting it requests a single NMI
+    /// @note Safe to call from bus callbacks and from other threads while the Cpu runs, the
+    ///       interrupt is taken after the current instruction (see InterruptLines)
+    void set_nmi_line(bool const asserted) {
+        m_lines.set_nmi(asserted);
+    }
+
+    /// Signal maskable interrupt, entering the handler right away
+    /// @note Only call between runs from the thread running the Cpu, set_irq_line waits for
+    ///       the instruction to complete and can be called from anywhere
     void signal_irq() {
         if ((m_regs.sr & I) == 0) {
-            request_interrupt(0xFFFE);
+            interrupt(0xFFFE);
         }
     }
 
-    /// Signal non maskable interrupt
+    /// Signal non maskable interrupt, entering the handler right away
     void signal_nmi() {
-        request_interrupt(0xFFFA);
+        interrupt(0xFFFA);
     }
 
     /// Signal reset
     void signal_reset() {
-        std::uint8_t const handler_lo = m_bus->read(0xFFFC);
-        std::uint8_t const handler_hi = m_bus->read(0xFFFD);
+        std::uint8_t const handler_lo = bus_read(0xFFFC);
+        std::uint8_t const handler_hi = bus_read(0xFFFD);
         std::uint16_t const handler = ((handler_hi << 8) | handler_lo) & 0xFFFF;
         m_regs.pc = handler;
     }
 
     /// Step current instruction
+    /// @return number of cycles consumed
     std::uint8_t step() {
-        m_instruction.opcode = m_bus->read(m_regs.pc);
-        m_immediate8 = m_bus->read(m_regs.pc + 1U);
-        m_immediate16 = static_cast<std::uint16_t>(m_bus->read(m_regs.pc + 2U) << 8) + m_immediate8;
-        m_extra_cycles = 0U;
-
-        /// Lookup Table for Instruction Length
-        /// @note BRK (00) instruction length includes mark byte
-        constexpr std::array<std::uint8_t, 256> InstructionLength = {
-        //  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, A, B, C, D, E, F  // (Low/High) Nibble
-            2, 2, 0, 0, 0, 2, 2, 0, 1, 2, 1, 0, 0, 3, 3, 0, // 0
-            2, 2, 0, 0, 0, 2, 2, 0, 1, 3, 0, 0, 0, 3, 3, 0, // 1
-            3, 2, 0, 0, 2, 2, 2, 0, 1, 2, 1, 0, 3, 3, 3, 0, // 2
-            2, 2, 0, 0, 0, 2, 2, 0, 1, 3, 0, 0, 0, 3, 3, 0, // 3
-            1, 2, 0, 0, 0, 2, 2, 0, 1, 2, 1, 0, 3, 3, 3, 0, // 4
-            2, 2, 0, 0, 0, 2, 2, 0, 1, 3, 0, 0, 0, 3, 3, 0, // 5
-            1, 2, 0, 0, 0, 2, 2, 0, 1, 2, 1, 0, 3, 3, 3, 0, // 6
-            2, 2, 0, 0, 0, 2, 2, 0, 1, 3, 0, 0, 0, 3, 3, 0, // 7
-            0, 2, 0, 0, 2, 2, 2, 0, 1, 0, 1, 0, 3, 3, 3, 0, // 8
-            2, 2, 0, 0, 2, 2, 2, 0, 1, 3, 1, 0, 0, 3, 0, 0, // 9
-            2, 2, 2, 0, 2, 2, 2, 0, 1, 2, 1, 0, 3, 3, 3, 0, // A
-            2, 2, 0, 0, 2, 2, 2, 0, 1, 3, 1, 0, 3, 3, 3, 0, // B
-            2, 2, 0, 0, 2, 2, 2, 0, 1, 2, 1, 0, 3, 3, 3, 0, // C
-            2, 2, 0, 0, 0, 2, 2, 0, 1, 3, 0, 0, 0, 3, 3, 0, // D
-            2, 2, 0, 0, 2, 2, 2, 0, 1, 2, 1, 0, 3, 3, 3, 0, // E
-            2, 2, 0, 0, 0, 2, 2, 0, 1, 3, 0, 0, 0, 3, 3, 0, // F
-        };
+        return static_cast<std::uint8_t>(run_cycles(1U));
+    }
+
+    /// Run instructions until the cycle budget is consumed
+    /// @param budget number of cycles to run, the last instruction may overshoot it
+    /// @return number of cycles consumed
+    /// @note At least one instruction is always executed
+    /// @note Registers are kept in locals while running and written back on return,
+    ///       regs() called from within the bus observes the values from before the call
+    std::uint64_t run_cycles(std::uint64_t const budget) {
+        return execute(CycleBudget{budget});
+    }
+
+    /// Run instructions until the predicate holds
+    /// @param predicate called after each instruction as predicate(regs) -> bool
+    /// @return number of cycles consumed
+    /// @note At least one instruction is always executed
+    template<class Predicate>
+    std::uint64_t run_until(Predicate&& predicate) {
+        return execute([&predicate](State const& regs, std::uint64_t) {
+            return static_cast<bool>(predicate(observe(regs)));
+        });
+    }
+
+    /// Bytes taken by the Cpu in a snapshot, a SnapshotableBus appends its own
+    static constexpr std::size_t kSnapshotSize{kSnapshotMagic.size() + 2U + sizeof(Registers) + 2U + 8U};
+
+    /// Save the registers, the interrupt lines, the cycle count and, when the bus is a
+    /// SnapshotableBus, its contents
+    /// @throw std::length_error when the writer runs out of space
+    void save(SnapshotWriter& writer) const {
+        writer.put(kSnapshotMagic);
+        writer.put8(kSnapshotVersion);
+        writer.put8(SnapshotableBus<Bus> ? kSnapshotHasBus : std::uint8_t{0});
+        writer.put8(m_regs.ac);
+        writer.put8(m_regs.xi);
+        writer.put8(m_regs.yi);
+        writer.put8(m_regs.sr);
+        writer.put16(m_regs.sp);
+        writer.put16(m_regs.pc);
+        writer.put16(m_lines.state());
+        writer.put64(m_cycles);
+        if constexpr (SnapshotableBus<Bus>) {
+            static_cast<Bus const&>(*m_bus).save(writer);
+        }
+    }
 
-        /// Lookup Table for Number of Cycles of an Instruction
-        constexpr std::array<std::uint8_t, 256> InstructionCycles = {
-        //  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, A, B, C, D, E, F  // (Low/High) Nibble
-            7, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 0, 4, 6, 0, // 0
-            2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 1
-            6, 6, 0, 0, 3, 3, 5, 0, 4, 2, 2, 0, 4, 4, 6, 0, // 2
-            2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 3
-            6, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 3, 4, 6, 0, // 4
-            2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 5
-            6, 6, 0, 0, 0, 3, 5, 0, 4, 2, 2, 0, 5, 4, 6, 0, // 6
-            2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 7
-            0, 6, 0, 0, 3, 3, 3, 0, 2, 0, 2, 0, 4, 4, 4, 0, // 8
-            2, 6, 0, 0, 4, 4, 4, 0, 2, 5, 2, 0, 0, 5, 0, 0, // 9
-            2, 6, 2, 0, 3, 3, 3, 0, 2, 2, 2, 0, 4, 4, 4, 0, // A
-            2, 5, 0, 0, 4, 4, 4, 0, 2, 4, 2, 0, 4, 4, 4, 0, // B
-            2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0, // C
-            2, 5, 0, 0, 4, 6, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // D
-            2, 2, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0, // E
-            2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // F
-        };
+    /// Restore a snapshot taken by save
+    /// @throw std::invalid_argument when it is not a snapshot, it comes from a newer version or
+    ///        it holds a bus this bus can not restore
+    /// @throw std::out_of_range when it is truncated
+    /// @note A snapshot without bus contents only restores the Cpu
+    /// @note Version 1 snapshots release the interrupt lines and keep the cycle count
+    /// @note Registers are left untouched on error, the bus may be partially restored
+    void restore(SnapshotReader& reader) {
+        std::array<std::uint8_t, kSnapshotMagic.size()> magic{};
+        reader.get(magic);
+        std::uint8_t const version = reader.get8();
+        if (magic != kSnapshotMagic || version == 0U || version > kSnapshotVersion) {
+            throw std::invalid_argument("not a snapshot of a supported version");
+        }
+        std::uint8_t const sections = reader.get8();
+
+        Registers regs{};
+        regs.ac = reader.get8();
+        regs.xi = reader.get8();
+        regs.yi = reader.get8();
+        regs.sr = reader.get8();
+        regs.sp = reader.get16();
+        regs.pc = reader.get16();
+        std::uint16_t const lines = version >= 2U ? reader.get16() : std::uint16_t{0U};
+        std::uint64_t const cycles = version >= 2U ? reader.get64() : m_cycles;
+
+        if ((sections & kSnapshotHasBus) != 0U) {
+            if constexpr (SnapshotableBus<Bus>) {
+                m_bus->restore(reader);
+            } else {
+                throw std::invalid_argument("snapshot holds a bus that can not be restored");
+            }
+            if constexpr (kBlockCache) {
+                m_blocks.invalidate();
+            }
+        }
+        m_regs = regs;
+        m_lines.set_state(lines);
+        m_cycles = cycles;
+    }
 
-        std::uint8_t length{InstructionLength[m_instruction.opcode]};
-        std::uint8_t cycles{InstructionCycles[m_instruction.opcode]};
-        m_regs.pc += length;
-
-        switch (m_instruction.opcode)
-        {
-        case 0x61:
-        case 0x65:
-        case 0x69:
-        case 0x6D:
-        case 0x71:
-        case 0x75:
-        case 0x79:
-        case 0x7D:
-            adc();
-            break;
-
-        case 0x21:
-        case 0x25:
-        case 0x29:
-        case 0x2D:
-        case 0x31:
-        case 0x35:
-        case 0x39:
-        case 0x3D:
-            amd();
-            break;
-
-        case 0x06:
-        case 0x0A:
-        case 0x0E:
-        case 0x16:
-        case 0x1E:
-            asl();
-            break;
-
-        case 0x90:
-            bcc();
-            break;
-
-        case 0xB0:
-            bcs();
-            break;
-
-        case 0xF0:
-            beq();
-            break;
-
-        case 0x30:
-            bmi();
-            break;
-
-        case 0xD0:
-            bne();
-            break;
-
-        case 0x10:
-            bpl();
-            break;
-
-        case 0x50:
-            bvc();
-            break;
-
-        case 0x70:
-            bvs();
-            break;
-
-        case 0x00:
-            brk();
-            break;
-
-        case 0x24:
-        case 0x2C:
-            bit();
-            break;
-
-        case 0x18:
-            clc();
-            break;
-
-        case 0xD8:
-            cld();
-            break;
-
-        case 0x58:
-            cli();
-            break;
-
-        case 0xB8:
-            clv();
-            break;
-
-        case 0xC1:
-        case 0xC5:
-        case 0xC9:
-        case 0xCD:
-        case 0xD1:
-        case 0xD5:
-        case 0xD9:
-        case 0xDD:
-            cmp();
-            break;
-
-        case 0xE0:
-        case 0xE4:
-        case 0xEC:
-            cpx();
-            break;
-
-        case 0xC0:
-        case 0xC4:
-        case 0xCC:
-            cpy();
-            break;
-
-        case 0x41:
-        case 0x45:
-        case 0x49:
-        case 0x4D:
-        case 0x51:
-        case 0x55:
-        case 0x59:
-        case 0x5D:
-            eor();
-            break;
-
-        case 0xC6:
-        case 0xCE:
-        case 0xD6:
-        case 0xDE:
-            dec();
-            break;
-
-        case 0xCA:
-            dex();
-            break;
-
-        case 0x88:
-            dey();
-            break;
-
-        case 0xE6:
-        case 0xEE:
-        case 0xF6:
-        case 0xFE:
-            inc();
-            break;
-
-        case 0xE8:
-            inx();
-            break;
-
-        case 0xC8:
-            iny();
-            break;
-
-        case 0x20:
-            jsr();
-            break;
-
-        case 0x4C:
-            jmp_abs();
-            break;
-
-        case 0x6C:
-            jmp_ind();
-            break;
-
-        case 0xA1:
-        case 0xA5:
-        case 0xA9:
-        case 0xAD:
-        case 0xB1:
-        case 0xB5:
-        case 0xB9:
-        case 0xBD:
-            lda();
-            break;
-
-        case 0xA2:
-        case 0xA6:
-        case 0xB6:
-        case 0xAE:
-        case 0xBE:
-            ldx();
-            break;
-
-        case 0xA0:
-        case 0xA4:
-        case 0xAC:
-        case 0xB4:
-        case 0xBC:
-            ldy();
-            break;
-
-        case 0x46:
-        case 0x4A:
-        case 0x4E:
-        case 0x56:
-        case 0x5E:
-            lsr();
-            break;
-
-        case 0xEA:
-            nop();
-            break;
-
-        case 0x01:
-        case 0x05:
-        case 0x09:
-        case 0x0D:
-        case 0x11:
-        case 0x15:
-        case 0x19:
-        case 0x1D:
-            ora();
-            break;
-
-        case 0x48:
-            pha();
-            break;
-
-        case 0x08:
-            php();
-            break;
-
-        case 0x68:
-            pla();
-            break;
-
-        case 0x28:
-            plp();
-            break;
-
-        case 0x26:
-        case 0x2A:
-        case 0x2E:
-        case 0x36:
-        case 0x3E:
-            rol();
-            break;
-
-        case 0x66:
-        case 0x6A:
-        case 0x6E:
-        case 0x76:
-        case 0x7E:
-            ror();
-            break;
-
-        case 0x40:
-            rti();
-            break;
-
-        case 0x60:
-            rts();
-            break;
-
-        case 0xE1:
-        case 0xE5:
-        case 0xE9:
-        case 0xED:
-        case 0xF1:
-        case 0xF5:
-        case 0xF9:
-        case 0xFD:
-            sbc();
-            break;
-
-        case 0x38:
-            sec();
-            break;
-
-        case 0xF8:
-            sed();
-            break;
-
-        case 0x78:
-            sei();
-            break;
-
-        case 0x81:
-        case 0x85:
-        case 0x8D:
-        case 0x91:
-        case 0x95:
-        case 0x99:
-        case 0x9D:
-            sta();
-            break;
-
-        case 0x86:
-        case 0x8E:
-        case 0x96:
-            stx();
-            break;
-
-        case 0x84:
-        case 0x8C:
-        case 0x94:
-            sty();
-            break;
-
-        case 0xAA:
-            tax();
-            break;
-
-        case 0xA8:
-            tay();
-            break;
-
-        case 0xBA:
-            tsx();
-            break;
-
-        case 0x8A:
-            txa();
-            break;
-
-        case 0x9A:
-            txs();
-            break;
-
-        case 0x98:
-            tya();
-            break;
+    /// Discard every decoded block (see BlockCacheDispatch)
+    /// @note Required when code changes without the Cpu writing it, e.g. remapped pages or DMA
+    void invalidate_blocks() requires kBlockCache {
+        m_blocks.invalidate();
+    }
 
-        default:
-            illegal();
-            break;
-        }
+    /// Discard the decoded blocks of a page (see BlockCacheDispatch)
+    void invalidate_blocks(std::uint8_t const page) requires kBlockCache {
+        m_blocks.invalidate_page(page);
+    }
 
-        return cycles + m_extra_cycles;
+    /// Number of blocks translated to native code (see JitDispatch)
+    std::size_t translated_blocks() const requires kJitDispatch {
+        if constexpr (kJit) {
+            return m_jit.translated();
+        } else {
+            return 0U;
+        }
     }
 
 private:
-    // @see https://llx.com/Neil/a2/opcodes.html
-    union Instruction
-    {
-        struct {
-            std::uint8_t group: 2;
-            std::uint8_t addr:  3;
-            std::uint8_t oper:  3;
-        } parts;
-        std::uint8_t opcode;
+    static constexpr bool kThreadedDispatch = std::is_same_v<typename Traits::Dispatch, ThreadedDispatch>;
+
+    static constexpr bool kJitDispatch = std::is_same_v<typename Traits::Dispatch, JitDispatch>;
+
+    static constexpr bool kLazyFlags = std::is_same_v<typename Traits::Flags, LazyFlags>;
+
+    static constexpr bool kInstrumented = std::is_same_v<typename Traits::Instrumentation, InstructionCounters>;
+
+    static constexpr bool kTracksCalls = std::is_same_v<typename Traits::Instrumentation, CallStackTracking>;
+
+    static constexpr bool kTraced = std::is_same_v<typename Traits::Instrumentation, InstructionTracing>;
+
+    /// Native blocks bypass the opcode handlers that instrumentation hooks into
+    static constexpr bool kJit = kJitDispatch && MOS6502_JIT && !kLazyFlags &&
+                                 std::is_same_v<typename Traits::Instrumentation, NoInstrumentation>;
+
+    /// Arithmetic of ADC, SBC and compares (see PortableAlu)
+    using Alu = typename Traits::Alu;
+
+    /// Decimal mode of ADC and SBC (see NmosDecimal)
+    using Decimal = typename Traits::Decimal;
+
+    /// Instruction set and behaviour of the processor model (see Nmos6502)
+    using Variant = typename Traits::Variant;
+
+    static constexpr std::array<OpcodeInfo, 256> const& kOpcodes = Variant::kOpcodes;
+
+    /// Section flag of a snapshot followed by the contents of the bus
+    static constexpr std::uint8_t kSnapshotHasBus{0x01};
+
+    /// Cycles to push the context and load the vector of an interrupt
+    static constexpr std::uint8_t kInterruptCycles{7U};
+
+    /// Bits of A kept by the unstable ANE and LXA, varies between parts, 0xEE is the most common
+    static constexpr std::uint8_t kUnstableMagic{0xEE};
+
+    /// Registers while executing, the flags may be deferred (see LazyFlags)
+    using State = std::conditional_t<kLazyFlags, LazyRegisters, Registers>;
+
+    /// Handler of a decoded instruction, takes the operand bytes already fetched
+    using DecodedHandler = std::uint8_t (*)(Cpu&, State&, std::uint16_t);
+
+    using DecodedBlock = typename BlockCache<DecodedHandler>::Block;
+
+    struct NoBlockCache final {};
+
+    /// Translation of a block to native code
+    /// @return number of cycles consumed
+    using NativeBlock = std::uint64_t (*)(Cpu*, Registers*);
+
+#if MOS6502_JIT
+    using JitStorage = std::conditional_t<kJit, JitCache<NativeBlock>, NoBlockCache>;
+#else
+    using JitStorage = NoBlockCache;
+#endif
+
+    struct NoInstructionStats final {};
+
+    using StatsStorage = std::conditional_t<kInstrumented, InstructionStats, NoInstructionStats>;
+
+    struct NoCallStack final {};
+
+    /// Stop condition of run_cycles, native blocks may run as long as they fit in the budget
+    struct CycleBudget final {
+        std::uint64_t budget;
+
+        bool operator()(Registers const&, std::uint64_t const cycles) const {
+            return cycles >= budget;
+        }
     };
-    static_assert(sizeof(Instruction) == 1);
 
-    std::shared_ptr<Bus> m_bus;
+    /// Operand bytes and page crossing cycles of the instruction being executed
+    struct Operand final {
+        std::uint16_t value{};
+        std::uint8_t extra_cycles{};
+    };
+
+    Bus* m_bus;
 
     Registers m_regs{};
 
-    Instruction m_instruction{};
+    std::uint64_t m_cycles{};
+
+    [[no_unique_address]] std::conditional_t<kBlockCache, BlockCache<DecodedHandler>, NoBlockCache> m_blocks{};
+
+    [[no_unique_address]] JitStorage m_jit{};
+
+    [[no_unique_address]] StatsStorage m_stats{make_stats()};
+
+    [[no_unique_address]] std::conditional_t<kTracksCalls, CallStack, NoCallStack> m_calls{};
+
+    struct NoTracer final {};
 
-    std::uint8_t m_immediate8{};
+    [[no_unique_address]] std::conditional_t<kTraced, InstructionTracer, NoTracer> m_trace{};
 
-    std::uint16_t m_immediate16{};
+    /// Keeps the bus alive when it was given as shared_ptr
+    std::shared_ptr<Bus> m_owner;
 
-    std::uint8_t m_extra_cycles{};
+    /// Tested at once between instructions
+    InterruptLines m_lines{};
 
-    std::array<std::uint8_t, 3> const m_padding{};
+    TimelineTracer* m_timeline{};
 
-    [[ noreturn ]] void illegal() {
-        char upper_half = static_cast<char>(m_instruction.opcode & 0xF0);
-        if (upper_half < 10) {
-            upper_half += '0';
+    Cpu(Bus& bus, std::shared_ptr<Bus> owner) : m_bus{&bus}, m_owner{std::move(owner)} {
+        m_regs.sp = 0x1FF;
+        m_regs.sr = U | B;
+    }
+
+    Cpu(Bus& bus, std::shared_ptr<Bus> owner, Cpu const& other)
+        : m_bus{&bus}, m_regs{other.m_regs}, m_cycles{other.m_cycles}, m_owner{std::move(owner)}, m_lines{other.m_lines} {}
+
+    static StatsStorage make_stats() {
+        if constexpr (kInstrumented) {
+            return InstructionStats{kOpcodes};
         } else {
-            upper_half += 'A';
-            upper_half -= 10;
+            return NoInstructionStats{};
+        }
+    }
+
+    /// Read from bus, by pointer when the page is mapped to memory
+    std::uint8_t bus_read(std::uint16_t const addr) FORCEINLINE {
+        if constexpr (PageMappedBus<Bus>) {
+            std::uint8_t const* page = m_bus->read_page(static_cast<std::uint8_t>(addr >> 8));
+            if (page != nullptr) {
+                return page[addr & 0xFF];
+            }
         }
+        return m_bus->read(addr);
+    }
+
+    /// Write to bus, by pointer when the page is mapped to memory
+    void bus_write(std::uint16_t const addr, std::uint8_t const data) FORCEINLINE {
+        if constexpr (kTraced) {
+            m_trace.write(addr, data);
+        }
+        if constexpr (kBlockCache) {
+            m_blocks.on_write(addr);
+        }
+        if constexpr (PageMappedBus<Bus>) {
+            std::uint8_t* page = m_bus->write_page(static_cast<std::uint8_t>(addr >> 8));
+            if (page != nullptr) {
+                page[addr & 0xFF] = data;
+                return;
+            }
+        }
+        m_bus->write(addr, data);
+    }
+
+    /// Fetch the opcode at program counter
+    std::uint8_t fetch(State const& regs) FORCEINLINE {
+        return bus_read(regs.pc);
+    }
 
-        char lower_half = static_cast<char>(m_instruction.opcode & 0x0F);
-        if (lower_half < 10) {
-            lower_half += '0';
+    /// Fetch the operand bytes that follow the opcode
+    /// @tparam Length instruction length, only the bytes it covers are read from the bus
+    template<std::uint8_t Length>
+    FORCEINLINE std::uint16_t fetch_operand(State const& regs) {
+        std::uint16_t const addr = static_cast<std::uint16_t>(regs.pc + 1U);
+        if constexpr (Length == 2) {
+            return bus_read(addr);
+        } else if constexpr (Length == 3) {
+            if constexpr (Fetch16Bus<Bus>) {
+                return m_bus->fetch16(addr);
+            } else {
+                std::uint8_t const lo = bus_read(addr);
+                std::uint8_t const hi = bus_read(static_cast<std::uint16_t>(addr + 1U));
+                return static_cast<std::uint16_t>((hi << 8) | lo);
+            }
         } else {
-            lower_half += 'A';
-            lower_half -= 10;
+            static_cast<void>(addr);
+            return 0U;
         }
+    }
 
-        std::string reason{"Illegal instruction: 0x"};
-        reason += upper_half;
-        reason += lower_half;
-        std::cerr << "panic!: " << reason << std::endl; 
-        std::abort();
+    /// Execute instructions until stop(regs, cycles) holds
+    /// @note At least one instruction is always executed
+    /// @return number of cycles consumed
+    template<class Stop>
+    std::uint64_t execute(Stop stop) {
+        // Work on a local copy so the registers live in machine registers across bus calls
+        State regs{enter(m_regs)};
+        std::uint64_t cycles{};
+        if constexpr (kThreadedDispatch) {
+            cycles = execute_threaded(regs, stop);
+        } else if constexpr (kBlockCache) {
+            cycles = execute_blocks(regs, stop);
+        } else {
+            cycles = execute_switch(regs, stop);
+        }
+        m_regs = leave(regs);
+        m_cycles += cycles;
+        return cycles;
     }
 
-    void brk() FORCEINLINE {
-        request_interrupt(0xFFFE, true);
+    /// Registers to execute from the architectural ones
+    static State enter(Registers const& regs) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            return LazyRegisters::defer(regs);
+        } else {
+            return regs;
+        }
     }
 
-    void clc() FORCEINLINE {
-        m_regs.sr &= ~C;
+    /// Architectural registers once execution stops, with every flag materialized
+    static Registers leave(State const& regs) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            return regs.materialize();
+        } else {
+            return regs;
+        }
     }
 
-    void cld() FORCEINLINE {
-        m_regs.sr &= ~D;
+    /// Registers as observed from outside the Cpu (e.g. run_until predicates)
+    static decltype(auto) observe(State const& regs) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            return regs.materialize();
+        } else {
+            return static_cast<Registers const&>(regs);
+        }
     }
 
-    void cli() FORCEINLINE {
-        m_regs.sr &= ~I;
+    /// Raise a hardware interrupt between run calls
+    void interrupt(std::uint16_t const addr) {
+        State regs{enter(m_regs)};
+        stage_interrupt(regs, addr);
+        request_interrupt(regs, addr);
+        track_interrupt(regs, addr);
+        if constexpr (kTraced) {
+            if (m_trace.active()) {
+                m_trace.end(0U);
+            }
+        }
+        m_regs = leave(regs);
+    }
+
+    /// Fetch, decode and execute the instruction at program counter
+    /// @return number of cycles consumed
+    std::uint8_t execute_instruction(State& regs) FORCEINLINE {
+        switch (fetch(regs)) {
+#define MOS6502_CASE(opcode) \
+        case opcode: return execute<opcode>(regs);
+        MOS6502_FOR_EACH_OPCODE(MOS6502_CASE)
+#undef MOS6502_CASE
+        default: return 0U;
+        }
     }
 
-    void clv() FORCEINLINE {
-        m_regs.sr &= ~V;
+    /// Take the interrupt requested by the lines at an instruction boundary
+    /// @return number of cycles consumed, 0 when none is taken
+    std::uint8_t poll_interrupts(State& regs) FORCEINLINE {
+        if (!m_lines.pending()) [[likely]] {
+            return 0U;
+        }
+        return take_interrupt(regs);
     }
 
-    void sec() FORCEINLINE {
-        m_regs.sr |= C;
+    /// Enter the handler of the interrupt requested by the lines, NMI first
+    /// @return number of cycles consumed, 0 when only a masked IRQ is pending
+    std::uint8_t take_interrupt(State& regs) {
+        std::uint16_t vector{};
+        if (m_lines.take_nmi()) {
+            vector = 0xFFFA;
+        } else if (m_lines.irq() && !flag(regs, I)) {
+            vector = 0xFFFE;
+        } else {
+            return 0U;
+        }
+        stage_interrupt(regs, vector);
+        request_interrupt(regs, vector);
+        if constexpr (kInstrumented) {
+            m_stats.record_interrupt(kInterruptCycles);
+        }
+        track_interrupt(regs, vector);
+        if constexpr (kTracksCalls) {
+            m_calls.tick(kInterruptCycles);
+        }
+        if constexpr (kTraced) {
+            if (m_trace.active()) {
+                m_trace.end(kInterruptCycles);
+            }
+        }
+        return kInterruptCycles;
     }
 
-    void sed() FORCEINLINE {
-        m_regs.sr |= D;
+    /// Stage the trace record of an interrupt about to be entered, its pushes are recorded with it
+    void stage_interrupt(State const& regs, std::uint16_t const vector) FORCEINLINE {
+        if constexpr (kTraced) {
+            m_trace.begin(regs.pc, 0x00, vector, regs.ac, regs.xi, regs.yi, read_status(regs),
+                          static_cast<std::uint8_t>(regs.sp), vector == 0xFFFA ? TraceEntry::Nmi : TraceEntry::Irq);
+        }
     }
 
-    void sei() FORCEINLINE {
-        m_regs.sr |= I;
+    /// Push the frame of the interrupt handler entered on the shadow call stack and the timeline
+    void track_interrupt(State const& regs, std::uint16_t const vector) FORCEINLINE {
+        if constexpr (kTracksCalls) {
+            m_calls.enter(regs.pc, static_cast<std::uint8_t>(regs.sp + 3U));
+        }
+        if (m_timeline != nullptr) [[unlikely]] {
+            m_timeline->instant(vector == 0xFFFA ? "NMI" : "IRQ", TimelineTrack::Cpu, regs.pc);
+        }
     }
 
-    void nop() FORCEINLINE {
+    template<class Stop>
+    std::uint64_t execute_switch(State& regs, Stop& stop) {
+        std::uint64_t cycles{};
+        do {
+            std::uint8_t const taken = poll_interrupts(regs);
+            cycles += taken != 0U ? taken : execute_instruction(regs);
+        } while (!stop(regs, cycles));
+        return cycles;
+    }
+
+    template<class Stop>
+    std::uint64_t execute_blocks(State& regs, Stop& stop) {
+        std::uint64_t cycles{};
+        for (;;) {
+            if (std::uint8_t const taken = poll_interrupts(regs)) {
+                cycles += taken;
+                if (stop(regs, cycles)) {
+                    return cycles;
+                }
+                continue;
+            }
+            DecodedBlock const* block = m_blocks.find(regs.pc);
+            if (block == nullptr) {
+                block = decode_block(regs.pc);
+            }
+            if (block == nullptr) {
+                cycles += execute_instruction(regs);
+                if (stop(regs, cycles)) {
+                    return cycles;
+                }
+                continue;
+            }
+            if constexpr (kJit) {
+                if (execute_native(*block, regs, stop, cycles)) {
+                    if (stop(regs, cycles)) {
+                        return cycles;
+                    }
+                    continue;
+                }
+            }
+            for (std::uint8_t i = 0U; i < block->length; ++i) {
+                auto const& instruction = block->instructions[i];
+                cycles += instruction.handler(*this, regs, instruction.operand);
+                if (stop(regs, cycles)) {
+                    return cycles;
+                }
+                // The instruction wrote to the code of its own block
+                if (!m_blocks.is_current(*block)) {
+                    break;
+                }
+                if (std::uint8_t const taken = poll_interrupts(regs)) {
+                    cycles += taken;
+                    if (stop(regs, cycles)) {
+                        return cycles;
+                    }
+                    break;
+                }
+            }
+        }
     }
 
-    void adc() FORCEINLINE {
-        // compute with signed values to set overflow flag in native x86
-        std::int8_t acc{static_cast<std::int8_t>(m_regs.ac)};
-        std::int8_t mem{static_cast<std::int8_t>(read_instruction_input())};
-        std::int8_t res{};
+    /// Decode the basic block starting at pc into the block cache
+    /// @return the block, or null when the code can not be cached (e.g. it is served by a device)
+    DecodedBlock const* decode_block(std::uint16_t const pc) {
+#define MOS6502_DECODED_HANDLER(opcode) &Cpu::execute_decoded<opcode>,
+        static constexpr DecodedHandler kDecodedHandlers[256] = { MOS6502_FOR_EACH_OPCODE(MOS6502_DECODED_HANDLER) };
+#undef MOS6502_DECODED_HANDLER
 
-        if (static_cast<bool>(m_regs.sr & C)) {
-            __asm__ __volatile__("stc");
-        } else {
-            __asm__ __volatile__("clc");
-        }
-        __asm__ __volatile__("adcb %%bl, %%al" : "=a" (res) : "a" (acc), "b" (mem));
-
-        std::uint8_t c_out{};
-        std::uint8_t n_out{};
-        std::uint8_t v_out{};
-        std::uint8_t z_out{};
-        __asm__ __volatile__("setc %0" : "=g" (c_out));
-        __asm__ __volatile__("sets %0" : "=g" (n_out));
-        __asm__ __volatile__("seto %0" : "=g" (v_out));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
-
-        m_regs.ac = static_cast<std::uint8_t>(res);
-
-        if (static_cast<bool>(m_regs.sr & D))
-        {
-            std::uint8_t adjustment{};
-            if ((m_regs.ac & 0xF) > 0x9)
-            {
-                adjustment += 0x6;
+        std::uint8_t const page = static_cast<std::uint8_t>(pc >> 8);
+        if constexpr (PageMappedBus<Bus>) {
+            if (m_bus->read_page(page) == nullptr) {
+                return nullptr;
+            }
+        }
+
+        DecodedBlock& block = m_blocks.slot(pc);
+        std::uint16_t addr = pc;
+        std::uint8_t length = 0U;
+        for (;;) {
+            std::uint8_t const opcode = bus_read(addr);
+            OpcodeInfo const& info = kOpcodes[opcode];
+            // Operand bytes on the next page would not be watched for writes
+            if ((addr & 0xFF) + info.length > 0x100) {
+                break;
+            }
+
+            std::uint16_t operand{};
+            if (info.length == 2U) {
+                operand = bus_read(static_cast<std::uint16_t>(addr + 1U));
+            } else if (info.length == 3U) {
+                std::uint8_t const lo = bus_read(static_cast<std::uint16_t>(addr + 1U));
+                std::uint8_t const hi = bus_read(static_cast<std::uint16_t>(addr + 2U));
+                operand = static_cast<std::uint16_t>((hi << 8) | lo);
             }
-            if (m_regs.ac > 0x99 || c_out)
-            {
-                adjustment += 0x60;
-                c_out = 1U;
+            block.instructions[length] = {kDecodedHandlers[opcode], operand, opcode};
+            ++length;
+
+            addr = static_cast<std::uint16_t>(addr + info.length);
+            if (ends_block(info.mnemonic) || length == block.instructions.size() || (addr >> 8) != page) {
+                break;
             }
-            m_regs.ac += adjustment;
-            z_out = (m_regs.ac == 0);
-            n_out = (m_regs.ac & 0x80);
         }
 
-        set_if(c_out, C);
-        set_if(n_out, N);
-        set_if(v_out, V);
-        set_if(z_out, Z);
+        if (length == 0U) {
+            return nullptr;
+        }
+        block.length = length;
+        m_blocks.commit(block);
+        return &block;
+    }
+
+#if MOS6502_JIT
+    /// Run the native translation of a block, translating it once it becomes hot
+    /// @return true when the block was run natively
+    template<class Stop>
+    bool execute_native(DecodedBlock const& block, State& regs, Stop const& stop, std::uint64_t& cycles) {
+        if constexpr (std::is_same_v<Stop, CycleBudget>) {
+            auto& entry = m_jit.entry(block.pc, block.generation);
+            if (entry.code == nullptr) {
+                entry.hits = static_cast<std::uint16_t>(entry.hits + 1U);
+                if (entry.hits < JitCache<NativeBlock>::kHotThreshold) {
+                    return false;
+                }
+                translate_block(block);
+            }
+            auto const& translated = m_jit.entry(block.pc, block.generation);
+            // Leave the tail of the budget to the interpreter so both stop at the same instruction
+            if (translated.code == nullptr || cycles + translated.max_cycles > stop.budget) {
+                return false;
+            }
+            cycles += translated.code(this, &regs);
+            return true;
+        } else {
+            static_cast<void>(block);
+            static_cast<void>(regs);
+            static_cast<void>(stop);
+            static_cast<void>(cycles);
+            return false;
+        }
     }
 
-    void sbc() FORCEINLINE {
-        // compute with signed values to set overflow flag in native x86
-        std::int8_t acc{static_cast<std::int8_t>(m_regs.ac)};
-        std::int8_t mem{static_cast<std::int8_t>(read_instruction_input())};
-        std::int8_t res{};
+    /// Translate a decoded block to native code
+    ///
+    /// Instructions working on registers and reads from memory pages are emitted inline, the rest
+    /// call the handler of the interpreter. After handlers that write memory the code returns early
+    /// if the block became stale.
+    void translate_block(DecodedBlock const& block) {
+        std::uint32_t max_cycles{};
+        NativeBlock const code = m_jit.emit([&](X64Emitter& emitter) {
+            std::array<std::uint8_t*, BlockCache<DecodedHandler>::kMaxInstructions> exits{};
+            std::size_t exit_count{};
+            std::uint32_t pending_cycles{};
+            bool pc_stale{};
+            std::uint16_t pc = block.pc;
+
+            emitter.prologue();
+            for (std::uint8_t i = 0U; i < block.length; ++i) {
+                auto const& instruction = block.instructions[i];
+                OpcodeInfo const& info = kOpcodes[instruction.opcode];
+                max_cycles += static_cast<std::uint32_t>(base_cycles(info) + info.page_penalty);
+
+                std::uint16_t const next = static_cast<std::uint16_t>(pc + info.length);
+                if (emit_control(emitter, instruction.operand, info, next)) {
+                    pending_cycles += info.cycles;
+                    pc_stale = false;
+                } else if (emit_native(emitter, instruction.operand, info)) {
+                    pending_cycles += info.cycles;
+                    pc_stale = true;
+                } else {
+                    if (pending_cycles != 0U) {
+                        emitter.add_cycles(pending_cycles);
+                        pending_cycles = 0U;
+                    }
+                    emitter.store_word(offsetof(Registers, pc), pc);
+                    emitter.call_handler(reinterpret_cast<std::uintptr_t>(instruction.handler), instruction.operand);
+                    pc_stale = false;
+                    if (writes_memory(info)) {
+                        exits[exit_count++] = emitter.jump_if_changed(m_blocks.generation(block.page), block.generation);
+                    }
+                }
+                pc = next;
+            }
+            if (pending_cycles != 0U) {
+                emitter.add_cycles(pending_cycles);
+            }
+            if (pc_stale) {
+                emitter.store_word(offsetof(Registers, pc), pc);
+            }
+            for (std::size_t i = 0U; i < exit_count; ++i) {
+                emitter.bind(exits[i]);
+            }
+            emitter.epilogue();
+        });
+
+        if (code != nullptr) {
+            auto& entry = m_jit.entry(block.pc, block.generation);
+            entry.code = code;
+            entry.max_cycles = max_cycles;
+        }
+    }
 
-        // Borrow when carry unset
-        if (static_cast<bool>(m_regs.sr & C)) {
-            __asm__ __volatile__("clc");
-        } else {
-            __asm__ __volatile__("stc");
+    /// Emit a branch or an absolute jump inline
+    /// @return false when the instruction is not one of them
+    static bool emit_control(X64Emitter& emitter, std::uint16_t const operand, OpcodeInfo const& info, std::uint16_t const next) {
+        constexpr auto kSr = static_cast<std::uint8_t>(offsetof(Registers, sr));
+        constexpr auto kPc = static_cast<std::uint8_t>(offsetof(Registers, pc));
+
+        auto const target = static_cast<std::uint16_t>(next + static_cast<std::int8_t>(operand));
+        switch (info.mnemonic) {
+        case Mnemonic::BCC: emitter.branch(kSr, C, false, kPc, target, next); return true;
+        case Mnemonic::BCS: emitter.branch(kSr, C, true, kPc, target, next); return true;
+        case Mnemonic::BEQ: emitter.branch(kSr, Z, true, kPc, target, next); return true;
+        case Mnemonic::BNE: emitter.branch(kSr, Z, false, kPc, target, next); return true;
+        case Mnemonic::BMI: emitter.branch(kSr, N, true, kPc, target, next); return true;
+        case Mnemonic::BPL: emitter.branch(kSr, N, false, kPc, target, next); return true;
+        case Mnemonic::BVS: emitter.branch(kSr, V, true, kPc, target, next); return true;
+        case Mnemonic::BVC: emitter.branch(kSr, V, false, kPc, target, next); return true;
+        case Mnemonic::JMP:
+            if (info.mode == AddressMode::Absolute) {
+                emitter.store_word(kPc, operand);
+                return true;
+            }
+            return false;
+        default:
+            return false;
         }
-        __asm__ __volatile__("sbbb %%bl, %%al" : "=a" (res) : "a" (acc), "b" (mem));
+    }
 
-        std::uint8_t c_out{};
-        std::uint8_t n_out{};
-        std::uint8_t v_out{};
-        std::uint8_t z_out{};
+    /// Emit an instruction inline
+    /// @return false when the instruction must call its handler
+    bool emit_native(X64Emitter& emitter, std::uint16_t const operand, OpcodeInfo const& info) {
+        constexpr auto kAc = static_cast<std::uint8_t>(offsetof(Registers, ac));
+        constexpr auto kXi = static_cast<std::uint8_t>(offsetof(Registers, xi));
+        constexpr auto kYi = static_cast<std::uint8_t>(offsetof(Registers, yi));
+        constexpr auto kSr = static_cast<std::uint8_t>(offsetof(Registers, sr));
+        constexpr auto kSp = static_cast<std::uint8_t>(offsetof(Registers, sp));
 
-        __asm__ __volatile__("setnc %0" : "=g" (c_out)); // C = ~B
-        __asm__ __volatile__("sets %0" : "=g" (n_out));
-        __asm__ __volatile__("seto %0" : "=g" (v_out));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
+        bool const immediate = info.mode == AddressMode::Immediate;
+        std::uint8_t const* const memory = native_memory(info.mode, operand);
+        auto const value = static_cast<std::uint8_t>(operand);
 
-        m_regs.ac = static_cast<std::uint8_t>(res);
-        set_if(c_out, C);
-        set_if(n_out, N);
-        set_if(v_out, V);
-        set_if(z_out, Z);
+        auto const load = [&](std::uint8_t const reg) {
+            if (immediate) {
+                emitter.move_al(value);
+            } else {
+                emitter.load_al_absolute(memory);
+            }
+            emitter.store_al(reg);
+            emitter.set_nz(kSr);
+        };
+        auto const logic = [&](std::uint8_t const immediate_opcode, std::uint8_t const memory_opcode) {
+            emitter.load_al(kAc);
+            if (immediate) {
+                emitter.alu_al(immediate_opcode, value);
+            } else {
+                emitter.alu_al_absolute(memory_opcode, memory);
+            }
+            emitter.store_al(kAc);
+            emitter.set_nz(kSr);
+        };
+        auto const transfer = [&](std::uint8_t const from, std::uint8_t const to) {
+            emitter.load_al(from);
+            emitter.store_al(to);
+            emitter.set_nz(kSr);
+        };
+        auto const step = [&](std::uint8_t const reg, bool const increment) {
+            emitter.load_al(reg);
+            if (increment) {
+                emitter.increment_al();
+            } else {
+                emitter.decrement_al();
+            }
+            emitter.store_al(reg);
+            emitter.set_nz(kSr);
+        };
+
+        bool const has_operand = immediate || memory != nullptr;
+        switch (info.mnemonic) {
+        case Mnemonic::LDA: if (has_operand) { load(kAc); return true; } return false;
+        case Mnemonic::LDX: if (has_operand) { load(kXi); return true; } return false;
+        case Mnemonic::LDY: if (has_operand) { load(kYi); return true; } return false;
+        case Mnemonic::AND: if (has_operand) { logic(0x24, 0x22); return true; } return false;
+        case Mnemonic::ORA: if (has_operand) { logic(0x0C, 0x0A); return true; } return false;
+        case Mnemonic::EOR: if (has_operand) { logic(0x34, 0x32); return true; } return false;
+        case Mnemonic::CMP: if (has_operand) { emitter.compare(kAc, kSr, memory, value); return true; } return false;
+        case Mnemonic::CPX: if (has_operand) { emitter.compare(kXi, kSr, memory, value); return true; } return false;
+        case Mnemonic::CPY: if (has_operand) { emitter.compare(kYi, kSr, memory, value); return true; } return false;
+        case Mnemonic::TAX: transfer(kAc, kXi); return true;
+        case Mnemonic::TAY: transfer(kAc, kYi); return true;
+        case Mnemonic::TXA: transfer(kXi, kAc); return true;
+        case Mnemonic::TYA: transfer(kYi, kAc); return true;
+        case Mnemonic::TSX: transfer(kSp, kXi); return true;
+        case Mnemonic::TXS: transfer(kXi, kSp); return true;
+        case Mnemonic::INX: step(kXi, true); return true;
+        case Mnemonic::INY: step(kYi, true); return true;
+        case Mnemonic::DEX: step(kXi, false); return true;
+        case Mnemonic::DEY: step(kYi, false); return true;
+        case Mnemonic::CLC: emitter.and_byte(kSr, static_cast<std::uint8_t>(~C)); return true;
+        case Mnemonic::CLD: emitter.and_byte(kSr, static_cast<std::uint8_t>(~D)); return true;
+        case Mnemonic::CLI: emitter.and_byte(kSr, static_cast<std::uint8_t>(~I)); return true;
+        case Mnemonic::CLV: emitter.and_byte(kSr, static_cast<std::uint8_t>(~V)); return true;
+        case Mnemonic::SEC: emitter.or_byte(kSr, C); return true;
+        case Mnemonic::SED: emitter.or_byte(kSr, D); return true;
+        case Mnemonic::SEI: emitter.or_byte(kSr, I); return true;
+        case Mnemonic::NOP: return info.mode == AddressMode::Implied;
+        default: return false;
+        }
     }
 
-    void amd() FORCEINLINE {
-        std::uint8_t acc{m_regs.ac};
-        std::uint8_t mem{read_instruction_input()};
-        std::uint8_t res{};
+    /// Retrieve the memory read by a zero page or absolute operand, or null if it must go through the bus
+    std::uint8_t const* native_memory(AddressMode const mode, std::uint16_t const operand) const {
+        if constexpr (PageMappedBus<Bus> && kStablePages<Bus>) {
+            if (mode == AddressMode::ZeroPage || mode == AddressMode::Absolute) {
+                std::uint8_t const* page = m_bus->read_page(static_cast<std::uint8_t>(operand >> 8));
+                if (page != nullptr) {
+                    return page + (operand & 0xFF);
+                }
+            }
+        } else {
+            static_cast<void>(mode);
+            static_cast<void>(operand);
+        }
+        return nullptr;
+    }
+
+    /// Check whether an instruction may write to memory
+    static constexpr bool writes_memory(OpcodeInfo const& info) {
+        bool const store = (info.access == Access::Write || info.access == Access::Modify) &&
+                           info.mode != AddressMode::Accumulator;
+        bool const push = info.mnemonic == Mnemonic::PHA || info.mnemonic == Mnemonic::PHP ||
+                          info.mnemonic == Mnemonic::JSR || info.mnemonic == Mnemonic::BRK ||
+                          info.mnemonic == Mnemonic::PHX || info.mnemonic == Mnemonic::PHY;
+        return store || push;
+    }
+#endif
 
-        __asm__ __volatile__("andb %%bl, %%al" : "=a" (res) : "a" (acc), "b" (mem));
+    /// Cycles of an instruction before page and branch penalties
+    /// @note Entries without timing (ILL) take 1 cycle, so that running a budget always progresses
+    static constexpr std::uint8_t base_cycles(OpcodeInfo const& info) {
+        return info.cycles != 0U ? info.cycles : std::uint8_t{1U};
+    }
 
-        std::uint8_t n_out{};
-        std::uint8_t z_out{};
-        __asm__ __volatile__("sets %0" : "=g" (n_out));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
+    /// Check whether an instruction may continue anywhere else than the next one
+    static constexpr bool ends_block(Mnemonic const mnemonic) {
+        switch (mnemonic) {
+        case Mnemonic::BCC: case Mnemonic::BCS: case Mnemonic::BEQ: case Mnemonic::BMI:
+        case Mnemonic::BNE: case Mnemonic::BPL: case Mnemonic::BVC: case Mnemonic::BVS:
+        case Mnemonic::BRK: case Mnemonic::JMP: case Mnemonic::JSR: case Mnemonic::RTI:
+        case Mnemonic::RTS: case Mnemonic::ILL: case Mnemonic::JAM: case Mnemonic::BRA:
+            return true;
+        default:
+            return false;
+        }
+    }
 
-        m_regs.ac = res;
-        set_if(n_out, N);
-        set_if(z_out, Z);
+    /// Entry of a decoded instruction in the block cache
+    template<std::uint8_t Opcode>
+    static std::uint8_t execute_decoded(Cpu& cpu, State& regs, std::uint16_t const operand) {
+        return cpu.execute<Opcode>(regs, operand);
     }
 
-    void bit() FORCEINLINE {
-        std::uint8_t acc{m_regs.ac};
-        std::uint8_t mem{read_instruction_input()};
+#if MOS6502_COMPUTED_GOTO
+    template<class Stop>
+    std::uint64_t execute_threaded(State& regs, Stop& stop) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#if defined(__clang__)
+#pragma clang diagnostic ignored "-Wgnu-label-as-value"
+#endif
+        // Each handler ends dispatching the next one, giving every opcode its own indirect branch
+#define MOS6502_LABEL_ADDRESS(opcode) &&opcode_##opcode,
+        static void* const kHandlers[256] = { MOS6502_FOR_EACH_OPCODE(MOS6502_LABEL_ADDRESS) };
+#undef MOS6502_LABEL_ADDRESS
+
+        std::uint64_t cycles{};
+        if (m_lines.pending()) {
+            goto interrupt_lines;
+        }
+        goto *kHandlers[fetch(regs)];
+
+#define MOS6502_LABEL(opcode) \
+    opcode_##opcode: \
+        cycles += execute<opcode>(regs); \
+        if (stop(regs, cycles)) { \
+            return cycles; \
+        } \
+        if (m_lines.pending()) [[unlikely]] { \
+            goto interrupt_lines; \
+        } \
+        goto *kHandlers[fetch(regs)];
+        MOS6502_FOR_EACH_OPCODE(MOS6502_LABEL)
+#undef MOS6502_LABEL
+
+    interrupt_lines:
+        if (std::uint8_t const taken = take_interrupt(regs)) {
+            cycles += taken;
+            if (stop(regs, cycles)) {
+                return cycles;
+            }
+        }
+        goto *kHandlers[fetch(regs)];
+#pragma GCC diagnostic pop
+    }
+#else
+    template<class Stop>
+    std::uint64_t execute_threaded(State& regs, Stop& stop) {
+        return execute_switch(regs, stop);
+    }
+#endif
 
-        std::uint8_t res{};
-        std::uint8_t z_out{};
+    /// Handler of an opcode, specialized at compile time from its descriptor
+    /// @return number of cycles consumed
+    template<std::uint8_t Opcode>
+    FORCEINLINE std::uint8_t execute(State& regs) {
+        return execute<Opcode>(regs, fetch_operand<kOpcodes[Opcode].length>(regs));
+    }
+
+    /// Handler of an opcode whose operand bytes were already fetched
+    /// @return number of cycles consumed
+    template<std::uint8_t Opcode>
+    FORCEINLINE std::uint8_t execute(State& regs, std::uint16_t const operand_bytes) {
+        constexpr OpcodeInfo kInfo = kOpcodes[Opcode];
+        constexpr Mnemonic kOp = kInfo.mnemonic;
+        constexpr AddressMode kMode = kInfo.mode;
+
+        Operand operand{operand_bytes, 0U};
+        if constexpr (kTraced) {
+            m_trace.begin(regs.pc, Opcode, operand_bytes, regs.ac, regs.xi, regs.yi, read_status(regs),
+                          static_cast<std::uint8_t>(regs.sp));
+        }
+        regs.pc = static_cast<std::uint16_t>(regs.pc + kInfo.length);
+
+        if constexpr (kInfo.access == Access::Read) {
+            std::uint8_t const value = read_operand<kMode, kInfo.page_penalty>(regs, operand);
+            if constexpr (kOp == Mnemonic::ADC) { adc(regs, value); }
+            else if constexpr (kOp == Mnemonic::AND) { amd(regs, value); }
+            else if constexpr (kOp == Mnemonic::BIT && kMode == AddressMode::Immediate) { bit_immediate(regs, value); }
+            else if constexpr (kOp == Mnemonic::BIT) { bit(regs, value); }
+            else if constexpr (kOp == Mnemonic::CMP) { cmp(regs, value); }
+            else if constexpr (kOp == Mnemonic::CPX) { cpx(regs, value); }
+            else if constexpr (kOp == Mnemonic::CPY) { cpy(regs, value); }
+            else if constexpr (kOp == Mnemonic::EOR) { eor(regs, value); }
+            else if constexpr (kOp == Mnemonic::LDA) { lda(regs, value); }
+            else if constexpr (kOp == Mnemonic::LDX) { ldx(regs, value); }
+            else if constexpr (kOp == Mnemonic::LDY) { ldy(regs, value); }
+            else if constexpr (kOp == Mnemonic::ORA) { ora(regs, value); }
+            else if constexpr (kOp == Mnemonic::SBC) { sbc(regs, value); }
+            else if constexpr (kOp == Mnemonic::NOP) { static_cast<void>(value); }
+            else if constexpr (kOp == Mnemonic::ALR) { alr(regs, value); }
+            else if constexpr (kOp == Mnemonic::ANC) { anc(regs, value); }
+            else if constexpr (kOp == Mnemonic::ANE) { ane(regs, value); }
+            else if constexpr (kOp == Mnemonic::ARR) { arr(regs, value); }
+            else if constexpr (kOp == Mnemonic::LAS) { las(regs, value); }
+            else if constexpr (kOp == Mnemonic::LAX) { lax(regs, value); }
+            else if constexpr (kOp == Mnemonic::LXA) { lxa(regs, value); }
+            else { static_assert(kOp == Mnemonic::SBX); sbx(regs, value); }
+        } else if constexpr (kInfo.access == Access::Write) {
+            if constexpr (kOp == Mnemonic::STA) { write_operand<kMode>(regs, operand, sta(regs)); }
+            else if constexpr (kOp == Mnemonic::STX) { write_operand<kMode>(regs, operand, stx(regs)); }
+            else if constexpr (kOp == Mnemonic::STY) { write_operand<kMode>(regs, operand, sty(regs)); }
+            else if constexpr (kOp == Mnemonic::STZ) { write_operand<kMode>(regs, operand, 0U); }
+            else if constexpr (kOp == Mnemonic::SAX) { write_operand<kMode>(regs, operand, sax(regs)); }
+            else if constexpr (kOp == Mnemonic::SHA) { write_unstable<kMode>(regs, operand, sax(regs)); }
+            else if constexpr (kOp == Mnemonic::SHX) { write_unstable<kMode>(regs, operand, regs.xi); }
+            else if constexpr (kOp == Mnemonic::SHY) { write_unstable<kMode>(regs, operand, regs.yi); }
+            else { static_assert(kOp == Mnemonic::TAS); write_unstable<kMode>(regs, operand, tas(regs)); }
+        } else if constexpr (kInfo.access == Access::Modify) {
+            std::uint8_t const value = read_operand<kMode, kInfo.page_penalty>(regs, operand);
+            if constexpr (kOp == Mnemonic::ASL) { write_operand<kMode>(regs, operand, asl(regs, value)); }
+            else if constexpr (kOp == Mnemonic::DEC) { write_operand<kMode>(regs, operand, dec(regs, value)); }
+            else if constexpr (kOp == Mnemonic::INC) { write_operand<kMode>(regs, operand, inc(regs, value)); }
+            else if constexpr (kOp == Mnemonic::LSR) { write_operand<kMode>(regs, operand, lsr(regs, value)); }
+            else if constexpr (kOp == Mnemonic::ROL) { write_operand<kMode>(regs, operand, rol(regs, value)); }
+            else if constexpr (kOp == Mnemonic::ROR) { write_operand<kMode>(regs, operand, ror(regs, value)); }
+            else if constexpr (kOp == Mnemonic::DCP) { write_operand<kMode>(regs, operand, dcp(regs, value)); }
+            else if constexpr (kOp == Mnemonic::ISC) { write_operand<kMode>(regs, operand, isc(regs, value)); }
+            else if constexpr (kOp == Mnemonic::RLA) { write_operand<kMode>(regs, operand, rla(regs, value)); }
+            else if constexpr (kOp == Mnemonic::RRA) { write_operand<kMode>(regs, operand, rra(regs, value)); }
+            else if constexpr (kOp == Mnemonic::SLO) { write_operand<kMode>(regs, operand, slo(regs, value)); }
+            else if constexpr (kOp == Mnemonic::SRE) { write_operand<kMode>(regs, operand, sre(regs, value)); }
+            else if constexpr (kOp == Mnemonic::TRB) { write_operand<kMode>(regs, operand, trb(regs, value)); }
+            else { static_assert(kOp == Mnemonic::TSB); write_operand<kMode>(regs, operand, tsb(regs, value)); }
+        } else {
+            if constexpr (kOp == Mnemonic::BCC) { bcc(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BCS) { bcs(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BEQ) { beq(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BMI) { bmi(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BNE) { bne(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BPL) { bpl(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BVC) { bvc(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BVS) { bvs(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BRA) { jmp_rel(regs, static_cast<std::uint8_t>(operand.value)); }
+            else if constexpr (kOp == Mnemonic::BRK) { brk(regs); }
+            else if constexpr (kOp == Mnemonic::CLC) { clc(regs); }
+            else if constexpr (kOp == Mnemonic::CLD) { cld(regs); }
+            else if constexpr (kOp == Mnemonic::CLI) { cli(regs); }
+            else if constexpr (kOp == Mnemonic::CLV) { clv(regs); }
+            else if constexpr (kOp == Mnemonic::DEX) { dex(regs); }
+            else if constexpr (kOp == Mnemonic::DEY) { dey(regs); }
+            else if constexpr (kOp == Mnemonic::INX) { inx(regs); }
+            else if constexpr (kOp == Mnemonic::INY) { iny(regs); }
+            else if constexpr (kOp == Mnemonic::JMP && kMode == AddressMode::Indirect) { jmp_ind(regs, operand.value); }
+            else if constexpr (kOp == Mnemonic::JMP && kMode == AddressMode::AbsoluteIndirectX) {
+                jmp_ind(regs, static_cast<std::uint16_t>(operand.value + regs.xi));
+            }
+            else if constexpr (kOp == Mnemonic::JMP) { jmp_abs(regs, operand.value); }
+            else if constexpr (kOp == Mnemonic::JSR) { jsr(regs, operand.value); }
+            else if constexpr (kOp == Mnemonic::NOP) { nop(regs); }
+            else if constexpr (kOp == Mnemonic::PHA) { pha(regs); }
+            else if constexpr (kOp == Mnemonic::PHP) { php(regs); }
+            else if constexpr (kOp == Mnemonic::PLA) { pla(regs); }
+            else if constexpr (kOp == Mnemonic::PLP) { plp(regs); }
+            else if constexpr (kOp == Mnemonic::PHX) { push(regs, regs.xi); }
+            else if constexpr (kOp == Mnemonic::PHY) { push(regs, regs.yi); }
+            else if constexpr (kOp == Mnemonic::PLX) { plx(regs); }
+            else if constexpr (kOp == Mnemonic::PLY) { ply(regs); }
+            else if constexpr (kOp == Mnemonic::RTI) { rti(regs); }
+            else if constexpr (kOp == Mnemonic::RTS) { rts(regs); }
+            else if constexpr (kOp == Mnemonic::SEC) { sec(regs); }
+            else if constexpr (kOp == Mnemonic::SED) { sed(regs); }
+            else if constexpr (kOp == Mnemonic::SEI) { sei(regs); }
+            else if constexpr (kOp == Mnemonic::TAX) { tax(regs); }
+            else if constexpr (kOp == Mnemonic::TAY) { tay(regs); }
+            else if constexpr (kOp == Mnemonic::TSX) { tsx(regs); }
+            else if constexpr (kOp == Mnemonic::TXA) { txa(regs); }
+            else if constexpr (kOp == Mnemonic::TXS) { txs(regs); }
+            else if constexpr (kOp == Mnemonic::TYA) { tya(regs); }
+            else { static_assert(kOp == Mnemonic::JAM || kOp == Mnemonic::ILL); jam(regs, kInfo.length); }
+        }
 
-        __asm__ __volatile__("andb %%bl, %%al" : "=a" (res) : "a" (acc), "b" (mem));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
+        std::uint8_t const cycles = static_cast<std::uint8_t>(base_cycles(kInfo) + operand.extra_cycles);
+        if constexpr (kInstrumented) {
+            m_stats.record(Opcode, cycles);
+        }
+        if constexpr (kTracksCalls) {
+            m_calls.tick(cycles);
+            if constexpr (kOp == Mnemonic::JSR) {
+                m_calls.enter(regs.pc, static_cast<std::uint8_t>(regs.sp + 2U));
+            } else if constexpr (kOp == Mnemonic::BRK) {
+                m_calls.enter(regs.pc, static_cast<std::uint8_t>(regs.sp + 3U));
+            } else if constexpr (kOp == Mnemonic::RTS || kOp == Mnemonic::RTI) {
+                m_calls.leave(static_cast<std::uint8_t>(regs.sp));
+            }
+        }
+        if constexpr (kTraced) {
+            if (m_trace.active()) {
+                m_trace.end(cycles);
+            }
+        }
+        return cycles;
+    }
 
-        m_regs.sr = (m_regs.sr & 0x3D) | (mem & 0xC0) | ((z_out << 1) & 0x02);
+    /// Halt until reset, the processor keeps fetching the same opcode
+    /// @note Opcodes without a descriptor (ILL) behave the same instead of aborting the host
+    void jam(State& regs, std::uint8_t const length) FORCEINLINE {
+        regs.pc = static_cast<std::uint16_t>(regs.pc - length);
     }
 
-    void eor() FORCEINLINE {
-        std::uint8_t acc{m_regs.ac};
-        std::uint8_t mem{read_instruction_input()};
-        std::uint8_t res{};
+    void brk(State& regs) FORCEINLINE {
+        request_interrupt(regs, 0xFFFE, true);
+    }
 
-        __asm__ __volatile__("xorb %%bl, %%al" : "=a" (res) : "a" (acc), "b" (mem));
+    void clc(State& regs) FORCEINLINE {
+        set_if(regs, false, C);
+    }
 
-        std::uint8_t n_out{};
-        std::uint8_t z_out{};
-        __asm__ __volatile__("sets %0" : "=g" (n_out));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
+    void cld(State& regs) FORCEINLINE {
+        regs.sr &= ~D;
+    }
 
-        m_regs.ac = res;
-        set_if(n_out, N);
-        set_if(z_out, Z);
+    void cli(State& regs) FORCEINLINE {
+        regs.sr &= ~I;
     }
 
-    void ora() FORCEINLINE {
-        std::uint8_t acc{m_regs.ac};
-        std::uint8_t mem{read_instruction_input()};
-        std::uint8_t res{};
+    void clv(State& regs) FORCEINLINE {
+        set_if(regs, false, V);
+    }
 
-        __asm__ __volatile__("orb %%bl, %%al" : "=a" (res) : "a" (acc), "b" (mem));
+    void sec(State& regs) FORCEINLINE {
+        set_if(regs, true, C);
+    }
 
-        std::uint8_t n_out{};
-        std::uint8_t z_out{};
-        __asm__ __volatile__("sets %0" : "=g" (n_out));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
+    void sed(State& regs) FORCEINLINE {
+        regs.sr |= D;
+    }
 
-        m_regs.ac = res;
-        set_if(n_out, N);
-        set_if(z_out, Z);
+    void sei(State& regs) FORCEINLINE {
+        regs.sr |= I;
     }
 
-    void cmp() FORCEINLINE {
-        std::uint8_t acc{m_regs.ac};
-        std::uint8_t mem{read_instruction_input()};
+    void nop(State& /*regs*/) FORCEINLINE {
+    }
 
-        __asm__ __volatile__("cmpb %%bl, %%al" : : "a" (acc), "b" (mem));
+    void adc(State& regs, std::uint8_t const operand) FORCEINLINE {
+        if constexpr (Variant::kDecimalMode) {
+            if (flag(regs, D)) {
+                decimal(regs, Decimal::add(regs.ac, operand, flag(regs, C)));
+                return;
+            }
+        }
+        AluResult const sum = Alu::add(regs.ac, operand, flag(regs, C));
+        regs.ac = sum.value;
+        set_if(regs, sum.carry, C);
+        set_if(regs, sum.overflow, V);
+        set_nz(regs, regs.ac);
+    }
+
+    void sbc(State& regs, std::uint8_t const operand) FORCEINLINE {
+        if constexpr (Variant::kDecimalMode) {
+            if (flag(regs, D)) {
+                decimal(regs, Decimal::subtract(regs.ac, operand, flag(regs, C)));
+                return;
+            }
+        }
+        AluResult const difference = Alu::subtract(regs.ac, operand, flag(regs, C));
+        regs.ac = difference.value;
+        set_if(regs, difference.carry, C);
+        set_if(regs, difference.overflow, V);
+        set_nz(regs, regs.ac);
+    }
 
-        std::uint8_t c_out{};
-        std::uint8_t n_out{};
-        std::uint8_t z_out{};
-        __asm__ __volatile__("setnc %0" : "=g" (c_out));
-        __asm__ __volatile__("sets %0" : "=g" (n_out));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
+    void decimal(State& regs, DecimalResult const& result) FORCEINLINE {
+        regs.ac = result.value;
+        set_if(regs, result.carry, C);
+        set_if(regs, result.overflow, V);
+        set_nz(regs, result.negative, result.zero);
+    }
 
-        set_if(c_out, C);
-        set_if(n_out, N);
-        set_if(z_out, Z);
+    void amd(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.ac &= operand;
+        set_nz(regs, regs.ac);
     }
 
-    void cpx() FORCEINLINE {
-        std::uint8_t idx{m_regs.xi};
-        std::uint8_t mem{read_instruction_input()};
+    void bit(State& regs, std::uint8_t const operand) FORCEINLINE {
+        set_if(regs, static_cast<bool>(operand & V), V);
+        set_nz(regs, operand, static_cast<std::uint8_t>(regs.ac & operand));
+    }
 
-        __asm__ __volatile__("cmpb %%bl, %%al" : : "a" (idx), "b" (mem));
+    /// BIT #imm of the 65C02 only changes Z
+    void bit_immediate(State& regs, std::uint8_t const operand) FORCEINLINE {
+        set_z(regs, static_cast<std::uint8_t>(regs.ac & operand));
+    }
 
-        std::uint8_t c_out{};
-        std::uint8_t n_out{};
-        std::uint8_t z_out{};
-        __asm__ __volatile__("setnc %0" : "=g" (c_out));
-        __asm__ __volatile__("sets %0" : "=g" (n_out));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
+    void eor(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.ac ^= operand;
+        set_nz(regs, regs.ac);
+    }
 
-        set_if(c_out, C);
-        set_if(n_out, N);
-        set_if(z_out, Z);
+    void ora(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.ac |= operand;
+        set_nz(regs, regs.ac);
     }
 
-    void cpy() FORCEINLINE {
-        std::uint8_t idy{m_regs.yi};
-        std::uint8_t mem{read_instruction_input()};
+    void cmp(State& regs, std::uint8_t const operand) FORCEINLINE {
+        compare(regs, regs.ac, operand);
+    }
 
-        __asm__ __volatile__("cmpb %%bl, %%al" : : "a" (idy), "b" (mem));
+    void cpx(State& regs, std::uint8_t const operand) FORCEINLINE {
+        compare(regs, regs.xi, operand);
+    }
 
-        std::uint8_t c_out{};
-        std::uint8_t n_out{};
-        std::uint8_t z_out{};
-        __asm__ __volatile__("setnc %0" : "=g" (c_out));
-        __asm__ __volatile__("sets %0" : "=g" (n_out));
-        __asm__ __volatile__("setz %0" : "=g" (z_out));
+    void cpy(State& regs, std::uint8_t const operand) FORCEINLINE {
+        compare(regs, regs.yi, operand);
+    }
 
-        set_if(c_out, C);
-        set_if(n_out, N);
-        set_if(z_out, Z);
+    void compare(State& regs, std::uint8_t const reg, std::uint8_t const operand) FORCEINLINE {
+        AluResult const difference = Alu::compare(reg, operand);
+        set_if(regs, difference.carry, C);
+        set_nz(regs, difference.value);
     }
 
-    void dec() FORCEINLINE {
-        std::uint8_t mem{read_instruction_input()};
+    std::uint8_t dec(State& regs, std::uint8_t mem) FORCEINLINE {
 
         mem -= 1U;
-        set_if(mem >= 0x80, N);
-        set_if(mem == 0x00, Z);
+        set_nz(regs, mem);
 
-        write_instruction_output(mem);
+        return mem;
     }
 
-    void dex() FORCEINLINE {
-        m_regs.xi -= 1U;
-        set_if(m_regs.xi >= 0x80, N);
-        set_if(m_regs.xi == 0x00, Z);
+    void dex(State& regs) FORCEINLINE {
+        regs.xi -= 1U;
+        set_nz(regs, regs.xi);
     }
 
-    void dey() FORCEINLINE {
-        m_regs.yi -= 1U;
-        set_if(m_regs.yi >= 0x80, N);
-        set_if(m_regs.yi == 0x00, Z);
+    void dey(State& regs) FORCEINLINE {
+        regs.yi -= 1U;
+        set_nz(regs, regs.yi);
     }
 
-    void inc() FORCEINLINE {
-        std::uint8_t mem{read_instruction_input()};
+    std::uint8_t inc(State& regs, std::uint8_t mem) FORCEINLINE {
 
         mem += 1U;
-        set_if(mem >= 0x80, N);
-        set_if(mem == 0x00, Z);
+        set_nz(regs, mem);
 
-        write_instruction_output(mem);
+        return mem;
     }
 
-    void inx() FORCEINLINE {
-        m_regs.xi += 1U;
-        set_if(m_regs.xi >= 0x80, N);
-        set_if(m_regs.xi == 0x00, Z);
+    void inx(State& regs) FORCEINLINE {
+        regs.xi += 1U;
+        set_nz(regs, regs.xi);
     }
 
-    void iny() FORCEINLINE {
-        m_regs.yi += 1U;
-        set_if(m_regs.yi >= 0x80, N);
-        set_if(m_regs.yi == 0x00, Z);
+    void iny(State& regs) FORCEINLINE {
+        regs.yi += 1U;
+        set_nz(regs, regs.yi);
     }
 
-    void lda() FORCEINLINE {
-        m_regs.ac = read_instruction_input();
-        set_if(m_regs.ac >= 128U, N);
-        set_if(m_regs.ac == 0U,   Z);
+    void lda(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.ac = operand;
+        set_nz(regs, regs.ac);
     }
 
-    void ldx() FORCEINLINE {
-        m_regs.xi = read_instruction_input();
-        set_if(m_regs.xi >= 128U, N);
-        set_if(m_regs.xi == 0U,   Z);
+    void ldx(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.xi = operand;
+        set_nz(regs, regs.xi);
     }
 
-    void ldy() FORCEINLINE {
-        m_regs.yi = read_instruction_input();
-        set_if(m_regs.yi >= 128U, N);
-        set_if(m_regs.yi == 0U,   Z);
+    void ldy(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.yi = operand;
+        set_nz(regs, regs.yi);
     }
 
-    void sta() FORCEINLINE {
-        write_instruction_output(m_regs.ac);
+    std::uint8_t sta(State& regs) FORCEINLINE {
+        return regs.ac;
     }
 
-    void stx() FORCEINLINE {
-        write_instruction_output(m_regs.xi);
+    std::uint8_t stx(State& regs) FORCEINLINE {
+        return regs.xi;
     }
 
-    void sty() FORCEINLINE {
-        write_instruction_output(m_regs.yi);
+    std::uint8_t sty(State& regs) FORCEINLINE {
+        return regs.yi;
     }
 
-    void tax()FORCEINLINE {
-        m_regs.xi = m_regs.ac;
-        set_if(m_regs.xi >= 0x80, N);
-        set_if(m_regs.xi == 0x00, Z);
+    void tax(State& regs) FORCEINLINE {
+        regs.xi = regs.ac;
+        set_nz(regs, regs.xi);
     }
 
-    void tay() FORCEINLINE {
-        m_regs.yi = m_regs.ac;
-        set_if(m_regs.yi >= 0x80, N);
-        set_if(m_regs.yi == 0x00, Z);
+    void tay(State& regs) FORCEINLINE {
+        regs.yi = regs.ac;
+        set_nz(regs, regs.yi);
     }
 
-    void tsx() FORCEINLINE {
-        m_regs.xi = (m_regs.sp & 0x00FF);
-        set_if(m_regs.xi >= 0x80, N);
-        set_if(m_regs.xi == 0x00, Z);
+    void tsx(State& regs) FORCEINLINE {
+        regs.xi = (regs.sp & 0x00FF);
+        set_nz(regs, regs.xi);
     }
 
-    void txa() FORCEINLINE {
-        m_regs.ac = m_regs.xi;
-        set_if(m_regs.ac >= 0x80, N);
-        set_if(m_regs.ac == 0x00, Z);
+    void txa(State& regs) FORCEINLINE {
+        regs.ac = regs.xi;
+        set_nz(regs, regs.ac);
     }
 
-    void txs() FORCEINLINE {
-        m_regs.sp = (m_regs.sp & 0xFF00) | m_regs.xi;
-        set_if(m_regs.xi >= 0x80, N);
-        set_if(m_regs.xi == 0x00, Z);
+    void txs(State& regs) FORCEINLINE {
+        regs.sp = (regs.sp & 0xFF00) | regs.xi;
+        set_nz(regs, regs.xi);
     }
 
-    void tya()FORCEINLINE {
-        m_regs.ac = m_regs.yi;
-        set_if(m_regs.ac >= 0x80, N);
-        set_if(m_regs.ac == 0x00, Z);
+    void tya(State& regs) FORCEINLINE {
+        regs.ac = regs.yi;
+        set_nz(regs, regs.ac);
     }
 
-    void asl() FORCEINLINE {
-        std::uint8_t mem{read_instruction_input()};
+    std::uint8_t asl(State& regs, std::uint8_t mem) FORCEINLINE {
 
-        set_if(mem >= 0x80, C);
+        set_if(regs, mem >= 0x80, C);
         mem <<= 1;
-        set_if(mem >= 0x80, N);
-        set_if(mem == 0x00, Z);
+        set_nz(regs, mem);
 
-        write_instruction_output(mem);
+        return mem;
     }
 
-    void lsr() FORCEINLINE {
-        std::uint8_t mem{read_instruction_input()};
+    std::uint8_t lsr(State& regs, std::uint8_t mem) FORCEINLINE {
 
-        set_if(static_cast<bool>(mem & 1), C);
+        set_if(regs, static_cast<bool>(mem & 1), C);
         mem >>= 1;
-        set_if(false,       N);
-        set_if(mem == 0x00, Z);
+        set_nz(regs, mem);
 
-        write_instruction_output(mem);
+        return mem;
     }
 
-    void rol() FORCEINLINE {
-        std::uint8_t mem{read_instruction_input()};
+    std::uint8_t rol(State& regs, std::uint8_t mem) FORCEINLINE {
 
-        std::uint8_t carry_in{static_cast<bool>(m_regs.sr & C) ? std::uint8_t{1} : std::uint8_t{0}};
+        std::uint8_t carry_in{flag(regs, C) ? std::uint8_t{1} : std::uint8_t{0}};
         std::uint8_t carry_out{static_cast<std::uint8_t>(mem >> 7)};
 
         mem <<= 1;
         mem += carry_in;
 
-        set_if(carry_out, C);
-        set_if(mem >= 0x80, N);
-        set_if(mem == 0x00, Z);
+        set_if(regs, carry_out, C);
+        set_nz(regs, mem);
 
-        write_instruction_output(mem);
+        return mem;
     }
 
-    void ror()FORCEINLINE {
-        std::uint8_t mem{read_instruction_input()};
+    std::uint8_t ror(State& regs, std::uint8_t mem) FORCEINLINE {
 
-        std::uint8_t carry_in{static_cast<bool>(m_regs.sr & C) ? std::uint8_t{0x80} : std::uint8_t{0}};
+        std::uint8_t carry_in{flag(regs, C) ? std::uint8_t{0x80} : std::uint8_t{0}};
         std::uint8_t carry_out{static_cast<std::uint8_t>(mem & 1)};
 
         mem >>= 1;
         mem += carry_in;
 
-        set_if(carry_out, C);
-        set_if(mem >= 0x80, N);
-        set_if(mem == 0x00, Z);
+        set_if(regs, carry_out, C);
+        set_nz(regs, mem);
+
+        return mem;
+    }
+
+    std::uint8_t trb(State& regs, std::uint8_t const mem) FORCEINLINE {
+        set_z(regs, static_cast<std::uint8_t>(regs.ac & mem));
+        return static_cast<std::uint8_t>(mem & ~regs.ac);
+    }
+
+    std::uint8_t tsb(State& regs, std::uint8_t const mem) FORCEINLINE {
+        set_z(regs, static_cast<std::uint8_t>(regs.ac & mem));
+        return static_cast<std::uint8_t>(mem | regs.ac);
+    }
+
+    /// ASL then ORA
+    std::uint8_t slo(State& regs, std::uint8_t mem) FORCEINLINE {
+        mem = asl(regs, mem);
+        ora(regs, mem);
+        return mem;
+    }
+
+    /// ROL then AND
+    std::uint8_t rla(State& regs, std::uint8_t mem) FORCEINLINE {
+        mem = rol(regs, mem);
+        amd(regs, mem);
+        return mem;
+    }
+
+    /// LSR then EOR
+    std::uint8_t sre(State& regs, std::uint8_t mem) FORCEINLINE {
+        mem = lsr(regs, mem);
+        eor(regs, mem);
+        return mem;
+    }
+
+    /// ROR then ADC
+    std::uint8_t rra(State& regs, std::uint8_t mem) FORCEINLINE {
+        mem = ror(regs, mem);
+        adc(regs, mem);
+        return mem;
+    }
+
+    /// DEC then CMP
+    std::uint8_t dcp(State& regs, std::uint8_t mem) FORCEINLINE {
+        mem -= 1U;
+        cmp(regs, mem);
+        return mem;
+    }
+
+    /// INC then SBC
+    std::uint8_t isc(State& regs, std::uint8_t mem) FORCEINLINE {
+        mem += 1U;
+        sbc(regs, mem);
+        return mem;
+    }
+
+    /// AND then LSR A
+    void alr(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.ac = lsr(regs, static_cast<std::uint8_t>(regs.ac & operand));
+    }
+
+    /// AND copying N to C
+    void anc(State& regs, std::uint8_t const operand) FORCEINLINE {
+        amd(regs, operand);
+        set_if(regs, regs.ac >= 0x80, C);
+    }
+
+    /// A = (A | magic) & X & operand
+    void ane(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.ac = static_cast<std::uint8_t>((regs.ac | kUnstableMagic) & regs.xi & operand);
+        set_nz(regs, regs.ac);
+    }
+
+    /// AND then ROR A, C comes from bit 6 and V from bit 6 xor bit 5
+    /// @note Decimal mode is not emulated, the result is always binary
+    void arr(State& regs, std::uint8_t const operand) FORCEINLINE {
+        std::uint8_t const carry_in{flag(regs, C) ? std::uint8_t{0x80} : std::uint8_t{0}};
+        regs.ac = static_cast<std::uint8_t>(((regs.ac & operand) >> 1) | carry_in);
+        set_if(regs, static_cast<bool>(regs.ac & 0x40), C);
+        set_if(regs, static_cast<bool>((regs.ac ^ (regs.ac << 1)) & 0x40), V);
+        set_nz(regs, regs.ac);
+    }
+
+    /// A, X and S = operand & S
+    void las(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.ac = static_cast<std::uint8_t>(operand & regs.sp);
+        regs.xi = regs.ac;
+        regs.sp = static_cast<std::uint16_t>((regs.sp & 0xFF00) | regs.ac);
+        set_nz(regs, regs.ac);
+    }
+
+    /// LDA and LDX at once
+    void lax(State& regs, std::uint8_t const operand) FORCEINLINE {
+        regs.ac = operand;
+        regs.xi = operand;
+        set_nz(regs, operand);
+    }
+
+    /// A and X = (A | magic) & operand
+    void lxa(State& regs, std::uint8_t const operand) FORCEINLINE {
+        lax(regs, static_cast<std::uint8_t>((regs.ac | kUnstableMagic) & operand));
+    }
+
+    /// X = (A & X) - operand, flags as CMP
+    void sbx(State& regs, std::uint8_t const operand) FORCEINLINE {
+        std::uint8_t const masked = regs.ac & regs.xi;
+        compare(regs, masked, operand);
+        regs.xi = static_cast<std::uint8_t>(masked - operand);
+    }
+
+    std::uint8_t sax(State& regs) FORCEINLINE {
+        return regs.ac & regs.xi;
+    }
+
+    /// S = A & X, stores S & (H + 1)
+    std::uint8_t tas(State& regs) FORCEINLINE {
+        regs.sp = static_cast<std::uint16_t>((regs.sp & 0xFF00) | sax(regs));
+        return sax(regs);
+    }
 
-        write_instruction_output(mem);
+    void pha(State& regs) FORCEINLINE {
+        push(regs, regs.ac);
     }
 
-    void pha() FORCEINLINE {
-        push(m_regs.ac);
+    void php(State& regs) FORCEINLINE {
+        push(regs, read_status(regs));
     }
 
-    void php() FORCEINLINE {
-        push(m_regs.sr);
+    void pla(State& regs) FORCEINLINE {
+        regs.ac = pull(regs);
+        set_nz(regs, regs.ac);
     }
 
-    void pla() FORCEINLINE {
-        m_regs.ac = pull();
-        set_if(m_regs.ac >= 0x80, N);
-        set_if(m_regs.ac == 0x00, Z);
+    void plp(State& regs) FORCEINLINE {
+        write_status(regs, static_cast<std::uint8_t>((pull(regs) & 0xCF) | (regs.sr & 0x30)));
     }
 
-    void plp() FORCEINLINE {
-        m_regs.sr = (pull() & 0xCF) | (m_regs.sr & 0x30);
+    void plx(State& regs) FORCEINLINE {
+        regs.xi = pull(regs);
+        set_nz(regs, regs.xi);
     }
 
-    void rti() FORCEINLINE {
-        plp();
-        rts();
+    void ply(State& regs) FORCEINLINE {
+        regs.yi = pull(regs);
+        set_nz(regs, regs.yi);
     }
 
-    void jsr() FORCEINLINE {
-        std::uint8_t const pc_lo = (m_regs.pc >> 0) & 0xFF;
-        std::uint8_t const pc_hi = (m_regs.pc >> 8) & 0xFF;
-        push(pc_hi);
-        push(pc_lo);
-        m_regs.pc = m_immediate16;
+    void rti(State& regs) FORCEINLINE {
+        plp(regs);
+        rts(regs);
     }
 
-    void rts() FORCEINLINE {
-        std::uint8_t const pc_lo = pull();
-        std::uint8_t const pc_hi = pull();
-        m_regs.pc = ((pc_hi << 8) & 0xFF00) | pc_lo;
+    void jsr(State& regs, std::uint16_t const target) FORCEINLINE {
+        std::uint8_t const pc_lo = (regs.pc >> 0) & 0xFF;
+        std::uint8_t const pc_hi = (regs.pc >> 8) & 0xFF;
+        push(regs, pc_hi);
+        push(regs, pc_lo);
+        regs.pc = target;
     }
 
-    void jmp_abs() FORCEINLINE {
-        m_regs.pc = m_immediate16;
+    void rts(State& regs) FORCEINLINE {
+        std::uint8_t const pc_lo = pull(regs);
+        std::uint8_t const pc_hi = pull(regs);
+        regs.pc = ((pc_hi << 8) & 0xFF00) | pc_lo;
     }
 
-    void jmp_ind() FORCEINLINE {
-        std::uint8_t const pc_lo = m_bus->read(m_immediate16);
-        std::uint8_t const pc_hi = m_bus->read(m_immediate16 + 1U);
-        m_regs.pc = ((pc_hi << 8) & 0xFF00) | pc_lo;
+    void jmp_abs(State& regs, std::uint16_t const target) FORCEINLINE {
+        regs.pc = target;
     }
 
-    void bcc() FORCEINLINE {
-        if ((m_regs.sr & C) == 0) {
-            jmp_rel();
+    void jmp_ind(State& regs, std::uint16_t const pointer) FORCEINLINE {
+        std::uint16_t next = static_cast<std::uint16_t>(pointer + 1U);
+        if constexpr (Variant::kIndirectJumpWraps) {
+            // The NMOS 6502 does not carry into the high byte, JMP ($xxFF) reads $xx00
+            next = static_cast<std::uint16_t>((pointer & 0xFF00) | (next & 0x00FF));
         }
+        std::uint8_t const pc_lo = bus_read(pointer);
+        std::uint8_t const pc_hi = bus_read(next);
+        regs.pc = ((pc_hi << 8) & 0xFF00) | pc_lo;
     }
 
-    void bcs() FORCEINLINE {
-        if ((m_regs.sr & C) == C) {
-            jmp_rel();
+    void bcc(State& regs, std::uint8_t const offset) FORCEINLINE {
+        if (!flag(regs, C)) {
+            jmp_rel(regs, offset);
         }
     }
 
-    void beq() FORCEINLINE {
-        if ((m_regs.sr & Z) == Z) {
-            jmp_rel();
+    void bcs(State& regs, std::uint8_t const offset) FORCEINLINE {
+        if (flag(regs, C)) {
+            jmp_rel(regs, offset);
         }
     }
 
-    void bne() FORCEINLINE {
-        if ((m_regs.sr & Z) == 0) {
-            jmp_rel();
+    void beq(State& regs, std::uint8_t const offset) FORCEINLINE {
+        if (flag(regs, Z)) {
+            jmp_rel(regs, offset);
         }
     }
 
-    void bmi() FORCEINLINE {
-        if ((m_regs.sr & N) == N) {
-            jmp_rel();
+    void bne(State& regs, std::uint8_t const offset) FORCEINLINE {
+        if (!flag(regs, Z)) {
+            jmp_rel(regs, offset);
         }
     }
 
-    void bpl() FORCEINLINE {
-        if ((m_regs.sr & N) == 0) {
-            jmp_rel();
+    void bmi(State& regs, std::uint8_t const offset) FORCEINLINE {
+        if (flag(regs, N)) {
+            jmp_rel(regs, offset);
         }
     }
 
-    void bvs() FORCEINLINE {
-        if ((m_regs.sr & V) == V) {
-            jmp_rel();
+    void bpl(State& regs, std::uint8_t const offset) FORCEINLINE {
+        if (!flag(regs, N)) {
+            jmp_rel(regs, offset);
         }
     }
 
-    void bvc() FORCEINLINE {
-        if ((m_regs.sr & V) == 0) {
-            jmp_rel();
+    void bvs(State& regs, std::uint8_t const offset) FORCEINLINE {
+        if (flag(regs, V)) {
+            jmp_rel(regs, offset);
         }
     }
 
-    void request_interrupt(std::uint16_t addr, bool software = false) FORCEINLINE {
-        std::uint8_t const pc_lo = (m_regs.pc >> 0) & 0xFF;
-        std::uint8_t const pc_hi = (m_regs.pc >> 8) & 0xFF;
+    void bvc(State& regs, std::uint8_t const offset) FORCEINLINE {
+        if (!flag(regs, V)) {
+            jmp_rel(regs, offset);
+        }
+    }
+
+    void request_interrupt(State& regs, std::uint16_t addr, bool software = false) FORCEINLINE {
+        std::uint8_t const pc_lo = (regs.pc >> 0) & 0xFF;
+        std::uint8_t const pc_hi = (regs.pc >> 8) & 0xFF;
 
-        std::uint8_t const handler_lo = m_bus->read(addr);
-        std::uint8_t const handler_hi = m_bus->read(addr + 1U);
+        std::uint8_t const handler_lo = bus_read(addr);
+        std::uint8_t const handler_hi = bus_read(addr + 1U);
         std::uint16_t const handler = ((handler_hi << 8) | handler_lo) & 0xFFFF;
 
-        std::uint8_t status = m_regs.sr;
+        std::uint8_t status = read_status(regs);
         if (software) {
             status |= B;
         } else {
@@ -1009,265 +1618,187 @@ private:
         }
 
         // Save current context
-        push(pc_hi);
-        push(pc_lo);
-        push(status);
+        push(regs, pc_hi);
+        push(regs, pc_lo);
+        push(regs, status);
 
         // Interrupt handler
-        m_regs.pc = handler;
+        regs.pc = handler;
 
         // Disable Interrupts
-        m_regs.sr |= I;
+        regs.sr |= I;
+        if constexpr (Variant::kInterruptClearsDecimal) {
+            regs.sr &= ~D;
+        }
     }
 
-    void jmp_rel() FORCEINLINE {
-        *(reinterpret_cast<std::int16_t*>(&m_regs.pc)) += static_cast<std::int16_t>(static_cast<std::int8_t>(m_immediate8));
+    void jmp_rel(State& regs, std::uint8_t const offset) FORCEINLINE {
+        *(reinterpret_cast<std::int16_t*>(&regs.pc)) += static_cast<std::int16_t>(static_cast<std::int8_t>(offset));
     }
 
-    void push(std::uint8_t const arg) FORCEINLINE {
-        m_bus->write(m_regs.sp, arg);
-        m_regs.sp = (m_regs.sp & 0xFF00) | (((m_regs.sp & 0xFF) - 1U) & 0xFF);
+    void push(State& regs, std::uint8_t const arg) FORCEINLINE {
+        bus_write(regs.sp, arg);
+        regs.sp = (regs.sp & 0xFF00) | (((regs.sp & 0xFF) - 1U) & 0xFF);
     }
 
-    std::uint8_t pull() FORCEINLINE {
-        m_regs.sp = (m_regs.sp & 0xFF00) | ((m_regs.sp + 1U) & 0x00FF);
-        return m_bus->read(m_regs.sp);
+    std::uint8_t pull(State& regs) FORCEINLINE {
+        regs.sp = (regs.sp & 0xFF00) | ((regs.sp + 1U) & 0x00FF);
+        return bus_read(regs.sp);
     }
 
-    void set_if(bool cond, std::uint8_t status) FORCEINLINE {
-        if (cond) {
-            m_regs.sr |= status;
-        } else {
-            m_regs.sr &= ~status;
-        }
-    }
-
-    std::uint8_t read_instruction_input() FORCEINLINE {
-        // Declutter switch inside switch using goto
-        switch (m_instruction.parts.group)
-        {
-        case 1: goto group_one;
-        case 2: goto group_two;
-        case 0: goto group_three;
-        default: goto unsupported;
-        }
-
-        group_one:
-        switch (m_instruction.parts.addr)
-        {
-        case 0: goto indirect_x;
-        case 1: goto zero_page;
-        case 2: goto immediate;
-        case 3: goto absolute;
-        case 4: goto indirect_y;
-        case 5: goto zero_page_x;
-        case 6: goto absolute_y;
-        case 7: goto absolute_x;
-        default: goto unsupported;
-        }
-
-        group_two:
-        switch (m_instruction.parts.addr)
-        {
-        case 0: goto immediate;
-        case 1: goto zero_page;
-        case 2:
-            if (m_instruction.parts.oper < 4) {
-                goto accumulator;
-            } else {
-                goto unsupported;
-            }
-        case 3: goto absolute;
-        case 4: goto unsupported;
-        case 5:
-            if (m_instruction.parts.oper == 4 ||
-                m_instruction.parts.oper == 5) {
-                goto zero_page_y;
-            } else {
-                goto zero_page_x;
+    void set_if(State& regs, bool cond, std::uint8_t status) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            if (status == C) {
+                regs.carry = static_cast<std::uint8_t>(cond ? C : 0U);
+                return;
             }
-        case 6: goto unsupported;
-        case 7:
-            if (m_instruction.parts.oper == 5) {
-                goto absolute_y;
-            } else {
-                goto absolute_x;
-            }
-        default: goto unsupported;
-        }
-
-        group_three:
-        switch (m_instruction.parts.addr)
-        {
-        case 0: goto immediate;
-        case 1: goto zero_page;
-        case 2: goto unsupported;
-        case 3: goto absolute;
-        case 4: goto unsupported;
-        case 5: goto zero_page_x;
-        case 6: goto unsupported;
-        case 7: goto absolute_x;
-        default: goto unsupported;
-        }
-
-        accumulator:
-        return m_regs.ac;
-
-        immediate:
-        return m_immediate8;
-
-        absolute:
-        return m_bus->read(m_immediate16);
-
-        absolute_x:
-        return m_bus->read(m_immediate16 + m_regs.xi);
-
-        absolute_y:
-        return m_bus->read(m_immediate16 + m_regs.yi);
-
-        zero_page:
-        return m_bus->read(m_immediate8);
-
-        zero_page_x:
-        return m_bus->read((m_immediate8 + m_regs.xi) & 0xFF);
-
-        zero_page_y:
-        return m_bus->read((m_immediate8 + m_regs.yi) & 0xFF);
-
-        indirect_x:
-        {
-            std::uint8_t lo = m_bus->read((m_immediate8 + m_regs.xi)      & 0xFF);
-            std::uint8_t hi = m_bus->read((m_immediate8 + m_regs.xi + 1U) & 0xFF);
-            std::uint16_t addr = ((hi << 8) | lo) & 0xFFFF;
-            return m_bus->read(addr);
-        }
-
-        indirect_y:
-        {
-            std::uint8_t lo = m_bus->read(m_immediate8);
-            std::uint8_t hi = m_bus->read((m_immediate8 + 1U) & 0xFF);
-            std::uint16_t addr = ((hi << 8) | lo) & 0xFFFF;
-            return m_bus->read((addr + m_regs.yi) & 0xFFFF);
-        }
-
-        unsupported:
-        illegal();
-    }
-
-    void write_instruction_output(std::uint8_t data) FORCEINLINE {
-        // Declutter switch inside switch using goto
-        switch (m_instruction.parts.group)
-        {
-        case 1: goto group_one;
-        case 2: goto group_two;
-        case 0: goto group_three;
-        default: goto unsupported;
-        }
-
-        group_one:
-        switch (m_instruction.parts.addr)
-        {
-        case 0: goto indirect_x;
-        case 1: goto zero_page;
-        case 2: goto unsupported;
-        case 3: goto absolute;
-        case 4: goto indirect_y;
-        case 5: goto zero_page_x;
-        case 6: goto absolute_y;
-        case 7: goto absolute_x;
-        default: goto unsupported;
-        }
-
-        group_two:
-        switch (m_instruction.parts.addr)
-        {
-        case 0: goto unsupported;
-        case 1: goto zero_page;
-        case 2:
-            if (m_instruction.parts.oper < 4) {
-                goto accumulator;
-            } else {
-                goto unsupported;
-            }
-        case 3: goto absolute;
-        case 4: goto unsupported;
-        case 5:
-            if (m_instruction.parts.oper == 4 ||
-                m_instruction.parts.oper == 5) {
-                goto zero_page_y;
-            } else {
-                goto zero_page_x;
+            if (status == V) {
+                regs.overflow = static_cast<std::uint8_t>(cond ? 0x80U : 0U);
+                return;
             }
-        case 6: goto unsupported;
-        case 7:
-            if (m_instruction.parts.oper == 5) {
-                goto absolute_y;
-            } else {
-                goto absolute_x;
-            }
-        default: goto unsupported;
         }
+        regs.sr = static_cast<std::uint8_t>((regs.sr & ~status) | (cond ? status : 0U));
+    }
 
-        group_three:
-        switch (m_instruction.parts.addr)
-        {
-        case 0: goto unsupported;
-        case 1: goto zero_page;
-        case 2: goto unsupported;
-        case 3: goto absolute;
-        case 4: goto unsupported;
-        case 5: goto zero_page_x;
-        case 6: goto unsupported;
-        case 7: goto absolute_x;
-        default: goto unsupported;
-        }
+    /// Set N from bit 7 of a result and Z when it is zero
+    void set_nz(State& regs, std::uint8_t const result) FORCEINLINE {
+        set_nz(regs, result, result);
+    }
 
-        accumulator:
-        m_regs.ac = data;
-        return;
+    /// Set N from bit 7 of negative and Z when zero is zero
+    void set_nz(State& regs, std::uint8_t const negative, std::uint8_t const zero) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            regs.negative = negative;
+            regs.zero = zero;
+        } else {
+            regs.sr = static_cast<std::uint8_t>((regs.sr & ~(N | Z)) | (kNZFlags[negative] & N) | (kNZFlags[zero] & Z));
+        }
+    }
 
-        absolute:
-        m_bus->write(m_immediate16, data);
-        return;
+    /// Set Z when zero is zero, leaving N unchanged
+    void set_z(State& regs, std::uint8_t const zero) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            regs.zero = zero;
+        } else {
+            regs.sr = static_cast<std::uint8_t>((regs.sr & ~Z) | (kNZFlags[zero] & Z));
+        }
+    }
 
-        absolute_x:
-        m_bus->write(m_immediate16 + m_regs.xi, data);
-        return;
+    /// Check whether a flag is set
+    static bool flag(State const& regs, std::uint8_t const status) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            switch (status) {
+            case N: return (regs.negative & N) != 0U;
+            case Z: return regs.zero == 0U;
+            case C: return regs.carry != 0U;
+            case V: return (regs.overflow & 0x80) != 0U;
+            default: break;
+            }
+        }
+        return (regs.sr & status) != 0U;
+    }
 
-        absolute_y:
-        m_bus->write(m_immediate16 + m_regs.yi, data);
-        return;
+    /// Retrieve the status register with every flag materialized
+    static std::uint8_t read_status(State const& regs) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            return regs.status();
+        } else {
+            return regs.sr;
+        }
+    }
 
-        zero_page:
-        m_bus->write(m_immediate8, data);
-        return;
+    /// Replace the status register
+    static void write_status(State& regs, std::uint8_t const status) FORCEINLINE {
+        if constexpr (kLazyFlags) {
+            regs.set_status(status);
+        } else {
+            regs.sr = status;
+        }
+    }
 
-        zero_page_x:
-        m_bus->write((m_immediate8 + m_regs.xi) & 0xFF, data);
-        return;
+    /// Compute the effective address of a memory operand
+    /// @tparam PagePenalty extra cycles to account when indexing crosses a page boundary
+    template<AddressMode Mode, std::uint8_t PagePenalty = 0>
+    FORCEINLINE std::uint16_t effective_address(State const& regs, Operand& operand) {
+        if constexpr (Mode == AddressMode::ZeroPage) {
+            return operand.value;
+        } else if constexpr (Mode == AddressMode::ZeroPageX) {
+            return static_cast<std::uint8_t>(operand.value + regs.xi);
+        } else if constexpr (Mode == AddressMode::ZeroPageY) {
+            return static_cast<std::uint8_t>(operand.value + regs.yi);
+        } else if constexpr (Mode == AddressMode::Absolute) {
+            return operand.value;
+        } else if constexpr (Mode == AddressMode::AbsoluteX) {
+            account_page_penalty<PagePenalty>(operand, operand.value, regs.xi);
+            return static_cast<std::uint16_t>(operand.value + regs.xi);
+        } else if constexpr (Mode == AddressMode::AbsoluteY) {
+            account_page_penalty<PagePenalty>(operand, operand.value, regs.yi);
+            return static_cast<std::uint16_t>(operand.value + regs.yi);
+        } else if constexpr (Mode == AddressMode::ZeroPageIndirect) {
+            std::uint8_t const lo = bus_read(operand.value);
+            std::uint8_t const hi = bus_read(static_cast<std::uint8_t>(operand.value + 1U));
+            return static_cast<std::uint16_t>((hi << 8) | lo);
+        } else if constexpr (Mode == AddressMode::IndirectX) {
+            std::uint8_t const lo = bus_read(static_cast<std::uint8_t>(operand.value + regs.xi));
+            std::uint8_t const hi = bus_read(static_cast<std::uint8_t>(operand.value + regs.xi + 1U));
+            return static_cast<std::uint16_t>((hi << 8) | lo);
+        } else {
+            static_assert(Mode == AddressMode::IndirectY, "addressing mode does not reference memory");
+            std::uint8_t const lo = bus_read(operand.value);
+            std::uint8_t const hi = bus_read(static_cast<std::uint8_t>(operand.value + 1U));
+            account_page_penalty<PagePenalty>(operand, lo, regs.yi);
+            return static_cast<std::uint16_t>(((hi << 8) | lo) + regs.yi);
+        }
+    }
 
-        zero_page_y:
-        m_bus->write((m_immediate8 + m_regs.yi) & 0xFF, data);
-        return;
+    /// Account extra cycles when base plus index crosses a page boundary
+    template<std::uint8_t PagePenalty>
+    FORCEINLINE void account_page_penalty(Operand& operand, std::uint16_t const base, std::uint8_t const index) {
+        if constexpr (PagePenalty != 0) {
+            std::uint8_t const crossed = static_cast<std::uint8_t>(((base & 0xFF) + index) >> 8);
+            operand.extra_cycles = static_cast<std::uint8_t>(operand.extra_cycles + crossed * PagePenalty);
+        } else {
+            static_cast<void>(base);
+            static_cast<void>(index);
+        }
+    }
 
-        indirect_x:
-        {
-            std::uint8_t lo = m_bus->read((m_immediate8 + m_regs.xi)      & 0xFF);
-            std::uint8_t hi = m_bus->read((m_immediate8 + m_regs.xi + 1U) & 0xFF);
-            std::uint16_t addr = ((hi << 8) | lo) & 0xFFFF;
-            return m_bus->write(addr, data);
+    /// Read the operand of an instruction
+    template<AddressMode Mode, std::uint8_t PagePenalty = 0>
+    FORCEINLINE std::uint8_t read_operand(State const& regs, Operand& operand) {
+        if constexpr (Mode == AddressMode::Accumulator) {
+            return regs.ac;
+        } else if constexpr (Mode == AddressMode::Immediate) {
+            return static_cast<std::uint8_t>(operand.value);
+        } else {
+            return bus_read(effective_address<Mode, PagePenalty>(regs, operand));
         }
+    }
 
-        indirect_y:
-        {
-            std::uint8_t lo = m_bus->read(m_immediate8);
-            std::uint8_t hi = m_bus->read((m_immediate8 + 1U) & 0xFF);
-            std::uint16_t addr = ((hi << 8) | lo) & 0xFFFF;
-            return m_bus->write((addr + m_regs.yi) & 0xFFFF, data);
+    /// Write data & (H + 1), where H is the high byte of the address before indexing
+    ///
+    /// Stores of the NMOS 6502 unstable opcodes (SHA, SHX, SHY, TAS). When indexing crosses
+    /// a page the high byte of the address is replaced by the data written.
+    template<AddressMode Mode>
+    FORCEINLINE void write_unstable(State& regs, Operand& operand, std::uint8_t const data) {
+        std::uint16_t addr = effective_address<Mode>(regs, operand);
+        std::uint8_t const index = Mode == AddressMode::AbsoluteX ? regs.xi : regs.yi;
+        std::uint16_t const base = static_cast<std::uint16_t>(addr - index);
+        std::uint8_t const value = static_cast<std::uint8_t>(data & ((base >> 8) + 1U));
+        if (((base ^ addr) & 0xFF00) != 0U) {
+            addr = static_cast<std::uint16_t>((value << 8) | (addr & 0x00FF));
         }
+        bus_write(addr, value);
+    }
 
-        unsupported:
-        illegal();
+    /// Write the operand of an instruction
+    template<AddressMode Mode>
+    FORCEINLINE void write_operand(State& regs, Operand& operand, std::uint8_t const data) {
+        if constexpr (Mode == AddressMode::Accumulator) {
+            regs.ac = data;
+        } else {
+            bus_write(effective_address<Mode>(regs, operand), data);
+        }
     }
 };
 }
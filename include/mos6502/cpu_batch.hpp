@@ -0,0 +1,395 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "mos6502/cpu.hpp"
+#include "mos6502/opcodes.hpp"
+#include "mos6502/regs.hpp"
+#include "mos6502/status.hpp"
+#include "mos6502/traits.hpp"
+
+namespace mos6502
+{
+/// Bus of a lane of CpuBatch, a flat 64KiB window on the batch arena
+class LaneBus final {
+public:
+    explicit LaneBus(std::uint8_t* memory) : m_memory{memory} {}
+
+    std::uint8_t read(std::uint16_t addr) {
+        return m_memory[addr];
+    }
+
+    void write(std::uint16_t addr, std::uint8_t data) {
+        m_memory[addr] = data;
+    }
+
+    std::uint8_t const* read_page(std::uint8_t page) const {
+        return m_memory + (page << 8);
+    }
+
+    std::uint8_t* write_page(std::uint8_t page) const {
+        return m_memory + (page << 8);
+    }
+
+private:
+    std::uint8_t* m_memory;
+};
+
+/// Many independent 6502 running in lockstep
+///
+/// Registers are stored as a structure of arrays, one element per lane, and the memory of every
+/// lane lives in a single arena. Each step groups the lanes by the opcode they fetched and runs
+/// the group at once with a lane mask, so lanes whose program counters diverged only cost an
+/// extra pass. The common opcodes are branch-free loops over the lanes that the compiler
+/// vectorizes for the instruction set enabled (e.g. -mavx2, -mavx512bw), the rest run lane by
+/// lane on a scalar Cpu.
+/// @tparam LaneCount number of lanes
+/// @tparam Traits configuration of the scalar Cpu (see CpuTraits)
+template<std::size_t LaneCount, class Traits = CpuTraits>
+class CpuBatch final {
+    static_assert(!std::is_same_v<typename Traits::Dispatch, BlockCacheDispatch> &&
+                  !std::is_same_v<typename Traits::Dispatch, JitDispatch>,
+                  "lanes are written behind the scalar Cpu, decoded blocks would go stale");
+
+public:
+    static constexpr std::size_t kLanes{LaneCount};
+    static constexpr std::size_t kMemorySize{0x10000};
+
+    /// Distance between the memory of two lanes, skewed by a cache line so the lanes fetching the
+    /// same address do not compete for the same cache set
+    static constexpr std::size_t kLaneStride{kMemorySize + 64U};
+
+    using Lanes8 = std::array<std::uint8_t, LaneCount>;
+    using Lanes16 = std::array<std::uint16_t, LaneCount>;
+
+    CpuBatch() : m_arena{std::make_unique<std::uint8_t[]>(LaneCount * kLaneStride)} {
+        m_buses.reserve(LaneCount);
+        m_scalar.reserve(LaneCount);
+        for (std::size_t lane = 0U; lane < LaneCount; ++lane) {
+            m_scalar.emplace_back(m_buses.emplace_back(memory(lane).data()));
+            set_regs(lane, m_scalar.back().regs());
+        }
+    }
+
+    /// Retrieve the registers of a lane
+    Registers regs(std::size_t const lane) const {
+        return Registers{m_ac[lane], m_xi[lane], m_yi[lane], m_sr[lane], m_sp[lane], m_pc[lane]};
+    }
+
+    /// Replace the registers of a lane
+    void set_regs(std::size_t const lane, Registers const& regs) {
+        m_ac[lane] = regs.ac;
+        m_xi[lane] = regs.xi;
+        m_yi[lane] = regs.yi;
+        m_sr[lane] = regs.sr;
+        m_sp[lane] = regs.sp;
+        m_pc[lane] = regs.pc;
+    }
+
+    /// Retrieve the memory of a lane
+    std::span<std::uint8_t, kMemorySize> memory(std::size_t const lane) {
+        return std::span<std::uint8_t, kMemorySize>{m_arena.get() + lane * kLaneStride, kMemorySize};
+    }
+
+    /// Copy data to the same address of every lane (e.g. the ROM)
+    void load(std::uint16_t const addr, std::span<std::uint8_t const> const data) {
+        for (std::size_t lane = 0U; lane < LaneCount; ++lane) {
+            std::copy_n(data.begin(), std::min(data.size(), kMemorySize - addr), memory(lane).begin() + addr);
+        }
+    }
+
+    /// Set the program counter of every lane
+    void jump(std::uint16_t const pc) {
+        m_pc.fill(pc);
+    }
+
+    /// Retrieve the cycles consumed by a lane
+    std::uint64_t cycles(std::size_t const lane) const {
+        return m_cycles[lane];
+    }
+
+    /// Execute one instruction on every lane
+    void step() {
+        Lanes8 active{};
+        active.fill(0xFF);
+        step(active);
+    }
+
+    /// Run every lane until it consumes the cycle budget
+    /// @note Like Cpu::run_cycles the last instruction of a lane may overshoot the budget
+    void run_cycles(std::uint64_t const budget) {
+        std::array<std::uint64_t, LaneCount> target{};
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            target[i] = m_cycles[i] + budget;
+        }
+        for (;;) {
+            Lanes8 active{};
+            bool any{};
+            for (std::size_t i = 0U; i < LaneCount; ++i) {
+                active[i] = m_cycles[i] < target[i] ? 0xFF : 0x00;
+                any |= m_cycles[i] < target[i];
+            }
+            if (!any) {
+                return;
+            }
+            step(active);
+        }
+    }
+
+private:
+    std::unique_ptr<std::uint8_t[]> m_arena;
+    std::vector<LaneBus> m_buses{};
+    std::vector<Cpu<LaneBus, Traits>> m_scalar{};
+
+    alignas(64) Lanes8 m_ac{};
+    alignas(64) Lanes8 m_xi{};
+    alignas(64) Lanes8 m_yi{};
+    alignas(64) Lanes8 m_sr{};
+    alignas(64) Lanes16 m_sp{};
+    alignas(64) Lanes16 m_pc{};
+    alignas(64) std::array<std::uint64_t, LaneCount> m_cycles{};
+
+    std::uint8_t* lane_memory(std::size_t const lane) const {
+        return m_arena.get() + lane * kLaneStride;
+    }
+
+    /// Execute one instruction on the active lanes, one pass per distinct opcode
+    void step(Lanes8 const& active) {
+        alignas(64) Lanes8 opcodes{};
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            opcodes[i] = lane_memory(i)[m_pc[i]];
+        }
+
+        Lanes8 pending{active};
+        for (std::size_t leader = 0U; leader < LaneCount; ++leader) {
+            if (pending[leader] == 0U) {
+                continue;
+            }
+            std::uint8_t const opcode = opcodes[leader];
+            alignas(64) Lanes8 mask{};
+            for (std::size_t i = 0U; i < LaneCount; ++i) {
+                mask[i] = (opcodes[i] == opcode) ? pending[i] : std::uint8_t{0};
+                pending[i] = static_cast<std::uint8_t>(pending[i] & ~mask[i]);
+            }
+            execute(opcode, mask);
+        }
+    }
+
+    /// Execute an opcode on the lanes of the mask
+    void execute(std::uint8_t const opcode, Lanes8 const& mask) {
+        OpcodeInfo const& info = Traits::Variant::kOpcodes[opcode];
+        bool const immediate = info.mode == AddressMode::Immediate;
+        bool const zero_page = info.mode == AddressMode::ZeroPage;
+
+        switch (info.mnemonic) {
+        case Mnemonic::LDA: if (immediate || zero_page) { load(mask, info, m_ac); return; } break;
+        case Mnemonic::LDX: if (immediate || zero_page) { load(mask, info, m_xi); return; } break;
+        case Mnemonic::LDY: if (immediate || zero_page) { load(mask, info, m_yi); return; } break;
+        case Mnemonic::STA: if (zero_page) { store(mask, info, m_ac); return; } break;
+        case Mnemonic::STX: if (zero_page) { store(mask, info, m_xi); return; } break;
+        case Mnemonic::STY: if (zero_page) { store(mask, info, m_yi); return; } break;
+        case Mnemonic::AND: if (immediate) { logic(mask, info, [](auto a, auto m) { return a & m; }); return; } break;
+        case Mnemonic::ORA: if (immediate) { logic(mask, info, [](auto a, auto m) { return a | m; }); return; } break;
+        case Mnemonic::EOR: if (immediate) { logic(mask, info, [](auto a, auto m) { return a ^ m; }); return; } break;
+        case Mnemonic::ADC: if (immediate) { add(mask, info, false); return; } break;
+        case Mnemonic::SBC: if (immediate) { add(mask, info, true); return; } break;
+        case Mnemonic::CMP: if (immediate) { compare(mask, info, m_ac); return; } break;
+        case Mnemonic::CPX: if (immediate) { compare(mask, info, m_xi); return; } break;
+        case Mnemonic::CPY: if (immediate) { compare(mask, info, m_yi); return; } break;
+        case Mnemonic::TAX: transfer(mask, info, m_ac, m_xi); return;
+        case Mnemonic::TAY: transfer(mask, info, m_ac, m_yi); return;
+        case Mnemonic::TXA: transfer(mask, info, m_xi, m_ac); return;
+        case Mnemonic::TYA: transfer(mask, info, m_yi, m_ac); return;
+        case Mnemonic::INX: increment(mask, info, m_xi, 1U); return;
+        case Mnemonic::INY: increment(mask, info, m_yi, 1U); return;
+        case Mnemonic::DEX: increment(mask, info, m_xi, 0xFFU); return;
+        case Mnemonic::DEY: increment(mask, info, m_yi, 0xFFU); return;
+        case Mnemonic::CLC: flag(mask, info, C, false); return;
+        case Mnemonic::CLD: flag(mask, info, D, false); return;
+        case Mnemonic::CLI: flag(mask, info, I, false); return;
+        case Mnemonic::CLV: flag(mask, info, V, false); return;
+        case Mnemonic::SEC: flag(mask, info, C, true); return;
+        case Mnemonic::SED: flag(mask, info, D, true); return;
+        case Mnemonic::SEI: flag(mask, info, I, true); return;
+        case Mnemonic::NOP: if (info.mode == AddressMode::Implied) { retire(mask, info); return; } break;
+        case Mnemonic::BCC: branch(mask, info, C, false); return;
+        case Mnemonic::BCS: branch(mask, info, C, true); return;
+        case Mnemonic::BEQ: branch(mask, info, Z, true); return;
+        case Mnemonic::BNE: branch(mask, info, Z, false); return;
+        case Mnemonic::BMI: branch(mask, info, N, true); return;
+        case Mnemonic::BPL: branch(mask, info, N, false); return;
+        case Mnemonic::BVS: branch(mask, info, V, true); return;
+        case Mnemonic::BVC: branch(mask, info, V, false); return;
+        default: break;
+        }
+        execute_scalar(mask);
+    }
+
+    /// Execute the instruction of each lane of the mask on a scalar Cpu
+    void execute_scalar(Lanes8 const& mask) {
+        for (std::size_t lane = 0U; lane < LaneCount; ++lane) {
+            if (mask[lane] != 0U) {
+                Cpu<LaneBus, Traits>& cpu = m_scalar[lane];
+                cpu.regs() = regs(lane);
+                m_cycles[lane] += cpu.step();
+                set_regs(lane, cpu.regs());
+            }
+        }
+    }
+
+    /// Operand byte following the opcode of each lane
+    Lanes8 operand8() const {
+        alignas(64) Lanes8 operand{};
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            operand[i] = lane_memory(i)[static_cast<std::uint16_t>(m_pc[i] + 1U)];
+        }
+        return operand;
+    }
+
+    /// Value read by an immediate or zero page operand on each lane
+    Lanes8 read_operand(OpcodeInfo const& info) const {
+        Lanes8 operand = operand8();
+        if (info.mode == AddressMode::ZeroPage) {
+            for (std::size_t i = 0U; i < LaneCount; ++i) {
+                operand[i] = lane_memory(i)[operand[i]];
+            }
+        }
+        return operand;
+    }
+
+    /// Advance program counter and cycles of the lanes of the mask
+    void retire(Lanes8 const& mask, OpcodeInfo const& info) {
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            std::uint16_t const taken = mask[i] != 0U ? 0xFFFF : 0x0000;
+            m_pc[i] = static_cast<std::uint16_t>(m_pc[i] + (info.length & taken));
+            m_cycles[i] += info.cycles & taken;
+        }
+    }
+
+    /// Replace N and Z of the lanes of the mask by those of the values
+    void set_nz(Lanes8 const& mask, Lanes8 const& values) {
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            auto const nz = static_cast<std::uint8_t>((values[i] & N) | (values[i] == 0U ? Z : 0U));
+            auto const updated = static_cast<std::uint8_t>((m_sr[i] & ~(N | Z)) | nz);
+            m_sr[i] = static_cast<std::uint8_t>((updated & mask[i]) | (m_sr[i] & ~mask[i]));
+        }
+    }
+
+    /// Write values to the registers of the lanes of the mask
+    static void blend(Lanes8 const& mask, Lanes8 const& values, Lanes8& reg) {
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            reg[i] = static_cast<std::uint8_t>((values[i] & mask[i]) | (reg[i] & ~mask[i]));
+        }
+    }
+
+    void load(Lanes8 const& mask, OpcodeInfo const& info, Lanes8& reg) {
+        Lanes8 const values = read_operand(info);
+        blend(mask, values, reg);
+        set_nz(mask, values);
+        retire(mask, info);
+    }
+
+    void store(Lanes8 const& mask, OpcodeInfo const& info, Lanes8 const& reg) {
+        Lanes8 const addr = operand8();
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            if (mask[i] != 0U) {
+                lane_memory(i)[addr[i]] = reg[i];
+            }
+        }
+        retire(mask, info);
+    }
+
+    template<class Op>
+    void logic(Lanes8 const& mask, OpcodeInfo const& info, Op op) {
+        Lanes8 const operand = read_operand(info);
+        alignas(64) Lanes8 values{};
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            values[i] = static_cast<std::uint8_t>(op(m_ac[i], operand[i]));
+        }
+        blend(mask, values, m_ac);
+        set_nz(mask, values);
+        retire(mask, info);
+    }
+
+    /// Binary ADC, or SBC as ADC of the complement; decimal lanes run on the scalar Cpu
+    void add(Lanes8 const& mask, OpcodeInfo const& info, bool const subtract) {
+        alignas(64) Lanes8 binary{};
+        alignas(64) Lanes8 decimal{};
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            std::uint8_t const is_decimal = (m_sr[i] & D) != 0U ? 0xFF : 0x00;
+            binary[i] = static_cast<std::uint8_t>(mask[i] & ~is_decimal);
+            decimal[i] = static_cast<std::uint8_t>(mask[i] & is_decimal);
+        }
+        execute_scalar(decimal);
+
+        Lanes8 const operand = read_operand(info);
+        alignas(64) Lanes8 values{};
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            auto const mem = static_cast<std::uint8_t>(subtract ? ~operand[i] : operand[i]);
+            unsigned const sum = unsigned{m_ac[i]} + unsigned{mem} + static_cast<unsigned>(m_sr[i] & C);
+            values[i] = static_cast<std::uint8_t>(sum);
+            auto const overflow = static_cast<std::uint8_t>((~(m_ac[i] ^ mem) & (m_ac[i] ^ sum) & 0x80U) >> 1);
+            auto const flags = static_cast<std::uint8_t>((m_sr[i] & static_cast<std::uint8_t>(~(V | C))) | overflow | (sum >> 8));
+            m_sr[i] = static_cast<std::uint8_t>((flags & binary[i]) | (m_sr[i] & ~binary[i]));
+        }
+        blend(binary, values, m_ac);
+        set_nz(binary, values);
+        retire(binary, info);
+    }
+
+    void compare(Lanes8 const& mask, OpcodeInfo const& info, Lanes8 const& reg) {
+        Lanes8 const operand = read_operand(info);
+        alignas(64) Lanes8 values{};
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            values[i] = static_cast<std::uint8_t>(reg[i] - operand[i]);
+            auto const carry = static_cast<std::uint8_t>(reg[i] >= operand[i] ? C : 0U);
+            auto const flags = static_cast<std::uint8_t>((m_sr[i] & ~C) | carry);
+            m_sr[i] = static_cast<std::uint8_t>((flags & mask[i]) | (m_sr[i] & ~mask[i]));
+        }
+        set_nz(mask, values);
+        retire(mask, info);
+    }
+
+    void transfer(Lanes8 const& mask, OpcodeInfo const& info, Lanes8 const& from, Lanes8& to) {
+        Lanes8 const values{from};
+        blend(mask, values, to);
+        set_nz(mask, values);
+        retire(mask, info);
+    }
+
+    void increment(Lanes8 const& mask, OpcodeInfo const& info, Lanes8& reg, std::uint8_t const delta) {
+        alignas(64) Lanes8 values{};
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            values[i] = static_cast<std::uint8_t>(reg[i] + delta);
+        }
+        blend(mask, values, reg);
+        set_nz(mask, values);
+        retire(mask, info);
+    }
+
+    void flag(Lanes8 const& mask, OpcodeInfo const& info, std::uint8_t const status, bool const set) {
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            auto const updated = static_cast<std::uint8_t>(set ? (m_sr[i] | status) : (m_sr[i] & ~status));
+            m_sr[i] = static_cast<std::uint8_t>((updated & mask[i]) | (m_sr[i] & ~mask[i]));
+        }
+        retire(mask, info);
+    }
+
+    void branch(Lanes8 const& mask, OpcodeInfo const& info, std::uint8_t const status, bool const taken_if_set) {
+        Lanes8 const offset = operand8();
+        retire(mask, info);
+        for (std::size_t i = 0U; i < LaneCount; ++i) {
+            bool const set = (m_sr[i] & status) != 0U;
+            std::uint16_t const taken = (mask[i] != 0U && set == taken_if_set) ? 0xFFFF : 0x0000;
+            auto const displacement = static_cast<std::uint16_t>(static_cast<std::int8_t>(offset[i]));
+            m_pc[i] = static_cast<std::uint16_t>(m_pc[i] + (displacement & taken));
+        }
+    }
+};
+}
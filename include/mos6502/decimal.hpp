@@ -0,0 +1,139 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "mos6502/alu.hpp"
+
+namespace mos6502
+{
+/// Result of a decimal mode operation
+struct DecimalResult final {
+    std::uint8_t value;
+    bool carry;
+    bool overflow;
+    std::uint8_t negative;  /// N is bit 7
+    std::uint8_t zero;      /// Z is set when zero
+};
+
+/// Nibble tables of decimal mode arithmetic, 2KiB in total
+///
+/// The low digit tables are indexed by carry << 8 | low nibble of a << 4 | low nibble of b, the
+/// high digit tables by the carry (or borrow) out of the low digit << 8 | high nibble of a << 4 |
+/// high nibble of b. Both operands may be invalid BCD, the tables reproduce what the chip does.
+struct DecimalTables final {
+    /// Low digit of a + b + carry, with the carry out in bit 4
+    static constexpr std::array<std::uint8_t, 512> kAddLow = [] {
+        std::array<std::uint8_t, 512> table{};
+        for (unsigned index = 0U; index < table.size(); ++index) {
+            unsigned digit = (index >> 8) + ((index >> 4) & 0x0FU) + (index & 0x0FU);
+            if (digit >= 0x0AU) {
+                digit = ((digit + 0x06U) & 0x0FU) + 0x10U;
+            }
+            table[index] = static_cast<std::uint8_t>(digit);
+        }
+        return table;
+    }();
+
+    /// High digit of a + b in bits 4-7, carry out in bit 0, overflow in bit 1 and the NMOS
+    /// negative flag (bit 7 before the high digit is adjusted) in bit 2
+    static constexpr std::array<std::uint8_t, 512> kAddHigh = [] {
+        std::array<std::uint8_t, 512> table{};
+        for (unsigned index = 0U; index < table.size(); ++index) {
+            unsigned const a = (index >> 4) & 0x0FU;
+            unsigned const b = index & 0x0FU;
+            unsigned const sum = a + b + (index >> 8);
+            int const signed_sum = static_cast<int>(a >= 8U ? a - 16U : a) + static_cast<int>(b >= 8U ? b - 16U : b) +
+                                   static_cast<int>(index >> 8);
+            bool const carry = sum >= 0x0AU;
+            unsigned const digit = (carry ? sum + 0x06U : sum) & 0x0FU;
+            bool const overflow = signed_sum > 7 || signed_sum < -8;
+            bool const negative = (sum & 0x08U) != 0U;
+            table[index] = static_cast<std::uint8_t>((digit << 4) | (carry ? 1U : 0U) | (overflow ? 2U : 0U) | (negative ? 4U : 0U));
+        }
+        return table;
+    }();
+
+    /// Low digit of a - b - !carry, with the borrow out in bit 4
+    static constexpr std::array<std::uint8_t, 512> kSubtractLow = [] {
+        std::array<std::uint8_t, 512> table{};
+        for (unsigned index = 0U; index < table.size(); ++index) {
+            int const difference = static_cast<int>((index >> 4) & 0x0FU) - static_cast<int>(index & 0x0FU) +
+                                   static_cast<int>(index >> 8) - 1;
+            if (difference < 0) {
+                table[index] = static_cast<std::uint8_t>(((difference - 0x06) & 0x0F) | 0x10);
+            } else {
+                table[index] = static_cast<std::uint8_t>(difference);
+            }
+        }
+        return table;
+    }();
+
+    /// High digit of a - b - borrow in bits 4-7
+    static constexpr std::array<std::uint8_t, 512> kSubtractHigh = [] {
+        std::array<std::uint8_t, 512> table{};
+        for (unsigned index = 0U; index < table.size(); ++index) {
+            int difference = static_cast<int>((index >> 4) & 0x0FU) - static_cast<int>(index & 0x0FU) -
+                             static_cast<int>(index >> 8);
+            if (difference < 0) {
+                difference -= 0x06;
+            }
+            table[index] = static_cast<std::uint8_t>((difference & 0x0F) << 4);
+        }
+        return table;
+    }();
+
+    static constexpr std::size_t low_index(std::uint8_t const a, std::uint8_t const b, unsigned const carry) {
+        return (carry << 8) | ((a & 0x0FU) << 4) | (b & 0x0FU);
+    }
+
+    static constexpr std::size_t high_index(std::uint8_t const a, std::uint8_t const b, unsigned const carry) {
+        return (carry << 8) | (a & 0xF0U) | (b >> 4);
+    }
+};
+
+/// Decimal mode of the NMOS 6502
+///
+/// ADC sets Z from the binary sum and N and V from the sum before the high digit is adjusted,
+/// SBC sets every flag from the binary difference.
+struct NmosDecimal final {
+    /// a + b + carry
+    static constexpr DecimalResult add(std::uint8_t const a, std::uint8_t const b, bool const carry) {
+        std::uint8_t const low = DecimalTables::kAddLow[DecimalTables::low_index(a, b, carry ? 1U : 0U)];
+        std::uint8_t const high = DecimalTables::kAddHigh[DecimalTables::high_index(a, b, low >> 4)];
+        return {static_cast<std::uint8_t>((high & 0xF0U) | (low & 0x0FU)), (high & 1U) != 0U, (high & 2U) != 0U,
+                static_cast<std::uint8_t>((high & 4U) << 5), static_cast<std::uint8_t>(a + b + (carry ? 1U : 0U))};
+    }
+
+    /// a - b - !carry, carry is set when there is no borrow
+    static constexpr DecimalResult subtract(std::uint8_t const a, std::uint8_t const b, bool const carry) {
+        AluResult const binary = PortableAlu::subtract(a, b, carry);
+        std::uint8_t const low = DecimalTables::kSubtractLow[DecimalTables::low_index(a, b, carry ? 1U : 0U)];
+        std::uint8_t const high = DecimalTables::kSubtractHigh[DecimalTables::high_index(a, b, low >> 4)];
+        return {static_cast<std::uint8_t>(high | (low & 0x0FU)), binary.carry, binary.overflow, binary.value, binary.value};
+    }
+};
+
+/// Decimal mode of the 65C02
+///
+/// N and Z are set from the decimal result, C and V as on the NMOS 6502. SBC adjusts the binary
+/// difference, which only differs from the NMOS result for invalid BCD operands.
+/// @note The extra cycle the 65C02 takes in decimal mode is not accounted
+struct CmosDecimal final {
+    /// a + b + carry
+    static constexpr DecimalResult add(std::uint8_t const a, std::uint8_t const b, bool const carry) {
+        DecimalResult result = NmosDecimal::add(a, b, carry);
+        result.negative = result.value;
+        result.zero = result.value;
+        return result;
+    }
+
+    /// a - b - !carry, carry is set when there is no borrow
+    static constexpr DecimalResult subtract(std::uint8_t const a, std::uint8_t const b, bool const carry) {
+        AluResult const binary = PortableAlu::subtract(a, b, carry);
+        std::uint8_t const low = DecimalTables::kSubtractLow[DecimalTables::low_index(a, b, carry ? 1U : 0U)];
+        auto const value = static_cast<std::uint8_t>(binary.value - (binary.carry ? 0x00U : 0x60U) - ((low & 0x10U) != 0U ? 0x06U : 0x00U));
+        return {value, binary.carry, binary.overflow, value, value};
+    }
+};
+}
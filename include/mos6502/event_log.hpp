@@ -0,0 +1,336 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "mos6502/bus.hpp"
+
+namespace mos6502
+{
+/// Version of the event log format written by EventLogWriter
+inline constexpr std::uint8_t kEventLogVersion{3U};
+
+/// Signature at the beginning of every event log
+inline constexpr std::array<std::uint8_t, 4> kEventLogMagic{'M', '6', '5', 'E'};
+
+/// Input of a machine that does not follow from its state
+enum class EventKind : std::uint8_t {
+    Read,     /// Value read from a device
+    Irq,      /// Cpu::signal_irq
+    Nmi,      /// Cpu::signal_nmi
+    Reset,    /// Cpu::signal_reset
+    End,      /// End of the recording
+    Sync,     /// No input up to this cycle, bounds the reads a replayer looks ahead (version 2)
+    IrqLine,  /// Cpu::set_irq_line (version 3)
+    NmiLine,  /// Cpu::set_nmi_line (version 3)
+};
+
+/// Event stamped with the cycle it happened at
+struct Event final {
+    std::uint64_t cycle;
+    EventKind kind;
+    std::uint16_t addr;  /// Address read (Read), source driving the line (IrqLine)
+    std::uint8_t value;  /// Value read (Read), whether the line is asserted (IrqLine and NmiLine)
+};
+
+/// Buffered writer of events to a stream
+///
+/// Each event takes a byte with its kind, the cycles since the previous event as a variable
+/// length integer and, for reads, the address and value. Reads in a loop take 5 bytes. Line
+/// changes take a byte more with the source and the level.
+class EventLogWriter final {
+public:
+    /// Constructor, writes the header
+    /// @param out stream that outlives the writer, usually a std::ofstream opened as binary
+    explicit EventLogWriter(std::ostream& out);
+
+    EventLogWriter(EventLogWriter const&) = delete;
+    EventLogWriter& operator=(EventLogWriter const&) = delete;
+
+    /// Append an event
+    /// @throw std::invalid_argument when the event is older than the previous one
+    /// @throw std::runtime_error when the stream fails
+    void append(Event const& event);
+
+    /// Write the events buffered to the stream
+    /// @throw std::runtime_error when the stream fails
+    void flush();
+
+private:
+    static constexpr std::size_t kMaxEventSize{1U + 10U + 3U};
+
+    std::ostream& m_out;
+    std::array<std::uint8_t, 4096> m_buffer{};
+    std::size_t m_size{};
+    std::uint64_t m_cycle{};
+};
+
+/// Buffered reader of the events written by EventLogWriter
+class EventLogReader final {
+public:
+    /// Constructor, reads the header
+    /// @param in stream that outlives the reader, usually a std::ifstream opened as binary
+    /// @throw std::invalid_argument when it is not an event log of a supported version
+    explicit EventLogReader(std::istream& in);
+
+    EventLogReader(EventLogReader const&) = delete;
+    EventLogReader& operator=(EventLogReader const&) = delete;
+
+    /// Read the next event
+    /// @return the event, or nothing at the end of the stream
+    /// @throw std::out_of_range when the stream ends in the middle of an event
+    std::optional<Event> next();
+
+private:
+    std::istream& m_in;
+    std::array<std::uint8_t, 4096> m_buffer{};
+    std::size_t m_position{};
+    std::size_t m_size{};
+    std::uint64_t m_cycle{};
+
+    /// Read a byte, or nothing at the end of the stream
+    std::optional<std::uint8_t> get();
+
+    std::uint8_t get_required();
+};
+
+/// Record the inputs of a machine so it can be run again exactly (see EventReplayer)
+///
+/// Run the Cpu and signal interrupts through the recorder so they are stamped with the cycle
+/// count, and let the Cpu reach the devices through record(). Reads carry the cycle of the run
+/// they happened in, they are exact when stepping one instruction at a time.
+///
+/// Devices drive the interrupt lines through the recorder as well, from the thread running the
+/// Cpu. Changes made while the Cpu runs, e.g. from a bus callback, are stamped with the end of
+/// the run, when the Cpu would take the interrupt when stepping one instruction at a time.
+///
+/// Once kSyncReads reads follow the last other event, a sync event is written at the end of the
+/// run, so the replayer never looks further ahead than that.
+class EventRecorder final {
+public:
+    /// Reads recorded between two events of other kinds at most, plus those of a single run
+    static constexpr std::size_t kSyncReads{1024U};
+
+    /// Constructor
+    /// @param out stream that outlives the recorder, usually a std::ofstream opened as binary
+    explicit EventRecorder(std::ostream& out) : m_log{out} {}
+
+    EventRecorder(EventRecorder const&) = delete;
+    EventRecorder& operator=(EventRecorder const&) = delete;
+
+    /// Destructor, closes the recording unless already closed
+    ~EventRecorder();
+
+    /// Wrap the devices so the values read from them are recorded
+    /// @return bus to use as fallback of the PagedBus (or similar), it must not outlive the recorder
+    std::shared_ptr<IBus> record(std::shared_ptr<IBus> devices);
+
+    /// Run the Cpu for the cycle budget (see Cpu::run_cycles)
+    template<class Cpu>
+    std::uint64_t run_cycles(Cpu& cpu, std::uint64_t const budget) {
+        m_running = true;
+        std::uint64_t const cycles = cpu.run_cycles(budget);
+        advance(cycles);
+        return cycles;
+    }
+
+    /// Step the current instruction of the Cpu (see Cpu::step)
+    template<class Cpu>
+    std::uint8_t step(Cpu& cpu) {
+        m_running = true;
+        std::uint8_t const cycles = cpu.step();
+        advance(cycles);
+        return cycles;
+    }
+
+    /// Drive the IRQ line of the Cpu (see Cpu::set_irq_line)
+    template<class Cpu>
+    void set_irq_line(Cpu& cpu, bool const asserted, unsigned const source = 0U) {
+        std::uint8_t const level = asserted ? 1U : 0U;
+        line(Event{m_cycle, EventKind::IrqLine, static_cast<std::uint16_t>(source % 8U), level});
+        cpu.set_irq_line(asserted, source);
+    }
+
+    /// Drive the NMI line of the Cpu (see Cpu::set_nmi_line)
+    template<class Cpu>
+    void set_nmi_line(Cpu& cpu, bool const asserted) {
+        std::uint8_t const level = asserted ? 1U : 0U;
+        line(Event{m_cycle, EventKind::NmiLine, 0U, level});
+        cpu.set_nmi_line(asserted);
+    }
+
+    template<class Cpu>
+    void signal_irq(Cpu& cpu) {
+        append(EventKind::Irq);
+        cpu.signal_irq();
+    }
+
+    template<class Cpu>
+    void signal_nmi(Cpu& cpu) {
+        append(EventKind::Nmi);
+        cpu.signal_nmi();
+    }
+
+    template<class Cpu>
+    void signal_reset(Cpu& cpu) {
+        append(EventKind::Reset);
+        cpu.signal_reset();
+    }
+
+    /// Cycles run since the recording started
+    std::uint64_t cycles() const {
+        return m_cycle;
+    }
+
+    /// Write the events buffered to the stream
+    void flush() {
+        m_log.flush();
+    }
+
+    /// Mark the end of the recording at the current cycle and flush it
+    void close();
+
+private:
+    class Devices;
+
+    EventLogWriter m_log;
+    std::uint64_t m_cycle{};
+    std::size_t m_unsynced{};
+    bool m_running{};
+    bool m_closed{};
+
+    /// Line changes made during the current run
+    std::vector<Event> m_lines{};
+
+    /// Append an event other than a read at the current cycle
+    void append(EventKind kind);
+
+    /// Append a line change, at the end of the run when the Cpu is running
+    void line(Event const& event);
+
+    /// Count the cycles of a run, ending the chunk of reads when it is full
+    void advance(std::uint64_t cycles);
+};
+
+/// Run a machine again from the events recorded by EventRecorder
+///
+/// The machine must start from the same state as the recorded one, e.g. restored from a
+/// snapshot taken when recording began. Interrupts are signaled at the cycles they were
+/// recorded at and reads from the devices return the values recorded, the devices themselves
+/// are never read. Nothing throttles the replay, it runs as fast as the host allows.
+///
+/// Reads recorded up to the next event of another kind are buffered while looking for it, at
+/// most EventRecorder::kSyncReads plus those of a run, so long recordings replay in constant memory.
+class EventReplayer final {
+public:
+    /// Constructor
+    /// @param in stream that outlives the replayer
+    /// @throw std::invalid_argument when it is not an event log of a supported version
+    explicit EventReplayer(std::istream& in) : m_log{in} {}
+
+    EventReplayer(EventReplayer const&) = delete;
+    EventReplayer& operator=(EventReplayer const&) = delete;
+
+    /// Devices answering reads from the log
+    /// @param devices bus receiving the writes, e.g. to keep the video output, null to drop them
+    /// @return bus to use as fallback of the PagedBus (or similar), it must not outlive the replayer
+    std::shared_ptr<IBus> replay(std::shared_ptr<IBus> devices = {});
+
+    /// Run the Cpu for the cycle budget, signaling the interrupts recorded on the way
+    /// @throw std::logic_error when the Cpu does not follow the recording
+    template<class Cpu>
+    std::uint64_t run_cycles(Cpu& cpu, std::uint64_t const budget) {
+        std::uint64_t consumed{};
+        do {
+            signal_due(cpu);
+            std::uint64_t slice = budget > consumed ? budget - consumed : 1U;
+            if (std::optional<std::uint64_t> const next = next_signal()) {
+                slice = std::min(slice, *next - m_cycle);
+            }
+            std::uint64_t const cycles = cpu.run_cycles(slice);
+            m_cycle += cycles;
+            consumed += cycles;
+        } while (consumed < budget);
+        return consumed;
+    }
+
+    /// Run the Cpu to the end of the recording
+    /// @return number of cycles consumed
+    /// @throw std::logic_error when the Cpu does not follow the recording
+    template<class Cpu>
+    std::uint64_t run(Cpu& cpu) {
+        std::uint64_t const start = m_cycle;
+        for (;;) {
+            signal_due(cpu);
+            std::optional<std::uint64_t> const next = next_signal();
+            if (!next) {
+                return m_cycle - start;
+            }
+            m_cycle += cpu.run_cycles(*next - m_cycle);
+        }
+    }
+
+    /// Whether every event was replayed
+    bool finished() {
+        return !next_signal() && m_reads.empty();
+    }
+
+    /// Cycles run since the replay started
+    std::uint64_t cycles() const {
+        return m_cycle;
+    }
+
+    /// Reads looked ahead of the Cpu
+    std::size_t buffered() const {
+        return m_reads.size();
+    }
+
+private:
+    class Devices;
+
+    EventLogReader m_log;
+    std::uint64_t m_cycle{};
+
+    /// Reads up to the next event of another kind
+    std::deque<Event> m_reads{};
+
+    /// Next event other than a read, up to which the Cpu runs
+    std::optional<Event> m_signal{};
+
+    /// Cycle of the next interrupt or of the end, or nothing once replayed
+    std::optional<std::uint64_t> next_signal();
+
+    /// Consume the next read
+    /// @throw std::logic_error when the read is not the one recorded
+    std::uint8_t read(std::uint16_t addr);
+
+    /// Signal the interrupts due at the current cycle
+    template<class Cpu>
+    void signal_due(Cpu& cpu) {
+        for (std::optional<std::uint64_t> next = next_signal(); next && *next <= m_cycle; next = next_signal()) {
+            if (*next < m_cycle || !m_reads.empty()) {
+                throw std::logic_error("replay diverged from the recording");
+            }
+            switch (m_signal->kind) {
+            case EventKind::Irq: cpu.signal_irq(); break;
+            case EventKind::Nmi: cpu.signal_nmi(); break;
+            case EventKind::Reset: cpu.signal_reset(); break;
+            case EventKind::Read: break;
+            case EventKind::End: break;
+            case EventKind::Sync: break;
+            case EventKind::IrqLine: cpu.set_irq_line(m_signal->value != 0U, m_signal->addr); break;
+            case EventKind::NmiLine: cpu.set_nmi_line(m_signal->value != 0U); break;
+            }
+            m_signal.reset();
+        }
+    }
+};
+}
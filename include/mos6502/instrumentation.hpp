@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "mos6502/opcodes.hpp"
+
+namespace mos6502
+{
+/// Run without instrumentation, nothing is counted nor stored
+struct NoInstrumentation {};
+
+/// Count the executions and cycles of every opcode (see InstructionStats)
+/// @note Native translation (JitDispatch) is disabled, it falls back to BlockCacheDispatch
+struct InstructionCounters {};
+
+/// Executions and cycles counted
+struct InstructionCount final {
+    std::uint64_t count;
+    std::uint64_t cycles;
+
+    bool operator==(InstructionCount const&) const = default;
+};
+
+/// Instruction mix of a Cpu configured with InstructionCounters
+///
+/// The counters of the 256 opcodes live in one flat array aligned to cache lines, the handler of
+/// each opcode adds to its own entry. Totals by addressing mode are summed from them on request
+/// rather than counted while running.
+class InstructionStats final {
+public:
+    static constexpr std::size_t kModeCount{static_cast<std::size_t>(AddressMode::AbsoluteIndirectX) + 1U};
+
+    /// Constructor
+    /// @param opcodes descriptors of the instruction set counted (see Nmos6502::kOpcodes)
+    explicit InstructionStats(std::array<OpcodeInfo, 256> const& opcodes) : m_opcodes{&opcodes} {}
+
+    /// Count an instruction executed
+    void record(std::uint8_t const opcode, std::uint8_t const cycles) {
+        InstructionCount& counter = m_counts[opcode];
+        ++counter.count;
+        counter.cycles += cycles;
+    }
+
+    /// Count an interrupt taken from the lines
+    void record_interrupt(std::uint8_t const cycles) {
+        ++m_interrupts.count;
+        m_interrupts.cycles += cycles;
+    }
+
+    InstructionCount const& opcode(std::uint8_t const opcode) const {
+        return m_counts[opcode];
+    }
+
+    /// Sum of the opcodes of an addressing mode
+    InstructionCount mode(AddressMode mode) const;
+
+    /// Interrupts taken from the lines, not counted as instructions
+    InstructionCount const& interrupts() const {
+        return m_interrupts;
+    }
+
+    /// Sum of every opcode
+    InstructionCount total() const;
+
+    /// Clear every counter
+    void reset();
+
+    /// Write the instruction mix as text
+    ///
+    /// One line per opcode executed, most cycles first, with its share of the cycles, followed by
+    /// the totals by addressing mode.
+    /// @param limit largest number of opcodes listed
+    void dump(std::ostream& out, std::size_t limit = 256U) const;
+
+private:
+    alignas(64) std::array<InstructionCount, 256> m_counts{};
+    InstructionCount m_interrupts{};
+    std::array<OpcodeInfo, 256> const* m_opcodes;
+};
+}
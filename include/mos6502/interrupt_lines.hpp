@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace mos6502
+{
+/// IRQ and NMI input lines of the Cpu, safe to drive from any thread
+///
+/// The IRQ sources holding the line and the NMI latched share one atomic word, so the Cpu tests
+/// both with a single relaxed load between instructions, a plain load on common hosts. Devices
+/// update it with relaxed atomic operations and never take a lock.
+///
+/// The lines do not order other memory, a device on another thread must publish the data the
+/// handler reads (e.g. a received byte) through its own synchronization.
+class InterruptLines final {
+public:
+    /// Number of devices that can hold the IRQ line
+    static constexpr unsigned kIrqSources{8U};
+
+    InterruptLines() = default;
+
+    /// Copies take the levels of the lines at the time of the copy
+    InterruptLines(InterruptLines const& other) noexcept
+        : m_word{other.m_word.load(std::memory_order_relaxed)}, m_nmi_level{other.m_nmi_level.load(std::memory_order_relaxed)} {}
+
+    InterruptLines& operator=(InterruptLines const& other) noexcept {
+        m_word.store(other.m_word.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_nmi_level.store(other.m_nmi_level.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    ~InterruptLines() = default;
+
+    /// Drive the IRQ line, level triggered
+    /// @param source device driving the line (below kIrqSources), the line is held while any holds it
+    void set_irq(bool const asserted, unsigned const source) {
+        std::uint16_t const mask = static_cast<std::uint16_t>(1U << (source % kIrqSources));
+        if (asserted) {
+            m_word.fetch_or(mask, std::memory_order_relaxed);
+        } else {
+            m_word.fetch_and(static_cast<std::uint16_t>(~mask), std::memory_order_relaxed);
+        }
+    }
+
+    /// Drive the NMI line, edge triggered, a rising edge latches a request
+    void set_nmi(bool const asserted) {
+        if (!asserted) {
+            m_nmi_level.store(false, std::memory_order_relaxed);
+        } else if (!m_nmi_level.exchange(true, std::memory_order_relaxed)) {
+            m_word.fetch_or(kNmiPending, std::memory_order_relaxed);
+        }
+    }
+
+    /// Whether the IRQ line is held or an NMI is latched
+    bool pending() const {
+        return m_word.load(std::memory_order_relaxed) != 0U;
+    }
+
+    /// Whether the IRQ line is held
+    bool irq() const {
+        return (m_word.load(std::memory_order_relaxed) & kIrqMask) != 0U;
+    }
+
+    /// Consume the NMI latched
+    /// @return whether an NMI was latched
+    bool take_nmi() {
+        if ((m_word.load(std::memory_order_relaxed) & kNmiPending) == 0U) {
+            return false;
+        }
+        return (m_word.fetch_and(static_cast<std::uint16_t>(~kNmiPending), std::memory_order_relaxed) & kNmiPending) != 0U;
+    }
+
+    /// IRQ sources holding the line (bits 0-7), NMI latched (bit 8) and NMI level (bit 9)
+    std::uint16_t state() const {
+        return static_cast<std::uint16_t>(m_word.load(std::memory_order_relaxed) |
+                                          (m_nmi_level.load(std::memory_order_relaxed) ? kNmiLevel : 0U));
+    }
+
+    /// Set every line from a state
+    void set_state(std::uint16_t const state) {
+        m_nmi_level.store((state & kNmiLevel) != 0U, std::memory_order_relaxed);
+        m_word.store(static_cast<std::uint16_t>(state & (kIrqMask | kNmiPending)), std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::uint16_t kIrqMask{0x00FF};
+
+    static constexpr std::uint16_t kNmiPending{0x0100};
+
+    static constexpr std::uint16_t kNmiLevel{0x0200};
+
+    /// IRQ sources holding the line (low byte) and NMI latched
+    std::atomic<std::uint16_t> m_word{};
+
+    /// Level of the NMI line, to tell rising edges
+    std::atomic<bool> m_nmi_level{};
+};
+
+static_assert(std::atomic<std::uint16_t>::is_always_lock_free);
+}
@@ -0,0 +1,327 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+
+#include "mos6502/alu.hpp"
+#include "mos6502/status.hpp"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define MOS6502_JIT 1
+#else
+#define MOS6502_JIT 0
+#endif
+
+namespace mos6502
+{
+#if MOS6502_JIT
+/// Memory for generated code, it is never writable and executable at the same time
+class ExecutableArena final {
+public:
+    static constexpr std::size_t kDefaultSize{4U << 20};
+
+    /// Constructor
+    /// @throw std::bad_alloc when the memory can not be mapped
+    explicit ExecutableArena(std::size_t size = kDefaultSize);
+
+    ExecutableArena(ExecutableArena const&) = delete;
+    ExecutableArena& operator=(ExecutableArena const&) = delete;
+
+    ~ExecutableArena();
+
+    /// Make the arena writable and not executable to emit code
+    void unprotect();
+
+    /// Make the arena executable and not writable
+    void protect();
+
+    std::uint8_t* data() const {
+        return m_data;
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+private:
+    std::uint8_t* m_data;
+    std::size_t m_size;
+};
+
+/// Encoder of the x86-64 instructions used to translate 6502 blocks
+///
+/// Generated functions follow the System V calling convention and keep
+/// Cpu* in r12, Registers* in rbx and the cycles consumed in r13.
+class X64Emitter final {
+public:
+    X64Emitter(std::uint8_t* begin, std::uint8_t* end) : m_begin{begin}, m_position{begin}, m_end{end} {}
+
+    std::uint8_t* begin() const {
+        return m_begin;
+    }
+
+    std::uint8_t* position() const {
+        return m_position;
+    }
+
+    /// Check whether the code did not fit in the memory given
+    bool overflow() const {
+        return m_overflow;
+    }
+
+    /// push rbx, r12, r13; r12 = cpu; rbx = regs; r13 = 0
+    void prologue() {
+        emit({0x53, 0x41, 0x54, 0x41, 0x55});
+        emit({0x49, 0x89, 0xFC, 0x48, 0x89, 0xF3, 0x45, 0x31, 0xED});
+    }
+
+    /// return r13 and restore the callee saved registers
+    void epilogue() {
+        emit({0x4C, 0x89, 0xE8, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});
+    }
+
+    /// mov al, [rbx + offset]
+    void load_al(std::uint8_t const offset) {
+        emit({0x8A, 0x43, offset});
+    }
+
+    /// mov [rbx + offset], al
+    void store_al(std::uint8_t const offset) {
+        emit({0x88, 0x43, offset});
+    }
+
+    /// mov al, imm8
+    void move_al(std::uint8_t const value) {
+        emit({0xB0, value});
+    }
+
+    /// movabs rdx, address; mov al, [rdx]
+    void load_al_absolute(std::uint8_t const* address) {
+        move_rdx(address);
+        emit({0x8A, 0x02});
+    }
+
+    /// and, or, xor al with an immediate (Opcode is the accumulator form: 0x24, 0x0C, 0x34)
+    void alu_al(std::uint8_t const opcode, std::uint8_t const value) {
+        emit({opcode, value});
+    }
+
+    /// and, or, xor al with [rdx] (Opcode is the r8, r/m8 form: 0x22, 0x0A, 0x32)
+    void alu_al_absolute(std::uint8_t const opcode, std::uint8_t const* address) {
+        move_rdx(address);
+        emit({opcode, 0x02});
+    }
+
+    /// inc al
+    void increment_al() {
+        emit({0xFE, 0xC0});
+    }
+
+    /// dec al
+    void decrement_al() {
+        emit({0xFE, 0xC8});
+    }
+
+    /// and byte [rbx + offset], mask
+    void and_byte(std::uint8_t const offset, std::uint8_t const mask) {
+        emit({0x80, 0x63, offset, mask});
+    }
+
+    /// or byte [rbx + offset], mask
+    void or_byte(std::uint8_t const offset, std::uint8_t const mask) {
+        emit({0x80, 0x4B, offset, mask});
+    }
+
+    /// mov word [rbx + offset], imm16
+    void store_word(std::uint8_t const offset, std::uint16_t const value) {
+        emit({0x66, 0xC7, 0x43, offset});
+        immediate(value);
+    }
+
+    /// Store in the word at pc_offset the target when the flag has the state given, otherwise next
+    void branch(std::uint8_t const status_offset, std::uint8_t const flag, bool const taken_if_set,
+                std::uint8_t const pc_offset, std::uint16_t const target, std::uint16_t const next) {
+        // test byte [rbx + status], flag; jz/jnz not_taken
+        emit({0xF6, 0x43, status_offset, flag, static_cast<std::uint8_t>(taken_if_set ? 0x74 : 0x75), 0x08});
+        store_word(pc_offset, target);
+        // jmp over the not taken store
+        emit({0xEB, 0x06});
+        store_word(pc_offset, next);
+    }
+
+    /// Replace the N and Z flags of the status register at offset by those of al
+    void set_nz(std::uint8_t const status_offset) {
+        emit({0x8A, 0x4B, status_offset, 0x80, 0xE1, static_cast<std::uint8_t>(~(N | Z))});
+        update_nz(status_offset);
+    }
+
+    /// Compare the register at offset with an immediate or with memory, setting N, Z and C
+    void compare(std::uint8_t const offset, std::uint8_t const status_offset, std::uint8_t const* address, std::uint8_t const value) {
+        if (address != nullptr) {
+            move_rdx(address);
+        }
+        emit({0x8A, 0x43, offset});
+        emit({0x8A, 0x4B, status_offset, 0x80, 0xE1, static_cast<std::uint8_t>(~(N | Z | C))});
+        if (address != nullptr) {
+            emit({0x2A, 0x02});
+        } else {
+            emit({0x2C, value});
+        }
+        // no borrow sets carry
+        emit({0x72, 0x03, 0x80, 0xC9, C});
+        update_nz(status_offset);
+    }
+
+    /// add r13, imm32
+    void add_cycles(std::uint32_t const cycles) {
+        emit({0x49, 0x81, 0xC5});
+        immediate(cycles);
+    }
+
+    /// Call handler(cpu, regs, operand) and add the cycles it returns
+    void call_handler(std::uintptr_t const handler, std::uint16_t const operand) {
+        emit({0x4C, 0x89, 0xE7, 0x48, 0x89, 0xDE, 0xBA});
+        immediate(std::uint32_t{operand});
+        emit({0x48, 0xB8});
+        immediate(std::uint64_t{handler});
+        emit({0xFF, 0xD0, 0x0F, 0xB6, 0xC0, 0x49, 0x01, 0xC5});
+    }
+
+    /// Jump forward when the dword at address differs from value
+    /// @return location to patch with bind
+    std::uint8_t* jump_if_changed(std::uint32_t const* address, std::uint32_t const value) {
+        move_rdx(address);
+        emit({0x81, 0x3A});
+        immediate(value);
+        emit({0x0F, 0x85});
+        std::uint8_t* const label = m_position;
+        immediate(std::uint32_t{});
+        return label;
+    }
+
+    /// Make a forward jump land at the current position
+    void bind(std::uint8_t* const label) {
+        if (m_overflow) {
+            return;
+        }
+        auto const displacement = static_cast<std::int32_t>(m_position - (label + 4));
+        std::memcpy(label, &displacement, sizeof(displacement));
+    }
+
+private:
+    std::uint8_t* m_begin;
+    std::uint8_t* m_position;
+    std::uint8_t* m_end;
+    bool m_overflow{};
+    std::array<std::uint8_t, 7> const m_padding{};
+
+    /// movabs rdx, address
+    void move_rdx(void const* address) {
+        emit({0x48, 0xBA});
+        immediate(reinterpret_cast<std::uint64_t>(address));
+    }
+
+    /// or cl, kNZFlags[al]; mov [rbx + status], cl
+    void update_nz(std::uint8_t const status_offset) {
+        move_rdx(kNZFlags.data());
+        emit({0x0F, 0xB6, 0xC0, 0x0A, 0x0C, 0x02, 0x88, 0x4B, status_offset});
+    }
+
+    void emit(std::initializer_list<std::uint8_t> const bytes) {
+        if (static_cast<std::size_t>(m_end - m_position) < bytes.size()) {
+            m_overflow = true;
+            m_position = m_end;
+            return;
+        }
+        for (std::uint8_t const byte : bytes) {
+            *m_position++ = byte;
+        }
+    }
+
+    template<class Immediate>
+    void immediate(Immediate const value) {
+        std::array<std::uint8_t, sizeof(Immediate)> bytes{};
+        std::memcpy(bytes.data(), &value, sizeof(Immediate));
+        if (static_cast<std::size_t>(m_end - m_position) < bytes.size()) {
+            m_overflow = true;
+            m_position = m_end;
+            return;
+        }
+        std::memcpy(m_position, bytes.data(), bytes.size());
+        m_position += bytes.size();
+    }
+};
+
+/// Native translations of hot basic blocks, keyed by the address of the block
+/// @tparam Native signature of the generated functions
+template<class Native>
+class JitCache final {
+public:
+    static constexpr std::size_t kEntryCount{1024U};
+
+    /// Executions of a block from the interpreter before it is translated
+    static constexpr std::uint16_t kHotThreshold{8U};
+
+    struct Entry final {
+        Native code;
+        std::uint32_t generation;
+        std::uint16_t pc;
+        std::uint16_t hits;
+        std::uint32_t max_cycles;
+        std::array<std::uint8_t, 4> padding;
+    };
+
+    JitCache() : m_entries{std::make_unique<std::array<Entry, kEntryCount>>()} {}
+
+    /// Retrieve the entry of the block at pc, reset when it belongs to another block
+    Entry& entry(std::uint16_t const pc, std::uint32_t const generation) {
+        Entry& entry = (*m_entries)[pc % kEntryCount];
+        if (entry.pc != pc || entry.generation != generation) {
+            entry = Entry{};
+            entry.pc = pc;
+            entry.generation = generation;
+        }
+        return entry;
+    }
+
+    /// Emit a function into the arena
+    /// @param body emits the function through a X64Emitter
+    /// @return the function, or null when the arena ran out of space (it is then flushed)
+    template<class Body>
+    Native emit(Body&& body) {
+        m_arena.unprotect();
+        X64Emitter emitter{m_arena.data() + m_used, m_arena.data() + m_arena.size()};
+        body(emitter);
+        if (emitter.overflow()) {
+            flush();
+            m_arena.protect();
+            return nullptr;
+        }
+        m_used = static_cast<std::size_t>(emitter.position() - m_arena.data());
+        m_arena.protect();
+        ++m_translated;
+        return reinterpret_cast<Native>(emitter.begin());
+    }
+
+    /// Drop every translation
+    void flush() {
+        m_entries->fill(Entry{});
+        m_used = 0U;
+    }
+
+    /// Number of blocks translated so far
+    std::size_t translated() const {
+        return m_translated;
+    }
+
+private:
+    ExecutableArena m_arena{};
+    std::unique_ptr<std::array<Entry, kEntryCount>> m_entries;
+    std::size_t m_used{};
+    std::size_t m_translated{};
+};
+#endif
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <concepts>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "mos6502/cpu.hpp"
+#include "mos6502/regs.hpp"
+#include "mos6502/traits.hpp"
+
+namespace mos6502
+{
+/// Compare buses with operator== when available, otherwise only the registers are checked
+struct DefaultBusCompare final {
+    template<class Bus>
+    bool operator()(Bus const& lhs, Bus const& rhs) const {
+        if constexpr (std::equality_comparable<Bus>) {
+            return lhs == rhs;
+        } else {
+            static_cast<void>(lhs);
+            static_cast<void>(rhs);
+            return true;
+        }
+    }
+};
+
+/// Run the JIT and the interpreter side by side on their own buses and check they agree
+///
+/// Both buses must start with the same contents. After every run the cycles consumed, the
+/// registers and the buses (through Compare) of both Cpu must be equal.
+/// @tparam Compare predicate over (Bus const&, Bus const&) telling whether the buses agree
+template<class Bus, class Compare = DefaultBusCompare>
+class JitDifferential final {
+public:
+    /// Constructor
+    /// @param jit_bus bus of the Cpu translating to native code
+    /// @param reference_bus bus of the Cpu interpreting every instruction
+    JitDifferential(std::shared_ptr<Bus> jit_bus, std::shared_ptr<Bus> reference_bus, Compare compare = {})
+        : m_jit_bus{jit_bus}, m_reference_bus{reference_bus}, m_jit{jit_bus}, m_reference{reference_bus}, m_compare{compare} {}
+
+    Cpu<Bus, JitCpuTraits>& jit() {
+        return m_jit;
+    }
+
+    Cpu<Bus>& reference() {
+        return m_reference;
+    }
+
+    /// Run both Cpu for the cycle budget
+    /// @return number of cycles consumed
+    /// @throw std::logic_error describing the first difference found
+    std::uint64_t run_cycles(std::uint64_t const budget) {
+        Registers const before = m_reference.regs();
+        std::uint64_t const jit_cycles = m_jit.run_cycles(budget);
+        std::uint64_t const reference_cycles = m_reference.run_cycles(budget);
+
+        if (jit_cycles != reference_cycles) {
+            diverge(before, "cycles", jit_cycles, reference_cycles);
+        }
+        Registers const& jit_regs = m_jit.regs();
+        Registers const& reference_regs = m_reference.regs();
+        if (jit_regs.pc != reference_regs.pc) { diverge(before, "pc", jit_regs.pc, reference_regs.pc); }
+        if (jit_regs.sp != reference_regs.sp) { diverge(before, "sp", jit_regs.sp, reference_regs.sp); }
+        if (jit_regs.sr != reference_regs.sr) { diverge(before, "sr", jit_regs.sr, reference_regs.sr); }
+        if (jit_regs.ac != reference_regs.ac) { diverge(before, "ac", jit_regs.ac, reference_regs.ac); }
+        if (jit_regs.xi != reference_regs.xi) { diverge(before, "xi", jit_regs.xi, reference_regs.xi); }
+        if (jit_regs.yi != reference_regs.yi) { diverge(before, "yi", jit_regs.yi, reference_regs.yi); }
+        if (!m_compare(static_cast<Bus const&>(*m_jit_bus), static_cast<Bus const&>(*m_reference_bus))) {
+            diverge(before, "bus", 0U, 0U);
+        }
+        return reference_cycles;
+    }
+
+private:
+    std::shared_ptr<Bus> m_jit_bus;
+    std::shared_ptr<Bus> m_reference_bus;
+    Cpu<Bus, JitCpuTraits> m_jit;
+    Cpu<Bus> m_reference;
+    [[no_unique_address]] Compare m_compare;
+
+    [[ noreturn ]] static void diverge(Registers const& before, char const* what, std::uint64_t const jit, std::uint64_t const reference) {
+        std::ostringstream reason{};
+        reason << std::hex << std::uppercase << "JIT diverged from interpreter on " << what
+               << " running from pc 0x" << before.pc
+               << ": jit 0x" << jit << ", interpreter 0x" << reference;
+        throw std::logic_error(reason.str());
+    }
+};
+}
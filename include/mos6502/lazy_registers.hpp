@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#include "mos6502/regs.hpp"
+#include "mos6502/status.hpp"
+
+namespace mos6502
+{
+/// Registers with the N, Z, C and V flags deferred (see LazyFlags)
+///
+/// Instructions record the values the flags derive from instead of updating the status register,
+/// sr only holds the other flags until the deferred ones are materialized.
+struct LazyRegisters final : Registers {
+    std::uint8_t negative;  /// N is bit 7
+    std::uint8_t zero;      /// Z is set when zero
+    std::uint8_t carry;     /// C is bit 0
+    std::uint8_t overflow;  /// V is bit 7
+
+    /// Defer the flags of the registers
+    static constexpr LazyRegisters defer(Registers const& regs) {
+        LazyRegisters lazy{regs, 0U, 0U, 0U, 0U};
+        lazy.set_status(regs.sr);
+        return lazy;
+    }
+
+    /// Replace the status register, including the deferred flags
+    constexpr void set_status(std::uint8_t const status) {
+        sr = status;
+        negative = static_cast<std::uint8_t>(status & N);
+        zero = static_cast<std::uint8_t>((status & Z) == 0U ? 1U : 0U);
+        carry = static_cast<std::uint8_t>(status & C);
+        overflow = static_cast<std::uint8_t>((status & V) << 1);
+    }
+
+    /// Retrieve the status register with the deferred flags materialized
+    constexpr std::uint8_t status() const {
+        return static_cast<std::uint8_t>((sr & static_cast<std::uint8_t>(~(N | V | Z | C))) | (negative & N) |
+                                          ((overflow & 0x80) >> 1) | (zero == 0U ? Z : 0U) | (carry & C));
+    }
+
+    /// Retrieve the registers with the deferred flags materialized
+    constexpr Registers materialize() const {
+        Registers regs{*this};
+        regs.sr = status();
+        return regs;
+    }
+};
+}
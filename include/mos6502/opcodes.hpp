@@ -0,0 +1,531 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include <utility>
+
+namespace mos6502
+{
+/// Addressing modes of the instruction set
+enum class AddressMode : std::uint8_t {
+    Implied,     /// Operand is implied by the instruction
+    Accumulator, /// Operand is the accumulator
+    Immediate,   /// #$nn
+    ZeroPage,    /// $nn
+    ZeroPageX,   /// $nn,X
+    ZeroPageY,   /// $nn,Y
+    Absolute,    /// $nnnn
+    AbsoluteX,   /// $nnnn,X
+    AbsoluteY,   /// $nnnn,Y
+    Indirect,    /// ($nnnn)
+    IndirectX,   /// ($nn,X)
+    IndirectY,   /// ($nn),Y
+    Relative,    /// Signed branch offset
+    ZeroPageIndirect,  /// ($nn), 65C02 only
+    AbsoluteIndirectX, /// ($nnnn,X), 65C02 only
+};
+
+/// Instruction mnemonics
+/// @note The second block are the undocumented opcodes of the NMOS 6502, named as in
+///       "No More Secrets", the third block the instructions added by the 65C02
+/// @note ILL stands for every opcode without a defined instruction
+enum class Mnemonic : std::uint8_t {
+    ADC, AND, ASL, BCC, BCS, BEQ, BIT, BMI,
+    BNE, BPL, BRK, BVC, BVS, CLC, CLD, CLI,
+    CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR,
+    INC, INX, INY, JMP, JSR, LDA, LDX, LDY,
+    LSR, NOP, ORA, PHA, PHP, PLA, PLP, ROL,
+    ROR, RTI, RTS, SBC, SEC, SED, SEI, STA,
+    STX, STY, TAX, TAY, TSX, TXA, TXS, TYA,
+    ALR, ANC, ANE, ARR, DCP, ISC, JAM, LAS,
+    LAX, LXA, RLA, RRA, SAX, SBX, SHA, SHX,
+    SHY, SLO, SRE, TAS,
+    BRA, PHX, PHY, PLX, PLY, STZ, TRB, TSB,
+    ILL,
+};
+
+/// How an instruction accesses its operand
+enum class Access : std::uint8_t {
+    Implied, /// No memory operand, or the instruction consumes the immediate bytes by itself
+    Read,    /// Operand is read
+    Write,   /// Operand is written
+    Modify,  /// Operand is read, modified and written back
+};
+
+/// Static description of an opcode
+struct OpcodeInfo final {
+    Mnemonic mnemonic;
+    AddressMode mode;
+    Access access;
+    std::uint8_t length;       /// Instruction length in bytes, BRK includes its mark byte
+    std::uint8_t cycles;       /// Base number of cycles
+    std::uint8_t page_penalty; /// Extra cycles when indexing crosses a page boundary
+};
+
+static_assert(sizeof(OpcodeInfo) == 6);
+
+/// Descriptor of every opcode documented by MOS Technology
+inline constexpr std::array<OpcodeInfo, 256> kOpcodeTable = {
+    /* 0x00 */ OpcodeInfo{Mnemonic::BRK, AddressMode::Implied,     Access::Implied, 2, 7, 0},
+    /* 0x01 */ OpcodeInfo{Mnemonic::ORA, AddressMode::IndirectX,   Access::Read,    2, 6, 0},
+    /* 0x02 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x03 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x04 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x05 */ OpcodeInfo{Mnemonic::ORA, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0x06 */ OpcodeInfo{Mnemonic::ASL, AddressMode::ZeroPage,    Access::Modify,  2, 5, 0},
+    /* 0x07 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x08 */ OpcodeInfo{Mnemonic::PHP, AddressMode::Implied,     Access::Implied, 1, 3, 0},
+    /* 0x09 */ OpcodeInfo{Mnemonic::ORA, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0x0A */ OpcodeInfo{Mnemonic::ASL, AddressMode::Accumulator, Access::Modify,  1, 2, 0},
+    /* 0x0B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x0C */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x0D */ OpcodeInfo{Mnemonic::ORA, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0x0E */ OpcodeInfo{Mnemonic::ASL, AddressMode::Absolute,    Access::Modify,  3, 6, 0},
+    /* 0x0F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x10 */ OpcodeInfo{Mnemonic::BPL, AddressMode::Relative,    Access::Implied, 2, 2, 0},
+    /* 0x11 */ OpcodeInfo{Mnemonic::ORA, AddressMode::IndirectY,   Access::Read,    2, 5, 1},
+    /* 0x12 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x13 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x14 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x15 */ OpcodeInfo{Mnemonic::ORA, AddressMode::ZeroPageX,   Access::Read,    2, 4, 0},
+    /* 0x16 */ OpcodeInfo{Mnemonic::ASL, AddressMode::ZeroPageX,   Access::Modify,  2, 6, 0},
+    /* 0x17 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x18 */ OpcodeInfo{Mnemonic::CLC, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0x19 */ OpcodeInfo{Mnemonic::ORA, AddressMode::AbsoluteY,   Access::Read,    3, 4, 1},
+    /* 0x1A */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x1B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x1C */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x1D */ OpcodeInfo{Mnemonic::ORA, AddressMode::AbsoluteX,   Access::Read,    3, 4, 1},
+    /* 0x1E */ OpcodeInfo{Mnemonic::ASL, AddressMode::AbsoluteX,   Access::Modify,  3, 7, 0},
+    /* 0x1F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x20 */ OpcodeInfo{Mnemonic::JSR, AddressMode::Absolute,    Access::Implied, 3, 6, 0},
+    /* 0x21 */ OpcodeInfo{Mnemonic::AND, AddressMode::IndirectX,   Access::Read,    2, 6, 0},
+    /* 0x22 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x23 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x24 */ OpcodeInfo{Mnemonic::BIT, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0x25 */ OpcodeInfo{Mnemonic::AND, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0x26 */ OpcodeInfo{Mnemonic::ROL, AddressMode::ZeroPage,    Access::Modify,  2, 5, 0},
+    /* 0x27 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x28 */ OpcodeInfo{Mnemonic::PLP, AddressMode::Implied,     Access::Implied, 1, 4, 0},
+    /* 0x29 */ OpcodeInfo{Mnemonic::AND, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0x2A */ OpcodeInfo{Mnemonic::ROL, AddressMode::Accumulator, Access::Modify,  1, 2, 0},
+    /* 0x2B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x2C */ OpcodeInfo{Mnemonic::BIT, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0x2D */ OpcodeInfo{Mnemonic::AND, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0x2E */ OpcodeInfo{Mnemonic::ROL, AddressMode::Absolute,    Access::Modify,  3, 6, 0},
+    /* 0x2F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x30 */ OpcodeInfo{Mnemonic::BMI, AddressMode::Relative,    Access::Implied, 2, 2, 0},
+    /* 0x31 */ OpcodeInfo{Mnemonic::AND, AddressMode::IndirectY,   Access::Read,    2, 5, 1},
+    /* 0x32 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x33 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x34 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x35 */ OpcodeInfo{Mnemonic::AND, AddressMode::ZeroPageX,   Access::Read,    2, 4, 0},
+    /* 0x36 */ OpcodeInfo{Mnemonic::ROL, AddressMode::ZeroPageX,   Access::Modify,  2, 6, 0},
+    /* 0x37 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x38 */ OpcodeInfo{Mnemonic::SEC, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0x39 */ OpcodeInfo{Mnemonic::AND, AddressMode::AbsoluteY,   Access::Read,    3, 4, 1},
+    /* 0x3A */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x3B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x3C */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x3D */ OpcodeInfo{Mnemonic::AND, AddressMode::AbsoluteX,   Access::Read,    3, 4, 1},
+    /* 0x3E */ OpcodeInfo{Mnemonic::ROL, AddressMode::AbsoluteX,   Access::Modify,  3, 7, 0},
+    /* 0x3F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x40 */ OpcodeInfo{Mnemonic::RTI, AddressMode::Implied,     Access::Implied, 1, 6, 0},
+    /* 0x41 */ OpcodeInfo{Mnemonic::EOR, AddressMode::IndirectX,   Access::Read,    2, 6, 0},
+    /* 0x42 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x43 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x44 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x45 */ OpcodeInfo{Mnemonic::EOR, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0x46 */ OpcodeInfo{Mnemonic::LSR, AddressMode::ZeroPage,    Access::Modify,  2, 5, 0},
+    /* 0x47 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x48 */ OpcodeInfo{Mnemonic::PHA, AddressMode::Implied,     Access::Implied, 1, 3, 0},
+    /* 0x49 */ OpcodeInfo{Mnemonic::EOR, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0x4A */ OpcodeInfo{Mnemonic::LSR, AddressMode::Accumulator, Access::Modify,  1, 2, 0},
+    /* 0x4B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x4C */ OpcodeInfo{Mnemonic::JMP, AddressMode::Absolute,    Access::Implied, 3, 3, 0},
+    /* 0x4D */ OpcodeInfo{Mnemonic::EOR, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0x4E */ OpcodeInfo{Mnemonic::LSR, AddressMode::Absolute,    Access::Modify,  3, 6, 0},
+    /* 0x4F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x50 */ OpcodeInfo{Mnemonic::BVC, AddressMode::Relative,    Access::Implied, 2, 2, 0},
+    /* 0x51 */ OpcodeInfo{Mnemonic::EOR, AddressMode::IndirectY,   Access::Read,    2, 5, 1},
+    /* 0x52 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x53 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x54 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x55 */ OpcodeInfo{Mnemonic::EOR, AddressMode::ZeroPageX,   Access::Read,    2, 4, 0},
+    /* 0x56 */ OpcodeInfo{Mnemonic::LSR, AddressMode::ZeroPageX,   Access::Modify,  2, 6, 0},
+    /* 0x57 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x58 */ OpcodeInfo{Mnemonic::CLI, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0x59 */ OpcodeInfo{Mnemonic::EOR, AddressMode::AbsoluteY,   Access::Read,    3, 4, 1},
+    /* 0x5A */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x5B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x5C */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x5D */ OpcodeInfo{Mnemonic::EOR, AddressMode::AbsoluteX,   Access::Read,    3, 4, 1},
+    /* 0x5E */ OpcodeInfo{Mnemonic::LSR, AddressMode::AbsoluteX,   Access::Modify,  3, 7, 0},
+    /* 0x5F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x60 */ OpcodeInfo{Mnemonic::RTS, AddressMode::Implied,     Access::Implied, 1, 6, 0},
+    /* 0x61 */ OpcodeInfo{Mnemonic::ADC, AddressMode::IndirectX,   Access::Read,    2, 6, 0},
+    /* 0x62 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x63 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x64 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x65 */ OpcodeInfo{Mnemonic::ADC, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0x66 */ OpcodeInfo{Mnemonic::ROR, AddressMode::ZeroPage,    Access::Modify,  2, 5, 0},
+    /* 0x67 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x68 */ OpcodeInfo{Mnemonic::PLA, AddressMode::Implied,     Access::Implied, 1, 4, 0},
+    /* 0x69 */ OpcodeInfo{Mnemonic::ADC, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0x6A */ OpcodeInfo{Mnemonic::ROR, AddressMode::Accumulator, Access::Modify,  1, 2, 0},
+    /* 0x6B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x6C */ OpcodeInfo{Mnemonic::JMP, AddressMode::Indirect,    Access::Implied, 3, 5, 0},
+    /* 0x6D */ OpcodeInfo{Mnemonic::ADC, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0x6E */ OpcodeInfo{Mnemonic::ROR, AddressMode::Absolute,    Access::Modify,  3, 6, 0},
+    /* 0x6F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x70 */ OpcodeInfo{Mnemonic::BVS, AddressMode::Relative,    Access::Implied, 2, 2, 0},
+    /* 0x71 */ OpcodeInfo{Mnemonic::ADC, AddressMode::IndirectY,   Access::Read,    2, 5, 1},
+    /* 0x72 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x73 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x74 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x75 */ OpcodeInfo{Mnemonic::ADC, AddressMode::ZeroPageX,   Access::Read,    2, 4, 0},
+    /* 0x76 */ OpcodeInfo{Mnemonic::ROR, AddressMode::ZeroPageX,   Access::Modify,  2, 6, 0},
+    /* 0x77 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x78 */ OpcodeInfo{Mnemonic::SEI, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0x79 */ OpcodeInfo{Mnemonic::ADC, AddressMode::AbsoluteY,   Access::Read,    3, 4, 1},
+    /* 0x7A */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x7B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x7C */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x7D */ OpcodeInfo{Mnemonic::ADC, AddressMode::AbsoluteX,   Access::Read,    3, 4, 1},
+    /* 0x7E */ OpcodeInfo{Mnemonic::ROR, AddressMode::AbsoluteX,   Access::Modify,  3, 7, 0},
+    /* 0x7F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x80 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x81 */ OpcodeInfo{Mnemonic::STA, AddressMode::IndirectX,   Access::Write,   2, 6, 0},
+    /* 0x82 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x83 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x84 */ OpcodeInfo{Mnemonic::STY, AddressMode::ZeroPage,    Access::Write,   2, 3, 0},
+    /* 0x85 */ OpcodeInfo{Mnemonic::STA, AddressMode::ZeroPage,    Access::Write,   2, 3, 0},
+    /* 0x86 */ OpcodeInfo{Mnemonic::STX, AddressMode::ZeroPage,    Access::Write,   2, 3, 0},
+    /* 0x87 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x88 */ OpcodeInfo{Mnemonic::DEY, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0x89 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x8A */ OpcodeInfo{Mnemonic::TXA, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0x8B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x8C */ OpcodeInfo{Mnemonic::STY, AddressMode::Absolute,    Access::Write,   3, 4, 0},
+    /* 0x8D */ OpcodeInfo{Mnemonic::STA, AddressMode::Absolute,    Access::Write,   3, 4, 0},
+    /* 0x8E */ OpcodeInfo{Mnemonic::STX, AddressMode::Absolute,    Access::Write,   3, 4, 0},
+    /* 0x8F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x90 */ OpcodeInfo{Mnemonic::BCC, AddressMode::Relative,    Access::Implied, 2, 2, 0},
+    /* 0x91 */ OpcodeInfo{Mnemonic::STA, AddressMode::IndirectY,   Access::Write,   2, 6, 0},
+    /* 0x92 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x93 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x94 */ OpcodeInfo{Mnemonic::STY, AddressMode::ZeroPageX,   Access::Write,   2, 4, 0},
+    /* 0x95 */ OpcodeInfo{Mnemonic::STA, AddressMode::ZeroPageX,   Access::Write,   2, 4, 0},
+    /* 0x96 */ OpcodeInfo{Mnemonic::STX, AddressMode::ZeroPageY,   Access::Write,   2, 4, 0},
+    /* 0x97 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x98 */ OpcodeInfo{Mnemonic::TYA, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0x99 */ OpcodeInfo{Mnemonic::STA, AddressMode::AbsoluteY,   Access::Write,   3, 5, 0},
+    /* 0x9A */ OpcodeInfo{Mnemonic::TXS, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0x9B */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x9C */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x9D */ OpcodeInfo{Mnemonic::STA, AddressMode::AbsoluteX,   Access::Write,   3, 5, 0},
+    /* 0x9E */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0x9F */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xA0 */ OpcodeInfo{Mnemonic::LDY, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0xA1 */ OpcodeInfo{Mnemonic::LDA, AddressMode::IndirectX,   Access::Read,    2, 6, 0},
+    /* 0xA2 */ OpcodeInfo{Mnemonic::LDX, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0xA3 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xA4 */ OpcodeInfo{Mnemonic::LDY, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0xA5 */ OpcodeInfo{Mnemonic::LDA, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0xA6 */ OpcodeInfo{Mnemonic::LDX, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0xA7 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xA8 */ OpcodeInfo{Mnemonic::TAY, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xA9 */ OpcodeInfo{Mnemonic::LDA, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0xAA */ OpcodeInfo{Mnemonic::TAX, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xAB */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xAC */ OpcodeInfo{Mnemonic::LDY, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0xAD */ OpcodeInfo{Mnemonic::LDA, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0xAE */ OpcodeInfo{Mnemonic::LDX, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0xAF */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xB0 */ OpcodeInfo{Mnemonic::BCS, AddressMode::Relative,    Access::Implied, 2, 2, 0},
+    /* 0xB1 */ OpcodeInfo{Mnemonic::LDA, AddressMode::IndirectY,   Access::Read,    2, 5, 1},
+    /* 0xB2 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xB3 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xB4 */ OpcodeInfo{Mnemonic::LDY, AddressMode::ZeroPageX,   Access::Read,    2, 4, 0},
+    /* 0xB5 */ OpcodeInfo{Mnemonic::LDA, AddressMode::ZeroPageX,   Access::Read,    2, 4, 0},
+    /* 0xB6 */ OpcodeInfo{Mnemonic::LDX, AddressMode::ZeroPageY,   Access::Read,    2, 4, 0},
+    /* 0xB7 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xB8 */ OpcodeInfo{Mnemonic::CLV, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xB9 */ OpcodeInfo{Mnemonic::LDA, AddressMode::AbsoluteY,   Access::Read,    3, 4, 1},
+    /* 0xBA */ OpcodeInfo{Mnemonic::TSX, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xBB */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xBC */ OpcodeInfo{Mnemonic::LDY, AddressMode::AbsoluteX,   Access::Read,    3, 4, 1},
+    /* 0xBD */ OpcodeInfo{Mnemonic::LDA, AddressMode::AbsoluteX,   Access::Read,    3, 4, 1},
+    /* 0xBE */ OpcodeInfo{Mnemonic::LDX, AddressMode::AbsoluteY,   Access::Read,    3, 4, 1},
+    /* 0xBF */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xC0 */ OpcodeInfo{Mnemonic::CPY, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0xC1 */ OpcodeInfo{Mnemonic::CMP, AddressMode::IndirectX,   Access::Read,    2, 6, 0},
+    /* 0xC2 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xC3 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xC4 */ OpcodeInfo{Mnemonic::CPY, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0xC5 */ OpcodeInfo{Mnemonic::CMP, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0xC6 */ OpcodeInfo{Mnemonic::DEC, AddressMode::ZeroPage,    Access::Modify,  2, 5, 0},
+    /* 0xC7 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xC8 */ OpcodeInfo{Mnemonic::INY, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xC9 */ OpcodeInfo{Mnemonic::CMP, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0xCA */ OpcodeInfo{Mnemonic::DEX, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xCB */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xCC */ OpcodeInfo{Mnemonic::CPY, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0xCD */ OpcodeInfo{Mnemonic::CMP, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0xCE */ OpcodeInfo{Mnemonic::DEC, AddressMode::Absolute,    Access::Modify,  3, 6, 0},
+    /* 0xCF */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xD0 */ OpcodeInfo{Mnemonic::BNE, AddressMode::Relative,    Access::Implied, 2, 2, 0},
+    /* 0xD1 */ OpcodeInfo{Mnemonic::CMP, AddressMode::IndirectY,   Access::Read,    2, 5, 1},
+    /* 0xD2 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xD3 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xD4 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xD5 */ OpcodeInfo{Mnemonic::CMP, AddressMode::ZeroPageX,   Access::Read,    2, 4, 0},
+    /* 0xD6 */ OpcodeInfo{Mnemonic::DEC, AddressMode::ZeroPageX,   Access::Modify,  2, 6, 0},
+    /* 0xD7 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xD8 */ OpcodeInfo{Mnemonic::CLD, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xD9 */ OpcodeInfo{Mnemonic::CMP, AddressMode::AbsoluteY,   Access::Read,    3, 4, 1},
+    /* 0xDA */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xDB */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xDC */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xDD */ OpcodeInfo{Mnemonic::CMP, AddressMode::AbsoluteX,   Access::Read,    3, 4, 1},
+    /* 0xDE */ OpcodeInfo{Mnemonic::DEC, AddressMode::AbsoluteX,   Access::Modify,  3, 7, 0},
+    /* 0xDF */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xE0 */ OpcodeInfo{Mnemonic::CPX, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0xE1 */ OpcodeInfo{Mnemonic::SBC, AddressMode::IndirectX,   Access::Read,    2, 6, 0},
+    /* 0xE2 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xE3 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xE4 */ OpcodeInfo{Mnemonic::CPX, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0xE5 */ OpcodeInfo{Mnemonic::SBC, AddressMode::ZeroPage,    Access::Read,    2, 3, 0},
+    /* 0xE6 */ OpcodeInfo{Mnemonic::INC, AddressMode::ZeroPage,    Access::Modify,  2, 5, 0},
+    /* 0xE7 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xE8 */ OpcodeInfo{Mnemonic::INX, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xE9 */ OpcodeInfo{Mnemonic::SBC, AddressMode::Immediate,   Access::Read,    2, 2, 0},
+    /* 0xEA */ OpcodeInfo{Mnemonic::NOP, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xEB */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xEC */ OpcodeInfo{Mnemonic::CPX, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0xED */ OpcodeInfo{Mnemonic::SBC, AddressMode::Absolute,    Access::Read,    3, 4, 0},
+    /* 0xEE */ OpcodeInfo{Mnemonic::INC, AddressMode::Absolute,    Access::Modify,  3, 6, 0},
+    /* 0xEF */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xF0 */ OpcodeInfo{Mnemonic::BEQ, AddressMode::Relative,    Access::Implied, 2, 2, 0},
+    /* 0xF1 */ OpcodeInfo{Mnemonic::SBC, AddressMode::IndirectY,   Access::Read,    2, 5, 1},
+    /* 0xF2 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xF3 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xF4 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xF5 */ OpcodeInfo{Mnemonic::SBC, AddressMode::ZeroPageX,   Access::Read,    2, 4, 0},
+    /* 0xF6 */ OpcodeInfo{Mnemonic::INC, AddressMode::ZeroPageX,   Access::Modify,  2, 6, 0},
+    /* 0xF7 */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xF8 */ OpcodeInfo{Mnemonic::SED, AddressMode::Implied,     Access::Implied, 1, 2, 0},
+    /* 0xF9 */ OpcodeInfo{Mnemonic::SBC, AddressMode::AbsoluteY,   Access::Read,    3, 4, 1},
+    /* 0xFA */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xFB */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xFC */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+    /* 0xFD */ OpcodeInfo{Mnemonic::SBC, AddressMode::AbsoluteX,   Access::Read,    3, 4, 1},
+    /* 0xFE */ OpcodeInfo{Mnemonic::INC, AddressMode::AbsoluteX,   Access::Modify,  3, 7, 0},
+    /* 0xFF */ OpcodeInfo{Mnemonic::ILL, AddressMode::Implied,     Access::Implied, 0, 0, 0},
+};
+
+/// Descriptor of every opcode of the NMOS 6502, including the undocumented ones
+///
+/// The twelve JAM opcodes halt the processor until reset.
+inline constexpr std::array<OpcodeInfo, 256> kNmosOpcodeTable = [] {
+    std::array<OpcodeInfo, 256> table = kOpcodeTable;
+
+    // Read-modify-write combined with an accumulator operation, same opcode pattern for each
+    constexpr std::array<std::pair<Mnemonic, std::uint8_t>, 6> kCombined = {{
+        {Mnemonic::SLO, 0x00}, {Mnemonic::RLA, 0x20}, {Mnemonic::SRE, 0x40},
+        {Mnemonic::RRA, 0x60}, {Mnemonic::DCP, 0xC0}, {Mnemonic::ISC, 0xE0},
+    }};
+    for (auto const& [mnemonic, row] : kCombined) {
+        table[row | 0x03U] = OpcodeInfo{mnemonic, AddressMode::IndirectX, Access::Modify, 2, 8, 0};
+        table[row | 0x07U] = OpcodeInfo{mnemonic, AddressMode::ZeroPage,  Access::Modify, 2, 5, 0};
+        table[row | 0x0FU] = OpcodeInfo{mnemonic, AddressMode::Absolute,  Access::Modify, 3, 6, 0};
+        table[row | 0x13U] = OpcodeInfo{mnemonic, AddressMode::IndirectY, Access::Modify, 2, 8, 0};
+        table[row | 0x17U] = OpcodeInfo{mnemonic, AddressMode::ZeroPageX, Access::Modify, 2, 6, 0};
+        table[row | 0x1BU] = OpcodeInfo{mnemonic, AddressMode::AbsoluteY, Access::Modify, 3, 7, 0};
+        table[row | 0x1FU] = OpcodeInfo{mnemonic, AddressMode::AbsoluteX, Access::Modify, 3, 7, 0};
+    }
+
+    table[0x83] = OpcodeInfo{Mnemonic::SAX, AddressMode::IndirectX, Access::Write, 2, 6, 0};
+    table[0x87] = OpcodeInfo{Mnemonic::SAX, AddressMode::ZeroPage,  Access::Write, 2, 3, 0};
+    table[0x8F] = OpcodeInfo{Mnemonic::SAX, AddressMode::Absolute,  Access::Write, 3, 4, 0};
+    table[0x97] = OpcodeInfo{Mnemonic::SAX, AddressMode::ZeroPageY, Access::Write, 2, 4, 0};
+
+    table[0xA3] = OpcodeInfo{Mnemonic::LAX, AddressMode::IndirectX, Access::Read, 2, 6, 0};
+    table[0xA7] = OpcodeInfo{Mnemonic::LAX, AddressMode::ZeroPage,  Access::Read, 2, 3, 0};
+    table[0xAF] = OpcodeInfo{Mnemonic::LAX, AddressMode::Absolute,  Access::Read, 3, 4, 0};
+    table[0xB3] = OpcodeInfo{Mnemonic::LAX, AddressMode::IndirectY, Access::Read, 2, 5, 1};
+    table[0xB7] = OpcodeInfo{Mnemonic::LAX, AddressMode::ZeroPageY, Access::Read, 2, 4, 0};
+    table[0xBF] = OpcodeInfo{Mnemonic::LAX, AddressMode::AbsoluteY, Access::Read, 3, 4, 1};
+
+    table[0x0B] = OpcodeInfo{Mnemonic::ANC, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    table[0x2B] = OpcodeInfo{Mnemonic::ANC, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    table[0x4B] = OpcodeInfo{Mnemonic::ALR, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    table[0x6B] = OpcodeInfo{Mnemonic::ARR, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    table[0x8B] = OpcodeInfo{Mnemonic::ANE, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    table[0xAB] = OpcodeInfo{Mnemonic::LXA, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    table[0xCB] = OpcodeInfo{Mnemonic::SBX, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    table[0xEB] = OpcodeInfo{Mnemonic::SBC, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    table[0xBB] = OpcodeInfo{Mnemonic::LAS, AddressMode::AbsoluteY, Access::Read, 3, 4, 1};
+
+    table[0x93] = OpcodeInfo{Mnemonic::SHA, AddressMode::IndirectY, Access::Write, 2, 6, 0};
+    table[0x9F] = OpcodeInfo{Mnemonic::SHA, AddressMode::AbsoluteY, Access::Write, 3, 5, 0};
+    table[0x9B] = OpcodeInfo{Mnemonic::TAS, AddressMode::AbsoluteY, Access::Write, 3, 5, 0};
+    table[0x9C] = OpcodeInfo{Mnemonic::SHY, AddressMode::AbsoluteX, Access::Write, 3, 5, 0};
+    table[0x9E] = OpcodeInfo{Mnemonic::SHX, AddressMode::AbsoluteY, Access::Write, 3, 5, 0};
+
+    for (std::uint8_t const opcode : std::initializer_list<std::uint8_t>{0x1A, 0x3A, 0x5A, 0x7A, 0xDA, 0xFA}) {
+        table[opcode] = OpcodeInfo{Mnemonic::NOP, AddressMode::Implied, Access::Implied, 1, 2, 0};
+    }
+    for (std::uint8_t const opcode : std::initializer_list<std::uint8_t>{0x80, 0x82, 0x89, 0xC2, 0xE2}) {
+        table[opcode] = OpcodeInfo{Mnemonic::NOP, AddressMode::Immediate, Access::Read, 2, 2, 0};
+    }
+    for (std::uint8_t const opcode : std::initializer_list<std::uint8_t>{0x04, 0x44, 0x64}) {
+        table[opcode] = OpcodeInfo{Mnemonic::NOP, AddressMode::ZeroPage, Access::Read, 2, 3, 0};
+    }
+    for (std::uint8_t const opcode : std::initializer_list<std::uint8_t>{0x14, 0x34, 0x54, 0x74, 0xD4, 0xF4}) {
+        table[opcode] = OpcodeInfo{Mnemonic::NOP, AddressMode::ZeroPageX, Access::Read, 2, 4, 0};
+    }
+    table[0x0C] = OpcodeInfo{Mnemonic::NOP, AddressMode::Absolute, Access::Read, 3, 4, 0};
+    for (std::uint8_t const opcode : std::initializer_list<std::uint8_t>{0x1C, 0x3C, 0x5C, 0x7C, 0xDC, 0xFC}) {
+        table[opcode] = OpcodeInfo{Mnemonic::NOP, AddressMode::AbsoluteX, Access::Read, 3, 4, 1};
+    }
+
+    for (std::uint8_t const opcode : std::initializer_list<std::uint8_t>{0x02, 0x12, 0x22, 0x32, 0x42, 0x52, 0x62, 0x72, 0x92, 0xB2, 0xD2, 0xF2}) {
+        table[opcode] = OpcodeInfo{Mnemonic::JAM, AddressMode::Implied, Access::Implied, 1, 2, 0};
+    }
+    return table;
+}();
+
+/// Descriptor of every opcode of the 65C02
+///
+/// Opcodes left undefined by the 65C02 are NOPs of fixed length and timing, the bit
+/// instructions of the Rockwell and WDC parts (RMB, SMB, BBR, BBS) are not included.
+inline constexpr std::array<OpcodeInfo, 256> kCmosOpcodeTable = [] {
+    std::array<OpcodeInfo, 256> table = kOpcodeTable;
+
+    for (std::size_t opcode = 0U; opcode < table.size(); ++opcode) {
+        if (table[opcode].mnemonic != Mnemonic::ILL) {
+            continue;
+        }
+        if ((opcode & 0x0FU) == 0x02U) {
+            table[opcode] = OpcodeInfo{Mnemonic::NOP, AddressMode::Immediate, Access::Read, 2, 2, 0};
+        } else {
+            table[opcode] = OpcodeInfo{Mnemonic::NOP, AddressMode::Implied, Access::Implied, 1, 1, 0};
+        }
+    }
+    table[0x44] = OpcodeInfo{Mnemonic::NOP, AddressMode::ZeroPage,  Access::Read, 2, 3, 0};
+    table[0x54] = OpcodeInfo{Mnemonic::NOP, AddressMode::ZeroPageX, Access::Read, 2, 4, 0};
+    table[0xD4] = OpcodeInfo{Mnemonic::NOP, AddressMode::ZeroPageX, Access::Read, 2, 4, 0};
+    table[0xF4] = OpcodeInfo{Mnemonic::NOP, AddressMode::ZeroPageX, Access::Read, 2, 4, 0};
+    table[0x5C] = OpcodeInfo{Mnemonic::NOP, AddressMode::Absolute,  Access::Read, 3, 8, 0};
+    table[0xDC] = OpcodeInfo{Mnemonic::NOP, AddressMode::Absolute,  Access::Read, 3, 4, 0};
+    table[0xFC] = OpcodeInfo{Mnemonic::NOP, AddressMode::Absolute,  Access::Read, 3, 4, 0};
+
+    // Accumulator operations on (zp)
+    for (std::uint8_t const opcode : std::initializer_list<std::uint8_t>{0x12, 0x32, 0x52, 0x72, 0xB2, 0xD2, 0xF2}) {
+        table[opcode] = table[opcode - 1U];
+        table[opcode].mode = AddressMode::ZeroPageIndirect;
+        table[opcode].cycles = 5U;
+        table[opcode].page_penalty = 0U;
+    }
+    table[0x92] = OpcodeInfo{Mnemonic::STA, AddressMode::ZeroPageIndirect, Access::Write, 2, 5, 0};
+
+    table[0x04] = OpcodeInfo{Mnemonic::TSB, AddressMode::ZeroPage,  Access::Modify,  2, 5, 0};
+    table[0x0C] = OpcodeInfo{Mnemonic::TSB, AddressMode::Absolute,  Access::Modify,  3, 6, 0};
+    table[0x14] = OpcodeInfo{Mnemonic::TRB, AddressMode::ZeroPage,  Access::Modify,  2, 5, 0};
+    table[0x1C] = OpcodeInfo{Mnemonic::TRB, AddressMode::Absolute,  Access::Modify,  3, 6, 0};
+    table[0x1A] = OpcodeInfo{Mnemonic::INC, AddressMode::Accumulator, Access::Modify, 1, 2, 0};
+    table[0x3A] = OpcodeInfo{Mnemonic::DEC, AddressMode::Accumulator, Access::Modify, 1, 2, 0};
+    table[0x34] = OpcodeInfo{Mnemonic::BIT, AddressMode::ZeroPageX, Access::Read,    2, 4, 0};
+    table[0x3C] = OpcodeInfo{Mnemonic::BIT, AddressMode::AbsoluteX, Access::Read,    3, 4, 1};
+    table[0x89] = OpcodeInfo{Mnemonic::BIT, AddressMode::Immediate, Access::Read,    2, 2, 0};
+    table[0x5A] = OpcodeInfo{Mnemonic::PHY, AddressMode::Implied,   Access::Implied, 1, 3, 0};
+    table[0x7A] = OpcodeInfo{Mnemonic::PLY, AddressMode::Implied,   Access::Implied, 1, 4, 0};
+    table[0xDA] = OpcodeInfo{Mnemonic::PHX, AddressMode::Implied,   Access::Implied, 1, 3, 0};
+    table[0xFA] = OpcodeInfo{Mnemonic::PLX, AddressMode::Implied,   Access::Implied, 1, 4, 0};
+    table[0x64] = OpcodeInfo{Mnemonic::STZ, AddressMode::ZeroPage,  Access::Write,   2, 3, 0};
+    table[0x74] = OpcodeInfo{Mnemonic::STZ, AddressMode::ZeroPageX, Access::Write,   2, 4, 0};
+    table[0x9C] = OpcodeInfo{Mnemonic::STZ, AddressMode::Absolute,  Access::Write,   3, 4, 0};
+    table[0x9E] = OpcodeInfo{Mnemonic::STZ, AddressMode::AbsoluteX, Access::Write,   3, 5, 0};
+    table[0x80] = OpcodeInfo{Mnemonic::BRA, AddressMode::Relative,  Access::Implied, 2, 3, 0};
+    table[0x7C] = OpcodeInfo{Mnemonic::JMP, AddressMode::AbsoluteIndirectX, Access::Implied, 3, 6, 0};
+
+    // JMP (ind) no longer wraps within the page and takes one more cycle
+    table[0x6C].cycles = 6U;
+
+    // Shifts and rotates on $nnnn,X only spend the extra cycle when crossing a page
+    for (std::uint8_t const opcode : std::initializer_list<std::uint8_t>{0x1E, 0x3E, 0x5E, 0x7E}) {
+        table[opcode].cycles = 6U;
+        table[opcode].page_penalty = 1U;
+    }
+    return table;
+}();
+
+/// Retrieve the name of a mnemonic
+constexpr std::string_view mnemonic_name(Mnemonic const mnemonic) {
+    constexpr std::array<std::string_view, 85> names = {
+        "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT", "BMI",
+        "BNE", "BPL", "BRK", "BVC", "BVS", "CLC", "CLD", "CLI",
+        "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY", "EOR",
+        "INC", "INX", "INY", "JMP", "JSR", "LDA", "LDX", "LDY",
+        "LSR", "NOP", "ORA", "PHA", "PHP", "PLA", "PLP", "ROL",
+        "ROR", "RTI", "RTS", "SBC", "SEC", "SED", "SEI", "STA",
+        "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS", "TYA",
+        "ALR", "ANC", "ANE", "ARR", "DCP", "ISC", "JAM", "LAS",
+        "LAX", "LXA", "RLA", "RRA", "SAX", "SBX", "SHA", "SHX",
+        "SHY", "SLO", "SRE", "TAS",
+        "BRA", "PHX", "PHY", "PLX", "PLY", "STZ", "TRB", "TSB",
+        "ILL",
+    };
+    return names[static_cast<std::size_t>(mnemonic)];
+}
+
+/// Retrieve the operand syntax of an addressing mode, e.g. "$nnnn,X"
+constexpr std::string_view address_mode_name(AddressMode const mode) {
+    constexpr std::array<std::string_view, 15> names = {
+        "", "A", "#$nn", "$nn", "$nn,X", "$nn,Y", "$nnnn", "$nnnn,X",
+        "$nnnn,Y", "($nnnn)", "($nn,X)", "($nn),Y", "$rr", "($nn)", "($nnnn,X)",
+    };
+    return names[static_cast<std::size_t>(mode)];
+}
+}
+
+/// Expand X(opcode) for the 16 opcodes of a row (high nibble)
+#define MOS6502_OPCODE_ROW(X, h) \
+    X(0x##h##0) \
+    X(0x##h##1) \
+    X(0x##h##2) \
+    X(0x##h##3) \
+    X(0x##h##4) \
+    X(0x##h##5) \
+    X(0x##h##6) \
+    X(0x##h##7) \
+    X(0x##h##8) \
+    X(0x##h##9) \
+    X(0x##h##A) \
+    X(0x##h##B) \
+    X(0x##h##C) \
+    X(0x##h##D) \
+    X(0x##h##E) \
+    X(0x##h##F)
+
+/// Expand X(opcode) for every opcode from 0x00 to 0xFF
+#define MOS6502_FOR_EACH_OPCODE(X) \
+    MOS6502_OPCODE_ROW(X, 0) \
+    MOS6502_OPCODE_ROW(X, 1) \
+    MOS6502_OPCODE_ROW(X, 2) \
+    MOS6502_OPCODE_ROW(X, 3) \
+    MOS6502_OPCODE_ROW(X, 4) \
+    MOS6502_OPCODE_ROW(X, 5) \
+    MOS6502_OPCODE_ROW(X, 6) \
+    MOS6502_OPCODE_ROW(X, 7) \
+    MOS6502_OPCODE_ROW(X, 8) \
+    MOS6502_OPCODE_ROW(X, 9) \
+    MOS6502_OPCODE_ROW(X, A) \
+    MOS6502_OPCODE_ROW(X, B) \
+    MOS6502_OPCODE_ROW(X, C) \
+    MOS6502_OPCODE_ROW(X, D) \
+    MOS6502_OPCODE_ROW(X, E) \
+    MOS6502_OPCODE_ROW(X, F)
@@ -0,0 +1,171 @@
+#pragma once
+#include <array>
+#include <bitset>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "mos6502/bus.hpp"
+#include "mos6502/snapshot.hpp"
+
+namespace mos6502
+{
+/// Bus that exposes its memory as pages of 256 bytes
+///
+/// A null page means the access must go through read/write (e.g. memory mapped devices).
+template<class Bus>
+concept PageMappedBus = requires(Bus const& bus, std::uint8_t page) {
+    { bus.read_page(page) } -> std::same_as<std::uint8_t const*>;
+    { bus.write_page(page) } -> std::same_as<std::uint8_t*>;
+};
+
+/// PageMappedBus that records which RAM pages were written (see PagedBus)
+template<class Bus>
+concept DirtyTrackingBus = PageMappedBus<Bus> && requires(Bus& bus, Bus const& const_bus, std::uint8_t page) {
+    { const_bus.ram_page(page) } -> std::same_as<std::uint8_t*>;
+    { const_bus.dirty_pages() } -> std::same_as<std::bitset<0x100> const&>;
+    { bus.clear_dirty() } -> std::same_as<void>;
+};
+
+/// Whether the pages of a PageMappedBus stay at the same address until they are remapped
+///
+/// The JIT only reads the memory of stable pages straight from native code.
+template<class Bus>
+inline constexpr bool kStablePages = true;
+
+/// Bus mapping the address space through a table of 256 pages
+///
+/// RAM and ROM pages are accessed by pointer, everything else is forwarded to a fallback bus
+/// which usually implements the memory mapped devices. By default every page is mapped to
+/// an internal 64KiB RAM.
+///
+/// The first write to a RAM page goes through write, which marks the page dirty, and from then
+/// on it is written by pointer until clear_dirty. Writes done through ram() are not tracked.
+class PagedBus final : public IBus {
+public:
+    static constexpr std::size_t kPageSize{0x100};
+    static constexpr std::size_t kPageCount{0x100};
+
+    /// Constructor
+    /// @param fallback bus serving the pages without memory, reads from them return 0xFF when null
+    explicit PagedBus(std::shared_ptr<IBus> fallback = {});
+
+    PagedBus(PagedBus const&) = delete;
+    PagedBus& operator=(PagedBus const&) = delete;
+
+    ~PagedBus() override;
+
+    std::uint8_t read(std::uint16_t addr) override {
+        std::uint8_t const* page = m_read_pages[addr >> 8];
+        if (page != nullptr) {
+            return page[addr & 0xFF];
+        }
+        return fallback_read(addr);
+    }
+
+    void write(std::uint16_t addr, std::uint8_t data) override {
+        std::uint8_t* page = m_write_pages[addr >> 8];
+        if (page != nullptr) {
+            page[addr & 0xFF] = data;
+        } else {
+            first_write(addr, data);
+        }
+    }
+
+    /// Read little endian word (see Fetch16Bus)
+    std::uint16_t fetch16(std::uint16_t addr) {
+        std::uint8_t const* page = m_read_pages[addr >> 8];
+        if (page != nullptr && (addr & 0xFF) != 0xFF) {
+            return static_cast<std::uint16_t>(page[addr & 0xFF] | (page[(addr & 0xFF) + 1U] << 8));
+        }
+        std::uint8_t const lo = read(addr);
+        std::uint8_t const hi = read(static_cast<std::uint16_t>(addr + 1U));
+        return static_cast<std::uint16_t>(lo | (hi << 8));
+    }
+
+    /// Retrieve the memory of a readable page, or null if it is served by the fallback
+    std::uint8_t const* read_page(std::uint8_t page) const {
+        return m_read_pages[page];
+    }
+
+    /// Retrieve the memory of a dirty RAM page, or null if writes must go through write
+    std::uint8_t* write_page(std::uint8_t page) const {
+        return m_write_pages[page];
+    }
+
+    /// Retrieve the memory of a RAM page, or null if it is ROM or served by the fallback
+    /// @note Writes through the pointer are not tracked (see mark_dirty)
+    std::uint8_t* ram_page(std::uint8_t page) const {
+        return m_ram_pages[page];
+    }
+
+    /// Pages written since the last clear_dirty
+    std::bitset<kPageCount> const& dirty_pages() const {
+        return m_dirty;
+    }
+
+    /// Mark a RAM page as written, e.g. after changing its memory directly
+    void mark_dirty(std::uint8_t page) {
+        m_write_pages[page] = m_ram_pages[page];
+        m_dirty[page] = m_ram_pages[page] != nullptr;
+    }
+
+    /// Forget the pages written, the next write to each of them goes through write again
+    void clear_dirty();
+
+    /// Map pages to the internal RAM at the same addresses
+    void map_ram(std::uint8_t first_page, std::size_t count);
+
+    /// Map pages to external RAM
+    /// @param memory storage of count * kPageSize bytes that outlives the bus
+    /// @note mapping several ranges to the same memory mirrors it
+    void map_ram(std::uint8_t first_page, std::size_t count, std::uint8_t* memory);
+
+    /// Map pages to read only memory, writes to them are forwarded to the fallback
+    /// @param memory storage of count * kPageSize bytes that outlives the bus
+    void map_rom(std::uint8_t first_page, std::size_t count, std::uint8_t const* memory);
+
+    /// Map pages to the fallback bus
+    void map_io(std::uint8_t first_page, std::size_t count);
+
+    /// Retrieve internal RAM
+    std::array<std::uint8_t, kPageCount * kPageSize>& ram() {
+        return m_ram;
+    }
+
+    std::array<std::uint8_t, kPageCount * kPageSize> const& ram() const {
+        return m_ram;
+    }
+
+    /// Bytes taken in a snapshot when every page is RAM
+    static constexpr std::size_t kSnapshotSize{kPageCount / 8U + kPageCount * kPageSize};
+
+    /// Save the contents of the RAM pages (see SnapshotableBus)
+    void save(SnapshotWriter& writer) const;
+
+    /// Restore the contents of the RAM pages, marking them dirty
+    /// @throw std::invalid_argument when the pages mapped to RAM differ from the ones saved
+    void restore(SnapshotReader& reader);
+
+private:
+    std::shared_ptr<IBus> m_fallback;
+    std::array<std::uint8_t const*, kPageCount> m_read_pages{};
+    std::array<std::uint8_t*, kPageCount> m_write_pages{};
+    std::array<std::uint8_t*, kPageCount> m_ram_pages{};
+    std::bitset<kPageCount> m_dirty{};
+    std::array<std::uint8_t, kPageCount * kPageSize> m_ram{};
+
+    /// Write to a page that is not dirty yet, marks it dirty if it is RAM
+    void first_write(std::uint16_t addr, std::uint8_t data);
+
+    std::uint8_t fallback_read(std::uint16_t addr);
+
+    void fallback_write(std::uint16_t addr, std::uint8_t data);
+};
+
+static_assert(PageMappedBus<PagedBus>);
+static_assert(Fetch16Bus<PagedBus>);
+static_assert(SnapshotableBus<PagedBus>);
+static_assert(DirtyTrackingBus<PagedBus>);
+}
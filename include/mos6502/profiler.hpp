@@ -0,0 +1,141 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+
+#include "mos6502/scheduler.hpp"
+#include "mos6502/spsc_ring.hpp"
+#include "mos6502/symbols.hpp"
+
+namespace mos6502
+{
+/// Statistical profiler of the guest program, sampling the program counter every few cycles
+///
+/// The thread running the Cpu records the program counter into a lock-free ring at the end of
+/// each period; another thread, or the same one between frames, drains the ring into a histogram
+/// by address with collect(). Reports resolve the addresses into routines through a SymbolTable.
+///
+/// Sampling happens at run boundaries, either through run_cycles or as an event of a Scheduler,
+/// so the Cpu runs its batches untouched and a program not profiled pays nothing. A sample lands
+/// on the instruction following the one that crossed the period.
+/// @code
+/// mos6502::PcSampler sampler{1000U};
+/// sampler.attach(scheduler, cpu);
+/// scheduler.run_cycles(cpu, kCyclesPerFrame);
+/// sampler.collect();
+/// sampler.write_report(std::cout, symbols);
+/// @endcode
+class PcSampler final {
+public:
+    /// Constructor
+    /// @param period number of cycles between samples
+    /// @param capacity number of samples the ring holds until collected, more are dropped
+    /// @throw std::invalid_argument when the period or the capacity is 0
+    explicit PcSampler(std::uint64_t period, std::size_t capacity = 65536U);
+
+    PcSampler(PcSampler const&) = delete;
+    PcSampler& operator=(PcSampler const&) = delete;
+
+    /// Destructor, detaches from the scheduler
+    ~PcSampler() {
+        detach();
+    }
+
+    std::uint64_t period() const {
+        return m_period;
+    }
+
+    /// Record a sample, from the thread running the Cpu
+    void record(std::uint16_t const pc) {
+        if (!m_ring.push(pc)) {
+            m_dropped.fetch_add(1U, std::memory_order_relaxed);
+        }
+    }
+
+    /// Run the Cpu for the cycle budget, sampling at every period
+    /// @return number of cycles consumed, the last instruction may overshoot the budget
+    template<class Cpu>
+    std::uint64_t run_cycles(Cpu& cpu, std::uint64_t const budget) {
+        std::uint64_t consumed = 0U;
+        while (consumed < budget) {
+            std::uint64_t const slice = std::min(budget - consumed, m_period - m_elapsed);
+            std::uint64_t const cycles = cpu.run_cycles(slice);
+            consumed += cycles;
+            m_elapsed += cycles;
+            if (m_elapsed >= m_period) {
+                m_elapsed %= m_period;
+                record(cpu.regs().pc);
+            }
+        }
+        return consumed;
+    }
+
+    /// Sample every period as an event of the scheduler, until detach
+    /// @note The Cpu must outlive the attachment
+    template<class Cpu>
+    void attach(Scheduler& scheduler, Cpu& cpu) {
+        detach();
+        m_scheduler = &scheduler;
+        m_tick = [this, &cpu](std::uint64_t const due) {
+            record(cpu.regs().pc);
+            m_event = m_scheduler->schedule(due + m_period, m_tick, "pc sample");
+        };
+        m_event = scheduler.schedule_in(m_period, m_tick, "pc sample");
+    }
+
+    /// Stop sampling through the scheduler
+    void detach();
+
+    /// Move the samples recorded into the histogram, from a single collector thread
+    /// @return number of samples collected
+    std::size_t collect();
+
+    /// Samples collected at an address
+    std::uint64_t samples(std::uint16_t const addr) const {
+        return (*m_histogram)[addr];
+    }
+
+    /// Samples collected at every address
+    std::uint64_t total() const {
+        return m_total;
+    }
+
+    /// Samples lost because the ring was full, from any thread
+    std::uint64_t dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    /// Clear the histogram, from the collector thread
+    void reset();
+
+    /// Write a flat profile, one line per routine with most samples first
+    /// @param limit largest number of routines listed
+    void write_report(std::ostream& out, SymbolTable const& symbols, std::size_t limit = 50U) const;
+
+    /// Write the samples as folded stacks ("routine count" lines) for flame graph tools
+    /// @note Stacks hold a single frame, the routine of the sample
+    void write_folded(std::ostream& out, SymbolTable const& symbols) const;
+
+private:
+    std::uint64_t m_period;
+    SpscRing<std::uint16_t> m_ring;
+
+    /// Counted by the thread running the Cpu, read by the collector
+    std::atomic<std::uint64_t> m_dropped{};
+
+    /// Owned by the thread running the Cpu
+    std::uint64_t m_elapsed{};
+    Scheduler* m_scheduler{};
+    Scheduler::EventId m_event{};
+    Scheduler::Callback m_tick{};
+
+    /// Owned by the collector thread
+    std::unique_ptr<std::array<std::uint64_t, 65536>> m_histogram;
+    std::uint64_t m_total{};
+};
+}
@@ -4,7 +4,7 @@
 namespace mos6502
 {
 /// MOS 6502 Registers
-struct Registers final {
+struct Registers {
     std::uint8_t ac;   /// Accumulator
     std::uint8_t xi;   /// X Index
     std::uint8_t yi;   /// Y Index
@@ -0,0 +1,205 @@
+#pragma once
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "mos6502/cpu.hpp"
+#include "mos6502/paged_bus.hpp"
+#include "mos6502/regs.hpp"
+#include "mos6502/traits.hpp"
+
+namespace mos6502
+{
+/// Largest delta of a page written by encode_page_delta
+inline constexpr std::size_t kMaxPageDelta{3U * (PagedBus::kPageSize / 2U + 1U)};
+
+/// Encode the XOR of two pages as runs of equal bytes to skip and runs of differing bytes
+/// @param out storage of kMaxPageDelta bytes
+/// @return number of bytes written, 0 when the pages are equal
+std::size_t encode_page_delta(std::uint8_t const* before, std::uint8_t const* after, std::uint8_t* out);
+
+/// XOR a delta written by encode_page_delta into a page, turning either side into the other
+/// @return number of bytes of delta read
+std::size_t apply_page_delta(std::uint8_t const* delta, std::uint8_t* page);
+
+/// Record the state of a machine every frame and go back to any frame kept
+///
+/// A frame holds the registers and, for each RAM page written since the previous frame (see
+/// DirtyTrackingBus), the XOR of its old and new contents with the unchanged bytes skipped.
+/// Frames are appended to a ring of fixed size, evicting the oldest ones they overwrite. Besides
+/// the ring a copy of the RAM as of the newest frame is kept, 64KiB at most.
+///
+/// The memory map must not change while recording. Memory changed without going through the bus
+/// must be notified with mark_dirty.
+template<class Bus, class Traits = CpuTraits>
+requires DirtyTrackingBus<Bus>
+class RewindBuffer final {
+public:
+    /// Bytes taken in the ring by a frame where every page changed
+    static constexpr std::size_t kMaxFrameSize{sizeof(Registers) + PagedBus::kPageCount * (1U + kMaxPageDelta)};
+
+    /// Constructor
+    /// @param cpu machine to record, it must outlive the RewindBuffer
+    /// @param capacity bytes of the ring, at least kMaxFrameSize
+    /// @param max_frames largest number of frames kept
+    /// @throw std::invalid_argument when the capacity is too small or max_frames is 0
+    RewindBuffer(Cpu<Bus, Traits>& cpu, std::size_t const capacity, std::size_t const max_frames)
+        : m_cpu{cpu}, m_ring{}, m_frames{}, m_shadow(kPageCount * kPageSize) {
+        if (capacity < kMaxFrameSize || max_frames == 0U) {
+            throw std::invalid_argument("rewind buffer too small for a frame");
+        }
+        m_ring.resize(capacity);
+        m_frames.resize(max_frames);
+
+        Bus& bus = m_cpu.bus();
+        for (std::size_t page = 0U; page < kPageCount; ++page) {
+            std::uint8_t const* memory = bus.ram_page(static_cast<std::uint8_t>(page));
+            if (memory != nullptr) {
+                std::memcpy(shadow(page), memory, kPageSize);
+            }
+        }
+        bus.clear_dirty();
+    }
+
+    RewindBuffer(RewindBuffer const&) = delete;
+    RewindBuffer& operator=(RewindBuffer const&) = delete;
+
+    /// Record the current state as the newest frame
+    void push() {
+        Bus& bus = m_cpu.bus();
+        std::size_t const offset = reserve(sizeof(Registers) + bus.dirty_pages().count() * (1U + kMaxPageDelta));
+
+        Registers const regs = m_cpu.regs();
+        std::memcpy(m_ring.data() + offset, &regs, sizeof(Registers));
+        std::size_t size = sizeof(Registers);
+        for (std::size_t page = 0U; page < kPageCount; ++page) {
+            std::uint8_t const* memory = bus.ram_page(static_cast<std::uint8_t>(page));
+            if (!bus.dirty_pages().test(page) || memory == nullptr) {
+                continue;
+            }
+            std::uint8_t* const record = m_ring.data() + offset + size;
+            std::size_t const length = encode_page_delta(shadow(page), memory, record + 1U);
+            if (length != 0U) {
+                record[0] = static_cast<std::uint8_t>(page);
+                size += 1U + length;
+                std::memcpy(shadow(page), memory, kPageSize);
+            }
+        }
+        bus.clear_dirty();
+
+        if (m_count == m_frames.size()) {
+            evict();
+        }
+        m_frames[(m_oldest + m_count) % m_frames.size()] = Frame{offset, size};
+        ++m_count;
+        m_end = offset + size;
+    }
+
+    /// Go back to the state of a frame, discarding the newer ones
+    /// @param count number of frames to go back, 0 returns to the newest frame
+    /// @throw std::out_of_range when there are not as many frames
+    void rewind(std::size_t const count) {
+        if (count >= m_count) {
+            throw std::out_of_range("rewind past the oldest frame");
+        }
+        Bus& bus = m_cpu.bus();
+        std::bitset<kPageCount> changed{bus.dirty_pages()};
+        for (std::size_t i = 0U; i < count; ++i) {
+            Frame const frame = m_frames[(m_oldest + m_count - 1U) % m_frames.size()];
+            std::uint8_t const* record = m_ring.data() + frame.offset + sizeof(Registers);
+            std::uint8_t const* const end = m_ring.data() + frame.offset + frame.size;
+            while (record != end) {
+                std::uint8_t const page = *record++;
+                record += apply_page_delta(record, shadow(page));
+                changed.set(page);
+            }
+            --m_count;
+            m_end = frame.offset;
+        }
+
+        for (std::size_t page = 0U; page < kPageCount; ++page) {
+            std::uint8_t* memory = bus.ram_page(static_cast<std::uint8_t>(page));
+            if (changed.test(page) && memory != nullptr) {
+                std::memcpy(memory, shadow(page), kPageSize);
+            }
+        }
+        bus.clear_dirty();
+        if constexpr (Cpu<Bus, Traits>::kBlockCache) {
+            m_cpu.invalidate_blocks();
+        }
+
+        Frame const& newest = m_frames[(m_oldest + m_count - 1U) % m_frames.size()];
+        std::memcpy(&m_cpu.regs(), m_ring.data() + newest.offset, sizeof(Registers));
+    }
+
+    /// Number of frames kept
+    std::size_t frames() const {
+        return m_count;
+    }
+
+    /// Bytes of the ring taken by the frames kept
+    std::size_t size() const {
+        if (m_count == 0U) {
+            return 0U;
+        }
+        std::size_t const used = distance(m_frames[m_oldest].offset, m_end);
+        return used == 0U ? m_ring.size() : used;
+    }
+
+private:
+    static constexpr std::size_t kPageCount{PagedBus::kPageCount};
+
+    static constexpr std::size_t kPageSize{PagedBus::kPageSize};
+
+    /// Location of a frame in the ring
+    struct Frame final {
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    Cpu<Bus, Traits>& m_cpu;
+
+    /// Frames one after another, a frame that does not fit before the end starts over at 0
+    std::vector<std::uint8_t> m_ring;
+
+    /// Ring of the frames kept, starting at m_oldest
+    std::vector<Frame> m_frames;
+    std::size_t m_oldest{};
+    std::size_t m_count{};
+
+    /// Offset in m_ring after the newest frame
+    std::size_t m_end{};
+
+    /// RAM as of the newest frame
+    std::vector<std::uint8_t> m_shadow;
+
+    std::uint8_t* shadow(std::size_t const page) {
+        return m_shadow.data() + page * kPageSize;
+    }
+
+    /// Bytes from offset to offset going forward around the ring
+    std::size_t distance(std::size_t const from, std::size_t const to) const {
+        return (to + m_ring.size() - from) % m_ring.size();
+    }
+
+    /// Evict the oldest frames in the way of a new frame
+    /// @param bound largest size of the new frame
+    /// @return offset of the new frame
+    std::size_t reserve(std::size_t const bound) {
+        std::size_t const offset = m_end + bound > m_ring.size() ? 0U : m_end;
+        std::size_t const needed = (offset == m_end ? 0U : m_ring.size() - m_end) + bound;
+        while (m_count > 0U && distance(m_end, m_frames[m_oldest].offset) < needed) {
+            evict();
+        }
+        return offset;
+    }
+
+    void evict() {
+        m_oldest = (m_oldest + 1U) % m_frames.size();
+        --m_count;
+    }
+};
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "mos6502/timeline.hpp"
+
+namespace mos6502
+{
+/// Calls devices back at the cycles they asked for while the Cpu runs
+///
+/// Instead of polling timers, video and audio chips after every instruction, a device schedules
+/// the cycle of its next change and run_cycles runs the Cpu up to the earliest one in a single
+/// batch. Events are kept in a binary heap, scheduling and firing cost O(log n) and cancelling O(n).
+///
+/// The clock is the running cycle count of the Cpu (see Cpu::cycles). An event fires once the
+/// instruction that reaches its cycle completes, so it may fire a few cycles late; the callback
+/// receives the cycle it was due at to compensate. Events due at the same cycle fire in the order
+/// they were scheduled. Callbacks may schedule and cancel events, including their own next one.
+///
+/// Scheduling from a bus callback counts from now(), the cycle the current batch started at.
+/// @code
+/// scheduler.schedule_in(kCyclesPerLine, [&](std::uint64_t due) {
+///     video.render_line();
+///     scheduler.schedule(due + kCyclesPerLine, ...);
+/// });
+/// scheduler.run_cycles(cpu, kCyclesPerFrame);
+/// @endcode
+class Scheduler final {
+public:
+    /// Called with the cycle the event was due at
+    using Callback = std::function<void(std::uint64_t)>;
+
+    /// Handle of a scheduled event, valid until the event fires or is cancelled
+    using EventId = std::uint64_t;
+
+    Scheduler() = default;
+
+    Scheduler(Scheduler const&) = delete;
+    Scheduler& operator=(Scheduler const&) = delete;
+
+    /// Schedule a callback at an absolute cycle, cycles already past fire at the next chance
+    /// @param name shown on the timeline (see set_timeline), it must outlive the event, null shows as "event"
+    EventId schedule(std::uint64_t cycle, Callback callback, char const* name = "event");
+
+    /// Schedule a callback a number of cycles after now()
+    EventId schedule_in(std::uint64_t delay, Callback callback, char const* name = "event") {
+        return schedule(m_now + delay, std::move(callback), name);
+    }
+
+    /// Cancel a scheduled event
+    /// @return false when the event already fired or was cancelled
+    bool cancel(EventId id);
+
+    /// Cycle of the earliest event scheduled, or nothing when there is none
+    std::optional<std::uint64_t> next_event() const {
+        if (m_queue.empty()) {
+            return std::nullopt;
+        }
+        return m_queue.front().cycle;
+    }
+
+    /// Number of events scheduled
+    std::size_t pending() const {
+        return m_queue.size();
+    }
+
+    /// Cycle count of the Cpu as of the last batch
+    std::uint64_t now() const {
+        return m_now;
+    }
+
+    /// Record the time each callback takes into a timeline, or stop with null
+    void set_timeline(TimelineTracer* timeline) {
+        m_timeline = timeline;
+    }
+
+    /// Run the Cpu for the cycle budget, firing the events due on the way
+    /// @return number of cycles consumed, the last instruction may overshoot the budget
+    template<class Cpu>
+    std::uint64_t run_cycles(Cpu& cpu, std::uint64_t const budget) {
+        std::uint64_t const start = cpu.cycles();
+        std::uint64_t const end = start + budget;
+        m_now = start;
+        for (;;) {
+            fire_due();
+            if (m_now >= end) {
+                return m_now - start;
+            }
+            std::uint64_t const target = m_queue.empty() ? end : std::min(end, m_queue.front().cycle);
+            cpu.run_cycles(target - m_now);
+            m_now = cpu.cycles();
+        }
+    }
+
+    /// Set the clock without running, e.g. after stepping the Cpu outside of run_cycles
+    /// @return number of events fired
+    template<class Cpu>
+    std::size_t sync(Cpu const& cpu) {
+        m_now = cpu.cycles();
+        return fire_due();
+    }
+
+private:
+    struct Entry final {
+        std::uint64_t cycle;
+        EventId id;
+        Callback callback;
+        char const* name;
+    };
+
+    /// Earliest cycle first, then earliest scheduled
+    static bool later(Entry const& lhs, Entry const& rhs) {
+        return lhs.cycle != rhs.cycle ? lhs.cycle > rhs.cycle : lhs.id > rhs.id;
+    }
+
+    /// Heap of the events scheduled, earliest at the front
+    std::vector<Entry> m_queue{};
+    EventId m_next_id{1U};
+    std::uint64_t m_now{};
+    TimelineTracer* m_timeline{};
+
+    /// Fire the events due at or before now()
+    std::size_t fire_due();
+};
+}
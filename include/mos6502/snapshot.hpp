@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+namespace mos6502
+{
+/// Version of the snapshot format written by Cpu::save
+///
+/// Readers accept every version up to the current one, fields are only ever appended.
+/// - 1: registers
+/// - 2: interrupt lines and cycle count after the registers
+inline constexpr std::uint8_t kSnapshotVersion{2U};
+
+/// Signature at the beginning of every snapshot
+inline constexpr std::array<std::uint8_t, 4> kSnapshotMagic{'M', '6', '5', 'S'};
+
+/// Sequential writer of little endian values over storage given by the caller
+class SnapshotWriter final {
+public:
+    explicit SnapshotWriter(std::span<std::uint8_t> const buffer) : m_buffer{buffer} {}
+
+    void put8(std::uint8_t const value) {
+        put(std::span<std::uint8_t const>{&value, 1U});
+    }
+
+    void put16(std::uint16_t const value) {
+        std::array<std::uint8_t, 2> const bytes{static_cast<std::uint8_t>(value), static_cast<std::uint8_t>(value >> 8)};
+        put(bytes);
+    }
+
+    void put64(std::uint64_t const value) {
+        std::array<std::uint8_t, 8> bytes{};
+        for (std::size_t i = 0U; i < bytes.size(); ++i) {
+            bytes[i] = static_cast<std::uint8_t>(value >> (8U * i));
+        }
+        put(bytes);
+    }
+
+    /// @throw std::length_error when the buffer is too small
+    void put(std::span<std::uint8_t const> const bytes) {
+        if (m_buffer.size() - m_size < bytes.size()) {
+            throw std::length_error("snapshot buffer too small");
+        }
+        std::memcpy(m_buffer.data() + m_size, bytes.data(), bytes.size());
+        m_size += bytes.size();
+    }
+
+    /// Number of bytes written so far
+    std::size_t size() const {
+        return m_size;
+    }
+
+private:
+    std::span<std::uint8_t> m_buffer;
+    std::size_t m_size{};
+};
+
+/// Sequential reader of the values written by SnapshotWriter
+class SnapshotReader final {
+public:
+    explicit SnapshotReader(std::span<std::uint8_t const> const snapshot) : m_snapshot{snapshot} {}
+
+    std::uint8_t get8() {
+        std::uint8_t value{};
+        get(std::span<std::uint8_t>{&value, 1U});
+        return value;
+    }
+
+    std::uint16_t get16() {
+        std::array<std::uint8_t, 2> bytes{};
+        get(bytes);
+        return static_cast<std::uint16_t>(bytes[0] | (bytes[1] << 8));
+    }
+
+    std::uint64_t get64() {
+        std::array<std::uint8_t, 8> bytes{};
+        get(bytes);
+        std::uint64_t value{};
+        for (std::size_t i = 0U; i < bytes.size(); ++i) {
+            value |= static_cast<std::uint64_t>(bytes[i]) << (8U * i);
+        }
+        return value;
+    }
+
+    /// @throw std::out_of_range when the snapshot is truncated
+    void get(std::span<std::uint8_t> const bytes) {
+        if (m_snapshot.size() - m_position < bytes.size()) {
+            throw std::out_of_range("snapshot truncated");
+        }
+        std::memcpy(bytes.data(), m_snapshot.data() + m_position, bytes.size());
+        m_position += bytes.size();
+    }
+
+    /// Number of bytes read so far
+    std::size_t position() const {
+        return m_position;
+    }
+
+private:
+    std::span<std::uint8_t const> m_snapshot;
+    std::size_t m_position{};
+};
+
+/// Bus whose contents can be saved to and restored from a snapshot
+///
+/// Only the state is saved (e.g. RAM), the configuration (e.g. the memory map) must be the same
+/// when restoring.
+template<class Bus>
+concept SnapshotableBus = requires(Bus& bus, Bus const& const_bus, SnapshotWriter& writer, SnapshotReader& reader) {
+    { const_bus.save(writer) } -> std::same_as<void>;
+    { bus.restore(reader) } -> std::same_as<void>;
+};
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace mos6502
+{
+/// Bounded queue from one producer thread to one consumer thread, without locks
+///
+/// The capacity is rounded up to a power of two. Producer and consumer indices live on their own
+/// cache lines and the producer keeps a copy of the consumer index, so a push touches shared
+/// memory only when the ring looks full. Pushing never waits, it fails when the ring is full.
+template<class T>
+requires std::is_trivially_copyable_v<T>
+class SpscRing final {
+public:
+    /// Constructor
+    /// @param capacity number of items held, at least 1
+    /// @throw std::invalid_argument when the capacity is 0
+    explicit SpscRing(std::size_t const capacity) : m_items(std::bit_ceil(std::max<std::size_t>(capacity, 1U))) {
+        if (capacity == 0U) {
+            throw std::invalid_argument("ring of no capacity");
+        }
+        m_mask = m_items.size() - 1U;
+    }
+
+    SpscRing(SpscRing const&) = delete;
+    SpscRing& operator=(SpscRing const&) = delete;
+
+    /// Append an item, from the producer thread
+    /// @return false when the ring is full
+    bool push(T const& item) {
+        T* const slot = claim();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = item;
+        publish();
+        return true;
+    }
+
+    /// Slot of the next item, to build it in place before publish, from the producer thread
+    /// @return null when the ring is full
+    T* claim() {
+        std::size_t const head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail_cache == m_items.size()) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tail_cache == m_items.size()) {
+                return nullptr;
+            }
+        }
+        return &m_items[head & m_mask];
+    }
+
+    /// Append the item built in the slot of claim, from the producer thread
+    void publish() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1U, std::memory_order_release);
+    }
+
+    /// Append as many items as fit, from the producer thread
+    /// @return number of items appended
+    std::size_t push(std::span<T const> const items) {
+        std::size_t const head = m_head.load(std::memory_order_relaxed);
+        if (m_items.size() - (head - m_tail_cache) < items.size()) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+        }
+        std::size_t const count = std::min(items.size(), m_items.size() - (head - m_tail_cache));
+        for (std::size_t i = 0U; i < count; ++i) {
+            m_items[(head + i) & m_mask] = items[i];
+        }
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /// Remove the oldest items, from the consumer thread
+    /// @return number of items written to out
+    std::size_t pop(std::span<T> const out) {
+        std::size_t const tail = m_tail.load(std::memory_order_relaxed);
+        std::size_t const head = m_head.load(std::memory_order_acquire);
+        std::size_t const count = std::min(head - tail, out.size());
+        for (std::size_t i = 0U; i < count; ++i) {
+            out[i] = m_items[(tail + i) & m_mask];
+        }
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /// Oldest items in place, as one run of the storage that may stop short of the ring end
+    /// @note From the consumer thread, the items stay in the ring until consume
+    std::span<T const> peek() const {
+        std::size_t const tail = m_tail.load(std::memory_order_relaxed);
+        std::size_t const head = m_head.load(std::memory_order_acquire);
+        std::size_t const start = tail & m_mask;
+        return {m_items.data() + start, std::min(head - tail, m_items.size() - start)};
+    }
+
+    /// Remove the oldest items, read through peek, from the consumer thread
+    void consume(std::size_t const count) {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    /// Number of items the ring holds
+    std::size_t capacity() const {
+        return m_items.size();
+    }
+
+    /// Number of items waiting, only exact when neither thread is using the ring
+    std::size_t size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> m_items;
+    std::size_t m_mask{};
+
+    /// Written by the producer
+    alignas(64) std::atomic<std::size_t> m_head{};
+    std::size_t m_tail_cache{};
+
+    /// Written by the consumer
+    alignas(64) std::atomic<std::size_t> m_tail{};
+};
+}
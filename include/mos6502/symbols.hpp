@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace mos6502
+{
+/// Label of a guest address
+struct Symbol final {
+    std::uint16_t addr;
+    std::string name;
+};
+
+/// Labels of a guest program, to name the addresses reported by the profilers
+///
+/// An address resolves to the closest label at or before it, so labels of routines name every
+/// instruction of the routine.
+class SymbolTable final {
+public:
+    SymbolTable() = default;
+
+    /// Add a label, replacing the one at the same address
+    void add(std::uint16_t addr, std::string name);
+
+    /// Load the labels of a VICE monitor label file (lines as "al C:c000 .reset")
+    /// @return number of labels loaded
+    /// @throw std::invalid_argument when a label line is malformed
+    std::size_t load_vice_labels(std::istream& in);
+
+    /// Load the labels of a ca65/ld65 debug info file (see ld65 --dbgfile), equates are skipped
+    /// @return number of labels loaded
+    /// @throw std::invalid_argument when a symbol line is malformed
+    std::size_t load_ca65_dbg(std::istream& in);
+
+    /// Retrieve the closest label at or before an address
+    /// @return the label, or null when there is none
+    Symbol const* resolve(std::uint16_t addr) const;
+
+    /// Name of the routine holding an address, or "$xxxx" when there is no label before it
+    std::string routine(std::uint16_t addr) const;
+
+    /// Name of an address relative to the closest label, e.g. "main+$12", or "$xxxx"
+    std::string describe(std::uint16_t addr) const;
+
+    std::size_t size() const {
+        return m_symbols.size();
+    }
+
+private:
+    /// Sorted by address
+    std::vector<Symbol> m_symbols{};
+};
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace mos6502
+{
+/// Row of the timeline an event is drawn on
+enum class TimelineTrack : std::uint8_t {
+    Frames,  /// Busy and idle time of each frame (see ClockSync::set_timeline)
+    Cpu,     /// Interrupts taken (see Cpu::trace_timeline)
+    Devices, /// Callbacks of the scheduler (see Scheduler::set_timeline)
+};
+
+/// Span or instant of the timeline, timestamps in nanoseconds of ClockSync::now
+struct TimelineEvent final {
+    char const* name;
+    std::uint64_t start;
+    std::uint64_t duration;
+    std::uint64_t arg; /// Frame number, handler address or cycle due, depending on the track
+    TimelineTrack track;
+    bool instant;
+};
+
+/// Recorder of frame pacing, interrupts and device events for the Chrome trace viewer and Perfetto
+///
+/// Events are stored in a buffer allocated once, recording never allocates nor formats. Flush the
+/// buffer to a stream between frames, every few seconds or at the end of the session; events
+/// recorded while it is full are dropped and counted. The output is Chrome JSON trace format,
+/// open it in chrome://tracing or ui.perfetto.dev.
+///
+/// Names must be string literals or otherwise outlive the flush. Recording is not thread safe,
+/// attach the tracer to objects driven from the same thread.
+/// @code
+/// mos6502::TimelineTracer timeline{};
+/// syncer.set_timeline(&timeline);
+/// scheduler.set_timeline(&timeline);
+/// cpu.trace_timeline(&timeline);
+/// ...
+/// timeline.flush(out);
+/// timeline.finish(out);
+/// @endcode
+class TimelineTracer final {
+public:
+    /// Constructor, timestamps are written relative to the time of construction
+    /// @param capacity number of events buffered until flushed
+    explicit TimelineTracer(std::size_t capacity = 1U << 16);
+
+    TimelineTracer(TimelineTracer const&) = delete;
+    TimelineTracer& operator=(TimelineTracer const&) = delete;
+
+    /// Record a span between two timestamps of ClockSync::now
+    void span(char const* const name, TimelineTrack const track, std::uint64_t const start, std::uint64_t const end,
+              std::uint64_t const arg = 0U) {
+        append(TimelineEvent{name, start, end > start ? end - start : 0U, arg, track, false});
+    }
+
+    /// Record an instant at the current time
+    void instant(char const* name, TimelineTrack track, std::uint64_t arg = 0U);
+
+    /// Events buffered
+    std::span<TimelineEvent const> events() const {
+        return m_events;
+    }
+
+    std::size_t capacity() const {
+        return m_events.capacity();
+    }
+
+    /// Events lost because the buffer was full
+    std::uint64_t dropped() const {
+        return m_dropped;
+    }
+
+    /// Write the events buffered and clear the buffer, the first flush starts the document
+    /// @throw std::runtime_error when the stream fails
+    void flush(std::ostream& out);
+
+    /// Write the events buffered and end the document
+    /// @throw std::runtime_error when the stream fails
+    void finish(std::ostream& out);
+
+private:
+    std::vector<TimelineEvent> m_events{};
+    std::uint64_t m_origin;
+    std::uint64_t m_dropped{};
+    bool m_started{};
+
+    void append(TimelineEvent const& event) {
+        if (m_events.size() == m_events.capacity()) {
+            ++m_dropped;
+            return;
+        }
+        m_events.push_back(event);
+    }
+};
+}
@@ -0,0 +1,334 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "mos6502/opcodes.hpp"
+#include "mos6502/spsc_ring.hpp"
+#include "mos6502/variant.hpp"
+
+namespace mos6502
+{
+/// Record every instruction executed and interrupt entered into a TraceWriter (see Cpu::trace_to)
+/// @note Native translation (JitDispatch) is disabled, it falls back to BlockCacheDispatch
+struct InstructionTracing {};
+
+/// Version of the trace format written by TraceWriter
+///
+/// Readers accept every version up to the current one. Version 1 kept a single byte written per
+/// record and counted the cycles from the start of each block.
+inline constexpr std::uint8_t kTraceVersion{2U};
+
+/// Signature at the beginning of every trace
+inline constexpr std::array<std::uint8_t, 4> kTraceMagic{'M', '6', '5', 'T'};
+
+/// What a trace record stands for
+enum class TraceEntry : std::uint8_t {
+    Instruction, /// Instruction executed
+    Irq,         /// IRQ entered, from the line or Cpu::signal_irq
+    Nmi,         /// NMI entered
+};
+
+/// Bytes written at most by an instruction or an interrupt, the three pushes of BRK
+inline constexpr std::size_t kTraceMaxWrites{3U};
+
+/// Instruction executed or interrupt entered, with the registers before it and the bytes it wrote
+///
+/// Every byte the Cpu writes is kept in order, e.g. the pushes of JSR, BRK and interrupts; the Cpu
+/// issues no dummy write for read-modify-write instructions. Bytes read are not recorded: replaying
+/// the writes from a known memory state rebuilds memory, not what the devices were asked for.
+struct TraceRecord final {
+    std::uint64_t cycle;   /// Cycle the instruction started at
+    std::uint16_t pc;
+    std::uint8_t opcode;      /// 0 for interrupts
+    std::uint8_t operand_lo;  /// Low byte of the vector for interrupts
+    std::uint8_t operand_hi;  /// High byte of the vector for interrupts
+    std::uint8_t ac;
+    std::uint8_t xi;
+    std::uint8_t yi;
+    std::uint8_t sr;
+    std::uint8_t sp;       /// Low byte of the stack pointer
+    TraceEntry entry;
+    std::uint8_t writes;   /// Number of bytes written, up to kTraceMaxWrites
+    std::array<std::uint16_t, kTraceMaxWrites> addr;  /// Addresses written, first writes first
+    std::array<std::uint8_t, kTraceMaxWrites> value;  /// Bytes written, first writes first
+    std::array<std::uint8_t, 3> reserved;             /// Zero, pads the record to 32 bytes
+
+    bool operator==(TraceRecord const&) const = default;
+};
+
+// Records are written to traces as they are laid out in memory on little endian hosts
+static_assert(sizeof(TraceRecord) == 32U);
+static_assert(std::has_unique_object_representations_v<TraceRecord>);
+
+/// What a TraceWriter does with a record when its ring is full
+enum class TraceOverflow : std::uint8_t {
+    Drop, /// The record is dropped and counted, the Cpu never waits
+    Wait, /// The Cpu waits for the writer thread, the trace has no holes
+};
+
+/// Text layout of the trace lines (see format_trace)
+enum class TraceFormat : std::uint8_t {
+    Nintendulator, /// C000  4C F5 C5  JMP $C5F5   A:00 X:00 Y:00 P:24 SP:FD CYC:7
+    Vice,          /// .C:c000  4C F5 C5  JMP $C5F5   - A:00 X:00 Y:00 SP:fd ..-..I..   7
+};
+
+/// Largest number of bytes lz_compress produces for size bytes
+constexpr std::size_t lz_bound(std::size_t const size) {
+    return size + size / 255U + 16U;
+}
+
+/// Compressor of lz_compress that keeps its hash table from one call to the next
+///
+/// Compressing does not allocate and needs no clearing between calls, positions seen in earlier
+/// calls are told apart by the offset of each call.
+class LzCompressor final {
+public:
+    LzCompressor();
+
+    /// Compress bytes (see lz_compress)
+    /// @param out storage of lz_bound(size) bytes at least
+    /// @return number of bytes written to out
+    std::size_t compress(std::uint8_t const* data, std::size_t size, std::uint8_t* out);
+
+private:
+    /// Entries of the hash table, 64KiB
+    static constexpr unsigned kHashBits{14U};
+
+    /// Offset plus one of the last position each 4 byte sequence was seen at
+    std::vector<std::uint32_t> m_seen;
+    std::uint32_t m_offset{};
+};
+
+/// Writer of instruction traces to a stream from a background thread
+///
+/// The Cpu thread pushes fixed size records into a lock-free ring, a thread of the writer hands
+/// whole runs of the ring to the stream as blocks of records, optionally compressed with an LZ77
+/// scheme in the spirit of LZ4. Records are stored as laid out in the ring, their cycle counted
+/// from the previous record, so raw blocks are written without copying them.
+///
+/// The Cpu never waits on the stream: when the ring is full the records are dropped and counted,
+/// unless the writer was made with TraceOverflow::Wait. The writer keeps up with the Cpu when its
+/// thread has a core of its own (see the trace benchmark), check dropped() otherwise.
+///
+/// Each block takes the number of records, the number of bytes stored and the records, raw or
+/// compressed. A block of no records ends the trace.
+class TraceWriter final {
+public:
+    /// Records the ring holds by default, 8MiB
+    static constexpr std::size_t kDefaultCapacity{1U << 18};
+
+    /// Records per block
+    static constexpr std::size_t kBlockRecords{4096U};
+
+    /// Constructor, writes the header and starts the writer thread
+    /// @param out stream that outlives the writer, usually a std::ofstream opened as binary
+    /// @param compress whether to compress the blocks
+    /// @param capacity number of records the ring holds
+    /// @param overflow whether to wait or drop records when the ring is full
+    explicit TraceWriter(std::ostream& out, bool compress = false, std::size_t capacity = kDefaultCapacity,
+                         TraceOverflow overflow = TraceOverflow::Drop);
+
+    TraceWriter(TraceWriter const&) = delete;
+    TraceWriter& operator=(TraceWriter const&) = delete;
+
+    /// Destructor, closes the trace unless already closed
+    ~TraceWriter();
+
+    /// Slot of the next record in the ring, filled in place then appended with publish
+    /// @note From the thread running the Cpu, the reserved bytes of the slot are zero already
+    /// @return null when the ring is full and the record is dropped
+    TraceRecord* claim() {
+        TraceRecord* const slot = m_ring.claim();
+        if (slot != nullptr) [[likely]] {
+            return slot;
+        }
+        return overflow();
+    }
+
+    /// Append the record filled in the slot of claim, from the thread running the Cpu
+    void publish(TraceRecord& slot) {
+        std::uint64_t const cycle = slot.cycle;
+        slot.cycle = cycle - m_cycle;
+        m_cycle = cycle;
+        m_ring.publish();
+    }
+
+    /// Append a record, from the thread running the Cpu
+    void record(TraceRecord const& record) {
+        if (TraceRecord* const slot = claim()) {
+            *slot = record;
+            publish(*slot);
+        }
+    }
+
+    /// Records lost because the ring was full (TraceOverflow::Drop), read from the thread running the Cpu
+    std::uint64_t dropped() const {
+        return m_dropped;
+    }
+
+    /// Records that waited for the writer because the ring was full (TraceOverflow::Wait)
+    std::uint64_t waits() const {
+        return m_waits;
+    }
+
+    /// Write the records left, end the trace and stop the writer thread
+    /// @throw std::runtime_error when the stream failed
+    void close();
+
+private:
+    std::ostream& m_out;
+    bool m_compress;
+    TraceOverflow m_overflow;
+    SpscRing<TraceRecord> m_ring;
+
+    /// Owned by the thread running the Cpu, cycle of the last record appended
+    std::uint64_t m_cycle{};
+    std::uint64_t m_dropped{};
+    std::uint64_t m_waits{};
+    std::atomic<bool> m_closing{};
+    std::atomic<bool> m_failed{};
+    bool m_closed{};
+
+    /// Owned by the writer thread
+    std::size_t m_block_records;
+    std::vector<std::uint8_t> m_raw;
+    std::vector<std::uint8_t> m_block;
+    LzCompressor m_compressor{};
+
+    std::thread m_thread{};
+
+    /// Wait for room in the ring, or drop the record
+    /// @return slot of the record, null when dropped
+    TraceRecord* overflow();
+
+    /// Body of the writer thread
+    void drain();
+
+    void write_block(std::span<TraceRecord const> records);
+};
+
+/// Reader of the traces written by TraceWriter
+class TraceReader final {
+public:
+    /// Constructor, reads the header
+    /// @param in stream that outlives the reader, usually a std::ifstream opened as binary
+    /// @throw std::invalid_argument when it is not a trace of a supported version
+    explicit TraceReader(std::istream& in);
+
+    TraceReader(TraceReader const&) = delete;
+    TraceReader& operator=(TraceReader const&) = delete;
+
+    /// Read the next record
+    /// @return the record, or nothing at the end of the trace
+    /// @throw std::out_of_range when the stream ends in the middle of a block
+    /// @throw std::invalid_argument when a block is corrupted
+    std::optional<TraceRecord> next();
+
+private:
+    std::istream& m_in;
+    std::vector<TraceRecord> m_records{};
+    std::vector<std::uint8_t> m_stored{};
+    std::size_t m_position{};
+    std::uint8_t m_version{};
+    bool m_ended{};
+
+    /// Cycle of the last record read, version 2 counts cycles across blocks
+    std::uint64_t m_cycle{};
+
+    /// Read the next block, false at the end of the trace
+    bool read_block();
+};
+
+/// Compress bytes with an LZ77 scheme (literal runs and back references up to 64KiB away)
+/// @return compressed bytes appended to out
+void lz_compress(std::uint8_t const* data, std::size_t size, std::vector<std::uint8_t>& out);
+
+/// Decompress the bytes of lz_compress
+/// @throw std::invalid_argument when the data is corrupted or does not expand to size bytes
+void lz_decompress(std::uint8_t const* data, std::size_t size, std::uint8_t* out, std::size_t expected);
+
+/// Format a record as a line of text, without line ending
+/// @param opcodes instruction set of the Cpu traced (see Nmos6502::kOpcodes)
+std::string format_trace(TraceRecord const& record, TraceFormat format,
+                         std::array<OpcodeInfo, 256> const& opcodes = Nmos6502::kOpcodes);
+
+/// State of tracing in a Cpu configured with InstructionTracing
+///
+/// Records are built in place in the ring of the writer, staging nothing while detached or while
+/// the ring is full.
+class InstructionTracer final {
+public:
+    /// Start or stop (null) recording into a writer, counting cycles from cycle
+    void attach(TraceWriter* const writer, std::uint64_t const cycle) {
+        m_writer = writer;
+        m_slot = nullptr;
+        m_cycle = cycle;
+    }
+
+    bool active() const {
+        return m_writer != nullptr;
+    }
+
+    /// Stage the record of an instruction about to execute, or of an interrupt about to be entered
+    void begin(std::uint16_t const pc, std::uint8_t const opcode, std::uint16_t const operand, std::uint8_t const ac,
+               std::uint8_t const xi, std::uint8_t const yi, std::uint8_t const sr, std::uint8_t const sp,
+               TraceEntry const entry = TraceEntry::Instruction) {
+        m_slot = m_writer != nullptr ? m_writer->claim() : nullptr;
+        if (m_slot == nullptr) {
+            return;
+        }
+        TraceRecord& record = *m_slot;
+        record.cycle = m_cycle;
+        record.pc = pc;
+        record.opcode = opcode;
+        record.operand_lo = static_cast<std::uint8_t>(operand);
+        record.operand_hi = static_cast<std::uint8_t>(operand >> 8);
+        record.ac = ac;
+        record.xi = xi;
+        record.yi = yi;
+        record.sr = sr;
+        record.sp = sp;
+        record.entry = entry;
+        record.writes = 0U;
+        record.addr = {};
+        record.value = {};
+    }
+
+    /// Note a byte written by the instruction staged
+    void write(std::uint16_t const addr, std::uint8_t const value) {
+        if (m_slot != nullptr && m_slot->writes < kTraceMaxWrites) {
+            m_slot->addr[m_slot->writes] = addr;
+            m_slot->value[m_slot->writes] = value;
+            ++m_slot->writes;
+        }
+    }
+
+    /// Record the instruction or interrupt staged, while attached
+    void end(std::uint8_t const cycles) {
+        if (m_slot != nullptr) {
+            m_writer->publish(*m_slot);
+            m_slot = nullptr;
+        }
+        m_cycle += cycles;
+    }
+
+private:
+    TraceWriter* m_writer{};
+
+    /// Record staged in the ring of the writer, null when none is
+    TraceRecord* m_slot{};
+
+    /// Cycle the next record starts at
+    std::uint64_t m_cycle{};
+};
+}
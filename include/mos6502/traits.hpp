@@ -0,0 +1,109 @@
+#pragma once
+#include "mos6502/alu.hpp"
+#include "mos6502/call_stack.hpp"
+#include "mos6502/decimal.hpp"
+#include "mos6502/instrumentation.hpp"
+#include "mos6502/trace.hpp"
+#include "mos6502/variant.hpp"
+
+namespace mos6502
+{
+/// Dispatch each instruction through a switch on its opcode
+struct SwitchDispatch {};
+
+/// Dispatch through a table of per opcode handlers where each handler jumps directly to the next one
+/// @note Requires labels as values (GCC/Clang), otherwise it falls back to SwitchDispatch
+struct ThreadedDispatch {};
+
+/// Decode straight-line runs of instructions once and execute them from a cache of basic blocks
+/// @note Writes done through the Cpu invalidate the blocks of the page written, other changes
+///       to the code (e.g. remapping or DMA) must be notified through Cpu::invalidate_blocks
+struct BlockCacheDispatch {};
+
+/// Translate hot basic blocks to native code, everything else runs as BlockCacheDispatch
+/// @note Native blocks only run from run_cycles, when the budget left covers the whole block
+/// @note Interrupt lines raised while a native block runs are taken once the block completes
+/// @note Requires x86-64 with System V ABI (Linux/macOS), otherwise it falls back to BlockCacheDispatch
+struct JitDispatch {};
+
+/// Update the status register as each instruction executes
+struct EagerFlags {};
+
+/// Record the values N, Z, C and V derive from and compute the flags only when they are observed
+/// (branches, PHP, BRK, interrupts and regs())
+/// @note Native translation (JitDispatch) requires EagerFlags, it falls back to BlockCacheDispatch
+struct LazyFlags {};
+
+/// Compile time configuration of Cpu
+///
+/// Customize by inheriting and overriding the member types.
+/// @code
+/// struct MyTraits : mos6502::CpuTraits {
+///     using Dispatch = mos6502::ThreadedDispatch;
+/// };
+/// @endcode
+struct CpuTraits {
+    using Dispatch = SwitchDispatch;
+    using Flags = EagerFlags;
+    using Alu = PortableAlu;
+    /// Flags of the 65C02 whatever the Variant, the behaviour before variants existed; programs
+    /// testing N or Z after decimal arithmetic on a NMOS 6502 need NmosDecimal
+    using Decimal = CmosDecimal;
+    using Variant = Nmos6502;
+    using Instrumentation = NoInstrumentation;
+};
+
+/// Cpu configuration with threaded dispatch
+struct ThreadedCpuTraits : CpuTraits {
+    using Dispatch = ThreadedDispatch;
+};
+
+/// Cpu configuration with the basic block cache
+struct BlockCacheCpuTraits : CpuTraits {
+    using Dispatch = BlockCacheDispatch;
+};
+
+/// Cpu configuration with native translation of hot blocks
+struct JitCpuTraits : CpuTraits {
+    using Dispatch = JitDispatch;
+};
+
+/// Cpu configuration with lazy flags
+struct LazyFlagsCpuTraits : CpuTraits {
+    using Flags = LazyFlags;
+};
+
+/// Cpu configuration reading carry and overflow from the flags of x86 instructions
+/// @note On other hosts it is the same as CpuTraits
+struct X86AluCpuTraits : CpuTraits {
+    using Alu = X86Alu;
+};
+
+/// Cpu configuration of the NES, without decimal mode
+struct Ricoh2A03CpuTraits : CpuTraits {
+    using Variant = Ricoh2A03;
+};
+
+/// Cpu configuration of the 65C02
+struct Cmos65C02CpuTraits : CpuTraits {
+    using Variant = Cmos65C02;
+};
+
+/// Cpu configuration counting the instruction mix (see Cpu::instruction_stats)
+struct InstrumentedCpuTraits : CpuTraits {
+    using Dispatch = ThreadedDispatch;
+    using Instrumentation = InstructionCounters;
+};
+
+/// Cpu configuration tracking the calls of the guest program (see Cpu::call_stack)
+struct CallStackCpuTraits : CpuTraits {
+    using Dispatch = ThreadedDispatch;
+    using Instrumentation = CallStackTracking;
+};
+
+/// Cpu configuration recording an instruction trace (see Cpu::trace_to)
+struct TracingCpuTraits : CpuTraits {
+    using Dispatch = ThreadedDispatch;
+    using Instrumentation = InstructionTracing;
+};
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+
+#include "mos6502/opcodes.hpp"
+
+namespace mos6502
+{
+/// NMOS 6502, the documented instruction set plus the undocumented opcodes
+///
+/// JMP ($xxFF) reads the high byte of the target from $xx00 and the JAM opcodes
+/// halt the processor until reset.
+struct Nmos6502 {
+    static constexpr std::array<OpcodeInfo, 256> const& kOpcodes = kNmosOpcodeTable;
+
+    /// ADC and SBC honour the D flag
+    static constexpr bool kDecimalMode = true;
+
+    /// JMP (ind) does not carry into the high byte of the pointer
+    static constexpr bool kIndirectJumpWraps = true;
+
+    /// Interrupts and BRK clear the D flag
+    static constexpr bool kInterruptClearsDecimal = false;
+};
+
+/// Ricoh 2A03 of the NES, a NMOS 6502 whose decimal mode was removed
+///
+/// SED and CLD still change the D flag but ADC and SBC always operate in binary.
+struct Ricoh2A03 : Nmos6502 {
+    static constexpr bool kDecimalMode = false;
+};
+
+/// CMOS 65C02, adds BRA, STZ, PHX, PHY, PLX, PLY, TRB, TSB and the (zp) and ($nnnn,X) modes
+///
+/// Undefined opcodes are NOPs, JMP (ind) crosses pages correctly and interrupts clear D.
+struct Cmos65C02 {
+    static constexpr std::array<OpcodeInfo, 256> const& kOpcodes = kCmosOpcodeTable;
+
+    static constexpr bool kDecimalMode = true;
+
+    static constexpr bool kIndirectJumpWraps = false;
+
+    static constexpr bool kInterruptClearsDecimal = true;
+};
+}
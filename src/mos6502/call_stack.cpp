@@ -0,0 +1,131 @@
+#include "mos6502/call_stack.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+namespace mos6502
+{
+CallStack::CallStack() : m_nodes{Node{0U, 0U, 0U}} {}
+
+void CallStack::enter(std::uint16_t const routine, std::uint8_t const return_sp) {
+    // Frames returning at or above the new one are gone, e.g. the stack was reset with TXS
+    leave(return_sp);
+    attribute();
+    std::uint32_t const parent = m_frames.empty() ? 0U : m_frames.back().node;
+    m_frames.push_back(Frame{routine, return_sp, child(parent, routine), m_now, 0U});
+    Totals& totals = m_totals[routine];
+    ++totals.calls;
+    ++totals.active;
+}
+
+void CallStack::leave(std::uint8_t const sp) {
+    while (!m_frames.empty() && m_frames.back().return_sp <= sp) {
+        pop();
+    }
+}
+
+std::vector<std::uint16_t> CallStack::frames() const {
+    std::vector<std::uint16_t> routines{};
+    routines.reserve(m_frames.size());
+    for (Frame const& frame : m_frames) {
+        routines.push_back(frame.routine);
+    }
+    return routines;
+}
+
+std::vector<RoutineCycles> CallStack::routines() const {
+    std::unordered_map<std::uint16_t, Totals> totals{m_totals};
+    std::vector<Frame> frames{m_frames};
+    while (!frames.empty()) {
+        Frame const frame = frames.back();
+        frames.pop_back();
+        close(totals, frame, frames.empty() ? nullptr : &frames.back(), m_now);
+    }
+
+    std::vector<RoutineCycles> routines{};
+    routines.reserve(totals.size());
+    for (auto const& [routine, sum] : totals) {
+        routines.push_back(RoutineCycles{routine, sum.calls, sum.inclusive, sum.exclusive});
+    }
+    std::sort(routines.begin(), routines.end(), [](RoutineCycles const& lhs, RoutineCycles const& rhs) {
+        return lhs.inclusive != rhs.inclusive ? lhs.inclusive > rhs.inclusive : lhs.routine < rhs.routine;
+    });
+    return routines;
+}
+
+void CallStack::reset() {
+    m_mark = m_now;
+    m_frames.clear();
+    m_totals.clear();
+    m_nodes.resize(1U);
+    m_nodes.front().cycles = 0U;
+    m_children.clear();
+}
+
+void CallStack::write_report(std::ostream& out, SymbolTable const& symbols, std::size_t const limit) const {
+    std::ios_base::fmtflags const flags = out.flags();
+    std::vector<RoutineCycles> routines = this->routines();
+    routines.resize(std::min(routines.size(), limit));
+
+    out << "     calls       inclusive       exclusive  routine\n";
+    for (RoutineCycles const& routine : routines) {
+        out << std::right << std::setw(10) << routine.calls << std::setw(16) << routine.inclusive << std::setw(16)
+            << routine.exclusive << "  " << symbols.routine(routine.routine) << '\n';
+    }
+    out.flags(flags);
+}
+
+void CallStack::write_folded(std::ostream& out, SymbolTable const& symbols) const {
+    std::uint32_t const innermost = m_frames.empty() ? 0U : m_frames.back().node;
+    for (std::uint32_t node = 0U; node < m_nodes.size(); ++node) {
+        std::uint64_t const cycles = m_nodes[node].cycles + (node == innermost ? m_now - m_mark : 0U);
+        if (cycles == 0U) {
+            continue;
+        }
+        std::string path{"[top]"};
+        if (node != 0U) {
+            path.clear();
+            for (std::uint32_t step = node; step != 0U; step = m_nodes[step].parent) {
+                std::string const name = symbols.routine(m_nodes[step].routine);
+                path.insert(0U, path.empty() ? name : name + ';');
+            }
+        }
+        out << path << ' ' << cycles << '\n';
+    }
+}
+
+void CallStack::attribute() {
+    m_nodes[m_frames.empty() ? 0U : m_frames.back().node].cycles += m_now - m_mark;
+    m_mark = m_now;
+}
+
+void CallStack::pop() {
+    attribute();
+    Frame const frame = m_frames.back();
+    m_frames.pop_back();
+    close(m_totals, frame, m_frames.empty() ? nullptr : &m_frames.back(), m_now);
+}
+
+std::uint32_t CallStack::child(std::uint32_t const parent, std::uint16_t const routine) {
+    std::uint64_t const key = (static_cast<std::uint64_t>(parent) << 16) | routine;
+    auto const [position, inserted] = m_children.try_emplace(key, static_cast<std::uint32_t>(m_nodes.size()));
+    if (inserted) {
+        m_nodes.push_back(Node{parent, routine, 0U});
+    }
+    return position->second;
+}
+
+void CallStack::close(std::unordered_map<std::uint16_t, Totals>& totals, Frame const& frame, Frame* parent,
+                      std::uint64_t const now) {
+    std::uint64_t const duration = now - frame.start;
+    Totals& sum = totals[frame.routine];
+    sum.exclusive += duration - frame.children;
+    if (--sum.active == 0U) {
+        sum.inclusive += duration;
+    }
+    if (parent != nullptr) {
+        parent->children += duration;
+    }
+}
+}
@@ -55,6 +55,7 @@ ClockSync::ClockSync(
     , m_busy_period{}
     , m_idle_period{}
     , m_total_ticks{}
+    , m_timeline{}
 {
     // TODO: Include fractions on calculation
     static_cast<void>(clock_rate_fraction);
@@ -65,7 +66,11 @@ ClockSync::ClockSync(
     static_cast<void>(m_frame_ticks_fraction);
 }
 
-void ClockSync::elapse(std::uint8_t ticks) {
+std::uint64_t ClockSync::now() {
+    return mos6502::now();
+}
+
+void ClockSync::elapse(std::uint64_t ticks) {
     if (m_frame_last_ts == 0U) {
         m_frame_first_ts = now();
         m_frame_next_ts = m_frame_first_ts;
@@ -93,12 +98,17 @@ void ClockSync::elapse(std::uint8_t ticks) {
 
         m_frame_next_ts = m_frame_next_ts + m_frame_period;
         std::uint64_t ts = now();
+        std::uint64_t const frame_start_ts = m_frame_last_ts;
         std::uint64_t const busy_idle_transition_ts = ts;
 
         switch (m_sync_precision) {
         case SyncPrecision::High:
             while (ts < m_frame_next_ts) {
+#if defined(__x86_64__) || defined(__i386__)
                 __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+                __asm__ __volatile__("yield");
+#endif
                 ts = now();
             }
             m_frame_last_ts = ts;
@@ -113,8 +123,9 @@ void ClockSync::elapse(std::uint8_t ticks) {
                 timespec remain{0U, 0U};
 
                 while(nanosleep(&request, &remain) == -1 && errno == EINTR);
-                m_frame_last_ts = now();
+                ts = now();
             }
+            m_frame_last_ts = ts;
             break;
         case SyncPrecision::Medium:
             if (ts < m_frame_next_ts) {
@@ -137,13 +148,18 @@ void ClockSync::elapse(std::uint8_t ticks) {
                     std::this_thread::yield();
                     ts = now();
                 } while (ts < m_frame_next_ts);
-                m_frame_last_ts = ts;
             }
+            m_frame_last_ts = ts;
             break;
         }
 
-        m_busy_period += busy_idle_transition_ts - m_frame_last_ts;
-        m_idle_period += m_frame_next_ts - busy_idle_transition_ts;
+        // A frame is busy until caught up with the clock rate, then idle until the next one starts
+        m_busy_period += busy_idle_transition_ts - frame_start_ts;
+        m_idle_period += m_frame_last_ts - busy_idle_transition_ts;
+        if (m_timeline != nullptr) {
+            m_timeline->span("busy", TimelineTrack::Frames, frame_start_ts, busy_idle_transition_ts, m_frame_count);
+            m_timeline->span("idle", TimelineTrack::Frames, busy_idle_transition_ts, m_frame_last_ts, m_frame_count);
+        }
     }
 }
 
@@ -0,0 +1,161 @@
+#include "mos6502/cow_bus.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+namespace mos6502
+{
+/// Memory of the RAM pages never written
+static constexpr CowBus::Page kZeroPage{};
+
+/// Page copies alive, for live_pages
+static std::atomic<std::size_t> live_page_count{};
+
+struct CowBus::PageCopy {
+    Page bytes;
+
+    explicit PageCopy(std::uint8_t const* source) : bytes{} {
+        std::memcpy(bytes.data(), source, kPageSize);
+        live_page_count.fetch_add(1U, std::memory_order_relaxed);
+    }
+
+    PageCopy(PageCopy const&) = delete;
+    PageCopy& operator=(PageCopy const&) = delete;
+
+    ~PageCopy() {
+        live_page_count.fetch_sub(1U, std::memory_order_relaxed);
+    }
+};
+
+static void check_range(std::uint8_t first_page, std::size_t count) {
+    if (first_page + count > CowBus::kPageCount) {
+        throw std::out_of_range("page range exceeds address space");
+    }
+}
+
+CowBus::CowBus(std::shared_ptr<IBus> fallback) : m_fallback{std::move(fallback)} {
+    map_ram(0U, kPageCount);
+}
+
+CowBus::CowBus(CowBus const* parent)
+    : m_fallback{parent->m_fallback}, m_read_pages{parent->m_read_pages}, m_ram{parent->m_ram},
+      m_copies{parent->m_copies} {}
+
+CowBus::CowBus(CowBus&&) noexcept = default;
+
+CowBus& CowBus::operator=(CowBus&&) noexcept = default;
+
+CowBus::~CowBus() = default;
+
+std::size_t CowBus::live_pages() {
+    return live_page_count.load(std::memory_order_relaxed);
+}
+
+void CowBus::map_ram(std::uint8_t first_page, std::size_t count) {
+    check_range(first_page, count);
+    for (std::size_t i = first_page; i < first_page + count; ++i) {
+        release(i);
+        m_read_pages[i] = kZeroPage.data();
+        m_ram.set(i);
+    }
+}
+
+void CowBus::map_rom(std::uint8_t first_page, std::size_t count, std::uint8_t const* memory) {
+    check_range(first_page, count);
+    for (std::size_t i = 0U; i < count; ++i) {
+        release(first_page + i);
+        m_read_pages[first_page + i] = memory + i * kPageSize;
+        m_ram.reset(first_page + i);
+    }
+}
+
+void CowBus::map_io(std::uint8_t first_page, std::size_t count) {
+    check_range(first_page, count);
+    for (std::size_t i = first_page; i < first_page + count; ++i) {
+        release(i);
+        m_read_pages[i] = nullptr;
+        m_ram.reset(i);
+    }
+}
+
+CowBus CowBus::fork() {
+    if (m_dirty != 0U) {
+        m_dirty = 0U;
+        m_write_pages.fill(nullptr);
+    }
+
+    return CowBus{this};
+}
+
+std::uint8_t* CowBus::copy_page(std::uint8_t page) {
+    if (!m_ram.test(page)) {
+        return nullptr;
+    }
+    // The copy read so far is freed here unless a fork still maps it
+    m_copies[page] = std::make_shared<PageCopy>(m_read_pages[page]);
+    std::uint8_t* memory = m_copies[page]->bytes.data();
+    m_read_pages[page] = memory;
+    m_write_pages[page] = memory;
+    ++m_dirty;
+    return memory;
+}
+
+void CowBus::release(std::size_t const page) {
+    if (m_write_pages[page] != nullptr) {
+        m_write_pages[page] = nullptr;
+        --m_dirty;
+    }
+    m_copies[page].reset();
+}
+
+/// Bitmap of the RAM pages, the layout of the RAM section of a snapshot
+static std::array<std::uint8_t, CowBus::kPageCount / 8U> ram_pages(std::bitset<CowBus::kPageCount> const& ram) {
+    std::array<std::uint8_t, CowBus::kPageCount / 8U> bitmap{};
+    for (std::size_t page = 0U; page < ram.size(); ++page) {
+        if (ram.test(page)) {
+            bitmap[page / 8U] = static_cast<std::uint8_t>(bitmap[page / 8U] | (1U << (page % 8U)));
+        }
+    }
+    return bitmap;
+}
+
+void CowBus::save(SnapshotWriter& writer) const {
+    writer.put(ram_pages(m_ram));
+    for (std::size_t page = 0U; page < kPageCount; ++page) {
+        if (m_ram.test(page)) {
+            writer.put(std::span<std::uint8_t const>{m_read_pages[page], kPageSize});
+        }
+    }
+}
+
+void CowBus::restore(SnapshotReader& reader) {
+    std::array<std::uint8_t, kPageCount / 8U> ram{};
+    reader.get(ram);
+    if (ram != ram_pages(m_ram)) {
+        throw std::invalid_argument("snapshot maps other pages as RAM");
+    }
+    for (std::size_t page = 0U; page < kPageCount; ++page) {
+        if (m_ram.test(page)) {
+            std::uint8_t* memory = m_write_pages[page];
+            if (memory == nullptr) {
+                memory = copy_page(static_cast<std::uint8_t>(page));
+            }
+            reader.get(std::span<std::uint8_t>{memory, kPageSize});
+        }
+    }
+}
+
+std::uint8_t CowBus::fallback_read(std::uint16_t addr) {
+    if (m_fallback) {
+        return m_fallback->read(addr);
+    }
+    return 0xFF;
+}
+
+void CowBus::fallback_write(std::uint16_t addr, std::uint8_t data) {
+    if (m_fallback) {
+        m_fallback->write(addr, data);
+    }
+}
+}
@@ -0,0 +1,233 @@
+#include "mos6502/event_log.hpp"
+
+namespace mos6502
+{
+EventLogWriter::EventLogWriter(std::ostream& out) : m_out{out} {
+    std::copy(kEventLogMagic.begin(), kEventLogMagic.end(), m_buffer.begin());
+    m_buffer[kEventLogMagic.size()] = kEventLogVersion;
+    m_size = kEventLogMagic.size() + 1U;
+}
+
+void EventLogWriter::append(Event const& event) {
+    if (event.cycle < m_cycle) {
+        throw std::invalid_argument("event older than the previous one");
+    }
+    if (m_buffer.size() - m_size < kMaxEventSize) {
+        flush();
+    }
+    m_buffer[m_size++] = static_cast<std::uint8_t>(event.kind);
+    std::uint64_t delta = event.cycle - m_cycle;
+    while (delta >= 0x80U) {
+        m_buffer[m_size++] = static_cast<std::uint8_t>(delta | 0x80U);
+        delta >>= 7;
+    }
+    m_buffer[m_size++] = static_cast<std::uint8_t>(delta);
+    if (event.kind == EventKind::Read) {
+        m_buffer[m_size++] = static_cast<std::uint8_t>(event.addr);
+        m_buffer[m_size++] = static_cast<std::uint8_t>(event.addr >> 8);
+        m_buffer[m_size++] = event.value;
+    } else if (event.kind == EventKind::IrqLine || event.kind == EventKind::NmiLine) {
+        m_buffer[m_size++] = static_cast<std::uint8_t>((event.addr << 1) | (event.value & 0x01U));
+    }
+    m_cycle = event.cycle;
+}
+
+void EventLogWriter::flush() {
+    m_out.write(reinterpret_cast<char const*>(m_buffer.data()), static_cast<std::streamsize>(m_size));
+    m_out.flush();
+    m_size = 0U;
+    if (!m_out) {
+        throw std::runtime_error("event log write failed");
+    }
+}
+
+EventLogReader::EventLogReader(std::istream& in) : m_in{in} {
+    std::array<std::uint8_t, kEventLogMagic.size()> magic{};
+    for (std::uint8_t& byte : magic) {
+        byte = get().value_or(0U);
+    }
+    std::uint8_t const version = get().value_or(0U);
+    if (magic != kEventLogMagic || version == 0U || version > kEventLogVersion) {
+        throw std::invalid_argument("not an event log of a supported version");
+    }
+}
+
+std::optional<Event> EventLogReader::next() {
+    std::optional<std::uint8_t> const kind = get();
+    if (!kind) {
+        return std::nullopt;
+    }
+    if (*kind > static_cast<std::uint8_t>(EventKind::NmiLine)) {
+        throw std::invalid_argument("unknown event in the log");
+    }
+
+    std::uint64_t delta{};
+    for (unsigned shift = 0U;; shift += 7U) {
+        std::uint8_t const byte = get_required();
+        if (shift >= 64U) {
+            throw std::invalid_argument("cycle out of range in the log");
+        }
+        delta |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+        if ((byte & 0x80U) == 0U) {
+            break;
+        }
+    }
+    m_cycle += delta;
+
+    Event event{m_cycle, static_cast<EventKind>(*kind), 0U, 0U};
+    if (event.kind == EventKind::Read) {
+        std::uint8_t const lo = get_required();
+        std::uint8_t const hi = get_required();
+        event.addr = static_cast<std::uint16_t>(lo | (hi << 8));
+        event.value = get_required();
+    } else if (event.kind == EventKind::IrqLine || event.kind == EventKind::NmiLine) {
+        std::uint8_t const line = get_required();
+        event.addr = static_cast<std::uint16_t>(line >> 1);
+        event.value = static_cast<std::uint8_t>(line & 0x01U);
+    }
+    return event;
+}
+
+std::optional<std::uint8_t> EventLogReader::get() {
+    if (m_position == m_size) {
+        m_in.read(reinterpret_cast<char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+        m_size = static_cast<std::size_t>(m_in.gcount());
+        m_position = 0U;
+        if (m_size == 0U) {
+            return std::nullopt;
+        }
+    }
+    return m_buffer[m_position++];
+}
+
+std::uint8_t EventLogReader::get_required() {
+    std::optional<std::uint8_t> const byte = get();
+    if (!byte) {
+        throw std::out_of_range("event log truncated");
+    }
+    return *byte;
+}
+
+/// Devices whose reads are appended to the log
+class EventRecorder::Devices final : public IBus {
+public:
+    Devices(EventRecorder& recorder, std::shared_ptr<IBus> devices)
+        : m_recorder{recorder}, m_devices{std::move(devices)} {}
+
+    std::uint8_t read(std::uint16_t addr) override {
+        std::uint8_t const value = m_devices ? m_devices->read(addr) : std::uint8_t{0xFF};
+        m_recorder.m_log.append(Event{m_recorder.m_cycle, EventKind::Read, addr, value});
+        ++m_recorder.m_unsynced;
+        return value;
+    }
+
+    void write(std::uint16_t addr, std::uint8_t data) override {
+        if (m_devices) {
+            m_devices->write(addr, data);
+        }
+    }
+
+private:
+    EventRecorder& m_recorder;
+    std::shared_ptr<IBus> m_devices;
+};
+
+EventRecorder::~EventRecorder() {
+    if (!m_closed) {
+        try {
+            close();
+        } catch (std::exception const&) {
+            // Nothing to report to from a destructor, call close to see the error
+        }
+    }
+}
+
+std::shared_ptr<IBus> EventRecorder::record(std::shared_ptr<IBus> devices) {
+    return std::make_shared<Devices>(*this, std::move(devices));
+}
+
+void EventRecorder::close() {
+    m_closed = true;
+    append(EventKind::End);
+    m_log.flush();
+}
+
+void EventRecorder::append(EventKind const kind) {
+    m_log.append(Event{m_cycle, kind, 0U, 0U});
+    m_unsynced = 0U;
+}
+
+void EventRecorder::line(Event const& event) {
+    if (m_running) {
+        m_lines.push_back(event);
+    } else {
+        m_log.append(event);
+        m_unsynced = 0U;
+    }
+}
+
+void EventRecorder::advance(std::uint64_t const cycles) {
+    m_running = false;
+    m_cycle += cycles;
+    for (Event& event : m_lines) {
+        event.cycle = m_cycle;
+        line(event);
+    }
+    m_lines.clear();
+    if (m_unsynced >= kSyncReads) {
+        append(EventKind::Sync);
+    }
+}
+
+/// Devices answering the reads from the log
+class EventReplayer::Devices final : public IBus {
+public:
+    Devices(EventReplayer& replayer, std::shared_ptr<IBus> devices)
+        : m_replayer{replayer}, m_devices{std::move(devices)} {}
+
+    std::uint8_t read(std::uint16_t addr) override {
+        return m_replayer.read(addr);
+    }
+
+    void write(std::uint16_t addr, std::uint8_t data) override {
+        if (m_devices) {
+            m_devices->write(addr, data);
+        }
+    }
+
+private:
+    EventReplayer& m_replayer;
+    std::shared_ptr<IBus> m_devices;
+};
+
+std::shared_ptr<IBus> EventReplayer::replay(std::shared_ptr<IBus> devices) {
+    return std::make_shared<Devices>(*this, std::move(devices));
+}
+
+std::optional<std::uint64_t> EventReplayer::next_signal() {
+    while (!m_signal) {
+        std::optional<Event> const event = m_log.next();
+        if (!event) {
+            return std::nullopt;
+        }
+        if (event->kind == EventKind::Read) {
+            m_reads.push_back(*event);
+        } else {
+            m_signal = event;
+        }
+    }
+    return m_signal->cycle;
+}
+
+std::uint8_t EventReplayer::read(std::uint16_t addr) {
+    if (m_reads.empty() && !m_signal) {
+        next_signal();
+    }
+    if (m_reads.empty() || m_reads.front().addr != addr) {
+        throw std::logic_error("replay diverged from the recording");
+    }
+    std::uint8_t const value = m_reads.front().value;
+    m_reads.pop_front();
+    return value;
+}
+}
@@ -0,0 +1,89 @@
+#include "mos6502/instrumentation.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace mos6502
+{
+InstructionCount InstructionStats::mode(AddressMode mode) const {
+    InstructionCount sum{};
+    for (std::size_t opcode = 0U; opcode < m_counts.size(); ++opcode) {
+        if ((*m_opcodes)[opcode].mode == mode) {
+            sum.count += m_counts[opcode].count;
+            sum.cycles += m_counts[opcode].cycles;
+        }
+    }
+    return sum;
+}
+
+InstructionCount InstructionStats::total() const {
+    InstructionCount sum{};
+    for (InstructionCount const& counter : m_counts) {
+        sum.count += counter.count;
+        sum.cycles += counter.cycles;
+    }
+    return sum;
+}
+
+void InstructionStats::reset() {
+    m_counts.fill(InstructionCount{});
+    m_interrupts = InstructionCount{};
+}
+
+/// Share of the cycles in percent with one decimal
+static void write_share(std::ostream& out, std::uint64_t const cycles, std::uint64_t const total) {
+    std::uint64_t const permille = total == 0U ? 0U : (cycles * 1000U + total / 2U) / total;
+    out << std::setw(4) << permille / 10U << '.' << permille % 10U << '%';
+}
+
+void InstructionStats::dump(std::ostream& out, std::size_t const limit) const {
+    std::ios_base::fmtflags const flags = out.flags();
+    char const fill = out.fill();
+    std::uint64_t const cycles = total().cycles + m_interrupts.cycles;
+
+    std::vector<std::uint8_t> executed{};
+    for (std::size_t opcode = 0U; opcode < m_counts.size(); ++opcode) {
+        if (m_counts[opcode].count != 0U) {
+            executed.push_back(static_cast<std::uint8_t>(opcode));
+        }
+    }
+    std::stable_sort(executed.begin(), executed.end(), [this](std::uint8_t lhs, std::uint8_t rhs) {
+        return m_counts[lhs].cycles > m_counts[rhs].cycles;
+    });
+    executed.resize(std::min(executed.size(), limit));
+
+    out << "opcode  instruction        count          cycles   share\n";
+    for (std::uint8_t const opcode : executed) {
+        OpcodeInfo const& info = (*m_opcodes)[opcode];
+        out << std::left << std::setfill(' ') << "  $" << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
+            << static_cast<unsigned>(opcode) << std::dec << std::setfill(' ') << "  " << mnemonic_name(info.mnemonic) << ' '
+            << std::setw(9) << address_mode_name(info.mode) << std::right << std::setw(12) << m_counts[opcode].count
+            << std::setw(16) << m_counts[opcode].cycles << ' ';
+        write_share(out, m_counts[opcode].cycles, cycles);
+        out << '\n';
+    }
+    if (m_interrupts.count != 0U) {
+        out << "  interrupts        " << std::setw(12) << m_interrupts.count << std::setw(16) << m_interrupts.cycles << ' ';
+        write_share(out, m_interrupts.cycles, cycles);
+        out << '\n';
+    }
+
+    out << "mode                   count          cycles   share\n";
+    for (std::size_t i = 0U; i < kModeCount; ++i) {
+        AddressMode const address_mode = static_cast<AddressMode>(i);
+        InstructionCount const sum = mode(address_mode);
+        if (sum.count == 0U) {
+            continue;
+        }
+        std::string_view const name = address_mode_name(address_mode);
+        out << "  " << std::left << std::setw(14) << (name.empty() ? "implied" : name) << std::right << std::setw(12)
+            << sum.count << std::setw(16) << sum.cycles << ' ';
+        write_share(out, sum.cycles, cycles);
+        out << '\n';
+    }
+
+    out.flags(flags);
+    out.fill(fill);
+}
+}
@@ -0,0 +1,34 @@
+#include "mos6502/jit.hpp"
+
+#if MOS6502_JIT
+#include <new>
+
+#include <sys/mman.h>
+
+namespace mos6502
+{
+ExecutableArena::ExecutableArena(std::size_t size) : m_data{}, m_size{size} {
+    void* memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc{};
+    }
+    m_data = static_cast<std::uint8_t*>(memory);
+}
+
+ExecutableArena::~ExecutableArena() {
+    munmap(m_data, m_size);
+}
+
+void ExecutableArena::unprotect() {
+    if (mprotect(m_data, m_size, PROT_READ | PROT_WRITE) != 0) {
+        throw std::bad_alloc{};
+    }
+}
+
+void ExecutableArena::protect() {
+    if (mprotect(m_data, m_size, PROT_READ | PROT_EXEC) != 0) {
+        throw std::bad_alloc{};
+    }
+}
+}
+#endif
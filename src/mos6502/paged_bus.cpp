@@ -0,0 +1,114 @@
+#include "mos6502/paged_bus.hpp"
+
+#include <stdexcept>
+
+namespace mos6502
+{
+static void check_range(std::uint8_t first_page, std::size_t count) {
+    if (first_page + count > PagedBus::kPageCount) {
+        throw std::out_of_range("page range exceeds address space");
+    }
+}
+
+PagedBus::PagedBus(std::shared_ptr<IBus> fallback) : m_fallback{std::move(fallback)} {
+    map_ram(0U, kPageCount);
+}
+
+PagedBus::~PagedBus() = default;
+
+void PagedBus::map_ram(std::uint8_t first_page, std::size_t count) {
+    check_range(first_page, count);
+    map_ram(first_page, count, m_ram.data() + first_page * kPageSize);
+}
+
+void PagedBus::map_ram(std::uint8_t first_page, std::size_t count, std::uint8_t* memory) {
+    check_range(first_page, count);
+    for (std::size_t i = 0U; i < count; ++i) {
+        m_read_pages[first_page + i] = memory + i * kPageSize;
+        m_ram_pages[first_page + i] = memory + i * kPageSize;
+        mark_dirty(static_cast<std::uint8_t>(first_page + i));
+    }
+}
+
+void PagedBus::map_rom(std::uint8_t first_page, std::size_t count, std::uint8_t const* memory) {
+    check_range(first_page, count);
+    for (std::size_t i = 0U; i < count; ++i) {
+        m_read_pages[first_page + i] = memory + i * kPageSize;
+        m_write_pages[first_page + i] = nullptr;
+        m_ram_pages[first_page + i] = nullptr;
+        m_dirty.reset(first_page + i);
+    }
+}
+
+void PagedBus::map_io(std::uint8_t first_page, std::size_t count) {
+    check_range(first_page, count);
+    for (std::size_t i = 0U; i < count; ++i) {
+        m_read_pages[first_page + i] = nullptr;
+        m_write_pages[first_page + i] = nullptr;
+        m_ram_pages[first_page + i] = nullptr;
+        m_dirty.reset(first_page + i);
+    }
+}
+
+void PagedBus::clear_dirty() {
+    m_write_pages.fill(nullptr);
+    m_dirty.reset();
+}
+
+/// Bitmap of the RAM pages, the layout of the RAM section of a snapshot
+static std::array<std::uint8_t, PagedBus::kPageCount / 8U> ram_pages(std::array<std::uint8_t*, PagedBus::kPageCount> const& pages) {
+    std::array<std::uint8_t, PagedBus::kPageCount / 8U> ram{};
+    for (std::size_t page = 0U; page < pages.size(); ++page) {
+        if (pages[page] != nullptr) {
+            ram[page / 8U] = static_cast<std::uint8_t>(ram[page / 8U] | (1U << (page % 8U)));
+        }
+    }
+    return ram;
+}
+
+void PagedBus::save(SnapshotWriter& writer) const {
+    writer.put(ram_pages(m_ram_pages));
+    for (std::uint8_t const* page : m_ram_pages) {
+        if (page != nullptr) {
+            writer.put(std::span<std::uint8_t const>{page, kPageSize});
+        }
+    }
+}
+
+void PagedBus::restore(SnapshotReader& reader) {
+    std::array<std::uint8_t, kPageCount / 8U> bitmap{};
+    reader.get(bitmap);
+    if (bitmap != ram_pages(m_ram_pages)) {
+        throw std::invalid_argument("snapshot maps other pages as RAM");
+    }
+    for (std::size_t page = 0U; page < kPageCount; ++page) {
+        if (m_ram_pages[page] != nullptr) {
+            reader.get(std::span<std::uint8_t>{m_ram_pages[page], kPageSize});
+            mark_dirty(static_cast<std::uint8_t>(page));
+        }
+    }
+}
+
+void PagedBus::first_write(std::uint16_t addr, std::uint8_t data) {
+    std::uint8_t const page = static_cast<std::uint8_t>(addr >> 8);
+    if (m_ram_pages[page] != nullptr) {
+        mark_dirty(page);
+        m_ram_pages[page][addr & 0xFF] = data;
+    } else {
+        fallback_write(addr, data);
+    }
+}
+
+std::uint8_t PagedBus::fallback_read(std::uint16_t addr) {
+    if (m_fallback) {
+        return m_fallback->read(addr);
+    }
+    return 0xFF;
+}
+
+void PagedBus::fallback_write(std::uint16_t addr, std::uint8_t data) {
+    if (m_fallback) {
+        m_fallback->write(addr, data);
+    }
+}
+}
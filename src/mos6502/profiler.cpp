@@ -0,0 +1,83 @@
+#include "mos6502/profiler.hpp"
+
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mos6502
+{
+/// Throw unless the sampling period is usable
+static std::uint64_t checked_period(std::uint64_t const period) {
+    if (period == 0U) {
+        throw std::invalid_argument("sampling period of no cycles");
+    }
+    return period;
+}
+
+PcSampler::PcSampler(std::uint64_t const period, std::size_t const capacity)
+    : m_period{checked_period(period)}, m_ring{capacity},
+      m_histogram{std::make_unique<std::array<std::uint64_t, 65536>>()} {}
+
+void PcSampler::detach() {
+    if (m_scheduler != nullptr) {
+        m_scheduler->cancel(m_event);
+        m_scheduler = nullptr;
+    }
+}
+
+std::size_t PcSampler::collect() {
+    std::array<std::uint16_t, 1024> batch{};
+    std::size_t collected = 0U;
+    while (std::size_t const count = m_ring.pop(batch)) {
+        for (std::size_t i = 0U; i < count; ++i) {
+            ++(*m_histogram)[batch[i]];
+        }
+        collected += count;
+    }
+    m_total += collected;
+    return collected;
+}
+
+void PcSampler::reset() {
+    m_histogram->fill(0U);
+    m_total = 0U;
+}
+
+/// Samples summed by routine, most samples first
+static std::vector<std::pair<std::string, std::uint64_t>> by_routine(std::array<std::uint64_t, 65536> const& histogram,
+                                                                     SymbolTable const& symbols) {
+    std::map<std::string, std::uint64_t> sums{};
+    for (std::size_t addr = 0U; addr < histogram.size(); ++addr) {
+        if (histogram[addr] != 0U) {
+            sums[symbols.routine(static_cast<std::uint16_t>(addr))] += histogram[addr];
+        }
+    }
+    std::vector<std::pair<std::string, std::uint64_t>> routines{sums.begin(), sums.end()};
+    std::stable_sort(routines.begin(), routines.end(), [](auto const& lhs, auto const& rhs) { return lhs.second > rhs.second; });
+    return routines;
+}
+
+void PcSampler::write_report(std::ostream& out, SymbolTable const& symbols, std::size_t const limit) const {
+    std::ios_base::fmtflags const flags = out.flags();
+    std::vector<std::pair<std::string, std::uint64_t>> routines = by_routine(*m_histogram, symbols);
+    routines.resize(std::min(routines.size(), limit));
+
+    out << "samples   share  routine\n";
+    for (auto const& [name, count] : routines) {
+        std::uint64_t const permille = (count * 1000U + m_total / 2U) / m_total;
+        out << std::right << std::setw(7) << count << ' ' << std::setw(4) << permille / 10U << '.' << permille % 10U << "%  "
+            << name << '\n';
+    }
+    out << std::setw(7) << m_total << " total, " << dropped() << " dropped\n";
+    out.flags(flags);
+}
+
+void PcSampler::write_folded(std::ostream& out, SymbolTable const& symbols) const {
+    for (auto const& [name, count] : by_routine(*m_histogram, symbols)) {
+        out << name << ' ' << count << '\n';
+    }
+}
+}
@@ -0,0 +1,66 @@
+#include "mos6502/rewind.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace mos6502
+{
+/// Number of equal bytes at the beginning of two runs of 8 bytes
+static std::size_t equal_bytes(std::uint8_t const* lhs, std::uint8_t const* rhs) {
+    std::uint64_t lhs_word{};
+    std::uint64_t rhs_word{};
+    std::memcpy(&lhs_word, lhs, sizeof(lhs_word));
+    std::memcpy(&rhs_word, rhs, sizeof(rhs_word));
+    std::uint64_t const difference = lhs_word ^ rhs_word;
+    if constexpr (std::endian::native == std::endian::little) {
+        return static_cast<std::size_t>(std::countr_zero(difference)) / 8U;
+    } else {
+        return static_cast<std::size_t>(std::countl_zero(difference)) / 8U;
+    }
+}
+
+std::size_t encode_page_delta(std::uint8_t const* before, std::uint8_t const* after, std::uint8_t* out) {
+    std::size_t size = 0U;
+    std::size_t pos = 0U;
+    bool changed = false;
+    while (pos < PagedBus::kPageSize) {
+        std::size_t const skip_begin = pos;
+        std::size_t const skip_end = std::min(PagedBus::kPageSize, skip_begin + 0xFF);
+        while (pos + sizeof(std::uint64_t) <= skip_end) {
+            std::size_t const equal = equal_bytes(before + pos, after + pos);
+            pos += equal;
+            if (equal != sizeof(std::uint64_t)) {
+                break;
+            }
+        }
+        while (pos < skip_end && before[pos] == after[pos]) {
+            ++pos;
+        }
+        std::size_t const copy_begin = pos;
+        while (pos < PagedBus::kPageSize && before[pos] != after[pos] && pos - copy_begin < 0xFF) {
+            ++pos;
+        }
+        out[size++] = static_cast<std::uint8_t>(copy_begin - skip_begin);
+        out[size++] = static_cast<std::uint8_t>(pos - copy_begin);
+        for (std::size_t i = copy_begin; i < pos; ++i) {
+            out[size++] = static_cast<std::uint8_t>(before[i] ^ after[i]);
+        }
+        changed = changed || pos != copy_begin;
+    }
+    return changed ? size : 0U;
+}
+
+std::size_t apply_page_delta(std::uint8_t const* delta, std::uint8_t* page) {
+    std::size_t size = 0U;
+    std::size_t pos = 0U;
+    while (pos < PagedBus::kPageSize) {
+        pos += delta[size++];
+        std::size_t const copy = delta[size++];
+        for (std::size_t i = 0U; i < copy; ++i) {
+            page[pos++] ^= delta[size++];
+        }
+    }
+    return size;
+}
+}
@@ -0,0 +1,42 @@
+#include "mos6502/scheduler.hpp"
+
+#include "mos6502/clock_sync.hpp"
+
+namespace mos6502
+{
+Scheduler::EventId Scheduler::schedule(std::uint64_t cycle, Callback callback, char const* name) {
+    EventId const id = m_next_id++;
+    m_queue.push_back(Entry{cycle, id, std::move(callback), name});
+    std::push_heap(m_queue.begin(), m_queue.end(), later);
+    return id;
+}
+
+bool Scheduler::cancel(EventId id) {
+    auto const entry = std::find_if(m_queue.begin(), m_queue.end(), [id](Entry const& e) { return e.id == id; });
+    if (entry == m_queue.end()) {
+        return false;
+    }
+    m_queue.erase(entry);
+    std::make_heap(m_queue.begin(), m_queue.end(), later);
+    return true;
+}
+
+std::size_t Scheduler::fire_due() {
+    std::size_t fired = 0U;
+    while (!m_queue.empty() && m_queue.front().cycle <= m_now) {
+        std::pop_heap(m_queue.begin(), m_queue.end(), later);
+        Entry entry = std::move(m_queue.back());
+        m_queue.pop_back();
+        // The callback may schedule again, it runs once the heap is consistent
+        if (m_timeline != nullptr) {
+            std::uint64_t const start = ClockSync::now();
+            entry.callback(entry.cycle);
+            m_timeline->span(entry.name, TimelineTrack::Devices, start, ClockSync::now(), entry.cycle);
+        } else {
+            entry.callback(entry.cycle);
+        }
+        ++fired;
+    }
+    return fired;
+}
+}
@@ -0,0 +1,145 @@
+#include "mos6502/symbols.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace mos6502
+{
+/// Parse a 16 bits address written in hexadecimal
+static std::optional<std::uint16_t> parse_address(std::string_view text, std::string_view const prefix) {
+    if (text.starts_with(prefix)) {
+        text.remove_prefix(prefix.size());
+    }
+    unsigned value{};
+    auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, 16);
+    if (error != std::errc{} || end != text.data() + text.size() || text.empty() || value > 0xFFFFU) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint16_t>(value);
+}
+
+static std::string hex_address(std::uint16_t const addr) {
+    constexpr std::string_view kDigits{"0123456789ABCDEF"};
+    std::string text{"$"};
+    for (int shift = 12; shift >= 0; shift -= 4) {
+        text += kDigits[(addr >> shift) & 0xFU];
+    }
+    return text;
+}
+
+void SymbolTable::add(std::uint16_t const addr, std::string name) {
+    auto const position = std::lower_bound(m_symbols.begin(), m_symbols.end(), addr,
+                                           [](Symbol const& symbol, std::uint16_t value) { return symbol.addr < value; });
+    if (position != m_symbols.end() && position->addr == addr) {
+        position->name = std::move(name);
+    } else {
+        m_symbols.insert(position, Symbol{addr, std::move(name)});
+    }
+}
+
+std::size_t SymbolTable::load_vice_labels(std::istream& in) {
+    std::size_t loaded = 0U;
+    std::string line{};
+    while (std::getline(in, line)) {
+        std::istringstream fields{line};
+        std::string command{};
+        std::string address{};
+        std::string name{};
+        fields >> command;
+        if (command != "al") {
+            continue;
+        }
+        fields >> address >> name;
+        // The memory space prefix (C: for the computer) is optional
+        std::size_t const colon = address.find(':');
+        std::optional<std::uint16_t> const addr =
+            parse_address(colon == std::string::npos ? std::string_view{address} : std::string_view{address}.substr(colon + 1U), "");
+        if (!addr || name.empty()) {
+            throw std::invalid_argument("malformed VICE label: " + line);
+        }
+        add(*addr, name.starts_with('.') ? name.substr(1U) : name);
+        ++loaded;
+    }
+    return loaded;
+}
+
+/// Value of a key in a line of key=value pairs separated by commas, quotes removed
+static std::optional<std::string_view> dbg_value(std::string_view line, std::string_view const key) {
+    while (!line.empty()) {
+        std::size_t end = 0U;
+        bool quoted = false;
+        while (end < line.size() && (quoted || line[end] != ',')) {
+            quoted = line[end] == '"' ? !quoted : quoted;
+            ++end;
+        }
+        std::string_view const pair = line.substr(0U, end);
+        line.remove_prefix(std::min(end + 1U, line.size()));
+        std::size_t const equal = pair.find('=');
+        if (equal != std::string_view::npos && pair.substr(0U, equal) == key) {
+            std::string_view value = pair.substr(equal + 1U);
+            if (value.size() >= 2U && value.front() == '"' && value.back() == '"') {
+                value = value.substr(1U, value.size() - 2U);
+            }
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+std::size_t SymbolTable::load_ca65_dbg(std::istream& in) {
+    std::size_t loaded = 0U;
+    std::string line{};
+    while (std::getline(in, line)) {
+        std::string_view text{line};
+        if (!text.starts_with("sym\t") && !text.starts_with("sym ")) {
+            continue;
+        }
+        text.remove_prefix(4U);
+        std::optional<std::string_view> const type = dbg_value(text, "type");
+        std::optional<std::string_view> const value = dbg_value(text, "val");
+        std::optional<std::string_view> const name = dbg_value(text, "name");
+        // Imports have no value, equates are constants rather than addresses
+        if (type != "lab" || !value) {
+            continue;
+        }
+        std::optional<std::uint16_t> const addr = parse_address(*value, "0x");
+        if (!addr || !name || name->empty()) {
+            throw std::invalid_argument("malformed ca65 symbol: " + line);
+        }
+        add(*addr, std::string{*name});
+        ++loaded;
+    }
+    return loaded;
+}
+
+Symbol const* SymbolTable::resolve(std::uint16_t const addr) const {
+    auto const after = std::upper_bound(m_symbols.begin(), m_symbols.end(), addr,
+                                        [](std::uint16_t value, Symbol const& symbol) { return value < symbol.addr; });
+    if (after == m_symbols.begin()) {
+        return nullptr;
+    }
+    return &*(after - 1);
+}
+
+std::string SymbolTable::routine(std::uint16_t const addr) const {
+    Symbol const* symbol = resolve(addr);
+    return symbol != nullptr ? symbol->name : hex_address(addr);
+}
+
+std::string SymbolTable::describe(std::uint16_t const addr) const {
+    Symbol const* symbol = resolve(addr);
+    if (symbol == nullptr) {
+        return hex_address(addr);
+    }
+    if (symbol->addr == addr) {
+        return symbol->name;
+    }
+    std::string offset = hex_address(static_cast<std::uint16_t>(addr - symbol->addr));
+    offset.erase(1U, std::min(offset.find_first_not_of('0', 1U), offset.size() - 1U) - 1U);
+    return symbol->name + "+" + offset;
+}
+}
@@ -0,0 +1,96 @@
+#include "mos6502/timeline.hpp"
+
+#include <array>
+#include <iomanip>
+#include <stdexcept>
+#include <string_view>
+
+#include "mos6502/clock_sync.hpp"
+
+namespace mos6502
+{
+static constexpr std::array<std::string_view, 3> kTrackNames{"frames", "cpu", "devices"};
+
+/// Name of the argument of the events of each track
+static constexpr std::array<std::string_view, 3> kArgNames{"frame", "pc", "cycle"};
+
+TimelineTracer::TimelineTracer(std::size_t const capacity) : m_origin{ClockSync::now()} {
+    m_events.reserve(capacity);
+}
+
+void TimelineTracer::instant(char const* const name, TimelineTrack const track, std::uint64_t const arg) {
+    append(TimelineEvent{name, ClockSync::now(), 0U, arg, track, true});
+}
+
+/// Write a string as a JSON string literal
+static void write_string(std::ostream& out, std::string_view const text) {
+    out << '"';
+    for (char const c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20U) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<unsigned>(c) << std::dec
+                << std::setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+/// Write nanoseconds as microseconds, the unit of the format
+static void write_microseconds(std::ostream& out, std::int64_t const nanoseconds) {
+    out << static_cast<double>(nanoseconds) / 1000.0;
+}
+
+void TimelineTracer::flush(std::ostream& out) {
+    std::ios_base::fmtflags const flags = out.flags();
+    std::streamsize const precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    if (!m_started) {
+        m_started = true;
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            << R"({"name":"process_name","ph":"M","pid":1,"tid":0,"args":{"name":"mos6502"}})";
+        for (std::size_t track = 0U; track < kTrackNames.size(); ++track) {
+            out << ",\n" << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << track + 1U << R"(,"args":{"name":)";
+            write_string(out, kTrackNames[track]);
+            out << "}}";
+        }
+    }
+
+    for (TimelineEvent const& event : m_events) {
+        auto const track = static_cast<std::size_t>(event.track);
+        out << ",\n{\"name\":";
+        write_string(out, event.name != nullptr ? event.name : "event");
+        out << ",\"cat\":";
+        write_string(out, kTrackNames[track]);
+        out << (event.instant ? R"(,"ph":"i","s":"t")" : R"(,"ph":"X")") << R"(,"pid":1,"tid":)" << track + 1U
+            << ",\"ts\":";
+        write_microseconds(out, static_cast<std::int64_t>(event.start - m_origin));
+        if (!event.instant) {
+            out << ",\"dur\":";
+            write_microseconds(out, static_cast<std::int64_t>(event.duration));
+        }
+        out << ",\"args\":{";
+        write_string(out, kArgNames[track]);
+        out << ':' << event.arg << "}}";
+    }
+    m_events.clear();
+
+    out.flags(flags);
+    out.precision(precision);
+    if (!out) {
+        throw std::runtime_error("timeline write failed");
+    }
+}
+
+void TimelineTracer::finish(std::ostream& out) {
+    flush(out);
+    out << "\n]}\n";
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("timeline write failed");
+    }
+}
+}
@@ -0,0 +1,541 @@
+#include "mos6502/trace.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+namespace mos6502
+{
+/// Bytes of a record in a trace, laid out as TraceRecord in little endian, the cycle counted
+/// from the previous record of the trace so that loops repeat the same bytes
+static constexpr std::size_t kRecordSize{sizeof(TraceRecord)};
+
+/// Bytes of a record in a trace of version 1, the cycle counted from the previous record of the block
+static constexpr std::size_t kRecordSizeV1{24U};
+
+/// Bytes of the header of a block: records, bytes stored and whether they are compressed
+static constexpr std::size_t kBlockHeaderSize{9U};
+
+/// Shortest back reference worth encoding
+static constexpr std::size_t kMinMatch{4U};
+
+static constexpr std::uint8_t kCompressed{0x01};
+
+static void put_u32(std::uint8_t* out, std::uint32_t const value) {
+    for (std::size_t i = 0U; i < 4U; ++i) {
+        out[i] = static_cast<std::uint8_t>(value >> (8U * i));
+    }
+}
+
+static std::uint32_t get_u32(std::uint8_t const* in) {
+    return static_cast<std::uint32_t>(in[0] | (in[1] << 8) | (in[2] << 16)) | (static_cast<std::uint32_t>(in[3]) << 24);
+}
+
+/// Store a record in the layout of the trace, on hosts that do not share it
+static void encode(TraceRecord const& record, std::uint8_t* out) {
+    for (std::size_t i = 0U; i < 8U; ++i) {
+        out[i] = static_cast<std::uint8_t>(record.cycle >> (8U * i));
+    }
+    out[8] = static_cast<std::uint8_t>(record.pc);
+    out[9] = static_cast<std::uint8_t>(record.pc >> 8);
+    out[10] = record.opcode;
+    out[11] = record.operand_lo;
+    out[12] = record.operand_hi;
+    out[13] = record.ac;
+    out[14] = record.xi;
+    out[15] = record.yi;
+    out[16] = record.sr;
+    out[17] = record.sp;
+    out[18] = static_cast<std::uint8_t>(record.entry);
+    out[19] = record.writes;
+    for (std::size_t i = 0U; i < kTraceMaxWrites; ++i) {
+        out[20U + 2U * i] = static_cast<std::uint8_t>(record.addr[i]);
+        out[21U + 2U * i] = static_cast<std::uint8_t>(record.addr[i] >> 8);
+        out[26U + i] = record.value[i];
+    }
+    std::fill(out + 29, out + kRecordSize, std::uint8_t{0U});
+}
+
+/// Read a record of the trace, its cycle still counted from the previous record
+/// @throw std::invalid_argument when the fields are out of range
+static TraceRecord decode(std::uint8_t const* in) {
+    TraceRecord record{};
+    for (std::size_t i = 0U; i < 8U; ++i) {
+        record.cycle |= static_cast<std::uint64_t>(in[i]) << (8U * i);
+    }
+    record.pc = static_cast<std::uint16_t>(in[8] | (in[9] << 8));
+    record.opcode = in[10];
+    record.operand_lo = in[11];
+    record.operand_hi = in[12];
+    record.ac = in[13];
+    record.xi = in[14];
+    record.yi = in[15];
+    record.sr = in[16];
+    record.sp = in[17];
+    record.entry = static_cast<TraceEntry>(in[18]);
+    record.writes = in[19];
+    if (record.entry > TraceEntry::Nmi || record.writes > kTraceMaxWrites) {
+        throw std::invalid_argument("corrupted trace record");
+    }
+    for (std::size_t i = 0U; i < kTraceMaxWrites; ++i) {
+        record.addr[i] = static_cast<std::uint16_t>(in[20U + 2U * i] | (in[21U + 2U * i] << 8));
+        record.value[i] = in[26U + i];
+    }
+    return record;
+}
+
+/// Read a record of a trace of version 1, its cycle still counted from the previous record
+static TraceRecord decode_v1(std::uint8_t const* in) {
+    TraceRecord record{};
+    for (std::size_t i = 0U; i < 8U; ++i) {
+        record.cycle |= static_cast<std::uint64_t>(in[i]) << (8U * i);
+    }
+    record.pc = static_cast<std::uint16_t>(in[8] | (in[9] << 8));
+    record.opcode = in[10];
+    record.operand_lo = in[11];
+    record.operand_hi = in[12];
+    record.ac = in[13];
+    record.xi = in[14];
+    record.yi = in[15];
+    record.sr = in[16];
+    record.sp = in[17];
+    if (in[21] != 0U) {
+        record.writes = 1U;
+        record.addr[0] = static_cast<std::uint16_t>(in[18] | (in[19] << 8));
+        record.value[0] = in[20];
+    }
+    return record;
+}
+
+TraceWriter::TraceWriter(std::ostream& out, bool const compress, std::size_t const capacity,
+                         TraceOverflow const overflow)
+    : m_out{out}, m_compress{compress}, m_overflow{overflow}, m_ring{capacity},
+      m_block_records{std::min(kBlockRecords, m_ring.capacity())},
+      m_raw(std::endian::native == std::endian::little ? 0U : m_block_records * kRecordSize),
+      m_block(kBlockHeaderSize + lz_bound(m_block_records * kRecordSize)) {
+    m_out.write(reinterpret_cast<char const*>(kTraceMagic.data()), kTraceMagic.size());
+    m_out.put(static_cast<char>(kTraceVersion));
+    if (!m_out) {
+        throw std::runtime_error("trace write failed");
+    }
+    m_thread = std::thread{[this] { drain(); }};
+}
+
+TraceWriter::~TraceWriter() {
+    if (!m_closed) {
+        try {
+            close();
+        } catch (std::exception const&) {
+            // Nothing to report to from a destructor, call close to see the error
+        }
+    }
+}
+
+void TraceWriter::close() {
+    m_closed = true;
+    if (m_thread.joinable()) {
+        m_closing.store(true, std::memory_order_release);
+        m_thread.join();
+    }
+    if (m_failed.load(std::memory_order_acquire)) {
+        throw std::runtime_error("trace write failed");
+    }
+}
+
+TraceRecord* TraceWriter::overflow() {
+    // Once closing nobody drains the ring anymore
+    if (m_overflow == TraceOverflow::Drop || m_closing.load(std::memory_order_relaxed)) {
+        ++m_dropped;
+        return nullptr;
+    }
+    ++m_waits;
+    TraceRecord* slot = nullptr;
+    do {
+        std::this_thread::yield();
+        slot = m_ring.claim();
+    } while (slot == nullptr);
+    return slot;
+}
+
+void TraceWriter::drain() {
+    for (;;) {
+        // Records pushed before close are visible once closing is
+        bool const closing = m_closing.load(std::memory_order_acquire);
+        // Full blocks start at multiples of the block size, so they never wrap around the ring
+        std::span<TraceRecord const> const records = m_ring.peek();
+        if (records.size() >= m_block_records || (closing && !records.empty())) {
+            std::size_t const count = std::min(records.size(), m_block_records);
+            write_block(records.first(count));
+            m_ring.consume(count);
+        } else if (closing) {
+            break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds{200});
+        }
+    }
+    write_block({});
+    m_out.flush();
+    if (!m_out) {
+        m_failed.store(true, std::memory_order_release);
+    }
+}
+
+void TraceWriter::write_block(std::span<TraceRecord const> const records) {
+    std::size_t const raw_size = records.size() * kRecordSize;
+    // Records are stored as laid out in the ring, only hosts of another byte order encode them
+    auto const* raw = reinterpret_cast<std::uint8_t const*>(records.data());
+    if constexpr (std::endian::native != std::endian::little) {
+        for (std::size_t i = 0U; i < records.size(); ++i) {
+            encode(records[i], m_raw.data() + i * kRecordSize);
+        }
+        raw = m_raw.data();
+    }
+    std::size_t stored = raw_size;
+    std::uint8_t flags = 0U;
+    if (m_compress && raw_size != 0U) {
+        std::size_t const packed = m_compressor.compress(raw, raw_size, m_block.data() + kBlockHeaderSize);
+        if (packed < raw_size) {
+            stored = packed;
+            flags = kCompressed;
+            raw = m_block.data() + kBlockHeaderSize;
+        }
+    }
+    put_u32(m_block.data(), static_cast<std::uint32_t>(records.size()));
+    put_u32(m_block.data() + 4U, static_cast<std::uint32_t>(stored));
+    m_block[8] = flags;
+    m_out.write(reinterpret_cast<char const*>(m_block.data()), kBlockHeaderSize);
+    m_out.write(reinterpret_cast<char const*>(raw), static_cast<std::streamsize>(stored));
+    if (!m_out) {
+        m_failed.store(true, std::memory_order_release);
+    }
+}
+
+TraceReader::TraceReader(std::istream& in) : m_in{in} {
+    std::array<std::uint8_t, kTraceMagic.size() + 1U> header{};
+    m_in.read(reinterpret_cast<char*>(header.data()), header.size());
+    m_version = m_in ? header.back() : std::uint8_t{0U};
+    if (!std::equal(kTraceMagic.begin(), kTraceMagic.end(), header.begin()) || m_version == 0U ||
+        m_version > kTraceVersion) {
+        throw std::invalid_argument("not a trace of a supported version");
+    }
+}
+
+std::optional<TraceRecord> TraceReader::next() {
+    while (m_position == m_records.size()) {
+        if (m_ended || !read_block()) {
+            m_ended = true;
+            return std::nullopt;
+        }
+    }
+    return m_records[m_position++];
+}
+
+bool TraceReader::read_block() {
+    std::array<std::uint8_t, kBlockHeaderSize> header{};
+    m_in.read(reinterpret_cast<char*>(header.data()), header.size());
+    if (m_in.gcount() == 0) {
+        // Trace cut short, e.g. the process was killed before closing it
+        return false;
+    }
+    if (!m_in) {
+        throw std::out_of_range("trace ends in a block header");
+    }
+    std::uint32_t const count = get_u32(header.data());
+    std::uint32_t const stored = get_u32(header.data() + 4U);
+    if (count == 0U) {
+        return false;
+    }
+    std::size_t const record_size = m_version == 1U ? kRecordSizeV1 : kRecordSize;
+    if (count > TraceWriter::kBlockRecords || stored > count * record_size) {
+        throw std::invalid_argument("corrupted trace block");
+    }
+    m_stored.resize(stored);
+    m_in.read(reinterpret_cast<char*>(m_stored.data()), stored);
+    if (!m_in) {
+        throw std::out_of_range("trace ends in a block");
+    }
+
+    std::vector<std::uint8_t> raw(count * record_size);
+    if ((header[8] & kCompressed) != 0U) {
+        lz_decompress(m_stored.data(), m_stored.size(), raw.data(), raw.size());
+    } else if (stored == raw.size()) {
+        raw.swap(m_stored);
+    } else {
+        throw std::invalid_argument("corrupted trace block");
+    }
+    m_records.resize(count);
+    if (m_version == 1U) {
+        m_cycle = 0U;
+    }
+    for (std::size_t i = 0U; i < count; ++i) {
+        std::uint8_t const* const in = raw.data() + i * record_size;
+        m_records[i] = m_version == 1U ? decode_v1(in) : decode(in);
+        m_cycle += m_records[i].cycle;
+        m_records[i].cycle = m_cycle;
+    }
+    m_position = 0U;
+    return true;
+}
+
+/// Number of equal bytes at the beginning of two runs, compared 8 bytes at a time
+static std::size_t match_length(std::uint8_t const* const source, std::uint8_t const* const data, std::size_t const limit) {
+    std::size_t length = 0U;
+    while (length + sizeof(std::uint64_t) <= limit) {
+        std::uint64_t source_word{};
+        std::uint64_t data_word{};
+        std::memcpy(&source_word, source + length, sizeof(source_word));
+        std::memcpy(&data_word, data + length, sizeof(data_word));
+        std::uint64_t const difference = source_word ^ data_word;
+        if (difference != 0U) {
+            if constexpr (std::endian::native == std::endian::little) {
+                return length + static_cast<std::size_t>(std::countr_zero(difference)) / 8U;
+            } else {
+                return length + static_cast<std::size_t>(std::countl_zero(difference)) / 8U;
+            }
+        }
+        length += sizeof(std::uint64_t);
+    }
+    while (length < limit && source[length] == data[length]) {
+        ++length;
+    }
+    return length;
+}
+
+/// Write a length beyond what fits in the 4 bits of the token
+static std::uint8_t* put_length(std::size_t length, std::uint8_t* out) {
+    while (length >= 255U) {
+        *out++ = 255U;
+        length -= 255U;
+    }
+    *out++ = static_cast<std::uint8_t>(length);
+    return out;
+}
+
+/// Write a sequence: token, literals and the back reference, if any
+/// @return end of the sequence written
+static std::uint8_t* put_sequence(std::uint8_t const* literals, std::size_t const literal_count, std::size_t const offset,
+                                  std::size_t const match, std::uint8_t* out) {
+    std::size_t const match_code = match == 0U ? 0U : match - kMinMatch;
+    *out++ = static_cast<std::uint8_t>((std::min<std::size_t>(literal_count, 15U) << 4) |
+                                       std::min<std::size_t>(match_code, 15U));
+    if (literal_count >= 15U) {
+        out = put_length(literal_count - 15U, out);
+    }
+    std::memcpy(out, literals, literal_count);
+    out += literal_count;
+    if (match == 0U) {
+        return out;
+    }
+    *out++ = static_cast<std::uint8_t>(offset);
+    *out++ = static_cast<std::uint8_t>(offset >> 8);
+    if (match_code >= 15U) {
+        out = put_length(match_code - 15U, out);
+    }
+    return out;
+}
+
+LzCompressor::LzCompressor() : m_seen(std::size_t{1U} << kHashBits) {}
+
+std::size_t LzCompressor::compress(std::uint8_t const* const data, std::size_t const size, std::uint8_t* const out) {
+    if (size >= std::numeric_limits<std::uint32_t>::max() - m_offset) {
+        std::fill(m_seen.begin(), m_seen.end(), 0U);
+        m_offset = 0U;
+    }
+    std::uint8_t* end = out;
+    std::size_t anchor = 0U;
+    std::size_t position = 0U;
+    while (position + kMinMatch <= size) {
+        std::uint32_t sequence{};
+        std::memcpy(&sequence, data + position, sizeof(sequence));
+        std::uint32_t const hash = (sequence * 2654435761U) >> (32U - kHashBits);
+        std::uint32_t const seen = m_seen[hash];
+        m_seen[hash] = static_cast<std::uint32_t>(m_offset + position + 1U);
+        // Positions of earlier calls are at or below the offset
+        if (seen <= m_offset) {
+            ++position;
+            continue;
+        }
+        std::size_t const source = seen - m_offset - 1U;
+        if (position - source > 0xFFFFU || std::memcmp(data + source, data + position, kMinMatch) != 0) {
+            ++position;
+            continue;
+        }
+        std::size_t const match = kMinMatch + match_length(data + source + kMinMatch, data + position + kMinMatch,
+                                                           size - position - kMinMatch);
+        end = put_sequence(data + anchor, position - anchor, position - source, match, end);
+        position += match;
+        anchor = position;
+    }
+    end = put_sequence(data + anchor, size - anchor, 0U, 0U, end);
+    m_offset = static_cast<std::uint32_t>(m_offset + size);
+    return static_cast<std::size_t>(end - out);
+}
+
+void lz_compress(std::uint8_t const* const data, std::size_t const size, std::vector<std::uint8_t>& out) {
+    LzCompressor compressor{};
+    std::size_t const start = out.size();
+    out.resize(start + lz_bound(size));
+    out.resize(start + compressor.compress(data, size, out.data() + start));
+}
+
+/// Read a length beyond the 4 bits of the token
+static std::size_t get_length(std::uint8_t const*& in, std::uint8_t const* const end) {
+    std::size_t length = 0U;
+    std::uint8_t byte = 255U;
+    while (byte == 255U) {
+        if (in == end) {
+            throw std::invalid_argument("corrupted compressed data");
+        }
+        byte = *in++;
+        length += byte;
+    }
+    return length;
+}
+
+void lz_decompress(std::uint8_t const* data, std::size_t const size, std::uint8_t* const out, std::size_t const expected) {
+    std::uint8_t const* const end = data + size;
+    std::size_t written = 0U;
+    while (data != end) {
+        std::uint8_t const token = *data++;
+        std::size_t literals = token >> 4;
+        if (literals == 15U) {
+            literals += get_length(data, end);
+        }
+        if (literals > static_cast<std::size_t>(end - data) || literals > expected - written) {
+            throw std::invalid_argument("corrupted compressed data");
+        }
+        std::memcpy(out + written, data, literals);
+        data += literals;
+        written += literals;
+        if (data == end) {
+            break;
+        }
+        if (end - data < 2) {
+            throw std::invalid_argument("corrupted compressed data");
+        }
+        std::size_t const offset = static_cast<std::size_t>(data[0] | (data[1] << 8));
+        data += 2;
+        std::size_t match = (token & 0x0FU) + kMinMatch;
+        if ((token & 0x0FU) == 15U) {
+            match += get_length(data, end);
+        }
+        if (offset == 0U || offset > written || match > expected - written) {
+            throw std::invalid_argument("corrupted compressed data");
+        }
+        // Byte by byte, the reference may overlap the bytes it produces
+        for (std::size_t i = 0U; i < match; ++i) {
+            out[written + i] = out[written + i - offset];
+        }
+        written += match;
+    }
+    if (written != expected) {
+        throw std::invalid_argument("corrupted compressed data");
+    }
+}
+
+/// Append a byte as two hexadecimal digits
+static void put_hex(std::string& text, std::uint8_t const byte, bool const lower = false) {
+    constexpr std::string_view kUpper{"0123456789ABCDEF"};
+    constexpr std::string_view kLower{"0123456789abcdef"};
+    std::string_view const digits = lower ? kLower : kUpper;
+    text += digits[byte >> 4];
+    text += digits[byte & 0x0FU];
+}
+
+/// Instruction as assembly, e.g. "LDA ($12),Y"
+static std::string disassemble(TraceRecord const& record, OpcodeInfo const& info) {
+    std::string text{mnemonic_name(info.mnemonic)};
+    std::string_view const operand = address_mode_name(info.mode);
+    if (operand.empty()) {
+        return text;
+    }
+    text += ' ';
+    std::size_t const field = operand.find_first_of("nr");
+    if (field == std::string_view::npos) {
+        text += operand;
+        return text;
+    }
+    text += operand.substr(0U, field);
+    if (operand[field] == 'r') {
+        auto const displacement = static_cast<std::int8_t>(record.operand_lo);
+        auto const target = static_cast<std::uint16_t>(record.pc + info.length + displacement);
+        put_hex(text, static_cast<std::uint8_t>(target >> 8));
+        put_hex(text, static_cast<std::uint8_t>(target));
+        text += operand.substr(field + 2U);
+    } else if (operand.substr(field).starts_with("nnnn")) {
+        put_hex(text, record.operand_hi);
+        put_hex(text, record.operand_lo);
+        text += operand.substr(field + 4U);
+    } else {
+        put_hex(text, record.operand_lo);
+        text += operand.substr(field + 2U);
+    }
+    return text;
+}
+
+std::string format_trace(TraceRecord const& record, TraceFormat const format, std::array<OpcodeInfo, 256> const& opcodes) {
+    OpcodeInfo const& info = opcodes[record.opcode];
+    bool const vice = format == TraceFormat::Vice;
+    std::string line{vice ? ".C:" : ""};
+    put_hex(line, static_cast<std::uint8_t>(record.pc >> 8), vice);
+    put_hex(line, static_cast<std::uint8_t>(record.pc), vice);
+    line += "  ";
+
+    // Interrupts show no bytes, only their name in place of the assembly
+    bool const instruction = record.entry == TraceEntry::Instruction;
+    std::array<std::uint8_t, 3> const bytes{record.opcode, record.operand_lo, record.operand_hi};
+    for (std::size_t i = 0U; i < 3U; ++i) {
+        if (instruction && i < std::max<std::size_t>(info.length, 1U)) {
+            put_hex(line, bytes[i]);
+            line += ' ';
+        } else {
+            line += "   ";
+        }
+    }
+    line += ' ';
+
+    std::string const assembly = instruction ? disassemble(record, info)
+                                             : std::string{record.entry == TraceEntry::Nmi ? "NMI" : "IRQ"};
+    line += assembly;
+    line.append(assembly.size() < (vice ? 15U : 32U) ? (vice ? 15U : 32U) - assembly.size() : 1U, ' ');
+
+    if (vice) {
+        line += "- A:";
+        put_hex(line, record.ac);
+        line += " X:";
+        put_hex(line, record.xi);
+        line += " Y:";
+        put_hex(line, record.yi);
+        line += " SP:";
+        put_hex(line, record.sp, true);
+        line += ' ';
+        constexpr std::string_view kFlags{"NV-BDIZC"};
+        for (std::size_t bit = 0U; bit < kFlags.size(); ++bit) {
+            bool const set = (record.sr & (0x80U >> bit)) != 0U;
+            line += bit == 2U ? '-' : (set ? kFlags[bit] : '.');
+        }
+        std::string const cycle = std::to_string(record.cycle);
+        line.append(cycle.size() < 8U ? 8U - cycle.size() : 1U, ' ');
+        line += cycle;
+    } else {
+        line += "A:";
+        put_hex(line, record.ac);
+        line += " X:";
+        put_hex(line, record.xi);
+        line += " Y:";
+        put_hex(line, record.yi);
+        line += " P:";
+        put_hex(line, record.sr);
+        line += " SP:";
+        put_hex(line, record.sp);
+        line += " CYC:";
+        line += std::to_string(record.cycle);
+    }
+    return line;
+}
+}
@@ -1,10 +1,29 @@
 #define ANKERL_NANOBENCH_IMPLEMENT
 #include "nanobench.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
 #include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "mos6502/bus.hpp"
+#include "mos6502/cow_bus.hpp"
 #include "mos6502/cpu.hpp"
+#include "mos6502/cpu_batch.hpp"
+#include "mos6502/paged_bus.hpp"
+#include "mos6502/rewind.hpp"
+#include "mos6502/scheduler.hpp"
+#include "mos6502/snapshot.hpp"
+#include "mos6502/trace.hpp"
 
 class BenchBus final : public mos6502::IBus {
 public:
@@ -36,38 +55,341 @@ void BenchBus::write(std::uint16_t addr, std::uint8_t data) {
 
 #define INSTRUCTION_BENCHMARK(name, opcode) \
 { \
-    std::shared_ptr<BenchBus> a_bus{new BenchBus{0xE0}}; \
-    std::shared_ptr<mos6502::Cpu<BenchBus>> a_cpu{new mos6502::Cpu<BenchBus>{a_bus}}; \
-    std::shared_ptr<mos6502::Cpu<mos6502::IBus>> a_vcpu{new mos6502::Cpu<mos6502::IBus>{a_bus}}; \
+    BenchBus a_bus{opcode}; \
+    mos6502::Cpu<BenchBus> a_cpu{a_bus}; \
+    mos6502::Cpu<BenchBus, mos6502::ThreadedCpuTraits> a_tcpu{a_bus}; \
+    mos6502::Cpu<mos6502::IBus> a_vcpu{a_bus}; \
     std::stringstream title{}; \
     title << "instruction " << name << " on concrete bus"; \
-    benchmark.run(title.str(), [&] { a_cpu->step(); }); \
+    benchmark.run(title.str(), [&] { a_cpu.step(); }); \
+    title = std::stringstream{}; \
+    title << "instruction " << name << " on concrete bus with threaded dispatch"; \
+    benchmark.run(title.str(), [&] { a_tcpu.step(); }); \
     title = std::stringstream{}; \
     title << "instruction " << name << " on virtual bus"; \
-    benchmark.run(title.str(), [&] { a_vcpu->step(); }); \
+    benchmark.run(title.str(), [&] { a_vcpu.step(); }); \
 } \
 
+#define PAGED_INSTRUCTION_BENCHMARK(name, opcode) \
+{ \
+    mos6502::PagedBus a_bus{}; \
+    a_bus.ram().fill(opcode); \
+    mos6502::Cpu<mos6502::PagedBus> a_cpu{a_bus}; \
+    std::stringstream title{}; \
+    title << "instruction " << name << " on paged bus"; \
+    benchmark.run(title.str(), [&] { a_cpu.step(); }); \
+} \
+
+/// Print the instruction mix of a program image loaded at the end of the address space, so it
+/// starts from its own reset vector, e.g. mos6502_bench --mix rom.bin 10000000
+static int print_instruction_mix(char const* path, std::uint64_t const cycles) {
+    std::ifstream in{path, std::ios::binary};
+    std::vector<std::uint8_t> const image{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    if (image.empty() || image.size() > 0x10000U) {
+        std::cerr << "can not load a program image of at most 64KiB from " << path << '\n';
+        return 1;
+    }
+
+    mos6502::PagedBus bus{};
+    std::copy(image.begin(), image.end(), bus.ram().end() - static_cast<std::ptrdiff_t>(image.size()));
+    mos6502::Cpu<mos6502::PagedBus, mos6502::InstrumentedCpuTraits> cpu{bus};
+    cpu.signal_reset();
+    cpu.run_cycles(cycles);
+    cpu.instruction_stats().dump(std::cout);
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
-    static_cast<void>(argc);
-    static_cast<void>(argv);
+    if (argc >= 3 && std::string_view{argv[1]} == "--mix") {
+        return print_instruction_mix(argv[2], argc >= 4 ? std::stoull(argv[3]) : 10'000'000U);
+    }
+
     auto benchmark = ankerl::nanobench::Bench();
     benchmark.minEpochIterations(2'000'000U);
+    bool failed = false;
+
+    {
+        BenchBus bus{0xE0};
+        mos6502::IBus& ibus{bus};
+        benchmark.run("Direct Bus Read", [&] { static_cast<void>(bus.read(0x00)); });
+        benchmark.run("Virtual Bus Read", [&] { static_cast<void>(ibus.read(0x00)); });
+    }
+
+    {
+        BenchBus bus{0xE0};
+        mos6502::IBus& ibus{bus};
+        benchmark.run("Direct Bus Write", [&] { static_cast<void>(bus.write(0x00, 0x00)); });
+        benchmark.run("Virtual Bus Write", [&] { static_cast<void>(ibus.write(0x00, 0x00)); });
+    }
+
+    {
+        BenchBus bus{0xEA};
+        auto shared = std::make_shared<BenchBus>(0xEA);
+        benchmark.run("Construct Cpu sharing the bus", [&] {
+            mos6502::Cpu<BenchBus> cpu{shared};
+            ankerl::nanobench::doNotOptimizeAway(cpu.regs());
+        });
+        benchmark.run("Construct Cpu referencing the bus", [&] {
+            mos6502::Cpu<BenchBus> cpu{bus};
+            ankerl::nanobench::doNotOptimizeAway(cpu.regs());
+        });
+    }
+
+    {
+        mos6502::PagedBus bus{};
+        mos6502::IBus& ibus{bus};
+        benchmark.run("Paged Bus Read", [&] { static_cast<void>(bus.read(0x00)); });
+        benchmark.run("Virtual Paged Bus Read", [&] { static_cast<void>(ibus.read(0x00)); });
+    }
+
+    {
+        // Countdown loop: LDX #$00; DEX; BNE *-1; JMP $0000
+        mos6502::PagedBus bus{};
+        auto& ram = bus.ram();
+        ram[0x00] = 0xA2;
+        ram[0x01] = 0x00;
+        ram[0x02] = 0xCA;
+        ram[0x03] = 0xD0;
+        ram[0x04] = 0xFD;
+        ram[0x05] = 0x4C;
+        ram[0x06] = 0x00;
+        ram[0x07] = 0x00;
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        mos6502::Cpu<mos6502::PagedBus, mos6502::ThreadedCpuTraits> tcpu{bus};
+        mos6502::Cpu<mos6502::PagedBus, mos6502::BlockCacheCpuTraits> bcpu{bus};
+        mos6502::Cpu<mos6502::PagedBus, mos6502::JitCpuTraits> jcpu{bus};
+        mos6502::Cpu<mos6502::PagedBus, mos6502::LazyFlagsCpuTraits> lcpu{bus};
+        mos6502::Cpu<mos6502::PagedBus, mos6502::InstrumentedCpuTraits> icpu{bus};
+        mos6502::Cpu<mos6502::IBus> vcpu{bus};
+        mos6502::Cpu<mos6502::IBus, mos6502::BlockCacheCpuTraits> vbcpu{bus};
+
+        constexpr std::uint64_t kBudget = 1024U;
+        auto batch = ankerl::nanobench::Bench().minEpochIterations(20'000U).batch(kBudget).unit("cycle");
+        batch.run("loop by step on paged bus", [&] {
+            std::uint64_t cycles{};
+            while (cycles < kBudget) {
+                cycles += cpu.step();
+            }
+        });
+        batch.run("loop by run_cycles on paged bus", [&] { static_cast<void>(cpu.run_cycles(kBudget)); });
+        batch.run("loop by run_cycles on paged bus with threaded dispatch", [&] { static_cast<void>(tcpu.run_cycles(kBudget)); });
+        batch.run("loop by run_cycles on paged bus with block cache", [&] { static_cast<void>(bcpu.run_cycles(kBudget)); });
+        batch.run("loop by run_cycles on paged bus with jit", [&] { static_cast<void>(jcpu.run_cycles(kBudget)); });
+        batch.run("loop by run_cycles on paged bus with lazy flags", [&] { static_cast<void>(lcpu.run_cycles(kBudget)); });
+        batch.run("loop by run_cycles on paged bus with instruction counters", [&] { static_cast<void>(icpu.run_cycles(kBudget)); });
+        batch.run("loop by run_cycles on virtual bus", [&] { static_cast<void>(vcpu.run_cycles(kBudget)); });
+        batch.run("loop by run_cycles on virtual bus with block cache", [&] { static_cast<void>(vbcpu.run_cycles(kBudget)); });
+
+        constexpr std::size_t kLanes = 16U;
+        auto lanes = std::make_unique<mos6502::CpuBatch<kLanes>>();
+        lanes->load(0x0000, std::span<std::uint8_t const>{ram.data(), 8U});
+        ankerl::nanobench::Bench().minEpochIterations(2'000U).batch(kBudget * kLanes).unit("cycle")
+            .run("loop by run_cycles on a batch of 16 lanes", [&] { lanes->run_cycles(kBudget); });
+    }
+
+    {
+        // Countdown loop with a timer expiring every 256 cycles, polled by the host or scheduled
+        mos6502::PagedBus bus{};
+        auto& ram = bus.ram();
+        ram[0x00] = 0xA2;
+        ram[0x01] = 0x00;
+        ram[0x02] = 0xCA;
+        ram[0x03] = 0xD0;
+        ram[0x04] = 0xFD;
+        ram[0x05] = 0x4C;
+        ram[0x06] = 0x00;
+        ram[0x07] = 0x00;
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        mos6502::Scheduler scheduler{};
+
+        constexpr std::uint64_t kBudget = 4096U;
+        constexpr std::uint64_t kPeriod = 256U;
+        std::uint64_t expired{};
+        auto batch = ankerl::nanobench::Bench().minEpochIterations(5'000U).batch(kBudget).unit("cycle");
+        batch.run("timer polled after every step", [&] {
+            std::uint64_t cycles{};
+            std::uint64_t next = cpu.cycles() + kPeriod;
+            while (cycles < kBudget) {
+                cycles += cpu.step();
+                if (cpu.cycles() >= next) {
+                    ++expired;
+                    next += kPeriod;
+                }
+            }
+        });
+
+        std::function<void(std::uint64_t)> timer = [&](std::uint64_t due) {
+            ++expired;
+            scheduler.schedule(due + kPeriod, timer);
+        };
+        scheduler.schedule(cpu.cycles() + kPeriod, timer);
+        batch.run("timer fired by the scheduler", [&] { static_cast<void>(scheduler.run_cycles(cpu, kBudget)); });
+        ankerl::nanobench::doNotOptimizeAway(expired);
+    }
 
     {
-        std::shared_ptr<BenchBus> bus{new BenchBus{0xE0}};
-        std::shared_ptr<mos6502::IBus> ibus{bus};
-        benchmark.run("Direct Bus Read", [&] { static_cast<void>(bus->read(0x00)); });
-        benchmark.run("Virtual Bus Read", [&] { static_cast<void>(ibus->read(0x00)); });
+        // Countdown loop traced into a stream discarding the bytes: LDX #$00; DEX; BNE *-1; JMP $0000
+        // runs 514 instructions every 1284 cycles
+        class NullBuffer final : public std::streambuf {
+        protected:
+            int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
+            std::streamsize xsputn(char const*, std::streamsize count) override { return count; }
+        };
+        mos6502::PagedBus bus{};
+        auto& ram = bus.ram();
+        ram[0x00] = 0xA2;
+        ram[0x01] = 0x00;
+        ram[0x02] = 0xCA;
+        ram[0x03] = 0xD0;
+        ram[0x04] = 0xFD;
+        ram[0x05] = 0x4C;
+        ram[0x06] = 0x00;
+        ram[0x07] = 0x00;
+        mos6502::Cpu<mos6502::PagedBus, mos6502::TracingCpuTraits> cpu{bus};
+
+        // Each run writes the whole trace and closes it, waiting for the writer rather than dropping
+        // records, so the rate is the one sustained with every record kept
+        constexpr std::uint64_t kLoops = 8'000U;
+        constexpr std::uint64_t kInstructions = kLoops * 514U;
+        constexpr double kRequiredRate = 50e6;
+        auto batch = ankerl::nanobench::Bench().epochs(5U).epochIterations(1U).batch(kInstructions).unit("instruction");
+        for (bool const compress : {false, true}) {
+            std::uint64_t dropped = 0U;
+            std::uint64_t waits = 0U;
+            std::uint64_t runs = 0U;
+            std::chrono::duration<double> elapsed{};
+            batch.run(compress ? "loop traced with compression" : "loop traced", [&] {
+                auto const start = std::chrono::steady_clock::now();
+                NullBuffer buffer{};
+                std::ostream sink{&buffer};
+                mos6502::TraceWriter writer{sink, compress, mos6502::TraceWriter::kDefaultCapacity,
+                                            mos6502::TraceOverflow::Wait};
+                cpu.trace_to(&writer);
+                static_cast<void>(cpu.run_cycles(kLoops * 1284U));
+                cpu.trace_to(nullptr);
+                writer.close();
+                elapsed += std::chrono::steady_clock::now() - start;
+                dropped += writer.dropped();
+                waits += writer.waits();
+                ++runs;
+            });
+            double const rate = static_cast<double>(kInstructions * runs) / elapsed.count();
+            std::cout << "instructions traced per second: " << rate << ", records dropped: " << dropped
+                      << ", waits for the writer: " << waits << '\n';
+            if (!compress && (dropped != 0U || rate < kRequiredRate)) {
+                std::cerr << "trace below " << kRequiredRate << " instructions per second without drops\n";
+                failed = true;
+            }
+        }
     }
 
     {
-        std::shared_ptr<BenchBus> bus{new BenchBus{0xE0}};
-        std::shared_ptr<mos6502::IBus> ibus{bus};
-        benchmark.run("Direct Bus Write", [&] { static_cast<void>(bus->write(0x00, 0x00)); });
-        benchmark.run("Virtual Bus Write", [&] { static_cast<void>(ibus->write(0x00, 0x00)); });
+        // Arithmetic loop: LDX #$00; CLC; ADC #$35; SBC #$12; CMP #$40; CPX #$80; BIT $00; DEX; BNE *-15; JMP $0000
+        mos6502::PagedBus bus{};
+        std::array<std::uint8_t, 21> const program{
+            0xA2, 0x00, 0x18, 0x69, 0x35, 0xE9, 0x12, 0xC9, 0x40, 0xE0, 0x80,
+            0x24, 0x00, 0xCA, 0xD0, 0xF2, 0x4C, 0x00, 0x00, 0x00, 0x00};
+        std::copy(program.begin(), program.end(), bus.ram().begin());
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        mos6502::Cpu<mos6502::PagedBus, mos6502::X86AluCpuTraits> x86cpu{bus};
+
+        constexpr std::uint64_t kBudget = 1024U;
+        auto batch = ankerl::nanobench::Bench().minEpochIterations(20'000U).batch(kBudget).unit("cycle");
+        batch.run("arithmetic loop with portable alu", [&] { static_cast<void>(cpu.run_cycles(kBudget)); });
+        batch.run("arithmetic loop with x86 alu", [&] { static_cast<void>(x86cpu.run_cycles(kBudget)); });
     }
 
+    {
+        // Score loop: SED; CLC; LDA $F0; ADC #$25; STA $F0; SEC; SBC #$13; CLD; JMP $0000
+        struct NmosDecimalCpuTraits : mos6502::CpuTraits {
+            using Decimal = mos6502::NmosDecimal;
+        };
+        mos6502::PagedBus bus{};
+        std::array<std::uint8_t, 16> const program{
+            0xF8, 0x18, 0xA5, 0xF0, 0x69, 0x25, 0x85, 0xF0, 0x38, 0xE9, 0x13, 0xD8, 0x4C, 0x00, 0x00, 0x00};
+        std::copy(program.begin(), program.end(), bus.ram().begin());
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        mos6502::Cpu<mos6502::PagedBus, NmosDecimalCpuTraits> nmos{bus};
+
+        constexpr std::uint64_t kBudget = 1024U;
+        auto batch = ankerl::nanobench::Bench().minEpochIterations(20'000U).batch(kBudget).unit("cycle");
+        batch.run("decimal loop with cmos flags", [&] { static_cast<void>(cpu.run_cycles(kBudget)); });
+        batch.run("decimal loop with nmos flags", [&] { static_cast<void>(nmos.run_cycles(kBudget)); });
+    }
+
+    {
+        mos6502::PagedBus bus{};
+        bus.map_io(0xD0, 16U);
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        std::vector<std::uint8_t> buffer(decltype(cpu)::kSnapshotSize + mos6502::PagedBus::kSnapshotSize);
+
+        auto snapshot = ankerl::nanobench::Bench().minEpochIterations(20'000U);
+        snapshot.run("save snapshot of paged bus", [&] {
+            mos6502::SnapshotWriter writer{buffer};
+            cpu.save(writer);
+        });
+        snapshot.run("restore snapshot of paged bus", [&] {
+            mos6502::SnapshotReader reader{buffer};
+            cpu.restore(reader);
+        });
+    }
+
+    {
+        mos6502::PagedBus paged{};
+        std::vector<std::uint8_t> copy(paged.ram().size());
+        auto bus = std::make_shared<mos6502::CowBus>();
+        for (std::uint32_t addr = 0U; addr < 0x10000U; ++addr) {
+            bus->write(static_cast<std::uint16_t>(addr), static_cast<std::uint8_t>(addr));
+        }
+        mos6502::Cpu<mos6502::CowBus> cpu{bus};
+
+        auto fork = ankerl::nanobench::Bench().minEpochIterations(20'000U);
+        fork.run("copy 64KiB of paged bus", [&] {
+            std::copy(paged.ram().begin(), paged.ram().end(), copy.begin());
+            ankerl::nanobench::doNotOptimizeAway(copy.data());
+        });
+        fork.run("fork copy-on-write bus", [&] {
+            mos6502::CowBus child = bus->fork();
+            ankerl::nanobench::doNotOptimizeAway(child.read_page(0x00));
+        });
+        fork.run("clone Cpu and write one page", [&] {
+            auto child = cpu.clone();
+            child.bus().write(0x0200, 0x2A);
+            ankerl::nanobench::doNotOptimizeAway(child.regs());
+        });
+    }
+
+    {
+        mos6502::PagedBus bus{};
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        mos6502::RewindBuffer<mos6502::PagedBus> rewind{cpu, 4U * 1024U * 1024U, 3600U};
+        std::uint8_t value{};
+        auto const write_pages = [&] {
+            ++value;
+            for (std::uint32_t addr = 0x0200U; addr < 0x0A00U; addr += 0x40U) {
+                bus.write(static_cast<std::uint16_t>(addr), value);
+            }
+        };
+
+        auto frames = ankerl::nanobench::Bench().minEpochIterations(20'000U);
+        frames.run("push rewind frame of 8 pages written", [&] {
+            write_pages();
+            rewind.push();
+        });
+        frames.run("push and rewind frame of 8 pages written", [&] {
+            write_pages();
+            rewind.push();
+            rewind.rewind(1U);
+        });
+    }
+
+    PAGED_INSTRUCTION_BENCHMARK("LDA_ZPG",   0xA5);
+    PAGED_INSTRUCTION_BENCHMARK("LDA_ABS_X", 0xBD);
+    PAGED_INSTRUCTION_BENCHMARK("LDA_IND_Y", 0xB1);
+    PAGED_INSTRUCTION_BENCHMARK("ADC_ZPG",   0x65);
+    PAGED_INSTRUCTION_BENCHMARK("CMP_IMM",   0xC9);
+
     INSTRUCTION_BENCHMARK("BRK", 0x00);
     INSTRUCTION_BENCHMARK("BPL", 0x10);
     INSTRUCTION_BENCHMARK("JSR", 0x20);
@@ -103,7 +425,7 @@ int main(int argc, char** argv)
 
     INSTRUCTION_BENCHMARK("LDX_IMM", 0xA2);
 
-    INSTRUCTION_BENCHMARK("BIT_ZPG",   0x14);
+    INSTRUCTION_BENCHMARK("BIT_ZPG",   0x24);
     INSTRUCTION_BENCHMARK("STY_ZPG",   0x84);
     INSTRUCTION_BENCHMARK("STY_ZPG_X", 0x94);
     INSTRUCTION_BENCHMARK("LDY_ZPG",   0xA4);
@@ -231,5 +553,5 @@ int main(int argc, char** argv)
     INSTRUCTION_BENCHMARK("INC_ABS",   0xEE);
     INSTRUCTION_BENCHMARK("INC_ABS_X", 0xFE);
 
-    return 0;
+    return failed ? 1 : 0;
 }
@@ -1,18 +1,43 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <iomanip>
 #include <memory>
+#include <span>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "mos6502/bus.hpp"
+#include "mos6502/call_stack.hpp"
+#include "mos6502/clock_sync.hpp"
+#include "mos6502/cow_bus.hpp"
 #include "mos6502/cpu.hpp"
+#include "mos6502/cpu_batch.hpp"
+#include "mos6502/event_log.hpp"
+#include "mos6502/jit_differential.hpp"
+#include "mos6502/paged_bus.hpp"
+#include "mos6502/profiler.hpp"
 #include "mos6502/regs.hpp"
+#include "mos6502/rewind.hpp"
+#include "mos6502/scheduler.hpp"
+#include "mos6502/snapshot.hpp"
+#include "mos6502/spsc_ring.hpp"
 #include "mos6502/status.hpp"
+#include "mos6502/symbols.hpp"
+#include "mos6502/timeline.hpp"
+#include "mos6502/trace.hpp"
 
 class MockBus final : public mos6502::IBus {
 public:
@@ -48,6 +73,39 @@ std::uint8_t MockBus::readWrittenValue(std::uint16_t addr) {
     return write_map.at(addr);
 }
 
+class RamBus {
+public:
+    std::uint8_t read(std::uint16_t addr);
+
+    void write(std::uint16_t addr, std::uint8_t data);
+
+    std::array<std::uint8_t, 0x10000> memory{};
+    std::size_t reads{};
+    std::size_t writes{};
+};
+
+std::uint8_t RamBus::read(std::uint16_t addr) {
+    ++reads;
+    return memory[addr];
+}
+
+void RamBus::write(std::uint16_t addr, std::uint8_t data) {
+    ++writes;
+    memory[addr] = data;
+}
+
+class RamBusWithFetch16 final : public RamBus {
+public:
+    std::uint16_t fetch16(std::uint16_t addr);
+
+    std::size_t fetches{};
+};
+
+std::uint16_t RamBusWithFetch16::fetch16(std::uint16_t addr) {
+    ++fetches;
+    return static_cast<std::uint16_t>(memory[addr] | (memory[static_cast<std::uint16_t>(addr + 1U)] << 8));
+}
+
 class CpuFixture {
 public:
     CpuFixture();
@@ -390,6 +448,41 @@ TEST_CASE_FIXTURE(CpuFixture, "Instruction Decimal ADC" ) {
     REQUIRE(m_cpu.regs().ac == 0x11);
 }
 
+TEST_CASE_FIXTURE(CpuFixture, "Instruction Decimal SBC" ) {
+    m_bus->mockAddressValue(0x00, 0xF8); // SED
+    m_bus->mockAddressValue(0x01, 0x38); // SEC
+
+    m_bus->mockAddressValue(0x02, 0xA9); // LDA
+    m_bus->mockAddressValue(0x03, 0x42); // IMM
+
+    m_bus->mockAddressValue(0x04, 0xE9); // SBC
+    m_bus->mockAddressValue(0x05, 0x13); // IMM
+
+    m_bus->mockAddressValue(0x06, 0xE9); // SBC
+    m_bus->mockAddressValue(0x07, 0x30); // IMM
+
+    m_bus->mockAddressValue(0x08, 0xE9); // SBC
+    m_bus->mockAddressValue(0x09, 0x98); // IMM
+
+    REQUIRE(m_cpu.step() == 2U); // SED
+    REQUIRE(m_cpu.step() == 2U); // SEC
+    REQUIRE(m_cpu.step() == 2U); // LDA
+    REQUIRE(m_cpu.step() == 2U); // SBC
+
+    REQUIRE(m_cpu.regs().ac == 0x29);
+    REQUIRE(m_cpu.regs().sr == (mos6502::U | mos6502::B | mos6502::D | mos6502::C));
+
+    REQUIRE(m_cpu.step() == 2U); // SBC
+
+    REQUIRE(m_cpu.regs().ac == 0x99);
+    REQUIRE(m_cpu.regs().sr == (mos6502::U | mos6502::B | mos6502::D | mos6502::N));
+
+    REQUIRE(m_cpu.step() == 2U); // SBC
+
+    REQUIRE(m_cpu.regs().ac == 0x00);
+    REQUIRE(m_cpu.regs().sr == (mos6502::U | mos6502::B | mos6502::D | mos6502::Z | mos6502::C));
+}
+
 TEST_CASE_FIXTURE(CpuFixture, "Instruction SBC" ) {
     m_bus->mockAddressValue(0x00, 0xE9); // SBC
     m_bus->mockAddressValue(0x01, 0x00); // IMM
@@ -1803,3 +1896,2521 @@ TEST_CASE_FIXTURE(CpuFixture, "Instruction BVS,BVC" ) {
     REQUIRE(m_cpu.step() == 2U);
     REQUIRE(m_cpu.regs().pc == 2U);
 }
+
+TEST_CASE_FIXTURE(CpuFixture, "Threaded dispatch matches switch dispatch" ) {
+    mos6502::Cpu<MockBus, mos6502::ThreadedCpuTraits> threaded{m_bus};
+
+    m_bus->mockAddressValue(0x00, 0xA2); // LDX
+    m_bus->mockAddressValue(0x01, 0x03); // IMM
+    m_bus->mockAddressValue(0x02, 0xA9); // LDA
+    m_bus->mockAddressValue(0x03, 0x10); // IMM
+    m_bus->mockAddressValue(0x04, 0x69); // ADC
+    m_bus->mockAddressValue(0x05, 0x25); // IMM
+    m_bus->mockAddressValue(0x06, 0x95); // STA
+    m_bus->mockAddressValue(0x07, 0x20); // ZPG,X
+    m_bus->mockAddressValue(0x08, 0x0A); // ASL
+    m_bus->mockAddressValue(0x09, 0xCA); // DEX
+    m_bus->mockAddressValue(0x0A, 0xD0); // BNE
+    m_bus->mockAddressValue(0x0B, 0xF8); // REL (-8)
+    m_bus->mockAddressValue(0x0C, 0x38); // SEC
+    m_bus->mockAddressValue(0x0D, 0xE9); // SBC
+    m_bus->mockAddressValue(0x0E, 0x01); // IMM
+    m_bus->mockAddressValue(0x0F, 0xEA); // NOP
+    m_bus->mockAddressValue(0x10, 0xEA); // NOP
+    m_bus->mockAddressValue(0x11, 0xEA); // NOP
+
+    for (int i = 0; i < 20; ++i) {
+        REQUIRE(threaded.step() == m_cpu.step());
+        REQUIRE(threaded.regs() == m_cpu.regs());
+    }
+
+    REQUIRE(m_cpu.regs().pc == 0x10);
+    REQUIRE(m_bus->readWrittenValue(0x21) == 0x44);
+}
+
+TEST_CASE("Opcode table" ) {
+    std::size_t documented{};
+    for (auto const& info : mos6502::kOpcodeTable) {
+        if (info.mnemonic == mos6502::Mnemonic::ILL) {
+            REQUIRE(info.length == 0U);
+            continue;
+        }
+        ++documented;
+        REQUIRE(info.length >= 1U);
+        REQUIRE(info.length <= 3U);
+        REQUIRE(info.cycles >= 2U);
+        REQUIRE(info.cycles <= 7U);
+    }
+    REQUIRE(documented == 151U);
+
+    REQUIRE(mos6502::kOpcodeTable[0x6C].mode == mos6502::AddressMode::Indirect);
+    REQUIRE(mos6502::kOpcodeTable[0xD5].cycles == 4U);
+    REQUIRE(mos6502::kOpcodeTable[0xE1].cycles == 6U);
+    REQUIRE(mos6502::kOpcodeTable[0x9D].page_penalty == 0U);
+    REQUIRE(mos6502::kOpcodeTable[0xBD].page_penalty == 1U);
+    REQUIRE(mos6502::mnemonic_name(mos6502::kOpcodeTable[0x29].mnemonic) == "AND");
+}
+
+TEST_CASE_FIXTURE(CpuFixture, "Page crossing penalty" ) {
+    m_bus->mockAddressValue(0x00, 0xA2); // LDX
+    m_bus->mockAddressValue(0x01, 0x01); // IMM
+    m_bus->mockAddressValue(0x02, 0xBD); // LDA
+    m_bus->mockAddressValue(0x03, 0xFF); // ABS LO,X
+    m_bus->mockAddressValue(0x04, 0x10); // ABS HI,X
+    m_bus->mockAddressValue(0x05, 0xBD); // LDA
+    m_bus->mockAddressValue(0x06, 0x00); // ABS LO,X
+    m_bus->mockAddressValue(0x07, 0x11); // ABS HI,X
+    m_bus->mockAddressValue(0x08, 0xA0); // LDY
+    m_bus->mockAddressValue(0x09, 0x01); // IMM
+    m_bus->mockAddressValue(0x0A, 0xB1); // LDA
+    m_bus->mockAddressValue(0x0B, 0x40); // IND,Y
+    m_bus->mockAddressValue(0x0C, 0x9D); // STA
+    m_bus->mockAddressValue(0x0D, 0xFF); // ABS LO,X
+    m_bus->mockAddressValue(0x0E, 0x10); // ABS HI,X
+    m_bus->mockAddressValue(0x0F, 0xEA); // NOP
+    m_bus->mockAddressValue(0x10, 0xEA); // NOP
+
+    m_bus->mockAddressValue(0x40, 0xFF); // IND LO
+    m_bus->mockAddressValue(0x41, 0x20); // IND HI
+
+    m_bus->mockAddressValue(0x1100, 0x42);
+    m_bus->mockAddressValue(0x1101, 0x43);
+    m_bus->mockAddressValue(0x2100, 0x44);
+
+    REQUIRE(m_cpu.step() == 2U); // LDX
+    REQUIRE(m_cpu.step() == 5U); // LDA crossing page
+    REQUIRE(m_cpu.regs().ac == 0x42);
+    REQUIRE(m_cpu.step() == 4U); // LDA same page
+    REQUIRE(m_cpu.regs().ac == 0x43);
+    REQUIRE(m_cpu.step() == 2U); // LDY
+    REQUIRE(m_cpu.step() == 6U); // LDA crossing page
+    REQUIRE(m_cpu.regs().ac == 0x44);
+    REQUIRE(m_cpu.step() == 5U); // STA has no penalty
+    REQUIRE(m_bus->readWrittenValue(0x1100) == 0x44);
+}
+
+TEST_CASE("Instruction fetch reads only the instruction length" ) {
+    auto bus = std::make_shared<RamBus>();
+    mos6502::Cpu<RamBus> cpu{bus};
+
+    bus->memory[0x00] = 0xE8; // INX
+    bus->memory[0x01] = 0xA9; // LDA
+    bus->memory[0x02] = 0x10; // IMM
+    bus->memory[0x03] = 0xAD; // LDA
+    bus->memory[0x04] = 0x34; // ABS LO
+    bus->memory[0x05] = 0x12; // ABS HI
+    bus->memory[0x1234] = 0x55;
+
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE(bus->reads == 1U);
+
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE(bus->reads == 3U);
+
+    REQUIRE(cpu.step() == 4U);
+    REQUIRE(bus->reads == 7U);
+    REQUIRE(cpu.regs().ac == 0x55);
+}
+
+TEST_CASE("Instruction fetch uses fetch16 when available" ) {
+    static_assert(mos6502::Fetch16Bus<RamBusWithFetch16>);
+    static_assert(!mos6502::Fetch16Bus<RamBus>);
+
+    auto bus = std::make_shared<RamBusWithFetch16>();
+    mos6502::Cpu<RamBusWithFetch16> cpu{bus};
+
+    bus->memory[0x00] = 0x4C; // JMP
+    bus->memory[0x01] = 0xEF; // ABS LO
+    bus->memory[0x02] = 0xBE; // ABS HI
+
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(cpu.regs().pc == 0xBEEF);
+    REQUIRE(bus->reads == 1U);
+    REQUIRE(bus->fetches == 1U);
+}
+
+TEST_CASE("PagedBus maps RAM, ROM and I/O pages" ) {
+    auto io = std::make_shared<MockBus>();
+    mos6502::PagedBus bus{io};
+
+    std::array<std::uint8_t, 0x200> rom{};
+    rom[0x000] = 0xAB;
+    rom[0x1FF] = 0xCD;
+    bus.map_rom(0xFE, 2U, rom.data());
+    bus.map_io(0x40, 1U);
+
+    bus.write(0x0010, 0x12);
+    REQUIRE(bus.read(0x0010) == 0x12);
+    REQUIRE(bus.ram()[0x0010] == 0x12);
+
+    REQUIRE(bus.read(0xFE00) == 0xAB);
+    REQUIRE(bus.read(0xFFFF) == 0xCD);
+    bus.write(0xFE00, 0x77);
+    REQUIRE(bus.read(0xFE00) == 0xAB);
+    REQUIRE(io->readWrittenValue(0xFE00) == 0x77);
+
+    io->mockAddressValue(0x4016, 0x41);
+    REQUIRE(bus.read(0x4016) == 0x41);
+    bus.write(0x4017, 0x99);
+    REQUIRE(io->readWrittenValue(0x4017) == 0x99);
+
+    REQUIRE(bus.read_page(0x40) == nullptr);
+    REQUIRE(bus.write_page(0xFE) == nullptr);
+    REQUIRE(bus.read_page(0xFE) == rom.data());
+
+    REQUIRE(bus.fetch16(0xFEFF) == 0x0000);
+    REQUIRE(bus.fetch16(0xFFFE) == 0xCD00);
+
+    std::array<std::uint8_t, 0x100> mirror{};
+    bus.map_ram(0x08, 1U, mirror.data());
+    bus.map_ram(0x09, 1U, mirror.data());
+    bus.write(0x0801, 0x5A);
+    REQUIRE(bus.read(0x0901) == 0x5A);
+
+    REQUIRE_THROWS(bus.map_io(0xFF, 2U));
+}
+
+TEST_CASE("Cpu runs on PagedBus" ) {
+    auto io = std::make_shared<MockBus>();
+    auto bus = std::make_shared<mos6502::PagedBus>(io);
+    bus->map_io(0xD0, 1U);
+    mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+
+    auto& ram = bus->ram();
+    ram[0x00] = 0xA9; // LDA
+    ram[0x01] = 0x2A; // IMM
+    ram[0x02] = 0x85; // STA
+    ram[0x03] = 0x10; // ZPG
+    ram[0x04] = 0x48; // PHA
+    ram[0x05] = 0x8D; // STA
+    ram[0x06] = 0x00; // ABS LO
+    ram[0x07] = 0xD0; // ABS HI
+    ram[0x08] = 0xAD; // LDA
+    ram[0x09] = 0x01; // ABS LO
+    ram[0x0A] = 0xD0; // ABS HI
+    io->mockAddressValue(0xD001, 0x99);
+
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(ram[0x10] == 0x2A);
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(ram[0x1FF] == 0x2A);
+    REQUIRE(cpu.step() == 4U);
+    REQUIRE(io->readWrittenValue(0xD000) == 0x2A);
+    REQUIRE(cpu.step() == 4U);
+    REQUIRE(cpu.regs().ac == 0x99);
+}
+
+TEST_CASE("Cpu references or shares the bus" ) {
+    RamBus bus{};
+    bus.memory[0x00] = 0x48; // PHA
+    mos6502::Cpu<RamBus> cpu{bus};
+    REQUIRE(&cpu.bus() == &bus);
+    cpu.regs().ac = 0x2A;
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(bus.memory[0x1FF] == 0x2A);
+
+    std::weak_ptr<RamBus> weak{};
+    {
+        auto shared = std::make_shared<RamBus>();
+        weak = shared;
+        mos6502::Cpu<RamBus> owner{std::move(shared)};
+        REQUIRE(!weak.expired());
+        REQUIRE(owner.step() == 7U);
+    }
+    REQUIRE(weak.expired());
+}
+
+TEST_CASE("Run cycles and run until" ) {
+    auto bus = std::make_shared<RamBus>();
+    bus->memory[0x00] = 0xA2; // LDX
+    bus->memory[0x01] = 0x05; // IMM
+    bus->memory[0x02] = 0xCA; // DEX
+    bus->memory[0x03] = 0xD0; // BNE
+    bus->memory[0x04] = 0xFD; // REL (-3)
+    bus->memory[0x05] = 0xEA; // NOP
+
+    mos6502::Cpu<RamBus> cpu{bus};
+    mos6502::Cpu<RamBus, mos6502::ThreadedCpuTraits> threaded{bus};
+
+    // At least one instruction is executed
+    REQUIRE(cpu.run_cycles(0U) == 2U);
+    REQUIRE(threaded.run_cycles(0U) == 2U);
+    REQUIRE(cpu.regs() == threaded.regs());
+
+    // The last instruction may overshoot the budget
+    REQUIRE(cpu.run_cycles(5U) == 6U);
+    REQUIRE(threaded.run_cycles(5U) == 6U);
+    REQUIRE(cpu.regs().pc == 0x03);
+    REQUIRE(cpu.regs().xi == 0x03);
+    REQUIRE(cpu.regs() == threaded.regs());
+
+    auto const at_nop = [](mos6502::Registers const& regs) { return regs.pc == 0x05; };
+    REQUIRE(cpu.run_until(at_nop) == 14U);
+    REQUIRE(threaded.run_until(at_nop) == 14U);
+    REQUIRE(cpu.regs().xi == 0x00);
+    REQUIRE(cpu.regs() == threaded.regs());
+}
+
+TEST_CASE("Block cache matches switch dispatch" ) {
+    auto bus = std::make_shared<RamBus>();
+    auto cached_bus = std::make_shared<RamBus>();
+    std::array<std::uint8_t, 22> const program{
+        0xA2, 0x03, // LDX #$03
+        0xA9, 0x10, // LDA #$10
+        0x69, 0x25, // ADC #$25
+        0x95, 0x20, // STA $20,X
+        0x0A,       // ASL
+        0xCA,       // DEX
+        0xD0, 0xF8, // BNE -8
+        0x20, 0x15, 0x00, // JSR $0015
+        0x38,       // SEC
+        0xE9, 0x01, // SBC #$01
+        0x4C, 0x0F, 0x00, // JMP $000F
+        0x60,       // RTS
+    };
+    for (std::size_t i = 0U; i < program.size(); ++i) {
+        bus->memory[i] = program[i];
+        cached_bus->memory[i] = program[i];
+    }
+
+    mos6502::Cpu<RamBus> cpu{bus};
+    mos6502::Cpu<RamBus, mos6502::BlockCacheCpuTraits> cached{cached_bus};
+
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(cached.step() == cpu.step());
+        REQUIRE(cached.regs() == cpu.regs());
+    }
+    REQUIRE(cached.run_cycles(1000U) == cpu.run_cycles(1000U));
+    REQUIRE(cached.regs() == cpu.regs());
+    REQUIRE(cached_bus->memory == bus->memory);
+}
+
+TEST_CASE("Block cache invalidates written code" ) {
+    auto bus = std::make_shared<RamBus>();
+    std::array<std::uint8_t, 13> const program{
+        0xA9, 0xE8,       // LDA #$E8 (INX)
+        0x8D, 0x06, 0x00, // STA $0006
+        0xEA,             // NOP
+        0xEA,             // NOP, replaced by INX
+        0x8D, 0x00, 0x02, // STA $0200
+        0x4C, 0x07, 0x00, // JMP $0007
+    };
+    for (std::size_t i = 0U; i < program.size(); ++i) {
+        bus->memory[i] = program[i];
+    }
+
+    mos6502::Cpu<RamBus, mos6502::BlockCacheCpuTraits> cpu{bus};
+    auto const at_jmp = [](mos6502::Registers const& regs) { return regs.pc == 0x0A; };
+
+    // The write lands in the block being executed
+    REQUIRE(cpu.run_until(at_jmp) == 14U);
+    REQUIRE(cpu.regs().xi == 0x01);
+
+    // Writes to other pages keep the loop in the cache
+    cpu.step();
+    REQUIRE(cpu.run_cycles(7U) == 7U);
+    std::size_t const reads = bus->reads;
+    REQUIRE(cpu.run_cycles(70U) == 70U);
+    REQUIRE(bus->reads == reads);
+    REQUIRE(bus->memory[0x200] == 0xE8);
+
+    // Changes done behind the Cpu must be notified
+    bus->memory[0x08] = 0x01; // STA $0201
+    REQUIRE(cpu.run_cycles(7U) == 7U);
+    REQUIRE(bus->memory[0x201] == 0x00);
+    cpu.invalidate_blocks(0x00);
+    REQUIRE(cpu.run_cycles(7U) == 7U);
+    REQUIRE(bus->memory[0x201] == 0xE8);
+}
+
+TEST_CASE("JIT matches interpreter" ) {
+    std::array<std::uint8_t, 0x47> const program{
+        0xA2, 0x00,       // 0200 LDX #$00
+        0xA0, 0x10,       // 0202 LDY #$10
+        0xA5, 0x10,       // 0204 LDA $10
+        0x29, 0x7F,       // 0206 AND #$7F
+        0x05, 0x11,       // 0208 ORA $11
+        0x49, 0x5A,       // 020A EOR #$5A
+        0x18,             // 020C CLC
+        0x65, 0x12,       // 020D ADC $12
+        0x95, 0x20,       // 020F STA $20,X
+        0xC9, 0x80,       // 0211 CMP #$80
+        0xE8,             // 0213 INX
+        0xE0, 0x08,       // 0214 CPX #$08
+        0x85, 0x10,       // 0216 STA $10
+        0x98,             // 0218 TYA
+        0x48,             // 0219 PHA
+        0x68,             // 021A PLA
+        0xA8,             // 021B TAY
+        0x38,             // 021C SEC
+        0xE5, 0x11,       // 021D SBC $11
+        0x85, 0x11,       // 021F STA $11
+        0x20, 0x40, 0x02, // 0221 JSR $0240
+        0x88,             // 0224 DEY
+        0xD0, 0xDD,       // 0225 BNE $0204
+        0x4C, 0x00, 0x02, // 0227 JMP $0200
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xC0, 0x05,       // 0240 CPY #$05
+        0xB0, 0x02,       // 0242 BCS $0246
+        0xE6, 0x12,       // 0244 INC $12
+        0x60,             // 0246 RTS
+    };
+    auto jit_bus = std::make_shared<RamBus>();
+    for (std::size_t i = 0U; i < program.size(); ++i) {
+        jit_bus->memory[0x200 + i] = program[i];
+    }
+    jit_bus->memory[0x10] = 0x35;
+    jit_bus->memory[0x11] = 0xC2;
+    jit_bus->memory[0x12] = 0x07;
+    auto reference_bus = std::make_shared<RamBus>(*jit_bus);
+
+    auto const same_memory = [](RamBus const& lhs, RamBus const& rhs) { return lhs.memory == rhs.memory; };
+    mos6502::JitDifferential<RamBus, decltype(same_memory)> differential{jit_bus, reference_bus, same_memory};
+    differential.jit().regs().pc = 0x200;
+    differential.reference().regs().pc = 0x200;
+
+    for (std::uint64_t i = 0U; i < 2000U; ++i) {
+        REQUIRE_NOTHROW(differential.run_cycles(3U + (i % 7U) * 40U + (i % 5U)));
+    }
+#if MOS6502_JIT
+    REQUIRE(differential.jit().translated_blocks() > 0U);
+#endif
+
+    // Reads from memory pages are translated inline
+    auto jit_paged_bus = std::make_shared<mos6502::PagedBus>();
+    auto reference_paged_bus = std::make_shared<mos6502::PagedBus>();
+    jit_paged_bus->ram() = jit_bus->memory;
+    reference_paged_bus->ram() = jit_bus->memory;
+
+    auto const same_ram = [](mos6502::PagedBus const& lhs, mos6502::PagedBus const& rhs) { return lhs.ram() == rhs.ram(); };
+    mos6502::JitDifferential<mos6502::PagedBus, decltype(same_ram)> paged{jit_paged_bus, reference_paged_bus, same_ram};
+
+    for (std::uint64_t i = 0U; i < 2000U; ++i) {
+        REQUIRE_NOTHROW(paged.run_cycles(3U + (i % 7U) * 40U + (i % 5U)));
+    }
+}
+
+TEST_CASE("JIT leaves blocks written by themselves" ) {
+    std::array<std::uint8_t, 15> const program{
+        0xA9, 0xE8,       // LDA #$E8 (INX)
+        0x8D, 0x06, 0x00, // STA $0006
+        0xEA,             // NOP, replaced by INX
+        0xEA,             // NOP
+        0xA9, 0xEA,       // LDA #$EA (NOP)
+        0x8D, 0x05, 0x00, // STA $0005
+        0x4C, 0x00, 0x00, // JMP $0000
+    };
+    auto jit_bus = std::make_shared<RamBus>();
+    for (std::size_t i = 0U; i < program.size(); ++i) {
+        jit_bus->memory[i] = program[i];
+    }
+    auto reference_bus = std::make_shared<RamBus>(*jit_bus);
+
+    auto const same_memory = [](RamBus const& lhs, RamBus const& rhs) { return lhs.memory == rhs.memory; };
+    mos6502::JitDifferential<RamBus, decltype(same_memory)> differential{jit_bus, reference_bus, same_memory};
+
+    for (int i = 0; i < 200; ++i) {
+        REQUIRE_NOTHROW(differential.run_cycles(100U));
+    }
+    REQUIRE(differential.jit().regs().xi == differential.reference().regs().xi);
+    REQUIRE(differential.reference().regs().xi != 0x00);
+}
+
+TEST_CASE("JIT differential reports divergence" ) {
+    auto jit_bus = std::make_shared<RamBus>();
+    auto reference_bus = std::make_shared<RamBus>();
+    jit_bus->memory[0x00] = 0xE8; // INX
+    reference_bus->memory[0x00] = 0xC8; // INY
+
+    mos6502::JitDifferential<RamBus> differential{jit_bus, reference_bus};
+    REQUIRE_THROWS(differential.run_cycles(1U));
+}
+
+TEST_CASE("CpuBatch matches independent Cpu" ) {
+    std::array<std::uint8_t, 39> const program{
+        0xA5, 0x00,       // 0200 LDA $00
+        0x29, 0x03,       // 0202 AND #$03
+        0xAA,             // 0204 TAX
+        0xF0, 0x04,       // 0205 BEQ $020B
+        0xCA,             // 0207 DEX
+        0x4C, 0x05, 0x02, // 0208 JMP $0205
+        0xA5, 0x00,       // 020B LDA $00
+        0x18,             // 020D CLC
+        0x69, 0x35,       // 020E ADC #$35
+        0x85, 0x00,       // 0210 STA $00
+        0x48,             // 0212 PHA
+        0xE9, 0x80,       // 0213 SBC #$80
+        0xC9, 0x40,       // 0215 CMP #$40
+        0x90, 0x01,       // 0217 BCC $021A
+        0xC8,             // 0219 INY
+        0x68,             // 021A PLA
+        0x49, 0xFF,       // 021B EOR #$FF
+        0x95, 0x10,       // 021D STA $10,X
+        0xF8,             // 021F SED
+        0x69, 0x01,       // 0220 ADC #$01
+        0xD8,             // 0222 CLD
+        0x4C, 0x00, 0x02, // 0223 JMP $0200
+    };
+    constexpr std::size_t kLanes = 16U;
+
+    mos6502::CpuBatch<kLanes> batch{};
+    batch.load(0x200, program);
+    batch.jump(0x200);
+
+    std::vector<std::shared_ptr<RamBus>> buses{};
+    std::vector<mos6502::Cpu<RamBus>> cpus{};
+    for (std::size_t lane = 0U; lane < kLanes; ++lane) {
+        // Each lane starts from its own data so their paths diverge
+        batch.memory(lane)[0x00] = static_cast<std::uint8_t>(lane * 37U);
+
+        buses.push_back(std::make_shared<RamBus>());
+        for (std::size_t i = 0U; i < program.size(); ++i) {
+            buses.back()->memory[0x200 + i] = program[i];
+        }
+        buses.back()->memory[0x00] = static_cast<std::uint8_t>(lane * 37U);
+        cpus.emplace_back(buses.back());
+        cpus.back().regs().pc = 0x200;
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        batch.step();
+    }
+    batch.run_cycles(5000U);
+
+    for (std::size_t lane = 0U; lane < kLanes; ++lane) {
+        std::uint64_t cycles{};
+        for (int i = 0; i < 50; ++i) {
+            cycles += cpus[lane].step();
+        }
+        cycles += cpus[lane].run_cycles(batch.cycles(lane) - cycles);
+        REQUIRE(cycles == batch.cycles(lane));
+        REQUIRE(batch.regs(lane) == cpus[lane].regs());
+        REQUIRE(std::equal(buses[lane]->memory.begin(), buses[lane]->memory.end(), batch.memory(lane).begin()));
+    }
+}
+
+TEST_CASE("Lazy flags match eager flags" ) {
+    struct LazyBlockCacheCpuTraits : mos6502::BlockCacheCpuTraits {
+        using Flags = mos6502::LazyFlags;
+    };
+
+    std::array<std::uint8_t, 28> const program{
+        0xA9, 0x7F, // LDA #$7F
+        0x69, 0x01, // ADC #$01
+        0x70, 0x02, // BVS +2
+        0xA9, 0x00, // LDA #$00
+        0x24, 0x30, // BIT $30
+        0x08,       // PHP
+        0xC9, 0x80, // CMP #$80
+        0x28,       // PLP
+        0x2A,       // ROL
+        0x6A,       // ROR
+        0xF8,       // SED
+        0x69, 0x19, // ADC #$19
+        0xD8,       // CLD
+        0x38,       // SEC
+        0xE9, 0x90, // SBC #$90
+        0xB8,       // CLV
+        0x08,       // PHP
+        0x4C, 0x00, 0x00, // JMP $0000
+    };
+    auto eager_bus = std::make_shared<RamBus>();
+    auto lazy_bus = std::make_shared<RamBus>();
+    auto cached_bus = std::make_shared<RamBus>();
+    for (auto const& bus : {eager_bus, lazy_bus, cached_bus}) {
+        std::copy(program.begin(), program.end(), bus->memory.begin());
+        bus->memory[0x30] = 0xC0;
+    }
+
+    mos6502::Cpu<RamBus> eager{eager_bus};
+    mos6502::Cpu<RamBus, mos6502::LazyFlagsCpuTraits> lazy{lazy_bus};
+    mos6502::Cpu<RamBus, LazyBlockCacheCpuTraits> cached{cached_bus};
+
+    for (int i = 0; i < 200; ++i) {
+        if (i == 100) {
+            eager.signal_nmi();
+            lazy.signal_nmi();
+            cached.signal_nmi();
+        }
+        std::uint8_t const cycles = eager.step();
+        REQUIRE(lazy.step() == cycles);
+        REQUIRE(cached.step() == cycles);
+        REQUIRE(lazy.regs() == eager.regs());
+        REQUIRE(cached.regs() == eager.regs());
+        REQUIRE(lazy_bus->memory == eager_bus->memory);
+        REQUIRE(cached_bus->memory == eager_bus->memory);
+    }
+
+    // Predicates observe the flags materialized
+    auto const negative = [](mos6502::Registers const& regs) { return (regs.sr & mos6502::N) != 0U; };
+    REQUIRE(lazy.run_until(negative) == eager.run_until(negative));
+    REQUIRE(lazy.regs() == eager.regs());
+}
+
+TEST_CASE("Portable ALU matches x86 ALU" ) {
+    for (unsigned a = 0U; a < 0x100U; ++a) {
+        for (unsigned b = 0U; b < 0x100U; ++b) {
+            auto const lhs = static_cast<std::uint8_t>(a);
+            auto const rhs = static_cast<std::uint8_t>(b);
+            for (bool const carry : {false, true}) {
+                mos6502::AluResult const sum = mos6502::PortableAlu::add(lhs, rhs, carry);
+                mos6502::AluResult const x86_sum = mos6502::X86Alu::add(lhs, rhs, carry);
+                REQUIRE(sum.value == static_cast<std::uint8_t>(a + b + carry));
+                REQUIRE(sum.value == x86_sum.value);
+                REQUIRE(sum.carry == x86_sum.carry);
+                REQUIRE(sum.overflow == x86_sum.overflow);
+
+                mos6502::AluResult const difference = mos6502::PortableAlu::subtract(lhs, rhs, carry);
+                mos6502::AluResult const x86_difference = mos6502::X86Alu::subtract(lhs, rhs, carry);
+                REQUIRE(difference.value == static_cast<std::uint8_t>(a - b - !carry));
+                REQUIRE(difference.value == x86_difference.value);
+                REQUIRE(difference.carry == x86_difference.carry);
+                REQUIRE(difference.overflow == x86_difference.overflow);
+            }
+            mos6502::AluResult const comparison = mos6502::PortableAlu::compare(lhs, rhs);
+            mos6502::AluResult const x86_comparison = mos6502::X86Alu::compare(lhs, rhs);
+            REQUIRE(comparison.value == x86_comparison.value);
+            REQUIRE(comparison.carry == x86_comparison.carry);
+        }
+    }
+
+    // Signed overflow cases
+    REQUIRE(mos6502::PortableAlu::add(0x7F, 0x01, false).overflow);
+    REQUIRE(mos6502::PortableAlu::add(0x80, 0xFF, false).overflow);
+    REQUIRE(!mos6502::PortableAlu::add(0x7F, 0xFF, false).overflow);
+    REQUIRE(mos6502::PortableAlu::subtract(0x80, 0x01, true).overflow);
+    REQUIRE(mos6502::PortableAlu::subtract(0x7F, 0xFF, true).overflow);
+}
+
+TEST_CASE("Decimal tables match the reference algorithms" ) {
+    // Reference: "Decimal Mode" by Bruce Clark, appendices A and B
+    for (int a = 0; a < 0x100; ++a) {
+        for (int b = 0; b < 0x100; ++b) {
+            for (int c = 0; c < 2; ++c) {
+                auto const lhs = static_cast<std::uint8_t>(a);
+                auto const rhs = static_cast<std::uint8_t>(b);
+
+                int low = (a & 0x0F) + (b & 0x0F) + c;
+                if (low >= 0x0A) {
+                    low = ((low + 0x06) & 0x0F) + 0x10;
+                }
+                int sum = (a & 0xF0) + (b & 0xF0) + low;
+                int const signed_sum = static_cast<std::int8_t>(a & 0xF0) + static_cast<std::int8_t>(b & 0xF0) + low;
+                bool const nmos_negative = (sum & 0x80) != 0;
+                if (sum >= 0xA0) {
+                    sum += 0x60;
+                }
+
+                mos6502::DecimalResult const nmos_sum = mos6502::NmosDecimal::add(lhs, rhs, c != 0);
+                REQUIRE(nmos_sum.value == (sum & 0xFF));
+                REQUIRE(nmos_sum.carry == (sum >= 0x100));
+                REQUIRE(nmos_sum.overflow == (signed_sum < -128 || signed_sum > 127));
+                REQUIRE(((nmos_sum.negative & mos6502::N) != 0) == nmos_negative);
+                REQUIRE((nmos_sum.zero == 0) == (((a + b + c) & 0xFF) == 0));
+
+                mos6502::DecimalResult const cmos_sum = mos6502::CmosDecimal::add(lhs, rhs, c != 0);
+                REQUIRE(cmos_sum.value == nmos_sum.value);
+                REQUIRE(cmos_sum.carry == nmos_sum.carry);
+                REQUIRE(cmos_sum.overflow == nmos_sum.overflow);
+                REQUIRE(cmos_sum.negative == cmos_sum.value);
+                REQUIRE(cmos_sum.zero == cmos_sum.value);
+
+                int const binary = a - b + c - 1;
+                int nmos_low = (a & 0x0F) - (b & 0x0F) + c - 1;
+                if (nmos_low < 0) {
+                    nmos_low = ((nmos_low - 0x06) & 0x0F) - 0x10;
+                }
+                int nmos_difference = (a & 0xF0) - (b & 0xF0) + nmos_low;
+                if (nmos_difference < 0) {
+                    nmos_difference -= 0x60;
+                }
+
+                mos6502::DecimalResult const nmos_difference_result = mos6502::NmosDecimal::subtract(lhs, rhs, c != 0);
+                REQUIRE(nmos_difference_result.value == (nmos_difference & 0xFF));
+                REQUIRE(nmos_difference_result.carry == (binary >= 0));
+                REQUIRE(nmos_difference_result.negative == (binary & 0xFF));
+                REQUIRE(nmos_difference_result.zero == (binary & 0xFF));
+
+                int cmos_difference = binary;
+                if (cmos_difference < 0) {
+                    cmos_difference -= 0x60;
+                }
+                if ((a & 0x0F) - (b & 0x0F) + c - 1 < 0) {
+                    cmos_difference -= 0x06;
+                }
+
+                mos6502::DecimalResult const cmos_difference_result = mos6502::CmosDecimal::subtract(lhs, rhs, c != 0);
+                REQUIRE(cmos_difference_result.value == (cmos_difference & 0xFF));
+                REQUIRE(cmos_difference_result.carry == (binary >= 0));
+                REQUIRE(cmos_difference_result.overflow == nmos_difference_result.overflow);
+                REQUIRE(cmos_difference_result.zero == cmos_difference_result.value);
+            }
+        }
+    }
+}
+
+TEST_CASE("Variant opcode tables" ) {
+    std::size_t jams{};
+    for (auto const& info : mos6502::kNmosOpcodeTable) {
+        REQUIRE(info.mnemonic != mos6502::Mnemonic::ILL);
+        REQUIRE(info.length >= 1U);
+        REQUIRE(info.length <= 3U);
+        jams += info.mnemonic == mos6502::Mnemonic::JAM ? 1U : 0U;
+    }
+    REQUIRE(jams == 12U);
+
+    for (auto const& info : mos6502::kCmosOpcodeTable) {
+        REQUIRE(info.mnemonic != mos6502::Mnemonic::ILL);
+        REQUIRE(info.mnemonic != mos6502::Mnemonic::JAM);
+        REQUIRE(info.length >= 1U);
+        REQUIRE(info.length <= 3U);
+    }
+
+    REQUIRE(mos6502::kNmosOpcodeTable[0xA7].mnemonic == mos6502::Mnemonic::LAX);
+    REQUIRE(mos6502::kNmosOpcodeTable[0xB3].page_penalty == 1U);
+    REQUIRE(mos6502::kNmosOpcodeTable[0xDB].cycles == 7U);
+    REQUIRE(mos6502::mnemonic_name(mos6502::kNmosOpcodeTable[0x8F].mnemonic) == "SAX");
+    REQUIRE(mos6502::kCmosOpcodeTable[0x6C].cycles == 6U);
+    REQUIRE(mos6502::kCmosOpcodeTable[0xB2].mode == mos6502::AddressMode::ZeroPageIndirect);
+    REQUIRE(mos6502::kCmosOpcodeTable[0xB2].page_penalty == 0U);
+    REQUIRE(mos6502::mnemonic_name(mos6502::kCmosOpcodeTable[0x9C].mnemonic) == "STZ");
+    REQUIRE(mos6502::mnemonic_name(mos6502::Mnemonic::ILL) == "ILL");
+}
+
+TEST_CASE("NMOS undocumented opcodes" ) {
+    auto bus = std::make_shared<RamBus>();
+    auto& ram = bus->memory;
+    ram[0x10] = 0x81;
+
+    std::size_t pc = 0x200U;
+    for (std::uint8_t const byte : std::initializer_list<std::uint8_t>{
+             0xA7, 0x10,       // LAX $10
+             0x87, 0x11,       // SAX $11
+             0x07, 0x10,       // SLO $10
+             0xC7, 0x11,       // DCP $11
+             0xE7, 0x11,       // ISC $11
+             0x0B, 0x80,       // ANC #$80
+             0x4B, 0xFF,       // ALR #$FF
+             0xCB, 0x01,       // SBX #$01
+             0x1C, 0xFF, 0x10, // NOP $10FF,X
+             0x6C, 0xFF, 0x10, // JMP ($10FF)
+         }) {
+        ram[pc++] = byte;
+    }
+    ram[0x10FF] = 0x00;
+    ram[0x1000] = 0x03;
+    ram[0x1100] = 0x04;
+    ram[0x0300] = 0x02; // JAM
+
+    mos6502::Cpu<RamBus> cpu{bus};
+    cpu.regs().pc = 0x200;
+
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(cpu.regs().ac == 0x81);
+    REQUIRE(cpu.regs().xi == 0x81);
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(ram[0x11] == 0x81);
+    REQUIRE(cpu.step() == 5U);
+    REQUIRE(ram[0x10] == 0x02);
+    REQUIRE(cpu.regs().ac == 0x83);
+    REQUIRE((cpu.regs().sr & mos6502::C) != 0U);
+    REQUIRE(cpu.step() == 5U);
+    REQUIRE(ram[0x11] == 0x80);
+    REQUIRE((cpu.regs().sr & mos6502::C) != 0U);
+    REQUIRE(cpu.step() == 5U);
+    REQUIRE(ram[0x11] == 0x81);
+    REQUIRE(cpu.regs().ac == 0x02);
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE(cpu.regs().ac == 0x00);
+    REQUIRE((cpu.regs().sr & mos6502::C) == 0U);
+    REQUIRE((cpu.regs().sr & mos6502::Z) != 0U);
+    cpu.regs().ac = 0x07;
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE(cpu.regs().ac == 0x03);
+    REQUIRE((cpu.regs().sr & mos6502::C) != 0U);
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE(cpu.regs().xi == 0x00);
+    REQUIRE((cpu.regs().sr & mos6502::Z) != 0U);
+    cpu.regs().xi = 0x01;
+    REQUIRE(cpu.step() == 5U);
+
+    // The high byte of the target comes from $1000, not $1100
+    REQUIRE(cpu.step() == 5U);
+    REQUIRE(cpu.regs().pc == 0x0300);
+
+    // JAM halts without leaving the opcode
+    REQUIRE(cpu.run_cycles(10U) == 10U);
+    REQUIRE(cpu.regs().pc == 0x0300);
+}
+
+TEST_CASE("2A03 ignores decimal mode" ) {
+    auto bus = std::make_shared<RamBus>();
+    bus->memory[0x00] = 0xF8; // SED
+    bus->memory[0x01] = 0x18; // CLC
+    bus->memory[0x02] = 0xA9; // LDA
+    bus->memory[0x03] = 0x09; // IMM
+    bus->memory[0x04] = 0x69; // ADC
+    bus->memory[0x05] = 0x01; // IMM
+    bus->memory[0x06] = 0xE9; // SBC
+    bus->memory[0x07] = 0x00; // IMM
+
+    mos6502::Cpu<RamBus> nmos{bus};
+    mos6502::Cpu<RamBus, mos6502::Ricoh2A03CpuTraits> ricoh{bus};
+    REQUIRE(nmos.run_cycles(8U) == 8U);
+    REQUIRE(ricoh.run_cycles(8U) == 8U);
+    REQUIRE(nmos.regs().ac == 0x10);
+    REQUIRE(ricoh.regs().ac == 0x0A);
+    REQUIRE((ricoh.regs().sr & mos6502::D) != 0U);
+
+    nmos.step();
+    ricoh.step();
+    REQUIRE(nmos.regs().ac == 0x09);
+    REQUIRE(ricoh.regs().ac == 0x09);
+}
+
+TEST_CASE("Default Cpu pairs NMOS opcodes with 65C02 decimal flags" ) {
+    auto bus = std::make_shared<RamBus>();
+    bus->memory[0x00] = 0xF8; // SED
+    bus->memory[0x01] = 0x18; // CLC
+    bus->memory[0x02] = 0xA9; // LDA
+    bus->memory[0x03] = 0x99; // IMM
+    bus->memory[0x04] = 0x69; // ADC
+    bus->memory[0x05] = 0x01; // IMM
+
+    struct NmosDecimalTraits : mos6502::CpuTraits {
+        using Decimal = mos6502::NmosDecimal;
+    };
+    static_assert(std::is_same_v<mos6502::CpuTraits::Variant, mos6502::Nmos6502>);
+    static_assert(std::is_same_v<mos6502::CpuTraits::Decimal, mos6502::CmosDecimal>);
+
+    mos6502::Cpu<RamBus> cpu{bus};
+    mos6502::Cpu<RamBus, NmosDecimalTraits> nmos{bus};
+    REQUIRE(cpu.run_cycles(8U) == 8U);
+    REQUIRE(nmos.run_cycles(8U) == 8U);
+    REQUIRE(cpu.regs().ac == 0x00);
+    REQUIRE(nmos.regs().ac == 0x00);
+    REQUIRE(cpu.regs().sr == (mos6502::U | mos6502::B | mos6502::D | mos6502::Z | mos6502::C));
+    REQUIRE(nmos.regs().sr == (mos6502::U | mos6502::B | mos6502::D | mos6502::N | mos6502::C));
+}
+
+/// NMOS 6502 limited to the documented opcodes, the others are ILL
+struct DocumentedNmos6502 : mos6502::Nmos6502 {
+    static constexpr std::array<mos6502::OpcodeInfo, 256> const& kOpcodes = mos6502::kOpcodeTable;
+};
+
+TEST_CASE("Opcodes without a descriptor halt in place" ) {
+    struct DocumentedTraits : mos6502::CpuTraits {
+        using Variant = DocumentedNmos6502;
+    };
+    struct DocumentedBlockTraits : DocumentedTraits {
+        using Dispatch = mos6502::BlockCacheDispatch;
+    };
+
+    auto bus = std::make_shared<RamBus>();
+    bus->memory[0x200] = 0xA9; // LDA
+    bus->memory[0x201] = 0x01; // IMM
+    bus->memory[0x202] = 0x02; // ILL
+
+    mos6502::Cpu<RamBus, DocumentedTraits> cpu{bus};
+    cpu.regs().pc = 0x200;
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE(cpu.step() == 1U);
+    REQUIRE(cpu.regs().pc == 0x202);
+    REQUIRE(cpu.step() == 1U);
+    REQUIRE(cpu.regs().pc == 0x202);
+    REQUIRE(cpu.regs().ac == 0x01);
+
+    mos6502::Cpu<RamBus, DocumentedBlockTraits> cached{bus};
+    cached.regs().pc = 0x200;
+    REQUIRE(cached.run_cycles(10U) == 10U);
+    REQUIRE(cached.regs().pc == 0x202);
+}
+
+TEST_CASE("65C02 instructions" ) {
+    auto bus = std::make_shared<RamBus>();
+    auto& ram = bus->memory;
+    ram[0x10] = 0x00;
+    ram[0x11] = 0x30;
+    ram[0x20] = 0x0F;
+    ram[0x3000] = 0x5A;
+    ram[0x10FF] = 0x00;
+    ram[0x1000] = 0x03;
+    ram[0x1100] = 0x04;
+    ram[0x4002] = 0x00;
+    ram[0x4003] = 0x05;
+    ram[0xFFFE] = 0x00;
+    ram[0xFFFF] = 0x06;
+
+    std::size_t pc = 0x200U;
+    for (std::uint8_t const byte : std::initializer_list<std::uint8_t>{
+             0xB2, 0x10,       // LDA ($10)
+             0x64, 0x20,       // STZ $20
+             0x1A,             // INC A
+             0x04, 0x20,       // TSB $20
+             0x14, 0x20,       // TRB $20
+             0xDA,             // PHX
+             0x7A,             // PLY
+             0x89, 0x80,       // BIT #$80
+             0x03,             // NOP
+             0x80, 0x01,       // BRA +1
+             0xEA,             // NOP (skipped)
+             0x6C, 0xFF, 0x10, // JMP ($10FF)
+         }) {
+        ram[pc++] = byte;
+    }
+    ram[0x0400] = 0x7C; // JMP ($4000,X)
+    ram[0x0401] = 0x00;
+    ram[0x0402] = 0x40;
+    ram[0x0500] = 0xF8; // SED
+    ram[0x0501] = 0x00; // BRK
+
+    mos6502::Cpu<RamBus, mos6502::Cmos65C02CpuTraits> cpu{bus};
+    cpu.regs().pc = 0x200;
+    cpu.regs().xi = 0x02;
+
+    REQUIRE(cpu.step() == 5U);
+    REQUIRE(cpu.regs().ac == 0x5A);
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(ram[0x20] == 0x00);
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE(cpu.regs().ac == 0x5B);
+    REQUIRE(cpu.step() == 5U);
+    REQUIRE(ram[0x20] == 0x5B);
+    REQUIRE((cpu.regs().sr & mos6502::Z) != 0U);
+    REQUIRE(cpu.step() == 5U);
+    REQUIRE(ram[0x20] == 0x00);
+    REQUIRE((cpu.regs().sr & mos6502::Z) == 0U);
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(cpu.step() == 4U);
+    REQUIRE(cpu.regs().yi == 0x02);
+    REQUIRE(cpu.step() == 2U);
+    REQUIRE((cpu.regs().sr & mos6502::Z) != 0U);
+    REQUIRE((cpu.regs().sr & mos6502::N) == 0U);
+    REQUIRE(cpu.step() == 1U);
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(cpu.regs().pc == 0x0211);
+
+    // The high byte of the target comes from $1100
+    REQUIRE(cpu.step() == 6U);
+    REQUIRE(cpu.regs().pc == 0x0400);
+    REQUIRE(cpu.step() == 6U);
+    REQUIRE(cpu.regs().pc == 0x0500);
+
+    // Interrupts clear decimal mode
+    cpu.step();
+    REQUIRE((cpu.regs().sr & mos6502::D) != 0U);
+    REQUIRE(cpu.step() == 7U);
+    REQUIRE(cpu.regs().pc == 0x0600);
+    REQUIRE((cpu.regs().sr & mos6502::D) == 0U);
+
+    struct BlockCacheCmosTraits : mos6502::Cmos65C02CpuTraits {
+        using Dispatch = mos6502::BlockCacheDispatch;
+    };
+    mos6502::Cpu<RamBus, BlockCacheCmosTraits> cached{bus};
+    cached.regs().pc = 0x200;
+    cached.regs().xi = 0x02;
+    REQUIRE(cached.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0600; }) == 54U);
+    REQUIRE(cached.regs() == cpu.regs());
+}
+
+TEST_CASE("Snapshot restores registers and memory" ) {
+    using PagedCpu = mos6502::Cpu<mos6502::PagedBus, mos6502::BlockCacheCpuTraits>;
+
+    mos6502::PagedBus bus{};
+    bus.map_io(0xD0, 1U);
+    auto& ram = bus.ram();
+    ram[0x00] = 0xA2; // LDX
+    ram[0x01] = 0x00; // IMM
+    ram[0x02] = 0xE8; // INX
+    ram[0x03] = 0x86; // STX
+    ram[0x04] = 0x10; // ZPG
+    ram[0x05] = 0x4C; // JMP
+    ram[0x06] = 0x02; // ABS LO
+    ram[0x07] = 0x00; // ABS HI
+
+    PagedCpu cpu{bus};
+    cpu.run_cycles(100U);
+
+    std::vector<std::uint8_t> buffer(PagedCpu::kSnapshotSize + mos6502::PagedBus::kSnapshotSize);
+    mos6502::SnapshotWriter writer{buffer};
+    cpu.save(writer);
+    REQUIRE(writer.size() == PagedCpu::kSnapshotSize + 32U + 255U * 256U);
+    mos6502::Registers const saved = cpu.regs();
+    std::uint8_t const counter = ram[0x10];
+
+    ram[0x02] = 0xCA; // DEX
+    cpu.invalidate_blocks();
+    cpu.run_cycles(100U);
+    REQUIRE(ram[0x10] != counter);
+
+    mos6502::SnapshotReader reader{std::span<std::uint8_t const>{buffer.data(), writer.size()}};
+    cpu.restore(reader);
+    REQUIRE(reader.position() == writer.size());
+    REQUIRE(cpu.regs() == saved);
+    REQUIRE(ram[0x10] == counter);
+    REQUIRE(ram[0x02] == 0xE8);
+
+    // A second machine restored from the same snapshot runs in lockstep
+    mos6502::PagedBus other_bus{};
+    other_bus.map_io(0xD0, 1U);
+    mos6502::Cpu<mos6502::PagedBus> other{other_bus};
+    mos6502::SnapshotReader other_reader{std::span<std::uint8_t const>{buffer.data(), writer.size()}};
+    other.restore(other_reader);
+    REQUIRE(cpu.run_cycles(50U) == other.run_cycles(50U));
+    REQUIRE(cpu.regs() == other.regs());
+    REQUIRE(ram == other_bus.ram());
+}
+
+TEST_CASE("Snapshot rejects invalid data" ) {
+    mos6502::PagedBus bus{};
+    mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+
+    std::array<std::uint8_t, 64> small{};
+    mos6502::SnapshotWriter small_writer{small};
+    REQUIRE_THROWS_AS(cpu.save(small_writer), std::length_error);
+
+    std::vector<std::uint8_t> buffer(decltype(cpu)::kSnapshotSize + mos6502::PagedBus::kSnapshotSize);
+    mos6502::SnapshotWriter writer{buffer};
+    cpu.save(writer);
+
+    mos6502::SnapshotReader truncated{std::span<std::uint8_t const>{buffer.data(), 100U}};
+    REQUIRE_THROWS_AS(cpu.restore(truncated), std::out_of_range);
+
+    std::vector<std::uint8_t> newer{buffer};
+    newer[4] = static_cast<std::uint8_t>(mos6502::kSnapshotVersion + 1U);
+    mos6502::SnapshotReader newer_reader{newer};
+    REQUIRE_THROWS_AS(cpu.restore(newer_reader), std::invalid_argument);
+
+    bus.map_io(0xD0, 1U);
+    mos6502::SnapshotReader remapped{buffer};
+    REQUIRE_THROWS_AS(cpu.restore(remapped), std::invalid_argument);
+
+    // Buses without state only save the registers and can not restore one
+    RamBus ram_bus{};
+    mos6502::Cpu<RamBus> registers_only{ram_bus};
+    mos6502::SnapshotReader bus_reader{buffer};
+    REQUIRE_THROWS_AS(registers_only.restore(bus_reader), std::invalid_argument);
+
+    std::array<std::uint8_t, mos6502::Cpu<RamBus>::kSnapshotSize> registers{};
+    mos6502::SnapshotWriter registers_writer{registers};
+    registers_only.regs().pc = 0x1234;
+    registers_only.save(registers_writer);
+    REQUIRE(registers_writer.size() == registers.size());
+    mos6502::SnapshotReader registers_reader{registers};
+    cpu.restore(registers_reader);
+    REQUIRE(cpu.regs().pc == 0x1234);
+}
+
+TEST_CASE("Snapshot keeps the interrupts pending and the cycle count" ) {
+    mos6502::PagedBus bus{};
+    auto& ram = bus.ram();
+    ram[0x0000] = 0xEA; // NOP
+    ram[0x0200] = 0xEA; // NOP
+    ram[0x0300] = 0xEA; // NOP
+    ram[0xFFFA] = 0x00;
+    ram[0xFFFB] = 0x02;
+    ram[0xFFFE] = 0x00;
+    ram[0xFFFF] = 0x03;
+
+    mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+    cpu.run_cycles(1000U);
+    cpu.regs().pc = 0x0000;
+    cpu.set_nmi_line(true);
+    cpu.set_irq_line(true, 3U);
+
+    std::vector<std::uint8_t> buffer(decltype(cpu)::kSnapshotSize + mos6502::PagedBus::kSnapshotSize);
+    mos6502::SnapshotWriter writer{buffer};
+    cpu.save(writer);
+    std::uint64_t const saved_cycles = cpu.cycles();
+    mos6502::Scheduler scheduler{};
+    scheduler.sync(cpu);
+    std::uint64_t fired{};
+
+    // The restored NMI is latched once and the line stays high, IRQ source 3 still holds its line
+    mos6502::PagedBus other_bus{};
+    other_bus.ram() = ram;
+    mos6502::Cpu<mos6502::PagedBus> other{other_bus};
+    scheduler.schedule(saved_cycles + 100U, [&other, &fired](std::uint64_t) { fired = other.cycles(); });
+    mos6502::SnapshotReader reader{std::span<std::uint8_t const>{buffer.data(), writer.size()}};
+    other.restore(reader);
+    REQUIRE(other.cycles() == saved_cycles);
+    other.step();
+    REQUIRE(other.regs().pc == 0x0200);
+    other.set_nmi_line(true);
+    other.regs().sr = static_cast<std::uint8_t>(other.regs().sr & ~mos6502::I);
+    other.step();
+    REQUIRE(other.regs().pc == 0x0300);
+    other.set_irq_line(false, 3U);
+    other.regs().pc = 0x0000;
+    other.step();
+    REQUIRE(other.regs().pc == 0x0001);
+
+    // Events scheduled against the saved Cpu fire on time on the restored one
+    other.regs().pc = 0x0000;
+    scheduler.run_cycles(other, 200U);
+    REQUIRE(fired >= saved_cycles + 100U);
+    REQUIRE(fired < saved_cycles + 108U);
+
+    // Version 1 had no lines, restoring it releases them
+    std::vector<std::uint8_t> v1{buffer.begin(), buffer.begin() + 6 + sizeof(mos6502::Registers)};
+    v1[4] = 1U;
+    v1[5] = 0U;
+    mos6502::SnapshotReader v1_reader{v1};
+    std::uint64_t const cycles = cpu.cycles();
+    cpu.restore(v1_reader);
+    REQUIRE(v1_reader.position() == v1.size());
+    REQUIRE(cpu.cycles() == cycles);
+    cpu.step();
+    REQUIRE(cpu.regs().pc == 0x0001);
+}
+
+TEST_CASE("CowBus shares pages until written" ) {
+    auto io = std::make_shared<MockBus>();
+    mos6502::CowBus bus{io};
+
+    std::array<std::uint8_t, 0x100> rom{};
+    rom[0x00] = 0xAB;
+    bus.map_rom(0xFF, 1U, rom.data());
+    bus.map_io(0x40, 1U);
+
+    REQUIRE(bus.read(0x1234) == 0x00);
+    REQUIRE(bus.write_page(0x12) == nullptr);
+    bus.write(0x0010, 0x12);
+    bus.write(0x0011, 0x34);
+    REQUIRE(bus.dirty_pages() == 1U);
+    REQUIRE(bus.write_page(0x00) != nullptr);
+    REQUIRE(bus.fetch16(0x0010) == 0x3412);
+
+    mos6502::CowBus child = bus.fork();
+    REQUIRE(bus.dirty_pages() == 0U);
+    REQUIRE(bus.write_page(0x00) == nullptr);
+    REQUIRE(child.read_page(0x00) == bus.read_page(0x00));
+    REQUIRE(child.read(0x0010) == 0x12);
+
+    child.write(0x0010, 0x56);
+    REQUIRE(child.read(0x0010) == 0x56);
+    REQUIRE(child.read(0x0011) == 0x34);
+    REQUIRE(bus.read(0x0010) == 0x12);
+    REQUIRE(child.read_page(0x00) != bus.read_page(0x00));
+
+    bus.write(0x0011, 0x78);
+    REQUIRE(child.read(0x0011) == 0x34);
+    REQUIRE(bus.read(0x0011) == 0x78);
+
+    // Grandchildren see the pages written by the child before forking
+    mos6502::CowBus grandchild = child.fork();
+    child.write(0x0010, 0x9A);
+    REQUIRE(grandchild.read(0x0010) == 0x56);
+
+    REQUIRE(child.read(0xFF00) == 0xAB);
+    child.write(0xFF00, 0x77);
+    REQUIRE(child.read(0xFF00) == 0xAB);
+    REQUIRE(io->readWrittenValue(0xFF00) == 0x77);
+    io->mockAddressValue(0x4016, 0x41);
+    REQUIRE(grandchild.read(0x4016) == 0x41);
+
+    // A long line of forks is released without recursion
+    {
+        mos6502::CowBus line = bus.fork();
+        for (int i = 0; i < 100000; ++i) {
+            line.write(0x0200, static_cast<std::uint8_t>(i));
+            line = line.fork();
+        }
+        REQUIRE(line.read(0x0200) == static_cast<std::uint8_t>(99999));
+    }
+    REQUIRE(bus.read(0x0200) == 0x00);
+
+    // Forking every frame keeps only the pages the live forks read
+    {
+        std::size_t const live = mos6502::CowBus::live_pages();
+        std::vector<mos6502::CowBus> history{};
+        for (int i = 0; i < 10000; ++i) {
+            bus.write(static_cast<std::uint16_t>(0x0300 + (i % 4) * 0x100), static_cast<std::uint8_t>(i));
+            history.push_back(bus.fork());
+            if (history.size() > 8U) {
+                history.erase(history.begin());
+            }
+            REQUIRE(mos6502::CowBus::live_pages() <= live + 12U);
+        }
+        REQUIRE(history.front().read(0x0300) == static_cast<std::uint8_t>(9992));
+        REQUIRE(history.back().read(0x0600) == static_cast<std::uint8_t>(9999));
+    }
+
+    REQUIRE_THROWS(bus.map_ram(0xFF, 2U));
+}
+
+TEST_CASE("Cpu clones run on forked memory" ) {
+    auto bus = std::make_shared<mos6502::CowBus>();
+    bus->write(0x0000, 0xE6); // INC
+    bus->write(0x0001, 0x10); // ZPG
+    bus->write(0x0002, 0x4C); // JMP
+    bus->write(0x0003, 0x00); // ABS LO
+    bus->write(0x0004, 0x00); // ABS HI
+    mos6502::Cpu<mos6502::CowBus> cpu{bus};
+    cpu.run_cycles(80U); // 10 iterations
+    REQUIRE(bus->read(0x0010) == 10U);
+
+    auto child = cpu.clone();
+    REQUIRE(&child.bus() != bus.get());
+    REQUIRE(child.regs() == cpu.regs());
+    child.run_cycles(80U);
+    REQUIRE(child.bus().read(0x0010) == 20U);
+    REQUIRE(bus->read(0x0010) == 10U);
+
+    cpu.run_cycles(40U);
+    REQUIRE(bus->read(0x0010) == 15U);
+    REQUIRE(child.bus().read(0x0010) == 20U);
+
+    // The JIT reads a CowBus through the interpreter, pages move when copied
+    mos6502::CowBus jit_bus = bus->fork();
+    mos6502::Cpu<mos6502::CowBus, mos6502::JitCpuTraits> jit{jit_bus};
+    jit.regs() = cpu.regs();
+    mos6502::CowBus jit_fork = jit_bus.fork();
+    auto jit_child = jit.clone(jit_fork);
+    for (int i = 0; i < 50; ++i) {
+        jit.run_cycles(80U);
+        jit_child.run_cycles(40U);
+    }
+    REQUIRE(jit_bus.read(0x0010) == static_cast<std::uint8_t>(15U + 500U));
+    REQUIRE(jit_fork.read(0x0010) == static_cast<std::uint8_t>(15U + 250U));
+
+    // Snapshots restore into forks without touching the parent
+    std::vector<std::uint8_t> buffer(decltype(cpu)::kSnapshotSize + mos6502::CowBus::kSnapshotSize);
+    mos6502::SnapshotWriter writer{buffer};
+    cpu.save(writer);
+    mos6502::SnapshotReader reader{buffer};
+    child.restore(reader);
+    REQUIRE(child.regs() == cpu.regs());
+    REQUIRE(child.bus().read(0x0010) == 15U);
+    REQUIRE(child.bus().dirty_pages() == mos6502::CowBus::kPageCount);
+}
+
+TEST_CASE("PagedBus tracks dirty pages" ) {
+    mos6502::PagedBus bus{};
+    bus.map_io(0xD0, 1U);
+    std::array<std::uint8_t, 0x100> rom{};
+    bus.map_rom(0xFF, 1U, rom.data());
+    REQUIRE(bus.dirty_pages().test(0x00));
+    REQUIRE(!bus.dirty_pages().test(0xD0));
+
+    bus.clear_dirty();
+    REQUIRE(bus.dirty_pages().none());
+    REQUIRE(bus.write_page(0x02) == nullptr);
+    REQUIRE(bus.ram_page(0x02) == bus.ram().data() + 0x200);
+    bus.write(0x0210, 0x12);
+    bus.write(0xD000, 0x34);
+    bus.write(0xFF00, 0x56);
+    REQUIRE(bus.dirty_pages().count() == 1U);
+    REQUIRE(bus.dirty_pages().test(0x02));
+    REQUIRE(bus.write_page(0x02) == bus.ram_page(0x02));
+    REQUIRE(bus.ram()[0x0210] == 0x12);
+    REQUIRE(bus.ram_page(0xFF) == nullptr);
+
+    bus.clear_dirty();
+    mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+    bus.ram()[0x0000] = 0x48; // PHA
+    bus.mark_dirty(0x00);
+    REQUIRE(cpu.step() == 3U);
+    REQUIRE(bus.dirty_pages().count() == 2U);
+    REQUIRE(bus.dirty_pages().test(0x01));
+}
+
+TEST_CASE("Page delta round trip" ) {
+    std::array<std::uint8_t, 0x100> before{};
+    std::array<std::uint8_t, 0x100> after{};
+    std::array<std::uint8_t, mos6502::kMaxPageDelta> delta{};
+    REQUIRE(mos6502::encode_page_delta(before.data(), after.data(), delta.data()) == 0U);
+
+    std::uint32_t seed = 0x12345678U;
+    for (std::uint32_t round = 0U; round < 200U; ++round) {
+        for (std::size_t i = 0U; i < after.size(); ++i) {
+            seed = seed * 1103515245U + 12345U;
+            before[i] = static_cast<std::uint8_t>(seed >> 24);
+            after[i] = (seed >> 8) % (round % 4U + 2U) == 0U ? before[i] : static_cast<std::uint8_t>(seed >> 16);
+        }
+        std::size_t const size = mos6502::encode_page_delta(before.data(), after.data(), delta.data());
+        REQUIRE(size <= delta.size());
+        std::array<std::uint8_t, 0x100> page{before};
+        REQUIRE(mos6502::apply_page_delta(delta.data(), page.data()) == size);
+        REQUIRE(page == after);
+        REQUIRE(mos6502::apply_page_delta(delta.data(), page.data()) == size);
+        REQUIRE(page == before);
+    }
+
+    for (std::size_t i = 0U; i < after.size(); ++i) {
+        before[i] = 0x00;
+        after[i] = i % 2U == 0U ? 0xFF : 0x00;
+    }
+    REQUIRE(mos6502::encode_page_delta(before.data(), after.data(), delta.data()) <= mos6502::kMaxPageDelta);
+}
+
+TEST_CASE("Rewind restores recorded frames" ) {
+    using PagedCpu = mos6502::Cpu<mos6502::PagedBus, mos6502::BlockCacheCpuTraits>;
+    using Rewind = mos6502::RewindBuffer<mos6502::PagedBus, mos6502::BlockCacheCpuTraits>;
+
+    mos6502::PagedBus bus{};
+    auto& ram = bus.ram();
+    ram[0x00] = 0xA2; // LDX
+    ram[0x01] = 0x00; // IMM
+    ram[0x02] = 0xFE; // INC
+    ram[0x03] = 0x00; // ABS LO
+    ram[0x04] = 0x02; // ABS HI
+    ram[0x05] = 0x9D; // STA
+    ram[0x06] = 0x00; // ABS LO
+    ram[0x07] = 0x05; // ABS HI
+    ram[0x08] = 0xE8; // INX
+    ram[0x09] = 0x8A; // TXA
+    ram[0x0A] = 0x4C; // JMP
+    ram[0x0B] = 0x02; // ABS LO
+    ram[0x0C] = 0x00; // ABS HI
+    PagedCpu cpu{bus};
+
+    REQUIRE_THROWS_AS(Rewind(cpu, Rewind::kMaxFrameSize - 1U, 8U), std::invalid_argument);
+    REQUIRE_THROWS_AS(Rewind(cpu, Rewind::kMaxFrameSize, 0U), std::invalid_argument);
+
+    struct State {
+        mos6502::Registers regs;
+        std::array<std::uint8_t, 0x10000> ram;
+    };
+    auto states = std::make_unique<std::array<State, 8>>();
+    Rewind rewind{cpu, Rewind::kMaxFrameSize, 64U};
+    REQUIRE_THROWS_AS(rewind.rewind(0U), std::out_of_range);
+    for (State& state : *states) {
+        cpu.run_cycles(500U);
+        rewind.push();
+        state = State{cpu.regs(), ram};
+    }
+    REQUIRE(rewind.frames() == states->size());
+    REQUIRE(rewind.size() < 8U * 1024U);
+
+    // Changes after the newest frame are dropped
+    cpu.run_cycles(500U);
+    ram[0x0A] = 0xEA; // NOP
+    bus.mark_dirty(0x00);
+    rewind.rewind(0U);
+    REQUIRE(cpu.regs() == (*states)[7].regs);
+    REQUIRE(ram == (*states)[7].ram);
+
+    rewind.rewind(3U);
+    REQUIRE(rewind.frames() == 5U);
+    REQUIRE(cpu.regs() == (*states)[4].regs);
+    REQUIRE(ram == (*states)[4].ram);
+
+    // Recording continues from the frame rewound to
+    cpu.run_cycles(500U);
+    rewind.push();
+    cpu.run_cycles(500U);
+    rewind.rewind(1U);
+    REQUIRE(cpu.regs() == (*states)[4].regs);
+    REQUIRE(ram == (*states)[4].ram);
+    rewind.rewind(4U);
+    REQUIRE(cpu.regs() == (*states)[0].regs);
+    REQUIRE(ram == (*states)[0].ram);
+    REQUIRE_THROWS_AS(rewind.rewind(1U), std::out_of_range);
+}
+
+TEST_CASE("Rewind evicts the oldest frames" ) {
+    mos6502::PagedBus bus{};
+    auto& ram = bus.ram();
+    ram[0x00] = 0xE6; // INC
+    ram[0x01] = 0x10; // ZPG
+    ram[0x02] = 0x9D; // STA
+    ram[0x03] = 0x00; // ABS LO
+    ram[0x04] = 0x03; // ABS HI
+    ram[0x05] = 0xE8; // INX
+    ram[0x06] = 0x8A; // TXA
+    ram[0x07] = 0x4C; // JMP
+    ram[0x08] = 0x00; // ABS LO
+    ram[0x09] = 0x00; // ABS HI
+    mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+
+    using Rewind = mos6502::RewindBuffer<mos6502::PagedBus>;
+    Rewind by_count{cpu, Rewind::kMaxFrameSize, 16U};
+    for (int i = 0; i < 100; ++i) {
+        cpu.run_cycles(100U);
+        by_count.push();
+    }
+    REQUIRE(by_count.frames() == 16U);
+
+    struct State {
+        mos6502::Registers regs;
+        std::array<std::uint8_t, 0x400> low;
+    };
+    std::vector<State> states{};
+    Rewind by_size{cpu, Rewind::kMaxFrameSize, 100000U};
+    for (int i = 0; i < 8000; ++i) {
+        cpu.run_cycles(100U);
+        by_size.push();
+        State& state = states.emplace_back();
+        state.regs = cpu.regs();
+        std::copy(ram.begin(), ram.begin() + 0x400, state.low.begin());
+    }
+    REQUIRE(by_size.frames() < states.size());
+    REQUIRE(by_size.frames() > 100U);
+    REQUIRE(by_size.size() <= Rewind::kMaxFrameSize);
+
+    std::size_t const oldest = states.size() - by_size.frames();
+    by_size.rewind(by_size.frames() - 1U);
+    REQUIRE(cpu.regs() == states[oldest].regs);
+    REQUIRE(std::equal(ram.begin(), ram.begin() + 0x400, states[oldest].low.begin()));
+}
+
+TEST_CASE("Replay follows the recorded events" ) {
+    struct NoiseBus final : public mos6502::IBus {
+        std::uint32_t seed{0x2545F491U};
+
+        std::uint8_t read(std::uint16_t) override {
+            seed = seed * 1103515245U + 12345U;
+            return static_cast<std::uint8_t>(seed >> 16);
+        }
+
+        void write(std::uint16_t, std::uint8_t) override {}
+    };
+
+    auto const load = [](mos6502::PagedBus& bus, std::uint8_t device_lo) {
+        bus.map_io(0xD0, 1U);
+        auto& ram = bus.ram();
+        ram[0x0000] = 0x58; // CLI
+        ram[0x0001] = 0xA2; // LDX
+        ram[0x0002] = 0x00; // IMM
+        ram[0x0003] = 0xAD; // LDA
+        ram[0x0004] = device_lo;
+        ram[0x0005] = 0xD0; // ABS HI
+        ram[0x0006] = 0x95; // STA
+        ram[0x0007] = 0x40; // ZPG,X
+        ram[0x0008] = 0xE8; // INX
+        ram[0x0009] = 0x4C; // JMP
+        ram[0x000A] = 0x03; // ABS LO
+        ram[0x000B] = 0x00; // ABS HI
+        ram[0x0200] = 0xE6; // INC
+        ram[0x0201] = 0x20; // ZPG
+        ram[0x0202] = 0x40; // RTI
+        ram[0x0210] = 0xE6; // INC
+        ram[0x0211] = 0x21; // ZPG
+        ram[0x0212] = 0x40; // RTI
+        ram[0xFFFA] = 0x10;
+        ram[0xFFFB] = 0x02;
+        ram[0xFFFE] = 0x00;
+        ram[0xFFFF] = 0x02;
+    };
+
+    std::stringstream log{};
+    mos6502::Registers recorded_regs{};
+    auto recorded_ram = std::make_unique<std::array<std::uint8_t, 0x10000>>();
+    std::uint64_t recorded_cycles{};
+    {
+        mos6502::EventRecorder recorder{log};
+        mos6502::PagedBus bus{recorder.record(std::make_shared<NoiseBus>())};
+        load(bus, 0x00);
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        for (std::uint64_t i = 0U; i < 60U; ++i) {
+            recorder.run_cycles(cpu, 90U + i);
+            if (i % 7U == 3U) {
+                recorder.signal_irq(cpu);
+            }
+            if (i % 13U == 5U) {
+                recorder.signal_nmi(cpu);
+            }
+            recorder.step(cpu);
+        }
+        recorder.close();
+        recorded_regs = cpu.regs();
+        *recorded_ram = bus.ram();
+        recorded_cycles = recorder.cycles();
+        REQUIRE(bus.ram()[0x20] != 0U);
+        REQUIRE(bus.ram()[0x21] != 0U);
+    }
+
+    // Devices are never read while replaying, MockBus throws on reads not mocked
+    {
+        std::istringstream in{log.str()};
+        mos6502::EventReplayer replayer{in};
+        mos6502::PagedBus bus{replayer.replay(std::make_shared<MockBus>())};
+        load(bus, 0x00);
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        REQUIRE(replayer.run(cpu) == recorded_cycles);
+        REQUIRE(replayer.finished());
+        REQUIRE(cpu.regs() == recorded_regs);
+        REQUIRE(bus.ram() == *recorded_ram);
+    }
+
+    // Other budgets reach the same state
+    {
+        std::istringstream in{log.str()};
+        mos6502::EventReplayer replayer{in};
+        mos6502::PagedBus bus{replayer.replay()};
+        load(bus, 0x00);
+        mos6502::Cpu<mos6502::PagedBus, mos6502::BlockCacheCpuTraits> cpu{bus};
+        while (replayer.cycles() + 250U < recorded_cycles) {
+            replayer.run_cycles(cpu, 250U);
+        }
+        replayer.run(cpu);
+        REQUIRE(replayer.cycles() == recorded_cycles);
+        REQUIRE(cpu.regs() == recorded_regs);
+        REQUIRE(bus.ram() == *recorded_ram);
+    }
+
+    // A different program diverges
+    {
+        std::istringstream in{log.str()};
+        mos6502::EventReplayer replayer{in};
+        mos6502::PagedBus bus{replayer.replay()};
+        load(bus, 0x01);
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        REQUIRE_THROWS_AS(replayer.run(cpu), std::logic_error);
+    }
+
+    std::istringstream not_a_log{"M65S"};
+    REQUIRE_THROWS_AS(mos6502::EventReplayer{not_a_log}, std::invalid_argument);
+
+    std::string truncated{log.str()};
+    truncated.resize(truncated.size() - 1U);
+    std::istringstream truncated_in{truncated};
+    mos6502::EventLogReader reader{truncated_in};
+    REQUIRE_THROWS_AS([&reader] { while (reader.next()) {} }(), std::out_of_range);
+}
+
+TEST_CASE("Replay of a polling loop reads ahead a chunk at most" ) {
+    struct CounterBus final : public mos6502::IBus {
+        std::uint8_t value{};
+
+        std::uint8_t read(std::uint16_t) override {
+            return value++;
+        }
+
+        void write(std::uint16_t, std::uint8_t) override {}
+    };
+
+    auto const load = [](mos6502::PagedBus& bus) {
+        bus.map_io(0xD0, 1U);
+        auto& ram = bus.ram();
+        ram[0x0000] = 0xAD; // LDA
+        ram[0x0001] = 0x00; // ABS LO
+        ram[0x0002] = 0xD0; // ABS HI
+        ram[0x0003] = 0x85; // STA
+        ram[0x0004] = 0x40; // ZPG
+        ram[0x0005] = 0x4C; // JMP
+        ram[0x0006] = 0x00; // ABS LO
+        ram[0x0007] = 0x00; // ABS HI
+    };
+
+    std::stringstream log{};
+    std::uint64_t recorded_cycles{};
+    {
+        mos6502::EventRecorder recorder{log};
+        mos6502::PagedBus bus{recorder.record(std::make_shared<CounterBus>())};
+        load(bus);
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        for (int i = 0; i < 5000; ++i) {
+            recorder.run_cycles(cpu, 100U);
+        }
+        recorder.close();
+        recorded_cycles = recorder.cycles();
+    }
+
+    std::istringstream in{log.str()};
+    mos6502::EventReplayer replayer{in};
+    mos6502::PagedBus bus{replayer.replay()};
+    load(bus);
+    mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+    std::size_t peak{};
+    while (replayer.cycles() < recorded_cycles) {
+        replayer.run_cycles(cpu, 100U);
+        peak = std::max(peak, replayer.buffered());
+    }
+    REQUIRE(replayer.run(cpu) == 0U);
+    REQUIRE(replayer.finished());
+    REQUIRE(peak > 0U);
+    REQUIRE(peak <= mos6502::EventRecorder::kSyncReads + 10U);
+    REQUIRE(bus.ram()[0x40] == static_cast<std::uint8_t>(recorded_cycles / 10U - 1U));
+}
+
+TEST_CASE("Replay drives the interrupt lines recorded" ) {
+    struct InterruptingBus final : public mos6502::IBus {
+        std::uint32_t seed{0x2545F491U};
+        std::function<void(bool)> irq{};
+
+        std::uint8_t read(std::uint16_t) override {
+            seed = seed * 1103515245U + 12345U;
+            return static_cast<std::uint8_t>(seed >> 16);
+        }
+
+        void write(std::uint16_t, std::uint8_t data) override {
+            irq((data & 0x07U) == 0U);
+        }
+    };
+
+    auto const load = [](mos6502::PagedBus& bus) {
+        bus.map_io(0xD0, 1U);
+        auto& ram = bus.ram();
+        ram[0x0000] = 0x58; // CLI
+        ram[0x0001] = 0xAD; // LDA
+        ram[0x0002] = 0x00; // ABS LO
+        ram[0x0003] = 0xD0; // ABS HI
+        ram[0x0004] = 0x8D; // STA
+        ram[0x0005] = 0x01; // ABS LO
+        ram[0x0006] = 0xD0; // ABS HI
+        ram[0x0007] = 0x4C; // JMP
+        ram[0x0008] = 0x01; // ABS LO
+        ram[0x0009] = 0x00; // ABS HI
+        ram[0x0200] = 0xE6; // INC
+        ram[0x0201] = 0x20; // ZPG
+        ram[0x0202] = 0xA9; // LDA
+        ram[0x0203] = 0x01; // IMM
+        ram[0x0204] = 0x8D; // STA
+        ram[0x0205] = 0x01; // ABS LO
+        ram[0x0206] = 0xD0; // ABS HI
+        ram[0x0207] = 0x40; // RTI
+        ram[0x0210] = 0xE6; // INC
+        ram[0x0211] = 0x21; // ZPG
+        ram[0x0212] = 0x40; // RTI
+        ram[0xFFFA] = 0x10;
+        ram[0xFFFB] = 0x02;
+        ram[0xFFFE] = 0x00;
+        ram[0xFFFF] = 0x02;
+    };
+
+    std::stringstream log{};
+    mos6502::Registers recorded_regs{};
+    auto recorded_ram = std::make_unique<std::array<std::uint8_t, 0x10000>>();
+    std::uint64_t recorded_cycles{};
+    {
+        mos6502::EventRecorder recorder{log};
+        auto device = std::make_shared<InterruptingBus>();
+        mos6502::PagedBus bus{recorder.record(device)};
+        load(bus);
+        mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+        device->irq = [&recorder, &cpu](bool const asserted) { recorder.set_irq_line(cpu, asserted, 2U); };
+        for (int i = 0; i < 3000; ++i) {
+            recorder.step(cpu);
+            if (i % 100 == 40) {
+                recorder.set_nmi_line(cpu, true);
+            } else if (i % 100 == 60) {
+                recorder.set_nmi_line(cpu, false);
+            }
+        }
+        recorder.close();
+        recorded_regs = cpu.regs();
+        *recorded_ram = bus.ram();
+        recorded_cycles = recorder.cycles();
+        REQUIRE(bus.ram()[0x20] > 10U);
+        REQUIRE(bus.ram()[0x21] == 30U);
+    }
+
+    std::istringstream in{log.str()};
+    mos6502::EventReplayer replayer{in};
+    mos6502::PagedBus bus{replayer.replay()};
+    load(bus);
+    mos6502::Cpu<mos6502::PagedBus> cpu{bus};
+    REQUIRE(replayer.run(cpu) == recorded_cycles);
+    REQUIRE(replayer.finished());
+    REQUIRE(cpu.regs() == recorded_regs);
+    REQUIRE(bus.ram() == *recorded_ram);
+}
+
+TEST_CASE("Interrupt lines are taken between instructions" ) {
+    struct LineBus final : public mos6502::IBus {
+        std::function<void(bool)> irq{};
+
+        std::uint8_t read(std::uint16_t) override {
+            return 0x00;
+        }
+
+        void write(std::uint16_t, std::uint8_t data) override {
+            irq(data != 0U);
+        }
+    };
+
+    auto const check = [&]<class Traits>() {
+        auto device = std::make_shared<LineBus>();
+        mos6502::PagedBus bus{device};
+        bus.map_io(0xD0, 1U);
+        auto& ram = bus.ram();
+        ram[0x0000] = 0x58; // CLI
+        ram[0x0001] = 0xA9; // LDA
+        ram[0x0002] = 0x01; // IMM
+        ram[0x0003] = 0x8D; // STA
+        ram[0x0004] = 0x00; // ABS LO
+        ram[0x0005] = 0xD0; // ABS HI
+        ram[0x0006] = 0xEA; // NOP
+        ram[0x0007] = 0x4C; // JMP
+        ram[0x0008] = 0x06; // ABS LO
+        ram[0x0009] = 0x00; // ABS HI
+        ram[0x0200] = 0xE6; // INC
+        ram[0x0201] = 0x20; // ZPG
+        ram[0x0202] = 0xA9; // LDA
+        ram[0x0203] = 0x00; // IMM
+        ram[0x0204] = 0x8D; // STA
+        ram[0x0205] = 0x00; // ABS LO
+        ram[0x0206] = 0xD0; // ABS HI
+        ram[0x0207] = 0x40; // RTI
+        ram[0x0210] = 0xE6; // INC
+        ram[0x0211] = 0x21; // ZPG
+        ram[0x0212] = 0x40; // RTI
+        ram[0xFFFA] = 0x10;
+        ram[0xFFFB] = 0x02;
+        ram[0xFFFE] = 0x00;
+        ram[0xFFFF] = 0x02;
+
+        // The device raises the IRQ from the bus, the STA completes before the handler starts
+        mos6502::Cpu<mos6502::PagedBus, Traits> cpu{bus};
+        device->irq = [&cpu](bool asserted) { cpu.set_irq_line(asserted, 1U); };
+        REQUIRE(cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0200; }) == 15U);
+        REQUIRE((cpu.regs().sr & mos6502::I) != 0U);
+        REQUIRE(ram[0x01FF] == 0x00);
+        REQUIRE(ram[0x01FE] == 0x06);
+
+        // The handler releases the line before returning
+        REQUIRE(cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0006; }) == 17U);
+        REQUIRE(cpu.step() == 2U);
+        REQUIRE(ram[0x20] == 0x01);
+
+        // A held line waits for the I flag to clear
+        cpu.regs().sr |= mos6502::I;
+        cpu.set_irq_line(true);
+        REQUIRE(cpu.step() == 3U);
+        REQUIRE(cpu.step() == 2U);
+        cpu.regs().sr &= ~mos6502::I;
+        REQUIRE(cpu.step() == 7U);
+        REQUIRE(cpu.regs().pc == 0x0200);
+        cpu.set_irq_line(false);
+        cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0007; });
+        REQUIRE(ram[0x20] == 0x02);
+
+        // NMI is taken once per rising edge, regardless of the I flag
+        cpu.regs().sr |= mos6502::I;
+        cpu.set_nmi_line(true);
+        REQUIRE(cpu.step() == 7U);
+        REQUIRE(cpu.regs().pc == 0x0210);
+        cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0007; });
+        cpu.set_nmi_line(true);
+        REQUIRE(cpu.run_cycles(20U) < 30U);
+        REQUIRE(ram[0x21] == 0x01);
+        cpu.set_nmi_line(false);
+        cpu.set_nmi_line(true);
+        REQUIRE(cpu.run_cycles(20U) >= 20U);
+        REQUIRE(ram[0x21] == 0x02);
+    };
+
+    check.operator()<mos6502::CpuTraits>();
+    check.operator()<mos6502::ThreadedCpuTraits>();
+    check.operator()<mos6502::BlockCacheCpuTraits>();
+    check.operator()<mos6502::JitCpuTraits>();
+    check.operator()<mos6502::LazyFlagsCpuTraits>();
+}
+
+TEST_CASE("Interrupt lines driven from other threads" ) {
+    constexpr unsigned kPulses{5000U};
+
+    // The handlers acknowledge by writing $D000 (IRQ) or $D001 (NMI)
+    struct AckBus final : public mos6502::IBus {
+        std::function<void(std::uint16_t)> ack{};
+
+        std::uint8_t read(std::uint16_t) override {
+            return 0x00;
+        }
+
+        void write(std::uint16_t addr, std::uint8_t) override {
+            ack(addr);
+        }
+    };
+
+    auto device = std::make_shared<AckBus>();
+    mos6502::PagedBus bus{device};
+    bus.map_io(0xD0, 1U);
+    auto& ram = bus.ram();
+    ram[0x0000] = 0x58; // CLI
+    ram[0x0001] = 0xE6; // INC
+    ram[0x0002] = 0x30; // ZPG
+    ram[0x0003] = 0x4C; // JMP
+    ram[0x0004] = 0x01; // ABS LO
+    ram[0x0005] = 0x00; // ABS HI
+    ram[0x0200] = 0xEE; // INC
+    ram[0x0201] = 0x00; // ABS LO
+    ram[0x0202] = 0x03; // ABS HI
+    ram[0x0203] = 0xD0; // BNE
+    ram[0x0204] = 0x03; // REL
+    ram[0x0205] = 0xEE; // INC
+    ram[0x0206] = 0x01; // ABS LO
+    ram[0x0207] = 0x03; // ABS HI
+    ram[0x0208] = 0x8D; // STA
+    ram[0x0209] = 0x00; // ABS LO
+    ram[0x020A] = 0xD0; // ABS HI
+    ram[0x020B] = 0x40; // RTI
+    ram[0x0210] = 0xEE; // INC
+    ram[0x0211] = 0x02; // ABS LO
+    ram[0x0212] = 0x03; // ABS HI
+    ram[0x0213] = 0xD0; // BNE
+    ram[0x0214] = 0x03; // REL
+    ram[0x0215] = 0xEE; // INC
+    ram[0x0216] = 0x03; // ABS LO
+    ram[0x0217] = 0x03; // ABS HI
+    ram[0x0218] = 0x8D; // STA
+    ram[0x0219] = 0x01; // ABS LO
+    ram[0x021A] = 0xD0; // ABS HI
+    ram[0x021B] = 0x40; // RTI
+    ram[0xFFFA] = 0x10;
+    ram[0xFFFB] = 0x02;
+    ram[0xFFFE] = 0x00;
+    ram[0xFFFF] = 0x02;
+
+    mos6502::Cpu<mos6502::PagedBus, mos6502::ThreadedCpuTraits> cpu{bus};
+    std::atomic<bool> irq_acked{true};
+    std::atomic<bool> nmi_acked{true};
+    std::atomic<bool> done{false};
+    device->ack = [&](std::uint16_t addr) {
+        if (addr == 0xD000) {
+            cpu.set_irq_line(false, 3U);
+            irq_acked.store(true, std::memory_order_release);
+        } else {
+            nmi_acked.store(true, std::memory_order_release);
+        }
+    };
+
+    // Each thread raises its line again once the previous interrupt was acknowledged
+    std::thread irq_thread{[&] {
+        for (unsigned i = 0U; i < kPulses && !done.load(); ++i) {
+            while (!irq_acked.exchange(false, std::memory_order_acquire) && !done.load()) {
+                std::this_thread::yield();
+            }
+            cpu.set_irq_line(true, 3U);
+        }
+    }};
+    std::thread nmi_thread{[&] {
+        for (unsigned i = 0U; i < kPulses && !done.load(); ++i) {
+            while (!nmi_acked.exchange(false, std::memory_order_acquire) && !done.load()) {
+                std::this_thread::yield();
+            }
+            cpu.set_nmi_line(false);
+            cpu.set_nmi_line(true);
+        }
+    }};
+
+    auto const count = [&ram](std::uint16_t addr) { return static_cast<unsigned>(ram[addr] | (ram[addr + 1U] << 8)); };
+    for (unsigned i = 0U; i < 10000000U && (count(0x0300) < kPulses || count(0x0302) < kPulses); ++i) {
+        cpu.run_cycles(500U);
+        std::this_thread::yield();
+    }
+    done.store(true);
+    irq_thread.join();
+    nmi_thread.join();
+
+    REQUIRE(count(0x0300) == kPulses);
+    REQUIRE(count(0x0302) == kPulses);
+    REQUIRE(cpu.regs().sp >= 0x01F0);
+}
+
+TEST_CASE("Scheduler fires events at their cycles" ) {
+    auto bus = std::make_shared<RamBus>();
+    bus->memory[0x0000] = 0xEA; // NOP
+    bus->memory[0x0001] = 0xE6; // INC
+    bus->memory[0x0002] = 0x20; // ZPG
+    bus->memory[0x0003] = 0x4C; // JMP
+    bus->memory[0x0004] = 0x00; // ABS LO
+    bus->memory[0x0005] = 0x00; // ABS HI
+    mos6502::Cpu<RamBus> cpu{bus};
+    mos6502::Scheduler scheduler{};
+
+    // A timer firing every 100 cycles, never more than an instruction late
+    std::vector<std::uint64_t> fired{};
+    std::function<void(std::uint64_t)> timer = [&](std::uint64_t due) {
+        REQUIRE(cpu.cycles() >= due);
+        REQUIRE(cpu.cycles() < due + 5U);
+        fired.push_back(due);
+        scheduler.schedule(due + 100U, timer);
+    };
+    scheduler.schedule(100U, timer);
+
+    std::vector<int> order{};
+    scheduler.schedule(250U, [&order](std::uint64_t) { order.push_back(1); });
+    scheduler.schedule(250U, [&order](std::uint64_t) { order.push_back(2); });
+    auto const cancelled = scheduler.schedule(300U, [&order](std::uint64_t) { order.push_back(3); });
+    REQUIRE(scheduler.pending() == 4U);
+    REQUIRE(scheduler.next_event() == 100U);
+    REQUIRE(scheduler.cancel(cancelled));
+    REQUIRE(!scheduler.cancel(cancelled));
+
+    std::uint64_t const cycles = scheduler.run_cycles(cpu, 1000U);
+    REQUIRE(cycles >= 1000U);
+    REQUIRE(cycles == cpu.cycles());
+    REQUIRE(scheduler.now() == cpu.cycles());
+    REQUIRE(fired == std::vector<std::uint64_t>{100U, 200U, 300U, 400U, 500U, 600U, 700U, 800U, 900U, 1000U});
+    REQUIRE(order == std::vector<int>{1, 2});
+    REQUIRE(scheduler.pending() == 1U);
+    REQUIRE(scheduler.next_event() == 1100U);
+
+    // Runs without events go as far as the budget in one batch
+    REQUIRE(scheduler.run_cycles(cpu, 50U) >= 50U);
+    REQUIRE(fired.size() == 10U);
+
+    // Stepping outside of the scheduler catches up on sync
+    while (cpu.cycles() < 1100U) {
+        cpu.step();
+    }
+    REQUIRE(scheduler.sync(cpu) == 1U);
+    REQUIRE(fired.back() == 1100U);
+}
+
+TEST_CASE("Instrumentation counts the instruction mix" ) {
+    struct CountingBlockCacheCpuTraits : mos6502::BlockCacheCpuTraits {
+        using Instrumentation = mos6502::InstructionCounters;
+    };
+
+    // Sieve of Eratosthenes, primes below 256 are left as zero in $0200-$02FF
+    std::array<std::uint8_t, 41> const program{
+        0xA0, 0x00,       // LDY #$00
+        0xA9, 0x00,       // LDA #$00
+        0x99, 0x00, 0x02, // STA $0200,Y
+        0xC8,             // INY
+        0xD0, 0xFA,       // BNE *-4
+        0xA2, 0x02,       // LDX #$02
+        0xBD, 0x00, 0x02, // LDA $0200,X
+        0xD0, 0x12,       // BNE next
+        0x86, 0xF0,       // STX $F0
+        0x8A,             // TXA
+        0x18,             // CLC
+        0x65, 0xF0,       // ADC $F0
+        0xB0, 0x0A,       // BCS next
+        0xA8,             // TAY
+        0xA9, 0x01,       // LDA #$01
+        0x99, 0x00, 0x02, // STA $0200,Y
+        0x98,             // TYA
+        0x4C, 0x14, 0x00, // JMP $0014
+        0xE8,             // next: INX
+        0xD0, 0xE6,       // BNE $000C
+        0x4C, 0x00, 0x00, // JMP $0000
+    };
+
+    auto const check = [&]<class Traits>() {
+        auto bus = std::make_shared<RamBus>();
+        std::copy(program.begin(), program.end(), bus->memory.begin());
+        mos6502::Cpu<RamBus, Traits> cpu{bus};
+        cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0026; });
+
+        std::size_t primes = 0U;
+        for (std::size_t i = 2U; i < 0x100U; ++i) {
+            primes += bus->memory[0x0200 + i] == 0U ? 1U : 0U;
+        }
+        REQUIRE(primes == 54U);
+
+        mos6502::InstructionStats const& stats = cpu.instruction_stats();
+        REQUIRE(stats.total().cycles == cpu.cycles());
+        REQUIRE(stats.opcode(0xC8).count == 256U);
+        REQUIRE(stats.opcode(0xC8).cycles == 512U);
+        REQUIRE(stats.opcode(0xE8).count == 254U);
+        REQUIRE(stats.opcode(0xBD) == mos6502::InstructionCount{254U, 254U * 4U});
+        REQUIRE(stats.mode(mos6502::AddressMode::AbsoluteX) == stats.opcode(0xBD));
+        REQUIRE(stats.mode(mos6502::AddressMode::AbsoluteY).count == 256U + stats.opcode(0xA8).count);
+        REQUIRE(stats.opcode(0x4C).count == stats.opcode(0xA8).count);
+        REQUIRE(stats.opcode(0x00).count == 0U);
+
+        std::ostringstream out{};
+        stats.dump(out, 3U);
+        std::string const text = out.str();
+        REQUIRE(text.find("$99  STA $nnnn,Y") != std::string::npos);
+        REQUIRE(text.find("$nnnn,X") != std::string::npos);
+        REQUIRE(std::count(text.begin(), text.end(), '\n') == 1 + 3 + 1 + 7);
+
+        cpu.instruction_stats().reset();
+        REQUIRE(cpu.instruction_stats().total() == mos6502::InstructionCount{0U, 0U});
+    };
+
+    check.operator()<mos6502::InstrumentedCpuTraits>();
+    check.operator()<CountingBlockCacheCpuTraits>();
+}
+
+TEST_CASE("SpscRing hands items over between threads" ) {
+    REQUIRE_THROWS_AS(mos6502::SpscRing<std::uint32_t>{0U}, std::invalid_argument);
+
+    mos6502::SpscRing<std::uint32_t> ring{100U};
+    REQUIRE(ring.capacity() == 128U);
+
+    constexpr std::uint32_t kItems{100000U};
+    std::thread producer{[&ring] {
+        std::array<std::uint32_t, 16> batch{};
+        std::uint32_t next = 0U;
+        while (next < kItems) {
+            if (next % 3U == 0U) {
+                if (ring.push(next)) {
+                    ++next;
+                } else {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+            std::size_t const count = std::min<std::size_t>(batch.size(), kItems - next);
+            for (std::size_t i = 0U; i < count; ++i) {
+                batch[i] = next + static_cast<std::uint32_t>(i);
+            }
+            std::size_t const pushed = ring.push(std::span<std::uint32_t const>{batch.data(), count});
+            next += static_cast<std::uint32_t>(pushed);
+            if (pushed == 0U) {
+                std::this_thread::yield();
+            }
+        }
+    }};
+
+    std::array<std::uint32_t, 50> out{};
+    std::uint32_t expected = 0U;
+    bool ordered = true;
+    while (expected < kItems) {
+        std::size_t const count = ring.pop(out);
+        for (std::size_t i = 0U; i < count; ++i) {
+            ordered = ordered && out[i] == expected;
+            ++expected;
+        }
+        if (count == 0U) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    REQUIRE(ordered);
+    REQUIRE(ring.size() == 0U);
+}
+
+TEST_CASE("SymbolTable loads VICE and ca65 labels" ) {
+    mos6502::SymbolTable vice{};
+    std::istringstream labels{
+        "al C:c000 .reset\n"
+        "al C:c010 .main\n"
+        "al C:c100 .irq\n"
+        "break c000\n"
+        "al 0020 .loop\n"};
+    REQUIRE(vice.load_vice_labels(labels) == 4U);
+    REQUIRE(vice.resolve(0x001F) == nullptr);
+    REQUIRE(vice.resolve(0xC00F)->name == "reset");
+    REQUIRE(vice.routine(0xC0FF) == "main");
+    REQUIRE(vice.routine(0x0010) == "$0010");
+    REQUIRE(vice.describe(0xC010) == "main");
+    REQUIRE(vice.describe(0xC012) == "main+$2");
+    REQUIRE(vice.describe(0xC1AB) == "irq+$AB");
+    REQUIRE(vice.describe(0x0001) == "$0001");
+
+    std::istringstream malformed{"al C:c0z0 .bad\n"};
+    REQUIRE_THROWS_AS(vice.load_vice_labels(malformed), std::invalid_argument);
+
+    mos6502::SymbolTable ca65{};
+    std::istringstream dbg{
+        "version\tmajor=2,minor=0\n"
+        "info\tcsym=0,file=1,lib=0,line=4,mod=1,scope=1,seg=2,span=3,sym=4,type=1\n"
+        "seg\tid=0,name=\"CODE\",start=0x008000,size=0x0040,addrsize=absolute,type=ro\n"
+        "sym\tid=0,name=\"reset\",addrsize=absolute,scope=0,def=1,ref=2,val=0x8000,seg=0,type=lab\n"
+        "sym\tid=1,name=\"PTR\",addrsize=zeropage,scope=0,def=3,val=0xF0,type=equ\n"
+        "sym\tid=2,name=\"copy\",addrsize=absolute,scope=0,def=4,val=0x8020,seg=0,type=lab\n"
+        "sym\tid=3,name=\"print\",addrsize=absolute,scope=0,def=5,type=imp,exp=0\n"};
+    REQUIRE(ca65.load_ca65_dbg(dbg) == 2U);
+    REQUIRE(ca65.size() == 2U);
+    REQUIRE(ca65.routine(0x00F0) == "$00F0");
+    REQUIRE(ca65.describe(0x801F) == "reset+$1F");
+    REQUIRE(ca65.describe(0x8020) == "copy");
+
+    ca65.add(0x8020, "copy_bytes");
+    REQUIRE(ca65.size() == 2U);
+    REQUIRE(ca65.routine(0x8030) == "copy_bytes");
+}
+
+TEST_CASE("PcSampler profiles the guest program" ) {
+    REQUIRE_THROWS_AS(mos6502::PcSampler{0U}, std::invalid_argument);
+
+    // Sieve of Eratosthenes, primes below 256 are left as zero in $0200-$02FF
+    std::array<std::uint8_t, 41> const program{
+        0xA0, 0x00,       // clear: LDY #$00
+        0xA9, 0x00,       // LDA #$00
+        0x99, 0x00, 0x02, // STA $0200,Y
+        0xC8,             // INY
+        0xD0, 0xFA,       // BNE *-4
+        0xA2, 0x02,       // LDX #$02
+        0xBD, 0x00, 0x02, // scan: LDA $0200,X
+        0xD0, 0x12,       // BNE next
+        0x86, 0xF0,       // STX $F0
+        0x8A,             // TXA
+        0x18,             // mark: CLC
+        0x65, 0xF0,       // ADC $F0
+        0xB0, 0x0A,       // BCS next
+        0xA8,             // TAY
+        0xA9, 0x01,       // LDA #$01
+        0x99, 0x00, 0x02, // STA $0200,Y
+        0x98,             // TYA
+        0x4C, 0x14, 0x00, // JMP mark
+        0xE8,             // next: INX
+        0xD0, 0xE6,       // BNE scan
+        0x4C, 0x00, 0x00, // JMP clear
+    };
+    mos6502::SymbolTable symbols{};
+    std::istringstream labels{"al C:0000 .clear\nal C:000c .scan\nal C:0014 .mark\nal C:0023 .next\n"};
+    symbols.load_vice_labels(labels);
+
+    auto bus = std::make_shared<RamBus>();
+    std::copy(program.begin(), program.end(), bus->memory.begin());
+    mos6502::Cpu<RamBus> cpu{bus};
+
+    mos6502::PcSampler sampler{7U};
+    std::uint64_t const cycles = sampler.run_cycles(cpu, 100000U);
+    REQUIRE(cycles >= 100000U);
+    REQUIRE(sampler.collect() == cycles / 7U);
+    REQUIRE(sampler.total() == cycles / 7U);
+    REQUIRE(sampler.dropped() == 0U);
+    REQUIRE(sampler.samples(0x0014) + sampler.samples(0x0015) > 0U);
+    REQUIRE(sampler.samples(0x0030) == 0U);
+
+    std::ostringstream report{};
+    sampler.write_report(report, symbols);
+    std::string const text = report.str();
+    REQUIRE(text.starts_with("samples   share  routine\n"));
+    REQUIRE(text.find("%  mark\n") < text.find("%  scan\n"));
+    REQUIRE(text.find("%  clear\n") != std::string::npos);
+    REQUIRE(text.find(" dropped\n") != std::string::npos);
+
+    std::ostringstream folded{};
+    sampler.write_folded(folded, symbols);
+    std::istringstream lines{folded.str()};
+    std::string name{};
+    std::uint64_t count = 0U;
+    std::uint64_t sum = 0U;
+    lines >> name >> count;
+    REQUIRE(name == "mark");
+    sum += count;
+    while (lines >> name >> count) {
+        sum += count;
+    }
+    REQUIRE(sum == sampler.total());
+
+    sampler.reset();
+    REQUIRE(sampler.total() == 0U);
+
+    // Through the scheduler, samples are dropped while not collected
+    mos6502::PcSampler small{100U, 4U};
+    mos6502::Scheduler scheduler{};
+    scheduler.sync(cpu);
+    small.attach(scheduler, cpu);
+    scheduler.run_cycles(cpu, 1000U);
+    REQUIRE(small.dropped() == 6U);
+    REQUIRE(small.collect() == 4U);
+    small.detach();
+    REQUIRE(scheduler.pending() == 0U);
+    scheduler.run_cycles(cpu, 1000U);
+    REQUIRE(small.collect() == 0U);
+
+    // Destroying an attached sampler cancels its event
+    {
+        mos6502::PcSampler scoped{100U};
+        scoped.attach(scheduler, cpu);
+        REQUIRE(scheduler.pending() == 1U);
+    }
+    REQUIRE(scheduler.pending() == 0U);
+    scheduler.run_cycles(cpu, 1000U);
+}
+
+TEST_CASE("Call stack tracks subroutines and interrupts" ) {
+    struct CallStackBlockCacheCpuTraits : mos6502::BlockCacheCpuTraits {
+        using Instrumentation = mos6502::CallStackTracking;
+    };
+    struct CallStackSwitchCpuTraits : mos6502::CpuTraits {
+        using Instrumentation = mos6502::CallStackTracking;
+    };
+
+    mos6502::SymbolTable symbols{};
+    symbols.add(0x0010, "outer");
+    symbols.add(0x0020, "inner");
+    symbols.add(0x0030, "irq");
+
+    auto const check = [&]<class Traits>() {
+        auto bus = std::make_shared<RamBus>();
+        auto const load = [&bus](std::uint16_t addr, std::initializer_list<std::uint8_t> code) {
+            std::copy(code.begin(), code.end(), bus->memory.begin() + addr);
+        };
+        load(0x0000, {0x20, 0x10, 0x00,   // JSR outer
+                      0x20, 0x20, 0x00,   // JSR inner
+                      0x4C, 0x00, 0x00}); // JMP $0000
+        load(0x0010, {0x20, 0x20, 0x00,   // outer: JSR inner
+                      0xEA,               // NOP
+                      0x60});             // RTS
+        load(0x0020, {0xA2, 0x03,         // inner: LDX #$03
+                      0xCA,               // DEX
+                      0xD0, 0xFD,         // BNE *-1
+                      0x60});             // RTS
+        load(0x0030, {0x20, 0x20, 0x00,   // irq: JSR inner
+                      0x40});             // RTI
+        load(0xFFFE, {0x30, 0x00});
+        mos6502::Cpu<RamBus, Traits> cpu{bus};
+        mos6502::CallStack& calls = cpu.call_stack();
+
+        cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0013; });
+        REQUIRE(calls.frames() == std::vector<std::uint16_t>{0x0010});
+        cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0006; });
+        REQUIRE(calls.now() == cpu.cycles());
+        REQUIRE(calls.now() == 66U);
+        REQUIRE(calls.frames().empty());
+        REQUIRE(calls.routines() == std::vector<mos6502::RoutineCycles>{
+            {0x0020, 2U, 40U, 40U},
+            {0x0010, 1U, 34U, 14U},
+        });
+
+        std::ostringstream folded{};
+        calls.write_folded(folded, symbols);
+        REQUIRE(folded.str() == "[top] 12\nouter 14\nouter;inner 20\ninner 20\n");
+
+        std::ostringstream report{};
+        calls.write_report(report, symbols, 1U);
+        REQUIRE(report.str().find("inner\n") != std::string::npos);
+        REQUIRE(report.str().find("outer") == std::string::npos);
+
+        calls.reset();
+        REQUIRE(calls.routines().empty());
+        cpu.set_irq_line(true);
+        REQUIRE(cpu.step() == 7U);
+        cpu.set_irq_line(false);
+        REQUIRE(calls.frames() == std::vector<std::uint16_t>{0x0030});
+        cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0006; });
+        REQUIRE(calls.frames().empty());
+        REQUIRE(calls.routines() == std::vector<mos6502::RoutineCycles>{
+            {0x0030, 1U, 39U, 19U},
+            {0x0020, 1U, 20U, 20U},
+        });
+
+        // Routines still running count up to now
+        cpu.run_until([](mos6502::Registers const& regs) { return regs.pc == 0x0013; });
+        std::vector<mos6502::RoutineCycles> const running = calls.routines();
+        REQUIRE(running.size() == 3U);
+        REQUIRE(std::find(running.begin(), running.end(), mos6502::RoutineCycles{0x0010, 1U, 26U, 6U}) != running.end());
+    };
+
+    check.operator()<mos6502::CallStackCpuTraits>();
+    check.operator()<CallStackBlockCacheCpuTraits>();
+    check.operator()<CallStackSwitchCpuTraits>();
+
+    // Returns match frames by stack pointer
+    mos6502::CallStack calls{};
+    calls.enter(0x1000, 0xFF);
+    calls.enter(0x2000, 0xFD);
+    calls.leave(0xF9);
+    REQUIRE(calls.frames() == std::vector<std::uint16_t>{0x1000, 0x2000});
+    calls.enter(0x3000, 0xFF);
+    REQUIRE(calls.frames() == std::vector<std::uint16_t>{0x3000});
+    calls.leave(0xFF);
+    REQUIRE(calls.frames().empty());
+    calls.leave(0xFF);
+    REQUIRE(calls.routines().size() == 3U);
+}
+
+TEST_CASE("Trace records every instruction" ) {
+    // Sieve of Eratosthenes, primes below 256 are left as zero in $0200-$02FF
+    std::array<std::uint8_t, 41> const program{
+        0xA0, 0x00, 0xA9, 0x00, 0x99, 0x00, 0x02, 0xC8, 0xD0, 0xFA, 0xA2, 0x02, 0xBD, 0x00,
+        0x02, 0xD0, 0x12, 0x86, 0xF0, 0x8A, 0x18, 0x65, 0xF0, 0xB0, 0x0A, 0xA8, 0xA9, 0x01,
+        0x99, 0x00, 0x02, 0x98, 0x4C, 0x14, 0x00, 0xE8, 0xD0, 0xE6, 0x4C, 0x00, 0x00,
+    };
+
+    auto const record = [&](bool compress) {
+        auto bus = std::make_shared<RamBus>();
+        std::copy(program.begin(), program.end(), bus->memory.begin());
+        mos6502::Cpu<RamBus, mos6502::TracingCpuTraits> cpu{bus};
+        cpu.run_cycles(100U);
+
+        std::ostringstream out{};
+        mos6502::TraceWriter writer{out, compress, 1U << 16};
+        cpu.trace_to(&writer);
+        std::uint64_t const start = cpu.cycles();
+        std::uint64_t instructions = 0U;
+        while (cpu.regs().pc != 0x0026) {
+            cpu.step();
+            ++instructions;
+        }
+        cpu.trace_to(nullptr);
+        cpu.run_cycles(100U);
+        writer.close();
+        REQUIRE(writer.dropped() == 0U);
+
+        std::istringstream in{out.str()};
+        mos6502::TraceReader reader{in};
+        std::vector<mos6502::TraceRecord> records{};
+        while (std::optional<mos6502::TraceRecord> const next = reader.next()) {
+            records.push_back(*next);
+        }
+        REQUIRE(!reader.next());
+        REQUIRE(records.size() == instructions);
+        REQUIRE(records.front().cycle == start);
+        REQUIRE(records.back().pc == 0x0024);
+        REQUIRE(records.back().cycle < cpu.cycles());
+        return std::make_pair(records, out.str().size());
+    };
+
+    auto const [records, raw_size] = record(false);
+    auto const [packed, packed_size] = record(true);
+    REQUIRE(records == packed);
+    REQUIRE(packed_size * 2U < raw_size);
+
+    auto const store = std::find_if(records.begin(), records.end(), [](mos6502::TraceRecord const& entry) {
+        return entry.opcode == 0x99 && entry.yi == 0x04;
+    });
+    REQUIRE(store != records.end());
+    REQUIRE(store->writes == 1U);
+    REQUIRE(store->addr[0] == 0x0204);
+    REQUIRE(store->value[0] == store->ac);
+    REQUIRE((store + 1)->cycle == store->cycle + 5U);
+    REQUIRE((store + 1)->writes == 0U);
+
+    // A ring smaller than the run makes the Cpu wait for the writer, or drop records when asked
+    for (mos6502::TraceOverflow const overflow : {mos6502::TraceOverflow::Wait, mos6502::TraceOverflow::Drop}) {
+        auto bus = std::make_shared<RamBus>();
+        std::copy(program.begin(), program.end(), bus->memory.begin());
+        mos6502::Cpu<RamBus, mos6502::TracingCpuTraits> cpu{bus};
+        std::ostringstream out{};
+        mos6502::TraceWriter writer{out, true, 4U, overflow};
+        cpu.trace_to(&writer);
+        for (std::size_t i = 0U; i < records.size(); ++i) {
+            cpu.step();
+        }
+        cpu.trace_to(nullptr);
+        writer.close();
+
+        std::istringstream in{out.str()};
+        mos6502::TraceReader reader{in};
+        std::size_t count = 0U;
+        while (reader.next()) {
+            ++count;
+        }
+        REQUIRE(count + writer.dropped() == records.size());
+        if (overflow == mos6502::TraceOverflow::Wait) {
+            REQUIRE(writer.dropped() == 0U);
+        } else {
+            REQUIRE(writer.waits() == 0U);
+        }
+    }
+
+    std::istringstream garbage{"M65E\x01"};
+    REQUIRE_THROWS_AS(mos6502::TraceReader{garbage}, std::invalid_argument);
+}
+
+TEST_CASE("Trace records every byte written and the interrupts entered" ) {
+    auto bus = std::make_shared<RamBus>();
+    std::array<std::uint8_t, 9> const program{
+        0x20, 0x10, 0x00, // JSR $0010
+        0xEE, 0x00, 0x03, // INC $0300
+        0x00, 0x00,       // BRK
+        0x60,             // RTS at $0008, unused
+    };
+    std::copy(program.begin(), program.end(), bus->memory.begin());
+    bus->memory[0x0010] = 0x60; // RTS
+    bus->memory[0x0020] = 0x4C; // JMP $0020
+    bus->memory[0x0021] = 0x20;
+    bus->memory[0x0030] = 0x58; // CLI
+    bus->memory[0x0031] = 0x4C; // JMP $0031
+    bus->memory[0x0032] = 0x31;
+    bus->memory[0x0300] = 0x41;
+    bus->memory[0xFFFA] = 0x30;
+    bus->memory[0xFFFE] = 0x20;
+    mos6502::Cpu<RamBus, mos6502::TracingCpuTraits> cpu{bus};
+
+    std::ostringstream out{};
+    mos6502::TraceWriter writer{out, false, 64U, mos6502::TraceOverflow::Wait};
+    cpu.trace_to(&writer);
+    for (int i = 0; i < 5; ++i) {
+        cpu.step(); // JSR, RTS, INC, BRK, JMP
+    }
+    cpu.set_nmi_line(true);
+    cpu.step();
+    cpu.step(); // CLI
+    cpu.signal_irq();
+    cpu.trace_to(nullptr);
+    writer.close();
+
+    std::istringstream in{out.str()};
+    mos6502::TraceReader reader{in};
+    std::vector<mos6502::TraceRecord> records{};
+    while (std::optional<mos6502::TraceRecord> const next = reader.next()) {
+        records.push_back(*next);
+    }
+    REQUIRE(records.size() == 8U);
+
+    mos6502::TraceRecord const& jsr = records[0];
+    REQUIRE(jsr.writes == 2U);
+    REQUIRE(jsr.addr == std::array<std::uint16_t, 3>{0x01FF, 0x01FE, 0x0000});
+    REQUIRE(jsr.value == std::array<std::uint8_t, 3>{0x00, 0x03, 0x00});
+    REQUIRE(records[1].writes == 0U);
+    REQUIRE(records[2].writes == 1U);
+    REQUIRE(records[2].addr[0] == 0x0300);
+    REQUIRE(records[2].value[0] == 0x42);
+
+    mos6502::TraceRecord const& brk = records[3];
+    REQUIRE(brk.entry == mos6502::TraceEntry::Instruction);
+    REQUIRE(brk.writes == 3U);
+    REQUIRE(brk.addr == std::array<std::uint16_t, 3>{0x01FF, 0x01FE, 0x01FD});
+    REQUIRE(brk.value[0] == 0x00);
+    REQUIRE(brk.value[1] == 0x08);
+    REQUIRE((brk.value[2] & mos6502::B) != 0U);
+
+    // The NMI is taken before the next instruction and carries its pushes
+    mos6502::TraceRecord const& nmi = records[5];
+    REQUIRE(nmi.entry == mos6502::TraceEntry::Nmi);
+    REQUIRE(nmi.pc == 0x0020);
+    REQUIRE(nmi.operand_lo == 0xFA);
+    REQUIRE(nmi.operand_hi == 0xFF);
+    REQUIRE(nmi.cycle == records[4].cycle + 3U);
+    REQUIRE(nmi.writes == 3U);
+    REQUIRE(nmi.addr == std::array<std::uint16_t, 3>{0x01FC, 0x01FB, 0x01FA});
+    REQUIRE(nmi.value[1] == 0x20);
+    REQUIRE((nmi.value[2] & mos6502::B) == 0U);
+    REQUIRE(records[6].pc == 0x0030);
+    REQUIRE(records[6].cycle == nmi.cycle + 7U);
+    mos6502::TraceRecord const& irq = records[7];
+    REQUIRE(irq.entry == mos6502::TraceEntry::Irq);
+    REQUIRE(irq.pc == 0x0031);
+    REQUIRE(irq.operand_lo == 0xFE);
+    REQUIRE(irq.writes == 3U);
+    REQUIRE(irq.cycle == records[6].cycle + 2U);
+
+    REQUIRE(mos6502::format_trace(nmi, mos6502::TraceFormat::Nintendulator)
+                .starts_with("0020" + std::string(12U, ' ') + "NMI "));
+    REQUIRE(mos6502::format_trace(irq, mos6502::TraceFormat::Vice)
+                .starts_with(".C:0031" + std::string(12U, ' ') + "IRQ "));
+
+    // Traces of version 1 kept the last byte written and counted cycles from each block
+    std::string v1{"M65T\x01"};
+    auto const put_block = [&v1](std::uint8_t const cycle, std::uint8_t const written) {
+        v1 += std::string{"\x01\x00\x00\x00\x18\x00\x00\x00\x00", 9U};
+        std::string record(24U, '\0');
+        record[0] = static_cast<char>(cycle);
+        record[8] = '\x00';
+        record[9] = '\x02';
+        record[10] = '\x8D';
+        record[18] = '\x34';
+        record[19] = '\x12';
+        record[20] = '\x56';
+        record[21] = static_cast<char>(written);
+        v1 += record;
+    };
+    put_block(7U, 1U);
+    put_block(9U, 0U);
+    v1 += std::string(9U, '\0');
+    std::istringstream old{v1};
+    mos6502::TraceReader old_reader{old};
+    std::optional<mos6502::TraceRecord> const first = old_reader.next();
+    REQUIRE(first);
+    REQUIRE(first->cycle == 7U);
+    REQUIRE(first->pc == 0x0200);
+    REQUIRE(first->writes == 1U);
+    REQUIRE(first->addr[0] == 0x1234);
+    REQUIRE(first->value[0] == 0x56);
+    std::optional<mos6502::TraceRecord> const second = old_reader.next();
+    REQUIRE(second);
+    REQUIRE(second->cycle == 9U);
+    REQUIRE(second->writes == 0U);
+    REQUIRE(!old_reader.next());
+}
+
+TEST_CASE("Trace compression and text formats" ) {
+    std::vector<std::uint8_t> data(20000U);
+    std::uint32_t seed = 1U;
+    for (std::size_t i = 0U; i < data.size(); ++i) {
+        seed = seed * 1103515245U + 12345U;
+        data[i] = i < 10000U ? static_cast<std::uint8_t>(seed >> 24) : static_cast<std::uint8_t>(i % 7U);
+    }
+    std::vector<std::uint8_t> packed{};
+    mos6502::lz_compress(data.data(), data.size(), packed);
+    REQUIRE(packed.size() < 10200U);
+    std::vector<std::uint8_t> unpacked(data.size());
+    mos6502::lz_decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+    REQUIRE(unpacked == data);
+    REQUIRE_THROWS_AS(mos6502::lz_decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size() - 1U),
+                      std::invalid_argument);
+    packed.resize(packed.size() / 2U);
+    REQUIRE_THROWS_AS(mos6502::lz_decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size()),
+                      std::invalid_argument);
+
+    constexpr mos6502::TraceEntry kInstruction = mos6502::TraceEntry::Instruction;
+    mos6502::TraceRecord jump{7U, 0xC000, 0x4C, 0xF5, 0xC5, 0x00, 0x01, 0x02, 0x24, 0xFD, kInstruction, 0U, {}, {}, {}};
+    REQUIRE(mos6502::format_trace(jump, mos6502::TraceFormat::Nintendulator) ==
+            "C000  4C F5 C5  JMP $C5F5                       A:00 X:01 Y:02 P:24 SP:FD CYC:7");
+    REQUIRE(mos6502::format_trace(jump, mos6502::TraceFormat::Vice) ==
+            ".C:c000  4C F5 C5  JMP $C5F5      - A:00 X:01 Y:02 SP:fd ..-..I..       7");
+
+    mos6502::TraceRecord branch{1234U, 0xE5D1, 0xD0, 0xFA, 0x00, 0x00, 0x00, 0x0A, 0xA3, 0xF3, kInstruction, 0U, {}, {}, {}};
+    REQUIRE(mos6502::format_trace(branch, mos6502::TraceFormat::Vice) ==
+            ".C:e5d1  D0 FA     BNE $E5CD      - A:00 X:00 Y:0A SP:f3 N.-...ZC    1234");
+    mos6502::TraceRecord indirect{0U, 0x0200, 0xB1, 0x12, 0x00, 0x00, 0x00, 0x00, 0x20, 0xFF, kInstruction, 0U, {}, {}, {}};
+    REQUIRE(mos6502::format_trace(indirect, mos6502::TraceFormat::Nintendulator).starts_with("0200  B1 12     LDA ($12),Y "));
+    mos6502::TraceRecord implied{0U, 0x0300, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0xFF, kInstruction, 0U, {}, {}, {}};
+    REQUIRE(mos6502::format_trace(implied, mos6502::TraceFormat::Nintendulator).starts_with("0300  0A        ASL A "));
+}
+
+TEST_CASE("Timeline records frames, interrupts and device events" ) {
+    mos6502::TimelineTracer timeline{64U};
+    REQUIRE(timeline.capacity() == 64U);
+
+    // 10 cycles per frame of 10ms
+    mos6502::ClockSync syncer{1000U, 100U, mos6502::ClockSync::SyncPrecision::High};
+    syncer.set_timeline(&timeline);
+    for (int frame = 0; frame < 3; ++frame) {
+        syncer.elapse(10U);
+    }
+    REQUIRE(syncer.frame_count() == 3U);
+    REQUIRE(timeline.events().size() == 6U);
+    std::uint64_t busy = 0U;
+    std::uint64_t idle = 0U;
+    for (std::size_t i = 0U; i < 6U; ++i) {
+        mos6502::TimelineEvent const& event = timeline.events()[i];
+        REQUIRE(event.track == mos6502::TimelineTrack::Frames);
+        REQUIRE(event.arg == i / 2U + 1U);
+        REQUIRE(std::string_view{event.name} == (i % 2U == 0U ? "busy" : "idle"));
+        (i % 2U == 0U ? busy : idle) += event.duration;
+        if (i != 0U) {
+            REQUIRE(event.start == timeline.events()[i - 1U].start + timeline.events()[i - 1U].duration);
+        }
+    }
+    REQUIRE(busy == syncer.busy_period());
+    REQUIRE(idle == syncer.idle_period());
+    REQUIRE(syncer.timestamp_of_last_frame() - syncer.timestamp_of_first_frame() >= 20'000'000U);
+
+    auto bus = std::make_shared<RamBus>();
+    bus->memory[0x0000] = 0x4C; // JMP $0000
+    bus->memory[0xFFFE] = 0x00;
+    bus->memory[0xFFFF] = 0x80;
+    bus->memory[0x8000] = 0x40; // RTI
+    mos6502::Cpu<RamBus> cpu{bus};
+    cpu.trace_timeline(&timeline);
+    mos6502::Scheduler scheduler{};
+    scheduler.set_timeline(&timeline);
+    scheduler.schedule(30U, [&cpu](std::uint64_t) { cpu.set_irq_line(true); }, "raise \"irq\"");
+    scheduler.schedule(40U, [&cpu](std::uint64_t) { cpu.set_irq_line(false); });
+    scheduler.schedule(50U, [](std::uint64_t) {}, nullptr);
+    scheduler.run_cycles(cpu, 100U);
+
+    std::span<mos6502::TimelineEvent const> const events = timeline.events().subspan(6U);
+    REQUIRE(events.size() == 4U);
+    REQUIRE(events[0].track == mos6502::TimelineTrack::Devices);
+    REQUIRE(events[0].arg == 30U);
+    REQUIRE(events[1].track == mos6502::TimelineTrack::Cpu);
+    REQUIRE(events[1].instant);
+    REQUIRE(std::string_view{events[1].name} == "IRQ");
+    REQUIRE(events[1].arg == 0x8000);
+    REQUIRE(std::string_view{events[2].name} == "event");
+    REQUIRE(events[2].arg == 40U);
+    REQUIRE(events[3].name == nullptr);
+
+    std::ostringstream out{};
+    timeline.flush(out);
+    REQUIRE(timeline.events().empty());
+    for (std::size_t i = 0U; i < 60U; ++i) {
+        timeline.span("late", mos6502::TimelineTrack::Frames, 0U, 1U);
+    }
+    REQUIRE(timeline.dropped() == 0U);
+    for (std::size_t i = 0U; i < 10U; ++i) {
+        timeline.instant("lost", mos6502::TimelineTrack::Cpu);
+    }
+    REQUIRE(timeline.dropped() == 6U);
+    timeline.finish(out);
+
+    std::string const json = out.str();
+    REQUIRE(json.starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+    REQUIRE(json.ends_with("}\n]}\n"));
+    REQUIRE(json.find(R"({"name":"thread_name","ph":"M","pid":1,"tid":1,"args":{"name":"frames"}})") != std::string::npos);
+    REQUIRE(json.find(R"({"name":"busy","cat":"frames","ph":"X","pid":1,"tid":1,"ts":)") != std::string::npos);
+    REQUIRE(json.find(R"("name":"raise \"irq\"","cat":"devices")") != std::string::npos);
+    REQUIRE(json.find(R"("ph":"i","s":"t","pid":1,"tid":2,)") != std::string::npos);
+    REQUIRE(json.find(R"("args":{"pc":32768}})") != std::string::npos);
+    REQUIRE(json.find(R"({"name":"event","cat":"devices","ph":"X","pid":1,"tid":3,)") != std::string::npos);
+    REQUIRE(static_cast<std::size_t>(std::count(json.begin(), json.end(), '\n')) == 1U + 4U + 10U + 64U + 1U);
+}
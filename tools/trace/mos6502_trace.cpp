@@ -0,0 +1,54 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+#include "mos6502/trace.hpp"
+#include "mos6502/variant.hpp"
+
+static int usage() {
+    std::cerr << "usage: mos6502_trace [--vice] [--2a03|--65c02] <trace>\n"
+                 "Print a trace of TraceWriter as text, Nintendulator layout unless --vice\n";
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    mos6502::TraceFormat format = mos6502::TraceFormat::Nintendulator;
+    std::array<mos6502::OpcodeInfo, 256> const* opcodes = &mos6502::Nmos6502::kOpcodes;
+    char const* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view const arg{argv[i]};
+        if (arg == "--vice") {
+            format = mos6502::TraceFormat::Vice;
+        } else if (arg == "--2a03") {
+            opcodes = &mos6502::Ricoh2A03::kOpcodes;
+        } else if (arg == "--65c02") {
+            opcodes = &mos6502::Cmos65C02::kOpcodes;
+        } else if (path == nullptr && !arg.starts_with("--")) {
+            path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (path == nullptr) {
+        return usage();
+    }
+
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        std::cerr << "cannot open " << path << '\n';
+        return 1;
+    }
+    try {
+        mos6502::TraceReader reader{in};
+        while (std::optional<mos6502::TraceRecord> const record = reader.next()) {
+            std::cout << mos6502::format_trace(*record, format, *opcodes) << '\n';
+        }
+    } catch (std::exception const& error) {
+        std::cout.flush();
+        std::cerr << path << ": " << error.what() << '\n';
+        return 1;
+    }
+    return 0;
+}